@@ -1,30 +1,31 @@
 #include "ini_file.h"
-#include <stddef.h>   // for NULL, size_t
-#include <stdint.h>   // for int32_t
-#include <stdio.h>    // for snprintf
-#include <stdlib.h>   // for free, calloc
-#include <string.h>   // for strnlen, strndup
-#include <strings.h>  // for strncasecmp
+#include <stddef.h>            // for NULL, size_t
+#include <stdint.h>            // for int32_t
+#include <stdio.h>             // for snprintf
+#include <stdlib.h>            // for free, calloc
+#include <string.h>            // for strnlen, strndup
+#include <strings.h>           // for strncasecmp
+#include "pdf2laser_memory.h"  // for memory_calloc, memory_free, memory_free_string, memory_strndup, MEMORY_INI
 
 ini_entry_t *ini_entry_create(char *key, char *value)
 {
-	ini_entry_t *ini_entry = calloc(1, sizeof(ini_entry_t));
-	ini_entry->key = strndup(key, MAX_FIELD_LENGTH);
-	ini_entry->value = strndup(value, MAX_FIELD_LENGTH);
+	ini_entry_t *ini_entry = memory_calloc(MEMORY_INI, 1, sizeof(ini_entry_t));
+	ini_entry->key = memory_strndup(MEMORY_INI, key, MAX_FIELD_LENGTH);
+	ini_entry->value = memory_strndup(MEMORY_INI, value, MAX_FIELD_LENGTH);
 	return ini_entry;
 }
 
 ini_section_t *ini_section_create(char *name)
 {
-	ini_section_t *ini_section = calloc(1, sizeof(ini_section_t));
-	ini_section->name = strndup(name, MAX_FIELD_LENGTH);
+	ini_section_t *ini_section = memory_calloc(MEMORY_INI, 1, sizeof(ini_section_t));
+	ini_section->name = memory_strndup(MEMORY_INI, name, MAX_FIELD_LENGTH);
 	return ini_section;
 }
 
 ini_file_t *ini_file_create(char *path)
 {
-	ini_file_t *ini_file = calloc(1, sizeof(ini_file_t));
-	ini_file->path = strndup(path, MAX_FIELD_LENGTH);
+	ini_file_t *ini_file = memory_calloc(MEMORY_INI, 1, sizeof(ini_file_t));
+	ini_file->path = memory_strndup(MEMORY_INI, path, MAX_FIELD_LENGTH);
 	return ini_file;
 }
 
@@ -33,9 +34,9 @@ ini_entry_t *ini_entry_destroy(ini_entry_t *self)
 	if (self == NULL)
 		return NULL;
 
-	free(self->key);
-	free(self->value);
-	free(self);
+	memory_free_string(MEMORY_INI, self->key);
+	memory_free_string(MEMORY_INI, self->value);
+	memory_free(MEMORY_INI, self, sizeof(ini_entry_t));
 
 	return NULL;
 }
@@ -45,7 +46,7 @@ ini_section_t *ini_section_destroy(ini_section_t *self)
 	if (self == NULL)
 		return NULL;
 
-	free(self->name);
+	memory_free_string(MEMORY_INI, self->name);
 
 	size_t entry_count = 0;
 	for (ini_entry_t *entry = self->entries; entry != NULL; entry = entry->next) {
@@ -63,7 +64,7 @@ ini_section_t *ini_section_destroy(ini_section_t *self)
 		ini_entry_destroy(entries[index]);
 	}
 
-	free(self);
+	memory_free(MEMORY_INI, self, sizeof(ini_section_t));
 
 	return NULL;
 }
@@ -73,7 +74,7 @@ ini_file_t *ini_file_destroy(ini_file_t *self)
 	if (self == NULL)
 		return NULL;
 
-	free(self->path);
+	memory_free_string(MEMORY_INI, self->path);
 
 	size_t section_count = 0;
 	for (ini_section_t *section = self->sections; section != NULL; section = section->next) {
@@ -91,7 +92,7 @@ ini_file_t *ini_file_destroy(ini_file_t *self)
 		ini_section_destroy(sections[index]);
 	}
 
-	free(self);
+	memory_free(MEMORY_INI, self, sizeof(ini_file_t));
 
 	return NULL;
 }
@@ -0,0 +1,648 @@
+#include "libpdf2laser.h"
+#include <fcntl.h>                    // for open, O_CREAT, O_EXCL, O_RDONLY, O_WRONLY
+#include <libgen.h>                   // for basename
+#include <math.h>                     // for lround
+#include <stdbool.h>                  // for bool, false, true
+#include <stddef.h>                   // for NULL, size_t
+#include <stdint.h>                   // for int32_t, uint32_t, uint8_t
+#include <stdio.h>                    // for printf
+#include <stdlib.h>                   // for calloc, free, mkdtemp
+#include <string.h>                   // for memcpy, strchr, strndup, strrchr
+#include <sys/stat.h>                 // for fstat, stat
+#include <unistd.h>                   // for access, close, read, rmdir, unlink, write, ssize_t, R_OK
+#include "config.h"                   // for FILENAME_NCHARS, HOSTNAME_NCHARS, TMP_DIRECTORY
+#include "pdf2laser_generator.h"      // for generate_pjl
+#include "pdf2laser_printer.h"        // for printer_transfer_to_string
+#include "pdf2laser_render.h"         // for render_source
+#include "pdf2laser_sender.h"         // for sender_create, sender_destroy, sender_run, sender_t
+#include "pdf2laser_util.h"           // for pdf2laser_format_string, pdf2laser_sendfile
+#include "type_preset.h"              // for preset_apply_to_print_job, preset_create, preset_destroy, preset_parse, preset_t
+#include "type_preset_file.h"         // for preset_file_create, preset_file_destroy, preset_file_t
+#include "type_print_job.h"           // for print_job_t, print_job_append_new_vector_list_config, print_job_clone_last_vector_list_config, print_job_create, print_job_destroy, print_job_find_vector_list_config_by_rgb, print_job_range_check, print_job_mode, PRINT_JOB_MODE_RASTER, PRINT_JOB_MODE_VECTOR, PRINT_JOB_MODE_COMBINED
+#include "type_image.h"               // for image_t, image_create, image_destroy
+#include "type_raster.h"              // for raster_t
+#include "type_timings.h"             // for timings_begin, timings_end
+#include "type_vector.h"              // for vector_create
+#include "type_vector_list.h"         // for vector_list_append
+#include "type_vector_list_config.h"  // for vector_list_config_t, vector_list_config_id_to_rgb
+
+struct pdf2laser_job {
+	print_job_t *print_job;
+	char *tmpdir;       // holds the intermediate files of the job
+	char *target_base;  // NULL until an input is added or the job is generated from a drawing
+	char *source;       // copy of an input given in memory, NULL otherwise
+	char *target_pjl;   // NULL until the job is generated
+	bool drawn;         // whether the job was drawn instead of given an input
+};
+
+pdf2laser_job_t *pdf2laser_job_create(void)
+{
+	char *tmpdir = pdf2laser_format_string("%s/libpdf2laser.XXXXXX", TMP_DIRECTORY);
+	if (mkdtemp(tmpdir) == NULL) {
+		free(tmpdir);
+		return NULL;
+	}
+
+	pdf2laser_job_t *job = calloc(1, sizeof(pdf2laser_job_t));
+	job->print_job = print_job_create();
+	job->print_job->vector_stats = false;  // stdout belongs to the program, not the library
+	job->tmpdir = tmpdir;
+	job->target_base = NULL;
+	job->source = NULL;
+	job->target_pjl = NULL;
+	job->drawn = false;
+
+	return job;
+}
+
+/**
+ * Destroy a job along with its intermediate files, which are kept in debug
+ * mode as the command keeps them.
+ */
+pdf2laser_job_t *pdf2laser_job_destroy(pdf2laser_job_t *self)
+{
+	if (self == NULL)
+		return NULL;
+
+	if (!self->print_job->debug) {
+		if (self->target_pjl != NULL)
+			unlink(self->target_pjl);
+		if (self->source != NULL)
+			unlink(self->source);
+		rmdir(self->tmpdir);
+	}
+
+	print_job_destroy(self->print_job);
+	free(self->tmpdir);
+	free(self->target_base);
+	free(self->source);
+	free(self->target_pjl);
+	free(self);
+
+	return NULL;
+}
+
+/**
+ * Check a job can still be configured: settings are fixed once it has been
+ * generated.
+ */
+static int pdf2laser_job_check_open(pdf2laser_job_t *self)
+{
+	if (self == NULL)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	if (self->target_pjl != NULL)
+		return PDF2LASER_ERROR_STATE;
+
+	return PDF2LASER_OK;
+}
+
+int pdf2laser_job_set_name(pdf2laser_job_t *self, const char *name)
+{
+	int rc = pdf2laser_job_check_open(self);
+	if (rc)
+		return rc;
+
+	if (name == NULL)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	free(self->print_job->name);
+	self->print_job->name = strndup(name, FILENAME_NCHARS);
+
+	return PDF2LASER_OK;
+}
+
+int pdf2laser_job_set_printer(pdf2laser_job_t *self, const char *host)
+{
+	if (self == NULL || host == NULL)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	free(self->print_job->host);
+	self->print_job->host = strndup(host, HOSTNAME_NCHARS);
+
+	return PDF2LASER_OK;
+}
+
+int pdf2laser_job_set_mode(pdf2laser_job_t *self, pdf2laser_mode mode)
+{
+	int rc = pdf2laser_job_check_open(self);
+	if (rc)
+		return rc;
+
+	if (mode != PDF2LASER_MODE_VECTOR && mode != PDF2LASER_MODE_RASTER && mode != PDF2LASER_MODE_COMBINED)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	self->print_job->mode = (print_job_mode)mode;
+
+	return PDF2LASER_OK;
+}
+
+/**
+ * Set the raster pass. Values out of range are clamped when the job is
+ * generated, as they are on the command line. The resolution cannot change
+ * once the job has been drawn in it.
+ */
+int pdf2laser_job_set_raster(pdf2laser_job_t *self, int32_t power, int32_t speed, uint32_t resolution)
+{
+	int rc = pdf2laser_job_check_open(self);
+	if (rc)
+		return rc;
+
+	if (self->drawn && resolution != self->print_job->raster->resolution)
+		return PDF2LASER_ERROR_STATE;
+
+	self->print_job->raster->power = power;
+	self->print_job->raster->speed = speed;
+	self->print_job->raster->resolution = resolution;
+
+	return PDF2LASER_OK;
+}
+
+/**
+ * Set the vector pass of a colour, given as 0xRRGGBB, adding it if the job
+ * has none yet. Values out of range are clamped when the job is generated.
+ */
+int pdf2laser_job_set_vector(pdf2laser_job_t *self, uint32_t color, int32_t power, int32_t speed, int32_t frequency, int32_t passes)
+{
+	int rc = pdf2laser_job_check_open(self);
+	if (rc)
+		return rc;
+
+	if (color > 0xffffff)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	int32_t red, green, blue;
+	vector_list_config_id_to_rgb((int32_t)color, &red, &green, &blue);
+
+	vector_list_config_t *config = print_job_find_vector_list_config_by_rgb(self->print_job, red, green, blue);
+	if (config == NULL)
+		config = print_job_append_new_vector_list_config(self->print_job, red, green, blue);
+
+	config->power = power;
+	config->speed = speed;
+	config->frequency = frequency;
+	config->multipass = passes;
+
+	return PDF2LASER_OK;
+}
+
+int pdf2laser_job_apply_preset_file(pdf2laser_job_t *self, const char *filename)
+{
+	int rc = pdf2laser_job_check_open(self);
+	if (rc)
+		return rc;
+
+	if (filename == NULL)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	char *path = strndup(filename, FILENAME_NCHARS);
+	preset_file_t *preset_file = preset_file_create(path);
+	free(path);
+	if (preset_file == NULL)
+		return PDF2LASER_ERROR_PRESET;
+
+	rc = (preset_apply_to_print_job(preset_file->preset, self->print_job) != NULL) ? PDF2LASER_OK : PDF2LASER_ERROR_PRESET;
+	preset_file_destroy(preset_file);
+
+	return rc;
+}
+
+/**
+ * Apply a preset given as the text of a preset file, which need not be nul
+ * terminated.
+ */
+int pdf2laser_job_apply_preset(pdf2laser_job_t *self, const char *text, size_t length)
+{
+	int rc = pdf2laser_job_check_open(self);
+	if (rc)
+		return rc;
+
+	if (text == NULL)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	preset_t *preset = preset_create("memory");
+	if (preset_parse(preset, text, length) == NULL || preset_apply_to_print_job(preset, self->print_job) == NULL)
+		rc = PDF2LASER_ERROR_PRESET;
+	preset_destroy(preset);
+
+	return rc;
+}
+
+/**
+ * Use a file as the input of the job. Its format is chosen by its extension
+ * as on the command line, and its name becomes the job name unless one was
+ * set. A job has a single input.
+ */
+int pdf2laser_job_add_file(pdf2laser_job_t *self, const char *filename)
+{
+	int rc = pdf2laser_job_check_open(self);
+	if (rc)
+		return rc;
+
+	if (filename == NULL)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	if (self->target_base != NULL || self->drawn)
+		return PDF2LASER_ERROR_STATE;
+
+	if (access(filename, R_OK))
+		return PDF2LASER_ERROR_SYSTEM;
+
+	print_job_t *print_job = self->print_job;
+	free(print_job->source_filename);
+	print_job->source_filename = strndup(filename, FILENAME_NCHARS);
+
+	char *source_basename_ptr = strndup(filename, FILENAME_NCHARS);
+	char *source_basename = basename(source_basename_ptr);
+
+	if (print_job->name == NULL)
+		print_job->name = strndup(source_basename, FILENAME_NCHARS);
+
+	char *last_dot = strrchr(source_basename, '.');
+	if (last_dot != NULL)
+		*last_dot = '\0';
+	self->target_base = pdf2laser_format_string("%s/%s", self->tmpdir, source_basename);
+
+	free(source_basename_ptr);
+
+	return PDF2LASER_OK;
+}
+
+/**
+ * Use data in memory as the input of the job. It is copied into the working
+ * directory of the job, under the extension given by format, such as "pdf"
+ * or "svg", which chooses how it is read.
+ */
+int pdf2laser_job_add_memory(pdf2laser_job_t *self, const char *format, const void *data, size_t length)
+{
+	int rc = pdf2laser_job_check_open(self);
+	if (rc)
+		return rc;
+
+	if (format == NULL || data == NULL)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	if (format[0] == '.')
+		format += 1;
+	if (format[0] == '\0' || strchr(format, '/') != NULL)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	if (self->target_base != NULL || self->drawn)
+		return PDF2LASER_ERROR_STATE;
+
+	char *source = pdf2laser_format_string("%s/input.%s", self->tmpdir, format);
+	int source_fd = open(source, O_WRONLY | O_CREAT | O_EXCL, 0600);
+	if (source_fd == -1) {
+		free(source);
+		return PDF2LASER_ERROR_SYSTEM;
+	}
+
+	const char *position = data;
+	size_t remaining = length;
+	while (remaining > 0) {
+		ssize_t written = write(source_fd, position, remaining);
+		if (written <= 0) {
+			close(source_fd);
+			unlink(source);
+			free(source);
+			return PDF2LASER_ERROR_SYSTEM;
+		}
+		position += written;
+		remaining -= written;
+	}
+	close(source_fd);
+
+	self->source = source;
+
+	if (self->print_job->name == NULL)
+		self->print_job->name = strndup("job", FILENAME_NCHARS);
+
+	return pdf2laser_job_add_file(self, source);
+}
+
+/**
+ * Check the job can be drawn in: it must be open and have no input.
+ */
+static int pdf2laser_job_check_drawable(pdf2laser_job_t *self)
+{
+	int rc = pdf2laser_job_check_open(self);
+	if (rc)
+		return rc;
+
+	if (self->target_base != NULL)
+		return PDF2LASER_ERROR_STATE;
+
+	return PDF2LASER_OK;
+}
+
+/**
+ * Cut a polyline in the layer of a colour, given as 0xRRGGBB, which follows
+ * the same fallthrough rules as colours of an input when the job has no
+ * settings for it.
+ *
+ * @param points count pairs of x and y, in points from the top left corner of
+ * the bed, converted with the resolution the job has at the time of the call.
+ * @param count the number of points, at least two.
+ * @param closed whether to cut back from the last point to the first.
+ */
+int pdf2laser_job_add_polyline(pdf2laser_job_t *self, uint32_t color, const double *points, size_t count, bool closed)
+{
+	int rc = pdf2laser_job_check_drawable(self);
+	if (rc)
+		return rc;
+
+	if (color > 0xffffff || points == NULL || count < 2)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	print_job_t *print_job = self->print_job;
+
+	int32_t red, green, blue;
+	vector_list_config_id_to_rgb((int32_t)color, &red, &green, &blue);
+
+	vector_list_config_t *config = print_job_find_vector_list_config_by_rgb(print_job, red, green, blue);
+	if (config == NULL && print_job->vector_fallthrough)
+		config = print_job_clone_last_vector_list_config(print_job, red, green, blue);
+	if (config == NULL)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	self->drawn = true;
+
+	double scale = print_job->raster->resolution / 72.0;
+	size_t segments = (closed && count > 2) ? count : count - 1;
+	for (size_t index = 0; index < segments; index += 1) {
+		const double *start = points + 2 * index;
+		const double *end = points + 2 * ((index + 1) % count);
+
+		int32_t start_x = lround(start[0] * scale);
+		int32_t start_y = lround(start[1] * scale);
+		int32_t end_x = lround(end[0] * scale);
+		int32_t end_y = lround(end[1] * scale);
+
+		if (start_x != end_x || start_y != end_y)
+			vector_list_append(config->vector_list, vector_create(start_x, start_y, end_x, end_y));
+	}
+
+	return PDF2LASER_OK;
+}
+
+/**
+ * Engrave an image, placed at the top left corner of the bed and cropped to
+ * it. Its pixels start blank and are given row by row with
+ * pdf2laser_job_set_image_row; setting another image replaces it.
+ *
+ * @param channels 1 for grey or 3 for rgb pixels.
+ * @param resolution pixels per inch, the image being scaled to the raster
+ * resolution when the job is generated.
+ */
+int pdf2laser_job_set_image(pdf2laser_job_t *self, int32_t width, int32_t height, int32_t channels, double resolution)
+{
+	int rc = pdf2laser_job_check_drawable(self);
+	if (rc)
+		return rc;
+
+	if (width <= 0 || height <= 0 || (channels != 1 && channels != 3) || !(resolution > 0.0))
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	print_job_t *print_job = self->print_job;
+	image_destroy(print_job->image);
+	print_job->image = image_create(width, height, channels);
+	print_job->image->resolution = resolution;
+
+	self->drawn = true;
+
+	return PDF2LASER_OK;
+}
+
+/**
+ * Copy a row of pixels, counted from the top, into the image of the job.
+ *
+ * @param pixels width times channels bytes, 0 being black.
+ */
+int pdf2laser_job_set_image_row(pdf2laser_job_t *self, int32_t row, const uint8_t *pixels)
+{
+	int rc = pdf2laser_job_check_drawable(self);
+	if (rc)
+		return rc;
+
+	image_t *image = self->print_job->image;
+	if (image == NULL)
+		return PDF2LASER_ERROR_STATE;
+
+	if (pixels == NULL || row < 0 || row >= image->height)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	size_t length = (size_t)image->width * image->channels;
+	memcpy(image->pixels + row * length, pixels, length);
+
+	return PDF2LASER_OK;
+}
+
+/**
+ * Settle the mode of a drawn job on the passes it was drawn for: there is no
+ * bitmap to engrave without an image.
+ */
+static int pdf2laser_job_draw_mode(pdf2laser_job_t *self)
+{
+	print_job_t *print_job = self->print_job;
+
+	if (print_job->image == NULL) {
+		if (print_job->mode == PRINT_JOB_MODE_RASTER)
+			return PDF2LASER_ERROR_STATE;
+		print_job->mode = PRINT_JOB_MODE_VECTOR;
+	}
+	else if (print_job->configs == NULL && print_job->mode == PRINT_JOB_MODE_COMBINED) {
+		print_job->mode = PRINT_JOB_MODE_RASTER;
+	}
+
+	return PDF2LASER_OK;
+}
+
+/**
+ * Render the input and generate the pjl of the job, once: later calls reuse
+ * it, since generating consumes the vectors of the job. A drawn job already
+ * holds its vectors and image and is generated straight from them.
+ */
+static int pdf2laser_job_render(pdf2laser_job_t *self)
+{
+	if (self == NULL)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	if (self->target_pjl != NULL)
+		return PDF2LASER_OK;
+
+	if (self->target_base == NULL && !self->drawn)
+		return PDF2LASER_ERROR_STATE;
+
+	print_job_t *print_job = self->print_job;
+	print_job_range_check(print_job);
+
+	char *target_bmp = NULL;
+	char *target_vector = NULL;
+	if (self->drawn) {
+		int rc = pdf2laser_job_draw_mode(self);
+		if (rc)
+			return rc;
+		if (print_job->name == NULL)
+			print_job->name = strndup("job", FILENAME_NCHARS);
+		self->target_base = pdf2laser_format_string("%s/job", self->tmpdir);
+	}
+	else if (render_source(print_job, print_job->source_filename, self->target_base, &target_bmp, &target_vector)) {
+		free(target_bmp);
+		free(target_vector);
+		return PDF2LASER_ERROR_INPUT;
+	}
+
+	char *target_pjl = pdf2laser_format_string("%s.pjl", self->target_base);
+	timings_begin(print_job->timings, "generate_pjl");
+	int rc = generate_pjl(print_job, target_bmp, target_vector, target_pjl);
+	timings_end(print_job->timings);
+
+	if (!print_job->debug) {
+		if (target_bmp != NULL)
+			unlink(target_bmp);
+		if (target_vector != NULL)
+			unlink(target_vector);
+	}
+	free(target_bmp);
+	free(target_vector);
+
+	if (rc) {
+		unlink(target_pjl);
+		free(target_pjl);
+		return PDF2LASER_ERROR_SYSTEM;
+	}
+
+	self->target_pjl = target_pjl;
+
+	return PDF2LASER_OK;
+}
+
+/**
+ * Generate the job into a buffer of the caller.
+ *
+ * @param buffer where the pjl is copied, may be NULL to only query its length.
+ * @param length set to the length of the pjl, even when the buffer is too small.
+ *
+ * @return PDF2LASER_OK, or PDF2LASER_ERROR_BUFFER if the buffer cannot hold
+ * the pjl.
+ */
+int pdf2laser_job_generate(pdf2laser_job_t *self, void *buffer, size_t capacity, size_t *length)
+{
+	if (length == NULL)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	int rc = pdf2laser_job_render(self);
+	if (rc)
+		return rc;
+
+	int pjl_fd = open(self->target_pjl, O_RDONLY);
+	if (pjl_fd == -1)
+		return PDF2LASER_ERROR_SYSTEM;
+
+	struct stat pjl_stat;
+	if (fstat(pjl_fd, &pjl_stat)) {
+		close(pjl_fd);
+		return PDF2LASER_ERROR_SYSTEM;
+	}
+
+	*length = pjl_stat.st_size;
+	if (buffer == NULL || capacity < *length) {
+		close(pjl_fd);
+		return PDF2LASER_ERROR_BUFFER;
+	}
+
+	char *position = buffer;
+	size_t remaining = *length;
+	while (remaining > 0) {
+		ssize_t count = read(pjl_fd, position, remaining);
+		if (count <= 0) {
+			close(pjl_fd);
+			return PDF2LASER_ERROR_SYSTEM;
+		}
+		position += count;
+		remaining -= count;
+	}
+
+	close(pjl_fd);
+
+	return PDF2LASER_OK;
+}
+
+/**
+ * Generate the job into a file descriptor of the caller, such as a file, a
+ * pipe or a socket.
+ */
+int pdf2laser_job_generate_fd(pdf2laser_job_t *self, int fd)
+{
+	if (fd < 0)
+		return PDF2LASER_ERROR_ARGUMENT;
+
+	int rc = pdf2laser_job_render(self);
+	if (rc)
+		return rc;
+
+	int pjl_fd = open(self->target_pjl, O_RDONLY);
+	if (pjl_fd == -1)
+		return PDF2LASER_ERROR_SYSTEM;
+
+	rc = pdf2laser_sendfile(fd, pjl_fd) ? PDF2LASER_ERROR_SYSTEM : PDF2LASER_OK;
+
+	close(pjl_fd);
+
+	return rc;
+}
+
+/**
+ * Generate the job if it has not been yet and send it to its printer. Unlike
+ * the command, the library draws no progress and only reports the transfer
+ * on stdout in debug mode.
+ */
+int pdf2laser_job_send(pdf2laser_job_t *self)
+{
+	int rc = pdf2laser_job_render(self);
+	if (rc)
+		return rc;
+
+	print_job_t *print_job = self->print_job;
+	sender_t *sender = sender_create(print_job, self->target_pjl, NULL, NULL);
+	if (sender == NULL)
+		return PDF2LASER_ERROR_SEND;
+
+	timings_begin(print_job->timings, "printer_send");
+	rc = sender_run(sender);
+	timings_end(print_job->timings);
+
+	if (!rc && print_job->debug) {
+		char *transfer_string = printer_transfer_to_string(&sender->transfer);
+		printf("%s\n", transfer_string);
+		free(transfer_string);
+	}
+
+	sender_destroy(sender);
+
+	return rc ? PDF2LASER_ERROR_SEND : PDF2LASER_OK;
+}
+
+const char *pdf2laser_strerror(int error)
+{
+	switch (error) {
+	case PDF2LASER_OK:
+		return "Success";
+	case PDF2LASER_ERROR_ARGUMENT:
+		return "Invalid argument";
+	case PDF2LASER_ERROR_SYSTEM:
+		return "System error";
+	case PDF2LASER_ERROR_PRESET:
+		return "Invalid preset";
+	case PDF2LASER_ERROR_INPUT:
+		return "Unreadable input";
+	case PDF2LASER_ERROR_STATE:
+		return "Call out of order";
+	case PDF2LASER_ERROR_BUFFER:
+		return "Buffer too small";
+	case PDF2LASER_ERROR_SEND:
+		return "Failed to send job to printer";
+	default:
+		return "Unknown error";
+	}
+}
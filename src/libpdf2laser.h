@@ -0,0 +1,77 @@
+#ifndef __LIBPDF2LASER_H__
+#define __LIBPDF2LASER_H__ 1
+
+#include <stdbool.h>  // for bool
+#include <stddef.h>   // for size_t
+#include <stdint.h>   // for int32_t, uint32_t, uint8_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/**
+ * Embeddable interface to pdf2laser, for programs which generate and send
+ * laser jobs in-process instead of running the command once per job.
+ *
+ * A job is created, configured with presets and settings, given one input
+ * or drawn with the geometry calls, and then generated, into a buffer or a
+ * file descriptor, or sent to its printer. Every function reports failure
+ * with a negative pdf2laser_error and never exits; details are printed on
+ * stderr as the command does.
+ *
+ * Jobs are not thread safe and inputs rendered by Ghostscript must not be
+ * generated from more than one thread at a time.
+ */
+
+typedef enum {
+	PDF2LASER_OK = 0,
+	PDF2LASER_ERROR_ARGUMENT = -1,  // a required argument is NULL or invalid
+	PDF2LASER_ERROR_SYSTEM = -2,    // a file or directory could not be used, see errno
+	PDF2LASER_ERROR_PRESET = -3,    // a preset could not be read or applied
+	PDF2LASER_ERROR_INPUT = -4,     // the input could not be read or rendered
+	PDF2LASER_ERROR_STATE = -5,     // the call does not fit the state of the job
+	PDF2LASER_ERROR_BUFFER = -6,    // the buffer is too small for the job
+	PDF2LASER_ERROR_SEND = -7,      // the job could not be sent to the printer
+} pdf2laser_error;
+
+typedef enum {
+	PDF2LASER_MODE_VECTOR = 'v',    // only cut
+	PDF2LASER_MODE_RASTER = 'r',    // only engrave
+	PDF2LASER_MODE_COMBINED = 'c',  // engrave then cut
+} pdf2laser_mode;
+
+typedef struct pdf2laser_job pdf2laser_job_t;
+
+pdf2laser_job_t *pdf2laser_job_create(void);
+pdf2laser_job_t *pdf2laser_job_destroy(pdf2laser_job_t *self);
+
+int pdf2laser_job_set_name(pdf2laser_job_t *self, const char *name);
+int pdf2laser_job_set_printer(pdf2laser_job_t *self, const char *host);
+int pdf2laser_job_set_mode(pdf2laser_job_t *self, pdf2laser_mode mode);
+int pdf2laser_job_set_raster(pdf2laser_job_t *self, int32_t power, int32_t speed, uint32_t resolution);
+int pdf2laser_job_set_vector(pdf2laser_job_t *self, uint32_t color, int32_t power, int32_t speed, int32_t frequency, int32_t passes);
+
+int pdf2laser_job_apply_preset_file(pdf2laser_job_t *self, const char *filename);
+int pdf2laser_job_apply_preset(pdf2laser_job_t *self, const char *text, size_t length);
+
+int pdf2laser_job_add_file(pdf2laser_job_t *self, const char *filename);
+int pdf2laser_job_add_memory(pdf2laser_job_t *self, const char *format, const void *data, size_t length);
+
+int pdf2laser_job_add_polyline(pdf2laser_job_t *self, uint32_t color, const double *points, size_t count, bool closed);
+int pdf2laser_job_set_image(pdf2laser_job_t *self, int32_t width, int32_t height, int32_t channels, double resolution);
+int pdf2laser_job_set_image_row(pdf2laser_job_t *self, int32_t row, const uint8_t *pixels);
+
+int pdf2laser_job_generate(pdf2laser_job_t *self, void *buffer, size_t capacity, size_t *length);
+int pdf2laser_job_generate_fd(pdf2laser_job_t *self, int fd);
+int pdf2laser_job_send(pdf2laser_job_t *self);
+
+const char *pdf2laser_strerror(int error);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -37,98 +37,37 @@
 #define _XOPEN_SOURCE 700
 
 #include "pdf2laser.h"
-#include <dirent.h>                // for closedir, opendir, readdir, DIR, dirent
-#include <ghostscript/gserrors.h>  // for gs_error_Quit
-#include <ghostscript/iapi.h>      // for gsapi_delete_instance, gsapi_exit, gsapi_init_with_args, gsapi_new_instance, gsapi_set_arg_encoding, gsapi_set_stdio, GSDLLCALL, GS_ARG_ENCODING_UTF8
-#include <libgen.h>                // for basename
-#include <limits.h>                // for PATH_MAX
-#include <stdbool.h>               // for false
-#include <stddef.h>                // for size_t, NULL
-#include <stdint.h>                // for int32_t
-#include <stdio.h>                 // for perror, snprintf, fclose, fflush, fopen, fwrite, printf, FILE
-#include <stdlib.h>                // for free, calloc, getenv, mkdtemp
-#include <string.h>                // for strndup, strnlen, strrchr
-#include <sys/stat.h>              // for stat, S_ISREG
-#include <unistd.h>                // for unlink, rmdir
-#include "config.h"                // for FILENAME_NCHARS, DEBUG, TMP_DIRECTORY
-#include "pdf2laser_cli.h"         // for pdf2laser_optparse
-#include "pdf2laser_generator.h"   // for generate_eps, generate_pdf, generate_pjl, generate_ps
-#include "pdf2laser_printer.h"     // for printer_send
-#include "pdf2laser_util.h"        // for pdf2laser_format_string
-#include "type_preset_file.h"      // for preset_file_t, preset_file_create, preset_file_destroy
-#include "type_print_job.h"        // for print_job_t, print_job_create, print_job_destroy, print_job_to_string
-#include "type_raster.h"           // for raster_t
-
-FILE *fh_vector;
-static int GSDLLCALL gsdll_stdout(__attribute__ ((unused)) void *minst, const char *str, int len)
-{
-	size_t rc = fwrite(str, 1, len, fh_vector);
-	fflush(fh_vector);
-	return rc;
-}
-
-/**
- * Execute ghostscript feeding it an ecapsulated postscript file which is then
- * converted into a bitmap image. As a byproduct output of the ghostscript
- * process is redirected to a .vector file which will contain instructions on
- * how to perform a vector cut of lines within the postscript.
- *
- * @param filename_bitmap the filename to use for the resulting bitmap file.
- * @param filename_eps the filename to read in encapsulated postscript from.
- * @param filename_vector the filename that will contain the vector
- * information.
- * @param bmp_mode a string which is one of bmp16m, bmpgray, or bmpmono.
- * @param resolution the encapsulated postscript resolution.
- *
- * @return Return true if the execution of ghostscript succeeds, false
- * otherwise.
- */
-static int execute_ghostscript(print_job_t *print_job, const char *const target_eps, const char *const target_bmp, const char *const target_vector) //, const char *const raster_string)
-{
-	int gs_argc = 8;
-	char *gs_argv[8];
-
-	gs_argv[0] = "gs";
-	gs_argv[1] = "-q";
-	gs_argv[2] = "-dBATCH";
-	gs_argv[3] = "-dNOPAUSE";
-	gs_argv[4] = pdf2laser_format_string("-r%d", print_job->raster->resolution);
-	gs_argv[5] = pdf2laser_format_string("-sDEVICE=%s", raster_mode_to_device_string(print_job->raster->mode));
-	gs_argv[6] = pdf2laser_format_string("-sOutputFile=%s", target_bmp);
-	gs_argv[7] = strndup(target_eps, FILENAME_NCHARS);
-
-	fh_vector = fopen(target_vector, "w");
-
-	int32_t rc;
-
-	void *minst = NULL;
-	rc = gsapi_new_instance(&minst, NULL);
-
-	if (rc < 0)
-		goto terminate_execute_ghostscript;
-
-	rc = gsapi_set_arg_encoding(minst, GS_ARG_ENCODING_UTF8);
-	if (rc == 0) {
-		gsapi_set_stdio(minst, NULL, gsdll_stdout, NULL);
-		rc = gsapi_init_with_args(minst, gs_argc, gs_argv);
-	}
-
-	int32_t rc2 = gsapi_exit(minst);
-	if ((rc == 0) || (rc2 == gs_error_Quit))
-		rc = rc2;
-
-	gsapi_delete_instance(minst);
-
- terminate_execute_ghostscript:
-	fclose(fh_vector);
-
-	free(gs_argv[4]);
-	free(gs_argv[5]);
-	free(gs_argv[6]);
-	free(gs_argv[7]);
-
-	return rc;
-}
+#include <dirent.h>                 // for closedir, opendir, readdir, DIR, dirent
+#include <fcntl.h>                  // for open, O_CREAT, O_RDONLY, O_TRUNC, O_WRONLY
+#include <inttypes.h>               // for PRId32
+#include <libgen.h>                 // for basename
+#include <limits.h>                 // for PATH_MAX
+#include <stdbool.h>                // for false
+#include <stddef.h>                 // for size_t, NULL
+#include <stdint.h>                 // for int32_t
+#include <stdio.h>                  // for perror, snprintf, fprintf, printf, stderr
+#include <stdlib.h>                 // for free, calloc, getenv, mkdtemp
+#include <string.h>                 // for strndup, strrchr
+#include <sys/stat.h>               // for stat, S_ISREG
+#include <unistd.h>                 // for close, unlink, rmdir
+#include "config.h"                 // for FILENAME_NCHARS, DEBUG, HOSTNAME_NCHARS, TMP_DIRECTORY
+#include "pdf2laser_calibrate.h"    // for calibrate_draw
+#include "pdf2laser_cli.h"          // for pdf2laser_optparse
+#include "pdf2laser_estimate.h"     // for estimate_print_job
+#include "pdf2laser_generator.h"    // for generate_pjl
+#include "pdf2laser_printer.h"      // for printer_send, printer_query_status, printer_status_t
+#include "pdf2laser_render.h"       // for render_source
+#include "pdf2laser_trace.h"        // for trace_start, trace_stop, trace_write
+#include "pdf2laser_util.h"         // for pdf2laser_format_string, pdf2laser_sendfile
+#include "type_calibration.h"       // for calibration_to_string
+#include "type_estimate.h"          // for estimate_breakdown_t, estimate_breakdown_to_string
+#include "type_fleet.h"             // for fleet_t, fleet_create, fleet_destroy, fleet_dispatch, fleet_probe, fleet_to_string
+#include "type_optimizer_report.h"  // for optimizer_report_render
+#include "type_preset_file.h"       // for preset_file_t, preset_file_create, preset_file_destroy
+#include "type_print_job.h"         // for print_job_t, print_job_create, print_job_destroy, print_job_to_string
+#include "type_printer.h"           // for printer_t, printer_accepts_print_job
+#include "type_timings.h"           // for timings_begin, timings_end, timings_report
+#include "type_raster.h"            // for raster_t
 
 static char *append_directory(char *base_directory, char *directory_name)
 {
@@ -200,8 +139,15 @@ static int pdf2laser_load_presets(preset_file_t ***preset_files, size_t *preset_
 				goto pfd2laser_load_preset_load_skip;
 
 			if (preset_file_index < preset_file_count) {
-				(*preset_files)[preset_file_index] = preset_file_create(preset_file_path);
-				preset_file_index += 1;
+				// unreadable presets are left out rather than failing every job
+				preset_file_t *preset_file = preset_file_create(preset_file_path);
+				if (preset_file != NULL) {
+					(*preset_files)[preset_file_index] = preset_file;
+					preset_file_index += 1;
+				}
+				else if (DEBUG) {
+					fprintf(stderr, "Skipping unreadable preset file %s\n", preset_file_path);
+				}
 			}
 
 		pfd2laser_load_preset_load_skip:
@@ -213,9 +159,168 @@ static int pdf2laser_load_presets(preset_file_t ***preset_files, size_t *preset_
 	for (size_t index = 0; index < 3; index += 1)
 		free(search_dirs[index]);
 
+	*preset_files_count = preset_file_index;
+
 	return  0;
 }
 
+/**
+ * Pick the printer of the configured fleet the job should be sent to and
+ * point the print job at it.
+ *
+ * @return 0 if a printer was selected, -1 otherwise.
+ */
+static int pdf2laser_dispatch(print_job_t *print_job, const char *const target_pjl)
+{
+	fleet_t *fleet = fleet_create(print_job->fleet_filename);
+	if (fleet == NULL)
+		return -1;
+
+	struct stat pjl_stat;
+	if (stat(target_pjl, &pjl_stat)) {
+		perror("Error reading pjl file");
+		fleet_destroy(fleet);
+		return -1;
+	}
+
+	if (fleet_probe(fleet) == 0) {
+		fprintf(stderr, "No printer in fleet %s is reachable\n", print_job->fleet_filename);
+		fleet_destroy(fleet);
+		return -1;
+	}
+
+	printer_t *printer = fleet_dispatch(fleet, print_job, pjl_stat.st_size);
+	if (printer == NULL) {
+		fprintf(stderr, "No printer in fleet %s can run this job\n", print_job->fleet_filename);
+		fleet_destroy(fleet);
+		return -1;
+	}
+
+	if (print_job->debug) {
+		char *fleet_string = fleet_to_string(fleet);
+		printf("%s\n", fleet_string);
+		free(fleet_string);
+	}
+
+	printf("Dispatching job to %s\n", printer->host);
+
+	free(print_job->host);
+	print_job->host = strndup(printer->host, HOSTNAME_NCHARS);
+
+	fleet_destroy(fleet);
+
+	return 0;
+}
+
+static int pdf2laser_print_status(print_job_t *print_job, const char *host)
+{
+	printer_status_t status;
+	char *response = NULL;
+
+	if (printer_query_status(host, &status, &response)) {
+		free(response);
+		return -1;
+	}
+
+	printf("%s: %"PRId32" job%s queued%s\n", host, status.queue_depth,
+	       (status.queue_depth == 1) ? "" : "s", status.active ? ", printing" : "");
+
+	if (print_job->debug)
+		printf("%s", response);
+
+	free(response);
+
+	return 0;
+}
+
+/**
+ * Report how long the generated job is expected to keep the machine busy, and
+ * on every printer of the fleet which can run it if one is configured.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+static int pdf2laser_estimate(print_job_t *print_job)
+{
+	estimate_breakdown_t breakdown;
+	estimate_print_job(print_job, print_job->kinematics, &breakdown);
+
+	char *breakdown_string = estimate_breakdown_to_string(&breakdown);
+	printf("%s\n", breakdown_string);
+	free(breakdown_string);
+
+	if (print_job->fleet_filename == NULL)
+		return 0;
+
+	fleet_t *fleet = fleet_create(print_job->fleet_filename);
+	if (fleet == NULL)
+		return -1;
+
+	for (printer_t *printer = fleet->printers; printer != NULL; printer = printer->next) {
+		if (printer_accepts_print_job(printer, print_job))
+			printf("%s: %.1f s\n", printer->host, estimate_print_job(print_job, printer->kinematics, NULL));
+		else
+			printf("%s: cannot run this job\n", printer->host);
+	}
+
+	fleet_destroy(fleet);
+
+	return 0;
+}
+
+/**
+ * Report the queue state of the configured printer, or of every printer in
+ * the fleet if one is configured, without submitting anything.
+ *
+ * @return 0 if every printer answered, -1 otherwise.
+ */
+static int pdf2laser_status(print_job_t *print_job)
+{
+	if (print_job->fleet_filename == NULL)
+		return pdf2laser_print_status(print_job, print_job->host);
+
+	fleet_t *fleet = fleet_create(print_job->fleet_filename);
+	if (fleet == NULL)
+		return -1;
+
+	int rc = 0;
+	for (printer_t *printer = fleet->printers; printer != NULL; printer = printer->next) {
+		if (pdf2laser_print_status(print_job, printer->host))
+			rc = -1;
+	}
+
+	fleet_destroy(fleet);
+
+	return rc;
+}
+
+/**
+ * Copy the generated job to a file in place of sending it to a printer, so
+ * that the whole pipeline can be run and measured without one.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+static int pdf2laser_write_output(const char *output_filename, const char *target_pjl)
+{
+	int pjl_fd = open(target_pjl, O_RDONLY);
+	if (pjl_fd == -1) {
+		perror("Error opening pjl file");
+		return -1;
+	}
+
+	int output_fd = open(output_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (output_fd == -1) {
+		perror("Error opening output file");
+		close(pjl_fd);
+		return -1;
+	}
+
+	int rc = pdf2laser_sendfile(output_fd, pjl_fd) ? -1 : 0;
+
+	close(output_fd);
+	close(pjl_fd);
+
+	return rc;
+}
 
 /**
  * Main entry point for the program.
@@ -245,6 +350,26 @@ int main(int argc, char *argv[])
 	print_job_t *print_job = print_job_create();
 	pdf2laser_optparse(print_job, preset_files, preset_files_count, argc, argv);
 
+	if (print_job->query_status) {
+		int rc = pdf2laser_status(print_job);
+
+		print_job_destroy(print_job);
+		for (size_t index = 0; index < preset_files_count; index += 1) {
+			preset_file_destroy(preset_files[index]);
+		}
+
+		if (rmdir(tmpdir_name) == -1) {
+			perror("Error deleting tmpdir");
+			return -1;
+		}
+		free(tmpdir_name);
+
+		return rc;
+	}
+
+	if (print_job->trace_filename != NULL)
+		trace_start();
+
 	const char *source_filename = print_job->source_filename;
 	char *source_basename = strndup(print_job->source_filename, FILENAME_NCHARS);
 	char *source_basename_ptr = source_basename;
@@ -266,62 +391,36 @@ int main(int argc, char *argv[])
 
 	free(source_basename_ptr);
 
-	char *target_pdf = pdf2laser_format_string("%s.pdf", target_base);
-	if (generate_pdf(source_filename, target_pdf)) {
-		perror("Failed to clone pdf file");
-		return -1;
-	}
+	int rc;
 
-	char *target_ps = pdf2laser_format_string("%s.ps", target_base);
-	if (generate_ps(target_pdf, target_ps)) {
-		perror("Failed to generate ps file");
-		return -1;
-	}
+	char *target_bmp = NULL;
+	char *target_vector = NULL;
 
-	if (!print_job->debug) {
-		if (unlink(target_pdf)) {
-			perror("Error deleting pdf file");
-			return -1;
-		}
-	}
-	free(target_pdf);
+	if (print_job->calibration != NULL) {
+		char *calibration_string = calibration_to_string(print_job->calibration);
+		printf("Calibration card:\n%s\n", calibration_string);
+		free(calibration_string);
 
-	char *target_eps = pdf2laser_format_string("%s.eps", target_base);
-	if (generate_eps(print_job, target_ps, target_eps)) {
-		perror("Failed to generate eps file");
-		return -1;
+		timings_begin(print_job->timings, "calibrate_draw");
+		rc = calibrate_draw(print_job);
+		timings_end(print_job->timings);
 	}
-
-	if (!print_job->debug) {
-		if (unlink(target_ps)) {
-			perror("Error deleting ps file");
-			return -1;
-		}
+	else {
+		rc = render_source(print_job, source_filename, target_base, &target_bmp, &target_vector);
 	}
-	free(target_ps);
-
-	char *target_bmp = pdf2laser_format_string("%s.bmp", target_base);
-	char *target_vector = pdf2laser_format_string("%s.vector", target_base);
-	if (execute_ghostscript(print_job, target_eps, target_bmp, target_vector)) {
-		perror("Failed to execute ghostscript");
+	if (rc)
 		return -1;
-	}
-
-	if (!print_job->debug) {
-		if (unlink(target_eps)) {
-			perror("Error deleting eps file");
-			return -1;
-		}
-	}
-	free(target_eps);
 
 	char *target_pjl = pdf2laser_format_string("%s.pjl", target_base);
-	if (generate_pjl(print_job, target_bmp, target_vector, target_pjl)) {
+	timings_begin(print_job->timings, "generate_pjl");
+	rc = generate_pjl(print_job, target_bmp, target_vector, target_pjl);
+	timings_end(print_job->timings);
+	if (rc) {
 		perror("Failed to generate pjl file");
 		return -1;
 	}
 
-	if (!print_job->debug) {
+	if (target_bmp != NULL && !print_job->debug) {
 		if (unlink(target_bmp)) {
 			perror("Error deleting bmp file");
 			return -1;
@@ -329,7 +428,7 @@ int main(int argc, char *argv[])
 	}
 	free(target_bmp);
 
-	if (!print_job->debug) {
+	if (target_vector != NULL && !print_job->debug) {
 		if (unlink(target_vector)) {
 			perror("Error deleting vector file");
 			return -1;
@@ -339,9 +438,40 @@ int main(int argc, char *argv[])
 
 	free(target_base);
 
-	if (printer_send(print_job, target_pjl)) {
-		perror("Failed to send job to printer");
-		return -1;
+	if (print_job->estimate_only) {
+		timings_begin(print_job->timings, "pdf2laser_estimate");
+		rc = pdf2laser_estimate(print_job);
+		timings_end(print_job->timings);
+		if (rc) {
+			fprintf(stderr, "Failed to estimate the job duration\n");
+			return -1;
+		}
+	}
+	else if (print_job->output_filename != NULL) {
+		timings_begin(print_job->timings, "write_output");
+		rc = pdf2laser_write_output(print_job->output_filename, target_pjl);
+		timings_end(print_job->timings);
+		if (rc) {
+			fprintf(stderr, "Failed to write job to %s\n", print_job->output_filename);
+			return -1;
+		}
+	}
+	else {
+		if (print_job->fleet_filename != NULL) {
+			timings_begin(print_job->timings, "pdf2laser_dispatch");
+			rc = pdf2laser_dispatch(print_job, target_pjl);
+			timings_end(print_job->timings);
+			if (rc)
+				return -1;
+		}
+
+		timings_begin(print_job->timings, "printer_send");
+		rc = printer_send(print_job, target_pjl);
+		timings_end(print_job->timings);
+		if (rc) {
+			perror("Failed to send job to printer");
+			return -1;
+		}
 	}
 
 	if (!print_job->debug) {
@@ -352,6 +482,23 @@ int main(int argc, char *argv[])
 	}
 	free(target_pjl);
 
+	if (print_job->timings != NULL) {
+		char *timings_string = timings_report(print_job->timings);
+		fprintf(stderr, "%s\n", timings_string);
+		free(timings_string);
+	}
+
+	if (print_job->optimizer_report != NULL) {
+		char *report_string = optimizer_report_render(print_job->optimizer_report);
+		fprintf(stderr, "%s\n", report_string);
+		free(report_string);
+	}
+
+	if (print_job->trace_filename != NULL) {
+		trace_write(print_job->trace_filename);
+		trace_stop();
+	}
+
 	print_job_destroy(print_job);
 
 	for (size_t index = 0; index < preset_files_count; index += 1) {
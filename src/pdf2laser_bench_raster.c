@@ -0,0 +1,268 @@
+#include "pdf2laser_bench_raster.h"
+#include <inttypes.h>             // for PRIu32
+#include <stdbool.h>              // for bool, false, true
+#include <stddef.h>               // for size_t, NULL
+#include <stdint.h>               // for int32_t, uint32_t
+#include <stdio.h>                // for fprintf, fclose, fflush, fread, fseek, ftell, printf, rewind, tmpfile, FILE, perror, stderr, stdout, SEEK_END
+#include <stdlib.h>               // for atof, calloc, exit, free, strtoull, EXIT_FAILURE, EXIT_SUCCESS
+#include <string.h>               // for strchr, strcmp, strdup, strtok_r
+#include "config.h"               // for PACKAGE, VERSION
+#define OPTPARSE_IMPLEMENTATION
+#define OPTPARSE_API static
+#include "optparse.h"             // for OPTPARSE_REQUIRED, optparse, OPTPARSE_NONE, optparse_long, optparse_init
+#include "pdf2laser_generator.h"  // for generate_raster, raster_pack
+#include "pdf2laser_util.h"       // for pdf2laser_clock
+#include "pdf2laser_workload.h"   // for workload_t, workload_create, workload_destroy, workload_fill_to_string, workload_write_bitmap, WORKLOAD_FILLS_LENGTH
+#include "type_print_job.h"       // for print_job_t, print_job_create, print_job_destroy
+#include "type_raster.h"          // for raster_mode, raster_t
+
+typedef struct bench_result bench_result_t;
+struct bench_result {
+	size_t bitmap_bytes;  // pixel data of the bitmap, without headers
+	size_t pjl_bytes;
+	double seconds;       // spent in generate_raster
+	double pack_seconds;  // spent packing every row of the bitmap on its own
+};
+
+static const struct optparse_long long_options[] = {
+	{"dpi",      'd',  OPTPARSE_REQUIRED},
+	{"modes",    'm',  OPTPARSE_REQUIRED},
+	{"contents", 'c',  OPTPARSE_REQUIRED},
+	{"width",    'W',  OPTPARSE_REQUIRED},
+	{"height",   'H',  OPTPARSE_REQUIRED},
+	{"density",  'D',  OPTPARSE_REQUIRED},
+	{"seed",     'r',  OPTPARSE_REQUIRED},
+	{"help",     'h',  OPTPARSE_NONE},
+	{"version",  '@',  OPTPARSE_NONE},
+	{0}
+};
+
+static void usage(int rc, const char * const msg)
+{
+	static const char usage_str[] =
+		"Usage: " PACKAGE "-bench-raster [OPTION]...\n"
+		"\n"
+		"Time the raster encoder on synthetic bitmaps and report its throughput\n"
+		"and compression ratio.\n"
+		"\n"
+		"  -d, --dpi=LIST                 Resolutions (default " BENCH_RASTER_DPIS ")\n"
+		"  -m, --modes=MODES              Any of m, g and c (default " BENCH_RASTER_MODES ")\n"
+		"  -c, --contents=LIST            Any of blank, text, photo, noise (default all)\n"
+		"  -W, --width=INCHES             Width of the page\n"
+		"  -H, --height=INCHES            Height of the page\n"
+		"  -D, --density=SHARE            Share of pixels inked by the noise content\n"
+		"  -r, --seed=SEED                Seed of the noise content\n"
+		"  -h, --help                     Output a usage message and exit\n"
+		"      --version                  Output the version number and exit\n"
+		"";
+
+	fprintf(stderr, "%s%s\n", msg, usage_str);
+
+	exit(rc);
+}
+
+/**
+ * Pack every row of the bitmap as it is stored, without the extent scan or
+ * any output, to time the PackBits encoder alone.
+ */
+static double bench_pack_rows(FILE *bitmap_file, size_t bitmap_bytes, int32_t rows)
+{
+	size_t row_bytes = bitmap_bytes / rows;
+	unsigned char *row = calloc(row_bytes, 1);
+	unsigned char *pack = calloc(row_bytes * 5 / 4 + 1, 1);
+
+	fseek(bitmap_file, -(long)bitmap_bytes, SEEK_END);
+
+	double seconds = 0.0;
+	for (int32_t y = 0; y < rows; y += 1) {
+		if (fread(row, 1, row_bytes, bitmap_file) != row_bytes)
+			break;
+
+		double start = pdf2laser_clock();
+		raster_pack(row, row_bytes, pack);
+		seconds += pdf2laser_clock() - start;
+	}
+
+	free(pack);
+	free(row);
+
+	return seconds;
+}
+
+static int bench_run(workload_t *workload, raster_mode mode, uint32_t dpi, bench_result_t *result)
+{
+	FILE *bitmap_file = tmpfile();
+	FILE *pjl_file = tmpfile();
+	if (bitmap_file == NULL || pjl_file == NULL) {
+		perror("Unable to create temporary file");
+		return -1;
+	}
+
+	result->bitmap_bytes = workload_write_bitmap(workload, bitmap_file, mode, dpi);
+	if (result->bitmap_bytes == 0) {
+		fclose(pjl_file);
+		fclose(bitmap_file);
+		return -1;
+	}
+	fflush(bitmap_file);
+	rewind(bitmap_file);
+
+	print_job_t *print_job = print_job_create();
+	print_job->raster->mode = mode;
+	print_job->raster->resolution = dpi;
+	print_job->raster->power = 100;
+	print_job->raster->speed = 100;
+
+	double start = pdf2laser_clock();
+	int rc = generate_raster(print_job, pjl_file, bitmap_file);
+	fflush(pjl_file);
+	result->seconds = pdf2laser_clock() - start;
+	result->pjl_bytes = ftell(pjl_file);
+
+	result->pack_seconds = bench_pack_rows(bitmap_file, result->bitmap_bytes, (int32_t)(workload->height * dpi));
+
+	print_job_destroy(print_job);
+	fclose(pjl_file);
+	fclose(bitmap_file);
+
+	return rc;
+}
+
+static double bench_rate(size_t bytes, double seconds)
+{
+	return (seconds > 0.0) ? (bytes / 1048576.0 / seconds) : 0.0;
+}
+
+static bool bench_selected(char *list, const char *name)
+{
+	if (list == NULL)
+		return true;
+
+	char *copy = strdup(list);
+	char *save = NULL;
+	bool selected = false;
+	for (char *token = strtok_r(copy, ",", &save); token != NULL; token = strtok_r(NULL, ",", &save)) {
+		if (!strcmp(token, name)) {
+			selected = true;
+			break;
+		}
+	}
+	free(copy);
+
+	return selected;
+}
+
+/**
+ * Entry point for the raster benchmark. Every content is rendered at each
+ * resolution in each mode, printing a row per run.
+ */
+int main(int argc, char *argv[])
+{
+	char *dpis = BENCH_RASTER_DPIS;
+	char *modes = BENCH_RASTER_MODES;
+	char *contents = NULL;
+	workload_t *workload = workload_create(BENCH_RASTER_SEED);
+	workload->width = BENCH_RASTER_WIDTH;
+	workload->height = BENCH_RASTER_HEIGHT;
+
+	struct optparse options;
+	int option;
+
+	optparse_init(&options, argv);
+	while ((option = optparse_long(&options, long_options, NULL)) != -1) {
+		switch (option) {
+		case 'd':
+			dpis = options.optarg;
+			break;
+
+		case 'm':
+			modes = options.optarg;
+			break;
+
+		case 'c':
+			contents = options.optarg;
+			break;
+
+		case 'W':
+			workload->width = atof(options.optarg);
+			break;
+
+		case 'H':
+			workload->height = atof(options.optarg);
+			break;
+
+		case 'r':
+			workload->seed = strtoull(options.optarg, NULL, 10);
+			break;
+
+		case 'D':
+			workload->density = atof(options.optarg);
+			break;
+
+		case 'h':
+			usage(EXIT_SUCCESS, "");
+			break;
+
+		case '@':
+			fprintf(stdout, "%s\n", VERSION);
+			exit(EXIT_SUCCESS);
+
+		case '?':
+			fprintf(stderr, "%s: %s\n", argv[0], options.errmsg);
+			exit(EXIT_FAILURE);
+
+		default:
+			usage(EXIT_FAILURE, "Unknown argument\n");
+		}
+	}
+
+	if (argc > options.optind)
+		usage(EXIT_FAILURE, "Unexpected argument\n");
+
+	if (workload->width <= 0.0 || workload->height <= 0.0)
+		usage(EXIT_FAILURE, "Page size must be positive\n");
+
+	printf("%5s %4s %-6s %11s %10s %9s %12s %8s %10s\n", "DPI", "Mode", "Content", "Bitmap (MB)", "Encode (s)", "MB/s in", "PJL bytes", "Ratio", "Pack MB/s");
+
+	char *list = strdup(dpis);
+	char *save = NULL;
+	for (char *token = strtok_r(list, ",", &save); token != NULL; token = strtok_r(NULL, ",", &save)) {
+		uint32_t dpi = strtoull(token, NULL, 10);
+		if (dpi == 0)
+			continue;
+
+		for (const char *mode = modes; *mode; mode += 1) {
+			if (strchr("mgc", *mode) == NULL) {
+				fprintf(stderr, "Unknown raster mode '%c'\n", *mode);
+				free(list);
+				workload_destroy(workload);
+				return EXIT_FAILURE;
+			}
+
+			for (int fill = 0; fill < WORKLOAD_FILLS_LENGTH; fill += 1) {
+				if (!bench_selected(contents, workload_fill_to_string(fill)))
+					continue;
+
+				workload->fill = fill;
+
+				bench_result_t result;
+				if (bench_run(workload, (raster_mode)*mode, dpi, &result)) {
+					free(list);
+					workload_destroy(workload);
+					return EXIT_FAILURE;
+				}
+
+				printf("%5"PRIu32" %4c %-6s %11.2f %10.4f %9.1f %12zu %8.2f %10.1f\n",
+				       dpi, *mode, workload_fill_to_string(fill), result.bitmap_bytes / 1048576.0, result.seconds,
+				       bench_rate(result.bitmap_bytes, result.seconds), result.pjl_bytes,
+				       result.pjl_bytes ? ((double)result.bitmap_bytes / result.pjl_bytes) : 0.0,
+				       bench_rate(result.bitmap_bytes, result.pack_seconds));
+				fflush(stdout);
+			}
+		}
+	}
+	free(list);
+	workload_destroy(workload);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,30 @@
+#ifndef __PDF2LASER_BENCH_RASTER_H__
+#define __PDF2LASER_BENCH_RASTER_H__ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/** Resolutions each bitmap is rendered at unless -d is given. */
+#define BENCH_RASTER_DPIS "300,600,1200"
+
+/** Raster modes run unless -m is given. */
+#define BENCH_RASTER_MODES "mgc"
+
+/** Size of the synthetic page in inches unless -W or -H is given. */
+#define BENCH_RASTER_WIDTH (4.0)
+#define BENCH_RASTER_HEIGHT (3.0)
+
+/** Seed of the noise content unless -r is given. */
+#define BENCH_RASTER_SEED (1)
+
+int main(int argc, char *argv[]);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,303 @@
+#include "pdf2laser_bench_vector.h"
+#include <inttypes.h>                 // for PRId64
+#include <math.h>                     // for HUGE_VAL
+#include <stdbool.h>                  // for bool, false, true
+#include <stddef.h>                   // for size_t, NULL
+#include <stdio.h>                    // for fprintf, fclose, fflush, fopen, printf, rewind, tmpfile, FILE, perror, stderr, stdout
+#include <stdlib.h>                   // for atof, exit, free, strtoul, strtoull, EXIT_FAILURE, EXIT_SUCCESS
+#include <string.h>                   // for strcmp, strdup, strtok_r
+#include "config.h"                   // for PACKAGE, VERSION
+#define OPTPARSE_IMPLEMENTATION
+#define OPTPARSE_API static
+#include "optparse.h"                 // for OPTPARSE_REQUIRED, optparse, OPTPARSE_NONE, optparse_long, optparse_init
+#include "pdf2laser_generator.h"      // for output_vector, vectors_parse
+#include "pdf2laser_util.h"           // for pdf2laser_clock
+#include "pdf2laser_workload.h"       // for workload_t, workload_create, workload_destroy, workload_shape_to_string, workload_write_vectors, WORKLOAD_SHAPES_LENGTH
+#include "type_print_job.h"           // for print_job_t, print_job_append_new_vector_list_config, print_job_create, print_job_destroy
+#include "type_vector_list.h"         // for vector_list_stats_t, vector_list_t, vector_list_dedup, vector_list_destroy, vector_list_measure, vector_list_optimize
+#include "type_vector_list_config.h"  // for vector_list_config_t
+
+/** Seconds spent in each stage, negative when the stage was skipped. */
+typedef struct bench_result bench_result_t;
+struct bench_result {
+	size_t segments;
+	size_t kept;  // segments left after dedup
+	double parse;
+	double dedup;
+	double optimize;
+	double output;
+	vector_list_stats_t before;  // order the vectors were parsed in
+	vector_list_stats_t after;   // order chosen by the optimizer
+};
+
+static const struct optparse_long long_options[] = {
+	{"sizes",         's',  OPTPARSE_REQUIRED},
+	{"workloads",     'w',  OPTPARSE_REQUIRED},
+	{"seed",          'r',  OPTPARSE_REQUIRED},
+	{"connectivity",  'k',  OPTPARSE_REQUIRED},
+	{"colors",        'c',  OPTPARSE_REQUIRED},
+	{"budget",        'b',  OPTPARSE_REQUIRED},
+	{"help",          'h',  OPTPARSE_NONE},
+	{"version",       '@',  OPTPARSE_NONE},
+	{0}
+};
+
+static void usage(int rc, const char * const msg)
+{
+	static const char usage_str[] =
+		"Usage: " PACKAGE "-bench-vector [OPTION]...\n"
+		"\n"
+		"Time parsing, deduplicating, ordering and emitting synthetic vector\n"
+		"sets, along with the transit length before and after ordering.\n"
+		"\n"
+		"  -s, --sizes=LIST               Segment counts (default " BENCH_VECTOR_SIZES ")\n"
+		"  -w, --workloads=LIST           Any of random, grid, circles, text (default all)\n"
+		"  -r, --seed=SEED                Seed of the workload generator\n"
+		"  -k, --connectivity=CHANCE      Chance a random segment continues the last\n"
+		"  -c, --colors=N                 Number of vector colours\n"
+		"  -b, --budget=SECONDS           Skip quadratic stages expected to take longer\n"
+		"  -h, --help                     Output a usage message and exit\n"
+		"      --version                  Output the version number and exit\n"
+		"";
+
+	fprintf(stderr, "%s%s\n", msg, usage_str);
+
+	exit(rc);
+}
+
+/**
+ * Estimate the run time of a quadratic stage from its previous run. A stage
+ * which was skipped stays skipped, and the first run is always made.
+ */
+static double bench_predict(double seconds, size_t segments, size_t previous_segments)
+{
+	if (previous_segments == 0)
+		return 0.0;
+
+	if (seconds < 0.0)
+		return HUGE_VAL;
+
+	double ratio = (double)segments / previous_segments;
+	return seconds * ratio * ratio;
+}
+
+static void bench_measure(print_job_t *print_job, vector_list_stats_t *stats)
+{
+	*stats = (vector_list_stats_t){ 0 };
+
+	for (vector_list_config_t *config = print_job->configs; config != NULL; config = config->next) {
+		vector_list_stats_t list_stats;
+		vector_list_measure(config->vector_list, &list_stats);
+		stats->cuts += list_stats.cuts;
+		stats->cut_length += list_stats.cut_length;
+		stats->transits += list_stats.transits;
+		stats->transit_length += list_stats.transit_length;
+	}
+}
+
+static int bench_run(workload_t *workload, double budget, bench_result_t *previous, bench_result_t *result)
+{
+	FILE *vector_file = tmpfile();
+	if (vector_file == NULL) {
+		perror("Unable to create vector file");
+		return -1;
+	}
+
+	size_t segments = workload_write_vectors(workload, vector_file);
+	rewind(vector_file);
+
+	FILE *pjl_file = fopen("/dev/null", "w");
+	if (pjl_file == NULL) {
+		perror("Unable to open /dev/null");
+		fclose(vector_file);
+		return -1;
+	}
+
+	// every other colour is cloned from the first by vectors_parse
+	print_job_t *print_job = print_job_create();
+	print_job_append_new_vector_list_config(print_job, 0, 0, 0);
+
+	result->segments = segments;
+	result->dedup = -1.0;
+	result->optimize = -1.0;
+
+	double start = pdf2laser_clock();
+	vectors_parse(print_job, vector_file);
+	result->parse = pdf2laser_clock() - start;
+
+	if (bench_predict(previous->dedup, segments, previous->segments) <= budget) {
+		start = pdf2laser_clock();
+		for (vector_list_config_t *config = print_job->configs; config != NULL; config = config->next)
+			vector_list_dedup(config->vector_list);
+		result->dedup = pdf2laser_clock() - start;
+	}
+
+	result->kept = 0;
+	for (vector_list_config_t *config = print_job->configs; config != NULL; config = config->next)
+		result->kept += config->vector_list->length;
+	bench_measure(print_job, &(result->before));
+
+	if (bench_predict(previous->optimize, result->kept, previous->kept) <= budget) {
+		start = pdf2laser_clock();
+		for (vector_list_config_t *config = print_job->configs; config != NULL; config = config->next) {
+			vector_list_t *vector_list = config->vector_list;
+			config->vector_list = vector_list_optimize(vector_list);
+			vector_list_destroy(vector_list);
+		}
+		result->optimize = pdf2laser_clock() - start;
+
+		bench_measure(print_job, &(result->after));
+	}
+
+	start = pdf2laser_clock();
+	for (vector_list_config_t *config = print_job->configs; config != NULL; config = config->next)
+		output_vector(config->vector_list, pjl_file);
+	fflush(pjl_file);
+	result->output = pdf2laser_clock() - start;
+
+	print_job_destroy(print_job);
+	fclose(pjl_file);
+	fclose(vector_file);
+
+	return 0;
+}
+
+static void bench_print_seconds(double seconds)
+{
+	if (seconds < 0.0)
+		printf(" %12s", "-");
+	else
+		printf(" %12.4f", seconds);
+}
+
+static void bench_print(workload_t *workload, bench_result_t *result)
+{
+	printf("%-10s %10zu %10zu", workload_shape_to_string(workload->shape), result->segments, result->kept);
+	bench_print_seconds(result->parse);
+	bench_print_seconds(result->dedup);
+	bench_print_seconds(result->optimize);
+	bench_print_seconds(result->output);
+	printf(" %15"PRId64, result->before.transit_length);
+	if (result->optimize < 0.0)
+		printf(" %15s\n", "-");
+	else
+		printf(" %15"PRId64"\n", result->after.transit_length);
+	fflush(stdout);
+}
+
+static bool bench_selected(char *workloads, const char *name)
+{
+	if (workloads == NULL)
+		return true;
+
+	char *list = strdup(workloads);
+	char *save = NULL;
+	bool selected = false;
+	for (char *token = strtok_r(list, ",", &save); token != NULL; token = strtok_r(NULL, ",", &save)) {
+		if (!strcmp(token, name)) {
+			selected = true;
+			break;
+		}
+	}
+	free(list);
+
+	return selected;
+}
+
+/**
+ * Entry point for the vector benchmark. Every selected workload is run at
+ * each size in turn, printing a row per run.
+ */
+int main(int argc, char *argv[])
+{
+	char *sizes = BENCH_VECTOR_SIZES;
+	char *workloads = NULL;
+	double budget = BENCH_VECTOR_BUDGET;
+	workload_t *workload = workload_create(BENCH_VECTOR_SEED);
+
+	struct optparse options;
+	int option;
+
+	optparse_init(&options, argv);
+	while ((option = optparse_long(&options, long_options, NULL)) != -1) {
+		switch (option) {
+		case 's':
+			sizes = options.optarg;
+			break;
+
+		case 'w':
+			workloads = options.optarg;
+			break;
+
+		case 'r':
+			workload->seed = strtoull(options.optarg, NULL, 10);
+			break;
+
+		case 'k':
+			workload->connectivity = atof(options.optarg);
+			break;
+
+		case 'c':
+			workload->colors = strtoul(options.optarg, NULL, 10);
+			if (workload->colors == 0)
+				usage(EXIT_FAILURE, "Colors must be at least 1\n");
+			break;
+
+		case 'b':
+			budget = atof(options.optarg);
+			break;
+
+		case 'h':
+			usage(EXIT_SUCCESS, "");
+			break;
+
+		case '@':
+			fprintf(stdout, "%s\n", VERSION);
+			exit(EXIT_SUCCESS);
+
+		case '?':
+			fprintf(stderr, "%s: %s\n", argv[0], options.errmsg);
+			exit(EXIT_FAILURE);
+
+		default:
+			usage(EXIT_FAILURE, "Unknown argument\n");
+		}
+	}
+
+	if (argc > options.optind)
+		usage(EXIT_FAILURE, "Unexpected argument\n");
+
+	printf("%-10s %10s %10s %12s %12s %12s %12s %15s %15s\n", "Workload", "Segments", "Kept", "Parse (s)", "Dedup (s)", "Optimize (s)", "Output (s)", "Transit before", "Transit after");
+
+	for (int shape = 0; shape < WORKLOAD_SHAPES_LENGTH; shape += 1) {
+		if (!bench_selected(workloads, workload_shape_to_string(shape)))
+			continue;
+
+		workload->shape = shape;
+
+		bench_result_t previous = { .segments = 0, .kept = 0 };
+
+		char *list = strdup(sizes);
+		char *save = NULL;
+		for (char *token = strtok_r(list, ",", &save); token != NULL; token = strtok_r(NULL, ",", &save)) {
+			workload->segments = strtoull(token, NULL, 10);
+			if (workload->segments == 0)
+				continue;
+
+			bench_result_t result;
+			if (bench_run(workload, budget, &previous, &result)) {
+				free(list);
+				workload_destroy(workload);
+				return EXIT_FAILURE;
+			}
+
+			bench_print(workload, &result);
+			previous = result;
+		}
+		free(list);
+	}
+
+	workload_destroy(workload);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,29 @@
+#ifndef __PDF2LASER_BENCH_VECTOR_H__
+#define __PDF2LASER_BENCH_VECTOR_H__ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/** Segment counts each workload is generated at unless -s is given. */
+#define BENCH_VECTOR_SIZES "1000,10000,100000,1000000"
+
+/** Seed of the workload generator unless -r is given. */
+#define BENCH_VECTOR_SEED (1)
+
+/**
+ * Quadratic stages (dedup and optimize) are skipped when they are expected
+ * to take longer than this many seconds, based on the previous size.
+ */
+#define BENCH_VECTOR_BUDGET (60.0)
+
+int main(int argc, char *argv[]);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
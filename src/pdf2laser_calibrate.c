@@ -0,0 +1,188 @@
+#include "pdf2laser_calibrate.h"
+#include <inttypes.h>                 // for PRId32
+#include <math.h>                     // for ceil, lround
+#include <stdbool.h>                  // for bool
+#include <stddef.h>                   // for NULL, size_t
+#include <stdint.h>                   // for int32_t, uint8_t
+#include <stdio.h>                    // for fprintf, printf, stderr
+#include <string.h>                   // for memset
+#include "type_calibration.h"         // for calibration_t
+#include "type_image.h"               // for image_t, image_create, image_destroy
+#include "type_print_job.h"           // for print_job_t, print_job_append_new_vector_list_config, print_job_range_check, PRINT_JOB_MODE_COMBINED, PRINT_JOB_MODE_RASTER, PRINT_JOB_MODE_VECTOR
+#include "type_raster.h"              // for raster_t, RASTER_MODE_GREY_SCALE
+#include "type_vector.h"              // for vector_create
+#include "type_vector_list.h"         // for vector_list_append, vector_list_t
+#include "type_vector_list_config.h"  // for vector_list_config_t, vector_list_config_destroy, vector_list_config_id_to_rgb
+
+/**
+ * Length of a row of cells, in points.
+ */
+static double calibrate_span(size_t count)
+{
+	return count * CALIBRATE_CELL_SIZE + (count - 1) * CALIBRATE_CELL_GAP;
+}
+
+/**
+ * Cut the outline of a cell whose top left corner is given in points.
+ */
+static void calibrate_cell(vector_list_t *list, double scale, double left, double top)
+{
+	int32_t x0 = lround(left * scale);
+	int32_t y0 = lround(top * scale);
+	int32_t x1 = lround((left + CALIBRATE_CELL_SIZE) * scale);
+	int32_t y1 = lround((top + CALIBRATE_CELL_SIZE) * scale);
+
+	vector_list_append(list, vector_create(x0, y0, x1, y0));
+	vector_list_append(list, vector_create(x1, y0, x1, y1));
+	vector_list_append(list, vector_create(x1, y1, x0, y1));
+	vector_list_append(list, vector_create(x0, y1, x0, y0));
+}
+
+/**
+ * Engrave a strip of one patch per power along the top of the card. The
+ * raster pass only has one speed and power, so the strip is engraved in grey
+ * scale at full power and the shade of each patch sets its power.
+ */
+static int calibrate_draw_raster(print_job_t *print_job)
+{
+	calibration_t *calibration = print_job->calibration;
+
+	double width = CALIBRATE_MARGIN + calibrate_span(calibration->powers_count);
+	double height = CALIBRATE_MARGIN + CALIBRATE_CELL_SIZE;
+	if (width > print_job->width || height > print_job->height) {
+		fprintf(stderr, "Calibration strip of %.0f points does not fit the bed\n", width);
+		return -1;
+	}
+
+	// one pixel per point
+	image_t *image = image_create((int32_t)ceil(width), (int32_t)ceil(height), 1);
+	image->resolution = 72.0;
+	memset(image->pixels, 255, (size_t)image->width * image->height);
+
+	int32_t top = lround(CALIBRATE_MARGIN);
+	int32_t size = lround(CALIBRATE_CELL_SIZE);
+	for (size_t index = 0; index < calibration->powers_count; index += 1) {
+		int32_t power = calibration->powers[index];
+		power = (power < 0) ? 0 : (power > 100) ? 100 : power;
+		uint8_t shade = (uint8_t)(255 - lround(255.0 * power / 100));
+
+		int32_t left = lround(CALIBRATE_MARGIN + index * (CALIBRATE_CELL_SIZE + CALIBRATE_CELL_GAP));
+		for (int32_t y = top; y < top + size && y < image->height; y += 1)
+			memset(image->pixels + (size_t)y * image->width + left, shade, size);
+	}
+
+	image_destroy(print_job->image);
+	print_job->image = image;
+	print_job->raster->mode = RASTER_MODE_GREY_SCALE;
+	print_job->raster->power = 100;
+
+	return 0;
+}
+
+/**
+ * Cut a grid of cells per frequency, with powers across and speeds down, each
+ * cell in a vector setting of its own. The settings of the job are replaced,
+ * its last one giving the number of passes and the frequency when the card
+ * does not step through frequencies.
+ */
+static int calibrate_draw_vector(print_job_t *print_job, double top)
+{
+	calibration_t *calibration = print_job->calibration;
+
+	int32_t multipass = 1;
+	int32_t frequency = CALIBRATE_FREQUENCY_DEFAULT;
+	vector_list_config_t *config = print_job->configs;
+	while (config != NULL) {
+		multipass = config->multipass;
+		frequency = config->frequency;
+
+		vector_list_config_t *next = config->next;
+		vector_list_config_destroy(config);
+		config = next;
+	}
+	print_job->configs = NULL;
+
+	int32_t *frequencies = calibration->frequencies;
+	size_t frequencies_count = calibration->frequencies_count;
+	if (frequencies_count == 0) {
+		frequencies = &frequency;
+		frequencies_count = 1;
+	}
+
+	double block_width = calibrate_span(calibration->powers_count);
+	double block_height = calibrate_span(calibration->speeds_count);
+
+	// blocks are laid out left to right, wrapping at the edge of the bed
+	size_t blocks_per_row = (print_job->width - 2 * CALIBRATE_MARGIN + CALIBRATE_BLOCK_GAP) / (block_width + CALIBRATE_BLOCK_GAP);
+	if (blocks_per_row == 0)
+		blocks_per_row = 1;
+	size_t block_rows = (frequencies_count + blocks_per_row - 1) / blocks_per_row;
+
+	double width = CALIBRATE_MARGIN + ((frequencies_count < blocks_per_row) ? frequencies_count : blocks_per_row) * (block_width + CALIBRATE_BLOCK_GAP) - CALIBRATE_BLOCK_GAP;
+	double height = top + block_rows * (block_height + CALIBRATE_BLOCK_GAP) - CALIBRATE_BLOCK_GAP;
+	if (width > print_job->width || height > print_job->height) {
+		fprintf(stderr, "Calibration card of %.0fx%.0f points does not fit the bed\n", width, height);
+		return -1;
+	}
+
+	double scale = print_job->raster->resolution / 72.0;
+	int32_t id = 0;
+
+	for (size_t block = 0; block < frequencies_count; block += 1) {
+		double block_left = CALIBRATE_MARGIN + (block % blocks_per_row) * (block_width + CALIBRATE_BLOCK_GAP);
+		double block_top = top + (block / blocks_per_row) * (block_height + CALIBRATE_BLOCK_GAP);
+
+		for (size_t row = 0; row < calibration->speeds_count; row += 1) {
+			for (size_t column = 0; column < calibration->powers_count; column += 1) {
+				// every cell is told apart by a colour of its own
+				int32_t red, green, blue;
+				id += 1;
+				vector_list_config_id_to_rgb(id, &red, &green, &blue);
+
+				config = print_job_append_new_vector_list_config(print_job, red, green, blue);
+				config->power = calibration->powers[column];
+				config->speed = calibration->speeds[row];
+				config->frequency = frequencies[block];
+				config->multipass = multipass;
+
+				calibrate_cell(config->vector_list, scale,
+				               block_left + column * (CALIBRATE_CELL_SIZE + CALIBRATE_CELL_GAP),
+				               block_top + row * (CALIBRATE_CELL_SIZE + CALIBRATE_CELL_GAP));
+			}
+		}
+	}
+
+	if (print_job->debug)
+		printf("Calibration cells: %"PRId32"\n", id);
+
+	return 0;
+}
+
+/**
+ * Draw a power and speed calibration card into a print job instead of
+ * reading a source: a strip of raster patches stepping through the powers,
+ * followed by a grid of cut cells for every power, speed and frequency. Jobs
+ * of one kind only get their part of the card.
+ *
+ * @return 0 on success, -1 if the card does not fit the bed.
+ */
+int calibrate_draw(print_job_t *print_job)
+{
+	bool raster = print_job->mode == PRINT_JOB_MODE_RASTER || print_job->mode == PRINT_JOB_MODE_COMBINED;
+	bool vector = print_job->mode == PRINT_JOB_MODE_VECTOR || print_job->mode == PRINT_JOB_MODE_COMBINED;
+
+	double top = CALIBRATE_MARGIN;
+	if (raster) {
+		if (calibrate_draw_raster(print_job))
+			return -1;
+		top += CALIBRATE_CELL_SIZE + CALIBRATE_BLOCK_GAP;
+	}
+
+	if (vector && calibrate_draw_vector(print_job, top))
+		return -1;
+
+	// the steps of the card may be outside what the printer takes
+	print_job_range_check(print_job);
+
+	return 0;
+}
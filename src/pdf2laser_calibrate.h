@@ -0,0 +1,34 @@
+#ifndef __PDF2LASER_CALIBRATE_H__
+#define __PDF2LASER_CALIBRATE_H__ 1
+
+#include "type_print_job.h"  // for print_job_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+// side of a cell of the card, in points
+#define CALIBRATE_CELL_SIZE (18.0)
+
+// space between neighbouring cells, in points
+#define CALIBRATE_CELL_GAP (9.0)
+
+// space between the raster strip and the blocks of each frequency, in points
+#define CALIBRATE_BLOCK_GAP (27.0)
+
+// space between the card and the corner of the bed, in points
+#define CALIBRATE_MARGIN (18.0)
+
+// frequency a card is cut at when the job has no vector settings, in hertz
+#define CALIBRATE_FREQUENCY_DEFAULT (500)
+
+int calibrate_draw(print_job_t *print_job);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
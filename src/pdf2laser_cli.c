@@ -1,26 +1,49 @@
 #include "pdf2laser_cli.h"
 #include <ctype.h>                    // for tolower
+#include <inttypes.h>                 // for SCNd32
 #include <stddef.h>                   // for NULL, offsetof, size_t
 #include <stdint.h>                   // for int32_t, uint64_t, uint8_t
 #include <stdio.h>                    // for fprintf, sscanf, stderr, stdout
 #include <stdlib.h>                   // for atoi, exit, EXIT_FAILURE, calloc, free, EXIT_SUCCESS
-#include <string.h>                   // for strndup, strtok, strncmp, strncpy, strnlen
+#include <string.h>                   // for strcmp, strndup, strtok, strncmp, strncpy, strnlen
 #include "config.h"                   // for FILENAME_NCHARS, HOSTNAME_NCHARS, PACKAGE, VERSION
 #define OPTPARSE_IMPLEMENTATION
 #define OPTPARSE_API static
 #include "optparse.h"                 // for OPTPARSE_REQUIRED, optparse, OPTPARSE_NONE, optparse_long, optparse_init
+#include "pdf2laser_counters.h"       // for counters_create
+#include "type_calibration.h"         // for calibration_t, calibration_create, calibration_parse_axis
+#include "type_estimate.h"            // for estimate_create
+#include "type_optimizer_report.h"    // for optimizer_report_create, optimizer_report_destroy
 #include "type_preset.h"              // for preset_apply_to_print_job, preset_t
 #include "type_preset_file.h"         // for preset_file_t
-#include "type_print_job.h"           // for print_job_t, print_job_append_new_vector_list_config, print_job_find_vector_list_config_by_rgb
+#include "type_print_job.h"           // for print_job_t, print_job_append_new_vector_list_config, print_job_find_vector_list_config_by_rgb, print_job_range_check
 #include "type_raster.h"              // for raster_t
+#include "type_timings.h"             // for timings_create, timings_destroy, timings_format, TIMINGS_FORMAT_JSON, TIMINGS_FORMAT_TABLE
+#include "type_transform.h"           // for transform_create, transform_parse_offset, transform_parse_rotation, transform_t
 #include "type_vector_list_config.h"  // for vector_list_config_t, vector_list_config_id_to_rgb
 
 static const struct optparse_long long_options[] = {
 	{"debug",                 'D',  OPTPARSE_NONE},
+	{"timings",               '%',  OPTPARSE_OPTIONAL},
+	{"trace",                 '*',  OPTPARSE_REQUIRED},
+	{"profile-counters",      '#',  OPTPARSE_NONE},
+	{"vector-report",         '+',  OPTPARSE_OPTIONAL},
 	{"printer",               'p',  OPTPARSE_REQUIRED},
+	{"fleet",                 '&',  OPTPARSE_REQUIRED},
+	{"output",                'o',  OPTPARSE_REQUIRED},
+	{"status",                '!',  OPTPARSE_NONE},
+	{"estimate",              'e',  OPTPARSE_NONE},
+	{"send-buffer",           '$',  OPTPARSE_REQUIRED},
+	{"tcp-nodelay",           '^',  OPTPARSE_NONE},
+	{"tcp-cork",              '~',  OPTPARSE_NONE},
 	{"preset",                'P',  OPTPARSE_REQUIRED},
 	{"autofocus",             'a',  OPTPARSE_NONE},
 	{"job-mode",              'j',  OPTPARSE_REQUIRED},
+	{"array",                 '|',  OPTPARSE_REQUIRED},
+	{"pitch",                 '_',  OPTPARSE_REQUIRED},
+	{"offset",                '<',  OPTPARSE_REQUIRED},
+	{"rotate",                '>',  OPTPARSE_REQUIRED},
+	{"mirror",                '/',  OPTPARSE_NONE},
 	{"job",                   'n',  OPTPARSE_REQUIRED},
 	{"raster-power",          'R',  OPTPARSE_REQUIRED},
 	{"raster-speed",          'r',  OPTPARSE_REQUIRED},
@@ -49,11 +72,24 @@ static void usage(int rc, const char * const msg)
 {
 	static const char usage_str[] =
 		"Usage: " PACKAGE " [OPTION]... [FILE]\n"
+		"  or:  " PACKAGE " [OPTION]... calibrate [POWERS [SPEEDS [FREQUENCIES]]]\n"
 		"\n"
 		"General options:\n"
 		"  -n, --job=JOBNAME              Set the job name to display\n"
 		"  -p, --printer=ADDRESS          ADDRESS of the printer\n"
+		"      --fleet=FILE               Send to the least loaded printer listed in FILE\n"
+		"  -o, --output=FILE              Write the job to FILE instead of a printer\n"
+		"      --status                   Show the queue state of the printer and exit\n"
+		"  -e, --estimate                 Show the estimated job duration and exit\n"
+		"      --send-buffer=BYTES        Socket send buffer size for the transfer\n"
+		"      --tcp-nodelay              Disable Nagle's algorithm for the transfer\n"
+		"      --tcp-cork                 Only send full frames during the transfer\n"
 		"  -j, --job-mode=MODE            Set job mode to Vector, Raster, or Combined\n"
+		"      --array=COLSxROWS          Cut COLS by ROWS copies of the job\n"
+		"      --pitch=DX,DY              Distance in inches between copies\n"
+		"      --offset=DX,DY             Move the job by DX,DY inches on the bed\n"
+		"      --rotate=DEGREES           Turn the job clockwise by 90, 180 or 270\n"
+		"      --mirror                   Flip the job left to right\n"
 		"  -P, --preset=PRESET            Load configuration preset\n"
 		"  -a, --autofocus                Enable auto focus\n"
 		"\n"
@@ -71,9 +107,13 @@ static void usage(int rc, const char * const msg)
 		"  -M, --vector-passes=PASSES     Number of times to repeat vector pass\n"
 		"  -O, --no-vector-optimize       Disable vector optimization\n"
 		"  -F, --no-vector-fallthrough    Disable automatic vector configuration\n"
+		"      --vector-report[=FORMAT]   Report transit saved by optimization as table or json\n"
 		"\n"
 		"Generic program options:\n"
 		"  -D, --debug                    Enable debug mode\n"
+		"      --timings[=FORMAT]         Report time spent per stage as table or json\n"
+		"      --trace=FILE               Write a Chrome trace of the job to FILE\n"
+		"      --profile-counters         Add hardware counters to the timing report\n"
 		"  -h, --help                     Output a usage message and exit\n"
 		"      --version                  Output the version number and exit\n"
 		"";
@@ -139,68 +179,6 @@ static int32_t vector_config_set_param_frequency(print_job_t *print_job, char *o
 	return vector_config_set_param_offset(print_job, optarg, offsetof(vector_list_config_t, frequency));
 }
 
-/**
- * Perform range validation checks on the major global variables to ensure
- * their values are sane. If values are outside accepted tolerances then modify
- * them to be the correct value.
- *
- * @return Nothing
- */
-static void range_checks(print_job_t *print_job)
-{
-	if (print_job->raster->power > 100) {
-		print_job->raster->power = 100;
-	}
-	else if (print_job->raster->power < 0) {
-		print_job->raster->power = 0;
-	}
-
-	if (print_job->raster->speed > 100) {
-		print_job->raster->speed = 100;
-	}
-	else if (print_job->raster->speed < 1) {
-		print_job->raster->speed = 1;
-	}
-
-	if (print_job->raster->resolution > 1200) {
-		print_job->raster->resolution = 1200;
-	}
-	else if (print_job->raster->resolution < 75) {
-		print_job->raster->resolution = 75;
-	}
-
-	if (print_job->raster->screen_size < 1) {
-		print_job->raster->screen_size = 1;
-	}
-
-	for (vector_list_config_t *current_config = print_job->configs; current_config != NULL; current_config = current_config->next) {
-		if (current_config->power > 100) {
-			current_config->power = 100;
-		}
-		else if (current_config->power < 0) {
-			current_config->power = 0;
-		}
-
-		if (current_config->speed > 100) {
-			current_config->speed = 100;
-		}
-		else if (current_config->speed < 1) {
-			current_config->speed = 1;
-		}
-
-		if (current_config->multipass < 1) {
-			current_config->multipass = 1;
-		}
-
-		if (current_config->frequency < 10) {
-			current_config->frequency = 10;
-		}
-		else if (current_config->frequency > 5000) {
-			current_config->frequency = 5000;
-		}
-	}
-}
-
 bool pdf2laser_optparse(print_job_t *print_job, preset_file_t **preset_files, size_t preset_files_count, int32_t argc, char **argv)
 {
 	struct optparse options;
@@ -226,7 +204,10 @@ bool pdf2laser_optparse(print_job_t *print_job, preset_file_t **preset_files, si
 			if (strncmp(preset, preset_files[index]->preset->name, FILENAME_NCHARS)) {
 				continue;
 			}
-			preset_apply_to_print_job(preset_files[index]->preset, print_job);
+			if (preset_apply_to_print_job(preset_files[index]->preset, print_job) == NULL) {
+				fprintf(stderr, "Invalid preset: %s\n", preset);
+				exit(-1);
+			}
 			preset_found = 1;
 			break;
 		}
@@ -245,14 +226,113 @@ bool pdf2laser_optparse(print_job_t *print_job, preset_file_t **preset_files, si
 	// Now we load command line options
 	optparse_init(&options, argv);
 
+	bool printer_given = false;
+
 	while ((option = optparse_long(&options, long_options, NULL)) != -1) {
 		switch (option) {
 		case 'D':
 			print_job->debug = true;
 			break;
 
+		case '%': {
+			timings_format format = TIMINGS_FORMAT_TABLE;
+			if (options.optarg != NULL && !strncmp(options.optarg, "json", 5))
+				format = TIMINGS_FORMAT_JSON;
+			else if (options.optarg != NULL && strncmp(options.optarg, "table", 6))
+				usage(EXIT_FAILURE, "timings format must be table or json\n");
+
+			timings_destroy(print_job->timings);
+			print_job->timings = timings_create(format);
+			break;
+		}
+
+		case '+': {
+			timings_format format = TIMINGS_FORMAT_TABLE;
+			if (options.optarg != NULL && !strncmp(options.optarg, "json", 5))
+				format = TIMINGS_FORMAT_JSON;
+			else if (options.optarg != NULL && strncmp(options.optarg, "table", 6))
+				usage(EXIT_FAILURE, "vector report format must be table or json\n");
+
+			optimizer_report_destroy(print_job->optimizer_report);
+			print_job->optimizer_report = optimizer_report_create(format);
+			break;
+		}
+
+		case '*':
+			free(print_job->trace_filename);
+			print_job->trace_filename = strndup(options.optarg, FILENAME_NCHARS);
+			break;
+
+		case '#':
+			print_job->profile_counters = true;
+			break;
+
 		case 'p':
+			free(print_job->host);
 			print_job->host = strndup(options.optarg, HOSTNAME_NCHARS);
+			printer_given = true;
+			break;
+
+		case '&':
+			free(print_job->fleet_filename);
+			print_job->fleet_filename = strndup(options.optarg, FILENAME_NCHARS);
+			break;
+
+		case 'o':
+			free(print_job->output_filename);
+			print_job->output_filename = strndup(options.optarg, FILENAME_NCHARS);
+			break;
+
+		case '!':
+			print_job->query_status = true;
+			break;
+
+		case 'e':
+			print_job->estimate_only = true;
+			break;
+
+		case '$':
+			print_job->send_buffer_size = atoi(options.optarg);
+			break;
+
+		case '^':
+			print_job->tcp_nodelay = true;
+			break;
+
+		case '~':
+			print_job->tcp_cork = true;
+			break;
+
+		case '|':
+			if (sscanf(options.optarg, "%"SCNd32"x%"SCNd32, &print_job->array_columns, &print_job->array_rows) != 2 ||
+			    print_job->array_columns < 1 || print_job->array_rows < 1)
+				usage(EXIT_FAILURE, "unable to parse array\n");
+			break;
+
+		case '_':
+			if (sscanf(options.optarg, "%lf,%lf", &print_job->pitch_x, &print_job->pitch_y) != 2 ||
+			    print_job->pitch_x < 0.0 || print_job->pitch_y < 0.0)
+				usage(EXIT_FAILURE, "unable to parse pitch\n");
+			break;
+
+		case '<':
+			if (print_job->transform == NULL)
+				print_job->transform = transform_create();
+			if (transform_parse_offset(print_job->transform, options.optarg))
+				usage(EXIT_FAILURE, "unable to parse offset\n");
+			break;
+
+		case '>':
+			if (print_job->transform == NULL)
+				print_job->transform = transform_create();
+			if (transform_parse_rotation(print_job->transform, options.optarg))
+				usage(EXIT_FAILURE, "rotation must be a multiple of 90 degrees\n");
+			break;
+
+		case '/':
+			if (print_job->transform == NULL)
+				print_job->transform = transform_create();
+			print_job->transform->mirror = true;
 			break;
 
 		case 'P':
@@ -336,7 +416,29 @@ bool pdf2laser_optparse(print_job_t *print_job, preset_file_t **preset_files, si
 		}
 	}
 
-	range_checks(print_job);
+	print_job_range_check(print_job);
+
+	// Copies of an array would land on top of each other without a pitch
+	if ((print_job->array_columns > 1 && print_job->pitch_x <= 0.0) ||
+	    (print_job->array_rows > 1 && print_job->pitch_y <= 0.0))
+		usage(EXIT_FAILURE, "array needs a pitch across and down\n");
+
+	// Counters are reported per stage, so they imply a timing report
+	if (print_job->profile_counters) {
+		if (print_job->timings == NULL)
+			print_job->timings = timings_create(TIMINGS_FORMAT_TABLE);
+		print_job->timings->counters = counters_create();
+	}
+
+	// An explicit printer always wins over fleet dispatch
+	if (printer_given && print_job->fleet_filename != NULL) {
+		free(print_job->fleet_filename);
+		print_job->fleet_filename = NULL;
+	}
+
+	// Fleet dispatch times the job against the motion limits of each printer
+	if (print_job->estimate_only || print_job->fleet_filename != NULL)
+		print_job->estimate = estimate_create();
 
 	// Skip any of the processed arguments
 	argc -= options.optind;
@@ -344,10 +446,25 @@ bool pdf2laser_optparse(print_job_t *print_job, preset_file_t **preset_files, si
 
 	// If there is an argument after, there must be only one
 	// and it will be the input postcript / pdf
-	if (argc > 1)
+	if (argc > 1 && strcmp(argv[0], "calibrate") != 0)
 		usage(EXIT_FAILURE, "Only one input file may be specified\n");
 
-	print_job->source_filename = argc ? strndup(argv[0], FILENAME_NCHARS) : "stdin";
+	print_job->source_filename = strndup(argc ? argv[0] : "stdin", FILENAME_NCHARS);
+
+	// A calibration card is drawn instead, stepping through the axes given
+	if (argc && strcmp(argv[0], "calibrate") == 0) {
+		calibration_t *calibration = calibration_create();
+		print_job->calibration = calibration;
+
+		if (argc > 4)
+			usage(EXIT_FAILURE, "calibrate takes at most powers, speeds and frequencies\n");
+		if (argc > 1 && calibration_parse_axis(argv[1], &calibration->powers, &calibration->powers_count))
+			usage(EXIT_FAILURE, "unable to parse calibration powers\n");
+		if (argc > 2 && calibration_parse_axis(argv[2], &calibration->speeds, &calibration->speeds_count))
+			usage(EXIT_FAILURE, "unable to parse calibration speeds\n");
+		if (argc > 3 && calibration_parse_axis(argv[3], &calibration->frequencies, &calibration->frequencies_count))
+			usage(EXIT_FAILURE, "unable to parse calibration frequencies\n");
+	}
 
 	return true;
 }
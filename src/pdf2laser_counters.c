@@ -0,0 +1,141 @@
+#define _DEFAULT_SOURCE
+
+#include "pdf2laser_counters.h"
+#include <stdbool.h>              // for bool, false, true
+#include <stdint.h>               // for uint64_t, uint32_t
+#include <stdio.h>                // for fprintf, perror, stderr, NULL
+#include <stdlib.h>               // for calloc, free
+#include <string.h>               // for memset
+#include <unistd.h>               // for close, read, ssize_t
+#include "config.h"               // for HAVE_LINUX_PERF_EVENT_H
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>     // for perf_event_attr, PERF_COUNT_HW_*, PERF_EVENT_IOC_*, PERF_FORMAT_GROUP, PERF_TYPE_HARDWARE
+#include <sys/ioctl.h>            // for ioctl
+#include <sys/syscall.h>          // for SYS_perf_event_open
+#endif
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+static const uint64_t counter_configs[COUNTERS_LENGTH] = {
+	[COUNTER_CYCLES] = PERF_COUNT_HW_CPU_CYCLES,
+	[COUNTER_INSTRUCTIONS] = PERF_COUNT_HW_INSTRUCTIONS,
+	[COUNTER_CACHE_MISSES] = PERF_COUNT_HW_CACHE_MISSES,
+	[COUNTER_BRANCH_MISSES] = PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+static int counters_open(uint64_t config, int group_fd)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.disabled = (group_fd == -1);
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP;
+
+	return syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+/**
+ * Open a group of hardware counters for the calling process. Counters the
+ * host does not offer (common in virtual machines) are left out of the
+ * group.
+ *
+ * @return The counters, or NULL if none could be opened.
+ */
+counters_t *counters_create(void)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+	counters_t *counters = calloc(1, sizeof(counters_t));
+	counters->group_fd = -1;
+	counters->length = 0;
+
+	for (uint32_t index = 0; index < COUNTERS_LENGTH; index += 1) {
+		counters->fds[index] = counters_open(counter_configs[index], counters->group_fd);
+		if (counters->fds[index] < 0)
+			continue;
+
+		if (counters->group_fd < 0)
+			counters->group_fd = counters->fds[index];
+
+		counters->slots[index] = counters->length;
+		counters->length += 1;
+	}
+
+	if (counters->group_fd < 0) {
+		perror("Unable to open hardware counters");
+		free(counters);
+		return NULL;
+	}
+
+	ioctl(counters->group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(counters->group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+	return counters;
+#else
+	fprintf(stderr, "Hardware counters are not supported on this platform\n");
+	return NULL;
+#endif
+}
+
+counters_t *counters_destroy(counters_t *self)
+{
+	if (self == NULL)
+		return NULL;
+
+	for (uint32_t index = 0; index < COUNTERS_LENGTH; index += 1) {
+		if (self->fds[index] >= 0 && self->fds[index] != self->group_fd)
+			close(self->fds[index]);
+	}
+
+	if (self->group_fd >= 0)
+		close(self->group_fd);
+
+	free(self);
+
+	return NULL;
+}
+
+bool counters_available(counters_t *self, counter_id id)
+{
+	return self != NULL && self->fds[id] >= 0;
+}
+
+/**
+ * Read the current value of every counter with a single system call.
+ * Counters which are not available read as 0.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int counters_read(counters_t *self, uint64_t values[COUNTERS_LENGTH])
+{
+	uint64_t buffer[1 + COUNTERS_LENGTH];
+
+	ssize_t expected = (1 + self->length) * sizeof(uint64_t);
+	if (read(self->group_fd, buffer, sizeof(buffer)) != expected)
+		return -1;
+
+	for (uint32_t index = 0; index < COUNTERS_LENGTH; index += 1)
+		values[index] = (self->fds[index] >= 0) ? buffer[1 + self->slots[index]] : 0;
+
+	return 0;
+}
+
+const char *counter_id_to_string(counter_id id)
+{
+	switch (id) {
+	case COUNTER_CYCLES:
+		return "cycles";
+	case COUNTER_INSTRUCTIONS:
+		return "instructions";
+	case COUNTER_CACHE_MISSES:
+		return "cache_misses";
+	case COUNTER_BRANCH_MISSES:
+		return "branch_misses";
+	default:
+		return "unknown";
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef __PDF2LASER_COUNTERS_H__
+#define __PDF2LASER_COUNTERS_H__ 1
+
+#include <stdbool.h>  // for bool
+#include <stdint.h>   // for uint32_t, uint64_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+typedef enum {
+	COUNTER_CYCLES,
+	COUNTER_INSTRUCTIONS,
+	COUNTER_CACHE_MISSES,
+	COUNTER_BRANCH_MISSES,
+	COUNTERS_LENGTH,
+} counter_id;
+
+typedef struct counters counters_t;
+struct counters {
+	int group_fd;                     // leader of the counter group
+	int fds[COUNTERS_LENGTH];         // -1 for counters the host does not offer
+	uint32_t slots[COUNTERS_LENGTH];  // position of each counter in a group read
+	uint32_t length;                  // number of counters in the group
+};
+
+counters_t *counters_create(void);
+counters_t *counters_destroy(counters_t *self);
+
+bool counters_available(counters_t *self, counter_id id);
+int counters_read(counters_t *self, uint64_t values[COUNTERS_LENGTH]);
+
+const char *counter_id_to_string(counter_id id);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,830 @@
+#include "pdf2laser_dxf.h"
+#include <ctype.h>                    // for isspace
+#include <inttypes.h>                 // for PRId32
+#include <math.h>                     // for acos, atan, atan2, ceil, cos, fabs, fmod, hypot, lround, sin, sqrt, M_PI
+#include <stdbool.h>                  // for bool, false, true
+#include <stddef.h>                   // for NULL, size_t
+#include <stdint.h>                   // for int32_t
+#include <stdio.h>                    // for fprintf, getline, printf, snprintf, stderr, FILE
+#include <stdlib.h>                   // for abs, atof, atoi, calloc, free, realloc, strtol
+#include <string.h>                   // for strcmp, strlen, strncmp, strndup
+#include <sys/types.h>                // for ssize_t
+#include "type_print_job.h"           // for print_job_t, print_job_clone_last_vector_list_config, print_job_find_vector_list_config_by_rgb
+#include "type_raster.h"              // for raster_t
+#include "type_vector.h"              // for vector_create
+#include "type_vector_list.h"         // for vector_list_append, vector_list_t
+#include "type_vector_list_config.h"  // for vector_list_config_t
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// colour index meaning the colour of the layer, or of the block for 0
+#define DXF_COLOR_BYBLOCK (0)
+#define DXF_COLOR_BYLAYER (256)
+#define DXF_COLOR_DEFAULT (7)
+
+// highest spline degree evaluated, splines above it are cut as their control polygon
+#define DXF_DEGREE_MAX (16)
+
+typedef enum {
+	DXF_SECTION_NONE,
+	DXF_SECTION_HEADER,
+	DXF_SECTION_TABLES,
+	DXF_SECTION_ENTITIES,
+	DXF_SECTION_OTHER,
+} dxf_section;
+
+typedef struct dxf_array dxf_array_t;
+struct dxf_array {
+	double *values;
+	size_t length;
+	size_t capacity;
+};
+
+typedef struct dxf_layer dxf_layer_t;
+struct dxf_layer {
+	char *name;
+	int32_t red;
+	int32_t green;
+	int32_t blue;
+	bool hidden;  // switched off or frozen
+};
+
+/**
+ * Group codes of the entity being read. Buffers are kept from one entity to
+ * the next so that large drawings do not allocate per entity.
+ */
+typedef struct dxf_entity dxf_entity_t;
+struct dxf_entity {
+	char type[DXF_NAME_NCHARS];
+	char layer[DXF_NAME_NCHARS];
+	int32_t color;       // colour index (62)
+	int32_t true_color;  // 24 bit rgb (420), -1 when not given
+	int32_t flags;       // 70
+	int32_t degree;      // 71
+	bool mirrored;       // extrusion direction along -z (230)
+
+	double x[2];         // 10, 11
+	double y[2];         // 20, 21
+	double radius;       // 40
+	double angles[2];    // 50, 51 in degrees
+	double bulge;        // 42
+
+	dxf_array_t xs;      // vertices or control points
+	dxf_array_t ys;
+	dxf_array_t bulges;
+	dxf_array_t knots;
+	dxf_array_t weights;
+	dxf_array_t fit_xs;
+	dxf_array_t fit_ys;
+};
+
+typedef struct dxf_parser dxf_parser_t;
+struct dxf_parser {
+	print_job_t *print_job;
+	FILE *file;
+
+	char *line;
+	size_t line_length;
+	int32_t line_number;
+	int32_t code;
+	char *value;
+
+	dxf_section section;
+	char variable[DXF_NAME_NCHARS];  // header variable being read
+	int32_t units;                   // $INSUNITS
+	int32_t measurement;             // $MEASUREMENT, -1 when not given
+
+	dxf_layer_t *layers;
+	size_t layers_length;
+	size_t layers_capacity;
+	dxf_layer_t *last_layer;         // cache for runs of entities on one layer
+
+	dxf_entity_t entity;
+	dxf_entity_t polyline;           // an old style POLYLINE collecting VERTEX entities
+	bool polyline_open;
+
+	double scale;                    // device units per drawing unit
+	double bed_height;               // in device units
+	vector_list_t *list;             // where the entity being drawn is cut, NULL to skip it
+	int32_t device_x;
+	int32_t device_y;
+
+	int32_t entities;
+	int32_t vectors;
+};
+
+static void dxf_array_push(dxf_array_t *self, double value)
+{
+	if (self->length == self->capacity) {
+		self->capacity = self->capacity ? 2 * self->capacity : 64;
+		self->values = realloc(self->values, self->capacity * sizeof(double));
+	}
+	self->values[self->length] = value;
+	self->length += 1;
+}
+
+static void dxf_array_set_last(dxf_array_t *self, double value)
+{
+	if (self->length > 0)
+		self->values[self->length - 1] = value;
+}
+
+static void dxf_entity_reset(dxf_entity_t *self, const char *type)
+{
+	snprintf(self->type, sizeof(self->type), "%s", type);
+	snprintf(self->layer, sizeof(self->layer), "0");
+	self->color = DXF_COLOR_BYLAYER;
+	self->true_color = -1;
+	self->flags = 0;
+	self->degree = 0;
+	self->mirrored = false;
+	self->x[0] = self->x[1] = 0.0;
+	self->y[0] = self->y[1] = 0.0;
+	self->radius = 0.0;
+	self->angles[0] = self->angles[1] = 0.0;
+	self->bulge = 0.0;
+	self->xs.length = 0;
+	self->ys.length = 0;
+	self->bulges.length = 0;
+	self->knots.length = 0;
+	self->weights.length = 0;
+	self->fit_xs.length = 0;
+	self->fit_ys.length = 0;
+}
+
+static void dxf_entity_free(dxf_entity_t *self)
+{
+	free(self->xs.values);
+	free(self->ys.values);
+	free(self->bulges.values);
+	free(self->knots.values);
+	free(self->weights.values);
+	free(self->fit_xs.values);
+	free(self->fit_ys.values);
+}
+
+/**
+ * Colour of an AutoCAD Color Index. The first nine and the greys are exact,
+ * the hue wheel in between is approximated from its hue, shade and
+ * saturation pattern.
+ */
+static void dxf_color_index_to_rgb(int32_t index, int32_t *red, int32_t *green, int32_t *blue)
+{
+	static const int32_t basic[10][3] = {
+		{0, 0, 0}, {255, 0, 0}, {255, 255, 0}, {0, 255, 0}, {0, 255, 255},
+		{0, 0, 255}, {255, 0, 255}, {0, 0, 0}, {128, 128, 128}, {192, 192, 192},
+	};
+	static const int32_t greys[6] = {51, 80, 105, 130, 190, 255};
+	static const double shades[5] = {1.0, 0.8, 0.6, 0.5, 0.3};
+
+	index = abs(index);
+	if (index < 10 || index > 255) {
+		if (index > 255)
+			index = DXF_COLOR_DEFAULT;
+		*red = basic[index][0];
+		*green = basic[index][1];
+		*blue = basic[index][2];
+		return;
+	}
+
+	if (index >= 250) {
+		*red = *green = *blue = greys[index - 250];
+		return;
+	}
+
+	double hue = (index / 10 - 1) * 15.0 / 60.0;
+	double value = 255.0 * shades[(index % 10) / 2];
+	double saturation = (index % 2) ? 0.5 : 1.0;
+
+	double chroma = value * saturation;
+	double x = chroma * (1.0 - fabs(fmod(hue, 2.0) - 1.0));
+	double m = value - chroma;
+	double rgb[3];
+	switch ((int)hue) {
+	case 0:  rgb[0] = chroma; rgb[1] = x;      rgb[2] = 0.0;    break;
+	case 1:  rgb[0] = x;      rgb[1] = chroma; rgb[2] = 0.0;    break;
+	case 2:  rgb[0] = 0.0;    rgb[1] = chroma; rgb[2] = x;      break;
+	case 3:  rgb[0] = 0.0;    rgb[1] = x;      rgb[2] = chroma; break;
+	case 4:  rgb[0] = x;      rgb[1] = 0.0;    rgb[2] = chroma; break;
+	default: rgb[0] = chroma; rgb[1] = 0.0;    rgb[2] = x;      break;
+	}
+
+	*red = lround(rgb[0] + m);
+	*green = lround(rgb[1] + m);
+	*blue = lround(rgb[2] + m);
+}
+
+static void dxf_true_color_to_rgb(int32_t true_color, int32_t *red, int32_t *green, int32_t *blue)
+{
+	*red = (true_color >> 16) & 0xff;
+	*green = (true_color >> 8) & 0xff;
+	*blue = true_color & 0xff;
+}
+
+/**
+ * Read the next group, a code line followed by a value line. Values are
+ * trimmed of surrounding white space and line endings.
+ *
+ * @return true if a group was read, false at the end of the file.
+ */
+static bool dxf_next(dxf_parser_t *self)
+{
+	ssize_t length_read = getline(&self->line, &self->line_length, self->file);
+	if (length_read == -1)
+		return false;
+	self->line_number += 1;
+	self->code = atoi(self->line);
+
+	length_read = getline(&self->line, &self->line_length, self->file);
+	if (length_read == -1)
+		return false;
+	self->line_number += 1;
+
+	char *value = self->line;
+	while (isspace((unsigned char)*value))
+		value += 1;
+	size_t length = strlen(value);
+	while (length > 0 && isspace((unsigned char)value[length - 1]))
+		length -= 1;
+	value[length] = '\0';
+	self->value = value;
+
+	return true;
+}
+
+static dxf_layer_t *dxf_find_layer(dxf_parser_t *self, const char *name)
+{
+	if (self->last_layer != NULL && strcmp(self->last_layer->name, name) == 0)
+		return self->last_layer;
+
+	for (size_t index = 0; index < self->layers_length; index += 1) {
+		if (strcmp(self->layers[index].name, name) == 0) {
+			self->last_layer = &(self->layers[index]);
+			return self->last_layer;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Record a LAYER table entry with the colour it gives its entities.
+ */
+static void dxf_add_layer(dxf_parser_t *self, dxf_entity_t *entry)
+{
+	if (self->layers_length == self->layers_capacity) {
+		self->layers_capacity = self->layers_capacity ? 2 * self->layers_capacity : 16;
+		self->layers = realloc(self->layers, self->layers_capacity * sizeof(dxf_layer_t));
+		self->last_layer = NULL;
+	}
+
+	dxf_layer_t *layer = &(self->layers[self->layers_length]);
+	self->layers_length += 1;
+
+	layer->name = strndup(entry->layer, DXF_NAME_NCHARS);
+	if (entry->true_color >= 0)
+		dxf_true_color_to_rgb(entry->true_color, &layer->red, &layer->green, &layer->blue);
+	else
+		dxf_color_index_to_rgb(entry->color, &layer->red, &layer->green, &layer->blue);
+
+	// a negative colour switches the layer off, flag 1 freezes it
+	layer->hidden = (entry->color < 0) || (entry->flags & 1);
+}
+
+/**
+ * Find the vector list an entity is cut into from its own colour or that of
+ * its layer, following the same fallthrough rules as colours found by
+ * Ghostscript.
+ *
+ * @return The vector list or NULL if the entity is not cut.
+ */
+static vector_list_t *dxf_vector_list(dxf_parser_t *self, dxf_entity_t *entity)
+{
+	dxf_layer_t *layer = dxf_find_layer(self, entity->layer);
+	if (layer != NULL && layer->hidden)
+		return NULL;
+
+	int32_t red, green, blue;
+	if (entity->true_color >= 0) {
+		dxf_true_color_to_rgb(entity->true_color, &red, &green, &blue);
+	}
+	else if (entity->color != DXF_COLOR_BYLAYER && entity->color != DXF_COLOR_BYBLOCK) {
+		dxf_color_index_to_rgb(entity->color, &red, &green, &blue);
+	}
+	else if (layer != NULL) {
+		red = layer->red;
+		green = layer->green;
+		blue = layer->blue;
+	}
+	else {
+		dxf_color_index_to_rgb(DXF_COLOR_DEFAULT, &red, &green, &blue);
+	}
+
+	print_job_t *print_job = self->print_job;
+	vector_list_config_t *config = print_job_find_vector_list_config_by_rgb(print_job, red, green, blue);
+	if (config == NULL && print_job->vector_fallthrough)
+		config = print_job_clone_last_vector_list_config(print_job, red, green, blue);
+
+	return (config != NULL) ? config->vector_list : NULL;
+}
+
+static void dxf_device(dxf_parser_t *self, double x, double y, int32_t *device_x, int32_t *device_y)
+{
+	*device_x = lround(x * self->scale);
+	*device_y = lround(self->bed_height - y * self->scale);
+}
+
+static void dxf_move_to(dxf_parser_t *self, double x, double y)
+{
+	dxf_device(self, x, y, &self->device_x, &self->device_y);
+}
+
+static void dxf_line_to(dxf_parser_t *self, double x, double y)
+{
+	int32_t device_x, device_y;
+	dxf_device(self, x, y, &device_x, &device_y);
+
+	if (device_x != self->device_x || device_y != self->device_y) {
+		vector_list_append(self->list, vector_create(self->device_x, self->device_y, device_x, device_y));
+		self->vectors += 1;
+	}
+
+	self->device_x = device_x;
+	self->device_y = device_y;
+}
+
+/**
+ * Flatten an arc from the current point, which must lie on it, keeping the
+ * chords within DXF_FLATNESS device units of the arc.
+ *
+ * @param start angle of the current point in radians.
+ * @param sweep signed angle to turn through, counterclockwise when positive.
+ */
+static void dxf_arc(dxf_parser_t *self, double cx, double cy, double radius, double start, double sweep)
+{
+	double device_radius = radius * self->scale;
+	int segments = 1;
+	if (device_radius > DXF_FLATNESS)
+		segments = (int)ceil(fabs(sweep) / (2.0 * acos(1.0 - DXF_FLATNESS / device_radius)));
+	if (segments > DXF_SEGMENTS_MAX)
+		segments = DXF_SEGMENTS_MAX;
+	if (segments < 1)
+		segments = 1;
+
+	for (int index = 1; index <= segments; index += 1) {
+		double angle = start + sweep * index / segments;
+		dxf_line_to(self, cx + radius * cos(angle), cy + radius * sin(angle));
+	}
+}
+
+/**
+ * Draw a polyline, where the bulge of a vertex turns the segment leaving it
+ * into an arc of included angle 4 atan(bulge).
+ */
+static void dxf_draw_polyline(dxf_parser_t *self, dxf_entity_t *entity, double mirror)
+{
+	size_t length = entity->xs.length;
+	if (length == 0)
+		return;
+
+	const double *xs = entity->xs.values;
+	const double *ys = entity->ys.values;
+	const double *bulges = entity->bulges.values;
+	bool closed = entity->flags & 1;
+
+	dxf_move_to(self, mirror * xs[0], ys[0]);
+
+	size_t segments = closed ? length : length - 1;
+	for (size_t index = 0; index < segments; index += 1) {
+		size_t next = (index + 1) % length;
+		double x0 = mirror * xs[index];
+		double y0 = ys[index];
+		double x1 = mirror * xs[next];
+		double y1 = ys[next];
+		double bulge = mirror * ((index < entity->bulges.length) ? bulges[index] : 0.0);
+
+		double chord = hypot(x1 - x0, y1 - y0);
+		if (bulge == 0.0 || chord == 0.0) {
+			dxf_line_to(self, x1, y1);
+			continue;
+		}
+
+		// the center lies off the middle of the chord, to its left for a positive bulge
+		double offset = (1.0 - bulge * bulge) / (4.0 * bulge);
+		double cx = (x0 + x1) / 2.0 - offset * (y1 - y0);
+		double cy = (y0 + y1) / 2.0 + offset * (x1 - x0);
+		double radius = hypot(x0 - cx, y0 - cy);
+
+		dxf_arc(self, cx, cy, radius, atan2(y0 - cy, x0 - cx), 4.0 * atan(bulge));
+		dxf_line_to(self, x1, y1);
+	}
+}
+
+/**
+ * Evaluate a (rational) B-spline with de Boor's algorithm.
+ *
+ * @param span index of the knot span holding u.
+ */
+static void dxf_spline_point(dxf_entity_t *entity, size_t span, double u, double *x, double *y)
+{
+	int32_t degree = entity->degree;
+	const double *knots = entity->knots.values;
+	bool rational = entity->weights.length == entity->xs.length;
+
+	double dx[DXF_DEGREE_MAX + 1];
+	double dy[DXF_DEGREE_MAX + 1];
+	double dw[DXF_DEGREE_MAX + 1];
+
+	for (int32_t j = 0; j <= degree; j += 1) {
+		size_t i = span - degree + j;
+		double w = rational ? entity->weights.values[i] : 1.0;
+		dx[j] = entity->xs.values[i] * w;
+		dy[j] = entity->ys.values[i] * w;
+		dw[j] = w;
+	}
+
+	for (int32_t r = 1; r <= degree; r += 1) {
+		for (int32_t j = degree; j >= r; j -= 1) {
+			size_t i = span - degree + j;
+			double denominator = knots[i + degree - r + 1] - knots[i];
+			double alpha = (denominator != 0.0) ? (u - knots[i]) / denominator : 0.0;
+			dx[j] = (1.0 - alpha) * dx[j - 1] + alpha * dx[j];
+			dy[j] = (1.0 - alpha) * dy[j - 1] + alpha * dy[j];
+			dw[j] = (1.0 - alpha) * dw[j - 1] + alpha * dw[j];
+		}
+	}
+
+	*x = dx[degree] / dw[degree];
+	*y = dy[degree] / dw[degree];
+}
+
+/**
+ * Draw a spline through its knot spans, flattening each span into segments
+ * by the length of the control points it depends on. Splines without a
+ * usable knot vector are cut through their fit points, or failing that
+ * along their control polygon.
+ */
+static void dxf_draw_spline(dxf_parser_t *self, dxf_entity_t *entity, double mirror)
+{
+	size_t count = entity->xs.length;
+	int32_t degree = entity->degree;
+
+	if (degree < 1 || degree > DXF_DEGREE_MAX || count <= (size_t)degree ||
+	    entity->knots.length != count + degree + 1 ||
+	    (entity->weights.length != 0 && entity->weights.length != count)) {
+		dxf_entity_t polyline = *entity;
+		polyline.flags = entity->flags & 1;
+		polyline.bulges.length = 0;
+		if (entity->fit_xs.length > 0) {
+			polyline.xs = entity->fit_xs;
+			polyline.ys = entity->fit_ys;
+		}
+		dxf_draw_polyline(self, &polyline, mirror);
+		return;
+	}
+
+	const double *knots = entity->knots.values;
+	double x, y;
+
+	dxf_spline_point(entity, degree, knots[degree], &x, &y);
+	dxf_move_to(self, mirror * x, y);
+
+	for (size_t span = degree; span < count; span += 1) {
+		if (knots[span + 1] <= knots[span])
+			continue;
+
+		double length = 0.0;
+		for (size_t i = span - degree + 1; i <= span; i += 1)
+			length += hypot(entity->xs.values[i] - entity->xs.values[i - 1], entity->ys.values[i] - entity->ys.values[i - 1]);
+
+		int segments = (int)ceil(sqrt(length * self->scale / DXF_FLATNESS) / 2.0);
+		if (segments < 1)
+			segments = 1;
+		if (segments > DXF_SEGMENTS_MAX)
+			segments = DXF_SEGMENTS_MAX;
+
+		for (int index = 1; index <= segments; index += 1) {
+			double u = knots[span] + (knots[span + 1] - knots[span]) * index / segments;
+			dxf_spline_point(entity, span, u, &x, &y);
+			dxf_line_to(self, mirror * x, y);
+		}
+	}
+}
+
+/**
+ * Cut a finished entity. Entities are given in their object coordinate
+ * system, which for the common case of an extrusion along -z mirrors x.
+ */
+static void dxf_draw(dxf_parser_t *self, dxf_entity_t *entity)
+{
+	self->list = dxf_vector_list(self, entity);
+	if (self->list == NULL)
+		return;
+
+	double mirror = entity->mirrored ? -1.0 : 1.0;
+	self->entities += 1;
+
+	if (strcmp(entity->type, "LINE") == 0) {
+		dxf_move_to(self, entity->x[0], entity->y[0]);
+		dxf_line_to(self, entity->x[1], entity->y[1]);
+	}
+	else if (strcmp(entity->type, "CIRCLE") == 0) {
+		double cx = mirror * entity->x[0];
+		dxf_move_to(self, cx + entity->radius, entity->y[0]);
+		dxf_arc(self, cx, entity->y[0], entity->radius, 0.0, 2.0 * M_PI);
+	}
+	else if (strcmp(entity->type, "ARC") == 0) {
+		double start = entity->angles[0] * M_PI / 180.0;
+		double sweep = fmod(entity->angles[1] - entity->angles[0], 360.0);
+		if (sweep <= 0.0)
+			sweep += 360.0;
+		sweep *= M_PI / 180.0;
+
+		// mirroring x turns counterclockwise arcs clockwise
+		double cx = mirror * entity->x[0];
+		start = entity->mirrored ? M_PI - start : start;
+		sweep = mirror * sweep;
+
+		dxf_move_to(self, cx + entity->radius * cos(start), entity->y[0] + entity->radius * sin(start));
+		dxf_arc(self, cx, entity->y[0], entity->radius, start, sweep);
+	}
+	else if (strcmp(entity->type, "LWPOLYLINE") == 0 || strcmp(entity->type, "POLYLINE") == 0) {
+		dxf_draw_polyline(self, entity, mirror);
+	}
+	else if (strcmp(entity->type, "SPLINE") == 0) {
+		dxf_draw_spline(self, entity, mirror);
+	}
+	else {
+		self->entities -= 1;
+	}
+}
+
+/**
+ * Take the group just read into the entity being built.
+ */
+static void dxf_entity_group(dxf_entity_t *entity, int32_t code, const char *value)
+{
+	bool vertices = strcmp(entity->type, "LWPOLYLINE") == 0 || strcmp(entity->type, "SPLINE") == 0;
+
+	switch (code) {
+	case 2:
+	case 8:
+		// table entries are named by 2, entities are placed by 8
+		snprintf(entity->layer, sizeof(entity->layer), "%s", value);
+		break;
+	case 10:
+		if (vertices) {
+			dxf_array_push(&entity->xs, atof(value));
+			dxf_array_push(&entity->ys, 0.0);
+			dxf_array_push(&entity->bulges, 0.0);
+		}
+		else {
+			entity->x[0] = atof(value);
+		}
+		break;
+	case 20:
+		if (vertices)
+			dxf_array_set_last(&entity->ys, atof(value));
+		else
+			entity->y[0] = atof(value);
+		break;
+	case 11:
+		if (vertices) {
+			dxf_array_push(&entity->fit_xs, atof(value));
+			dxf_array_push(&entity->fit_ys, 0.0);
+		}
+		else {
+			entity->x[1] = atof(value);
+		}
+		break;
+	case 21:
+		if (vertices)
+			dxf_array_set_last(&entity->fit_ys, atof(value));
+		else
+			entity->y[1] = atof(value);
+		break;
+	case 40:
+		if (strcmp(entity->type, "SPLINE") == 0)
+			dxf_array_push(&entity->knots, atof(value));
+		else
+			entity->radius = atof(value);
+		break;
+	case 41:
+		if (strcmp(entity->type, "SPLINE") == 0)
+			dxf_array_push(&entity->weights, atof(value));
+		break;
+	case 42:
+		if (vertices)
+			dxf_array_set_last(&entity->bulges, atof(value));
+		else
+			entity->bulge = atof(value);
+		break;
+	case 50:
+		entity->angles[0] = atof(value);
+		break;
+	case 51:
+		entity->angles[1] = atof(value);
+		break;
+	case 62:
+		entity->color = atoi(value);
+		break;
+	case 70:
+		entity->flags = atoi(value);
+		break;
+	case 71:
+		entity->degree = atoi(value);
+		break;
+	case 230:
+		entity->mirrored = atof(value) < 0.0;
+		break;
+	case 420:
+		entity->true_color = strtol(value, NULL, 10) & 0xffffff;
+		break;
+	}
+}
+
+/**
+ * Finish the entity or table entry just read, before the next one starts.
+ * Old style polylines are collected from their VERTEX entities and drawn at
+ * their SEQEND.
+ */
+static void dxf_finish(dxf_parser_t *self)
+{
+	dxf_entity_t *entity = &(self->entity);
+
+	if (self->section == DXF_SECTION_TABLES) {
+		if (strcmp(entity->type, "LAYER") == 0)
+			dxf_add_layer(self, entity);
+		return;
+	}
+
+	if (self->section != DXF_SECTION_ENTITIES)
+		return;
+
+	if (strcmp(entity->type, "POLYLINE") == 0) {
+		dxf_entity_t *polyline = &(self->polyline);
+		dxf_entity_reset(polyline, "POLYLINE");
+		snprintf(polyline->layer, sizeof(polyline->layer), "%s", entity->layer);
+		polyline->color = entity->color;
+		polyline->true_color = entity->true_color;
+		polyline->flags = entity->flags;
+		polyline->mirrored = entity->mirrored;
+		self->polyline_open = true;
+	}
+	else if (strcmp(entity->type, "VERTEX") == 0) {
+		if (self->polyline_open) {
+			dxf_array_push(&self->polyline.xs, entity->x[0]);
+			dxf_array_push(&self->polyline.ys, entity->y[0]);
+			dxf_array_push(&self->polyline.bulges, entity->bulge);
+		}
+	}
+	else if (strcmp(entity->type, "SEQEND") == 0) {
+		if (self->polyline_open)
+			dxf_draw(self, &self->polyline);
+		self->polyline_open = false;
+	}
+	else {
+		dxf_draw(self, entity);
+	}
+}
+
+/**
+ * Drawing units in inches, from $INSUNITS or failing that $MEASUREMENT.
+ * Unitless drawings are taken to be in millimetres.
+ */
+static double dxf_units_to_inches(dxf_parser_t *self)
+{
+	switch (self->units) {
+	case 1:  return 1.0;            // inches
+	case 2:  return 12.0;           // feet
+	case 4:  return 1.0 / 25.4;     // millimetres
+	case 5:  return 1.0 / 2.54;     // centimetres
+	case 6:  return 1000.0 / 25.4;  // metres
+	case 8:  return 1.0e-6;         // microinches
+	case 9:  return 1.0e-3;         // mils
+	case 13: return 1.0e-3 / 25.4;  // microns
+	case 14: return 10.0 / 25.4;    // decimetres
+	}
+
+	return (self->measurement == 0) ? 1.0 : 1.0 / 25.4;
+}
+
+static void dxf_header_group(dxf_parser_t *self)
+{
+	if (self->code == 9) {
+		snprintf(self->variable, sizeof(self->variable), "%s", self->value);
+	}
+	else if (self->code == 70) {
+		if (strcmp(self->variable, "$INSUNITS") == 0)
+			self->units = atoi(self->value);
+		else if (strcmp(self->variable, "$MEASUREMENT") == 0)
+			self->measurement = atoi(self->value);
+	}
+}
+
+/**
+ * Start the section named by the group following a SECTION marker. Units are
+ * fixed once the header has been read, before any entity is drawn.
+ */
+static void dxf_section_begin(dxf_parser_t *self)
+{
+	if (strcmp(self->value, "HEADER") == 0) {
+		self->section = DXF_SECTION_HEADER;
+	}
+	else if (strcmp(self->value, "TABLES") == 0) {
+		self->section = DXF_SECTION_TABLES;
+	}
+	else if (strcmp(self->value, "ENTITIES") == 0) {
+		self->section = DXF_SECTION_ENTITIES;
+		self->scale = dxf_units_to_inches(self) * self->print_job->raster->resolution;
+	}
+	else {
+		self->section = DXF_SECTION_OTHER;
+	}
+}
+
+/**
+ * Read the lines, arcs, circles, polylines and splines of an ASCII DXF
+ * drawing straight into the vector lists of a print job, without going
+ * through Ghostscript.
+ *
+ * The file is read one group at a time and every entity is cut as soon as it
+ * ends, so that memory use does not grow with the size of the drawing.
+ * Entities are cut in their own colour or that of their layer, hidden layers
+ * are skipped, and the drawing origin is placed at the bottom left corner of
+ * the bed.
+ *
+ * @return 0 on success, -1 if the drawing could not be read.
+ */
+int dxf_parse(print_job_t *print_job, FILE *dxf_file)
+{
+	dxf_parser_t *self = calloc(1, sizeof(dxf_parser_t));
+	self->print_job = print_job;
+	self->file = dxf_file;
+	self->section = DXF_SECTION_NONE;
+	self->units = 0;
+	self->measurement = -1;
+	self->polyline_open = false;
+	self->bed_height = print_job->height / 72.0 * print_job->raster->resolution;
+	dxf_entity_reset(&self->entity, "");
+
+	int rc = 0;
+	bool ended = false;
+	bool entity_open = false;
+	bool section_open = false;
+
+	while (!ended && dxf_next(self)) {
+		if (self->line_number == 2 && strncmp(self->line, "AutoCAD Binary DXF", 18) == 0) {
+			fprintf(stderr, "Binary DXF files are not supported\n");
+			rc = -1;
+			break;
+		}
+
+		if (self->code != 0) {
+			if (section_open && self->code == 2)
+				dxf_section_begin(self);
+			else if (self->section == DXF_SECTION_HEADER)
+				dxf_header_group(self);
+			else if (entity_open)
+				dxf_entity_group(&self->entity, self->code, self->value);
+			section_open = false;
+			continue;
+		}
+
+		if (entity_open)
+			dxf_finish(self);
+		entity_open = false;
+		section_open = false;
+
+		dxf_entity_reset(&self->entity, self->value);
+
+		if (strcmp(self->value, "SECTION") == 0)
+			section_open = true;
+		else if (strcmp(self->value, "ENDSEC") == 0)
+			self->section = DXF_SECTION_NONE;
+		else if (strcmp(self->value, "EOF") == 0)
+			ended = true;
+		else if (self->section == DXF_SECTION_TABLES || self->section == DXF_SECTION_ENTITIES)
+			entity_open = true;
+	}
+
+	if (rc == 0 && !ended) {
+		fprintf(stderr, "DXF file ends without EOF after line %"PRId32"\n", self->line_number);
+		rc = -1;
+	}
+
+	if (print_job->debug)
+		printf("DXF entities: %"PRId32" vectors: %"PRId32"\n", self->entities, self->vectors);
+
+	for (size_t index = 0; index < self->layers_length; index += 1)
+		free(self->layers[index].name);
+	free(self->layers);
+	dxf_entity_free(&self->entity);
+	dxf_entity_free(&self->polyline);
+	free(self->line);
+	free(self);
+
+	return rc;
+}
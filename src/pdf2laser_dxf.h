@@ -0,0 +1,29 @@
+#ifndef __PDF2LASER_DXF_H__
+#define __PDF2LASER_DXF_H__ 1
+
+#include <stdio.h>           // for FILE
+#include "type_print_job.h"  // for print_job_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+// longest layer or entity name kept, longer ones are truncated
+#define DXF_NAME_NCHARS (256)
+
+// largest distance in device units between a curve and its flattened segments
+#define DXF_FLATNESS (0.5)
+
+// most segments a single curve is flattened into
+#define DXF_SEGMENTS_MAX (4096)
+
+int dxf_parse(print_job_t *print_job, FILE *dxf_file);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+#include "pdf2laser_estimate.h"
+#include <math.h>                     // for fmax, hypot
+#include <stddef.h>                   // for NULL, size_t
+#include <stdint.h>                   // for int32_t, int64_t, uint32_t
+#include "type_estimate.h"            // for estimate_breakdown_t, estimate_row_t, estimate_t
+#include "type_kinematics.h"          // for kinematics_t, kinematics_move_seconds
+#include "type_print_job.h"           // for print_job_t, PRINT_JOB_MODE_COMBINED, PRINT_JOB_MODE_VECTOR
+#include "type_raster.h"              // for raster_t
+#include "type_vector.h"              // for vector_t
+#include "type_vector_list.h"         // for vector_list_t
+#include "type_vector_list_config.h"  // for vector_list_config_t
+
+/**
+ * Speed the head can carry from one cut into the next without stopping. The
+ * head stops between cuts which do not join and slows down in proportion to
+ * how sharply the path turns where they do, coming to a stop for a right
+ * angle or worse.
+ */
+static double estimate_junction_speed(vector_t *vector, vector_t *next, double speed)
+{
+	if (next == NULL || vector->end->x != next->start->x || vector->end->y != next->start->y)
+		return 0.0;
+
+	double ax = (double)vector->end->x - vector->start->x;
+	double ay = (double)vector->end->y - vector->start->y;
+	double bx = (double)next->end->x - next->start->x;
+	double by = (double)next->end->y - next->start->y;
+
+	double lengths = hypot(ax, ay) * hypot(bx, by);
+	if (lengths == 0.0)
+		return speed;
+
+	return speed * fmax(0.0, (ax * bx + ay * by) / lengths);
+}
+
+/**
+ * Estimate how long a machine takes to run a vector list once, in the order
+ * given. Every cut which does not start where the last one ended costs a pen
+ * up and a transit at the transit speed, so this doubles as the cost of a
+ * tour for the optimizer.
+ *
+ * @param resolution units per inch of the vector coordinates.
+ * @param speed the vector speed setting of the list, in percent.
+ * @param breakdown counts and times are added to it when not NULL.
+ *
+ * @return The estimated duration in seconds.
+ */
+double estimate_vector_list(kinematics_t *kinematics, vector_list_t *vector_list, uint32_t resolution, int32_t speed, estimate_breakdown_t *breakdown)
+{
+	double cut_speed = kinematics->vector_speed * speed / 100.0;
+
+	int32_t cuts = 0;
+	double cut_seconds = 0.0;
+
+	int32_t pen_ups = 0;
+	double transit_seconds = 0.0;
+
+	int32_t current_x = 0;
+	int32_t current_y = 0;
+	double entry_speed = 0.0;
+
+	for (vector_t *vector = vector_list->head; vector != NULL; vector = vector->next) {
+		int64_t transit_dx = (int64_t)vector->start->x - current_x;
+		int64_t transit_dy = (int64_t)vector->start->y - current_y;
+		if (transit_dx || transit_dy) {
+			pen_ups += 1;
+			transit_seconds += kinematics->pen_up_seconds
+				+ kinematics_move_seconds(kinematics, hypot(transit_dx, transit_dy) / resolution, kinematics->transit_speed, 0.0, 0.0);
+			entry_speed = 0.0;
+		}
+
+		double exit_speed = estimate_junction_speed(vector, vector->next, cut_speed);
+
+		int64_t cut_dx = (int64_t)vector->end->x - vector->start->x;
+		int64_t cut_dy = (int64_t)vector->end->y - vector->start->y;
+		if (cut_dx || cut_dy) {
+			cuts += 1;
+			cut_seconds += kinematics_move_seconds(kinematics, hypot(cut_dx, cut_dy) / resolution, cut_speed, entry_speed, exit_speed);
+		}
+
+		entry_speed = exit_speed;
+		current_x = vector->end->x;
+		current_y = vector->end->y;
+	}
+
+	if (breakdown != NULL) {
+		breakdown->cuts += cuts;
+		breakdown->vector_seconds += cut_seconds;
+		breakdown->pen_ups += pen_ups;
+		breakdown->transit_seconds += transit_seconds;
+	}
+
+	return cut_seconds + transit_seconds;
+}
+
+/**
+ * Estimate how long a machine takes to engrave the recorded raster rows. Each
+ * row is run from a standstill at the raster speed and the head steps to the
+ * start of the next row at the transit speed.
+ *
+ * @param resolution pixels per inch of the rows.
+ * @param speed the raster speed setting of the job, in percent.
+ * @param breakdown counts and times are added to it when not NULL.
+ *
+ * @return The estimated duration in seconds.
+ */
+double estimate_raster(kinematics_t *kinematics, estimate_t *estimate, uint32_t resolution, int32_t speed, estimate_breakdown_t *breakdown)
+{
+	double row_speed = kinematics->raster_speed * speed / 100.0;
+	double seconds = 0.0;
+
+	int32_t current_x = 0;
+	int32_t current_y = 0;
+
+	for (size_t index = 0; index < estimate->rows_length; index += 1) {
+		estimate_row_t *row = &(estimate->rows[index]);
+		int32_t start = row->reverse ? row->right : row->left;
+		int32_t end = row->reverse ? row->left : row->right;
+
+		double step = hypot((double)start - current_x, (double)row->y - current_y) / resolution;
+		seconds += kinematics_move_seconds(kinematics, step, kinematics->transit_speed, 0.0, 0.0);
+		seconds += kinematics_move_seconds(kinematics, (double)(row->right - row->left) / resolution, row_speed, 0.0, 0.0);
+
+		current_x = end;
+		current_y = row->y;
+	}
+
+	if (breakdown != NULL) {
+		breakdown->raster_rows += (int32_t)estimate->rows_length;
+		breakdown->raster_seconds += seconds;
+	}
+
+	return seconds;
+}
+
+/**
+ * Estimate how long a machine takes to run a generated print job: the raster
+ * rows recorded in its estimate followed by every vector list, once per pass.
+ *
+ * @param breakdown filled in with the times by kind of motion when not NULL.
+ *
+ * @return The estimated duration in seconds.
+ */
+double estimate_print_job(print_job_t *print_job, kinematics_t *kinematics, estimate_breakdown_t *breakdown)
+{
+	estimate_breakdown_t local;
+	if (breakdown == NULL)
+		breakdown = &local;
+	*breakdown = (estimate_breakdown_t){ .total_seconds = 0.0 };
+
+	uint32_t resolution = print_job->raster->resolution;
+
+	if (print_job->estimate != NULL)
+		estimate_raster(kinematics, print_job->estimate, resolution, print_job->raster->speed, breakdown);
+
+	if (print_job->mode == PRINT_JOB_MODE_VECTOR ||
+	    print_job->mode == PRINT_JOB_MODE_COMBINED) {
+		for (vector_list_config_t *vector_list_config = print_job->configs;
+		     vector_list_config != NULL;
+		     vector_list_config = vector_list_config->next) {
+			for (int pass = 0; pass < vector_list_config->multipass; pass++)
+				estimate_vector_list(kinematics, vector_list_config->vector_list, resolution, vector_list_config->speed, breakdown);
+		}
+	}
+
+	breakdown->total_seconds = breakdown->raster_seconds + breakdown->vector_seconds + breakdown->transit_seconds;
+
+	return breakdown->total_seconds;
+}
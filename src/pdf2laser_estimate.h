@@ -0,0 +1,25 @@
+#ifndef __PDF2LASER_ESTIMATE_H__
+#define __PDF2LASER_ESTIMATE_H__ 1
+
+#include <stdint.h>            // for int32_t, uint32_t
+#include "type_estimate.h"     // for estimate_breakdown_t, estimate_t
+#include "type_kinematics.h"   // for kinematics_t
+#include "type_print_job.h"    // for print_job_t
+#include "type_vector_list.h"  // for vector_list_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+double estimate_vector_list(kinematics_t *kinematics, vector_list_t *vector_list, uint32_t resolution, int32_t speed, estimate_breakdown_t *breakdown);
+double estimate_raster(kinematics_t *kinematics, estimate_t *estimate, uint32_t resolution, int32_t speed, estimate_breakdown_t *breakdown);
+double estimate_print_job(print_job_t *print_job, kinematics_t *kinematics, estimate_breakdown_t *breakdown);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
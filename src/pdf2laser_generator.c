@@ -2,21 +2,27 @@
 #include <fcntl.h>                    // for open, O_RDONLY, SEEK_SET
 #include <ghostscript/gserrors.h>     // for gs_error_Quit
 #include <ghostscript/iapi.h>         // for gsapi_delete_instance, gsapi_exit, gsapi_init_with_args, gsapi_new_instance, gsapi_set_arg_encoding, GS_ARG_ENCODING_UTF8
-#include <inttypes.h>                 // for PRId32
+#include <inttypes.h>                 // for PRId32, PRIx32
+#include <math.h>                     // for lround
 #include <stdbool.h>                  // for bool, false
-#include <stdint.h>                   // for int32_t, uint8_t, uint32_t
+#include <stdint.h>                   // for int32_t, uint8_t, uint32_t, INT32_MAX, INT32_MIN
 #include <stdio.h>                    // for fprintf, fclose, fopen, fread, FILE, fputc, sscanf, NULL, fileno, perror, printf, getline, stderr, size_t, fflush, fseek, fwrite, snprintf, stdin
-#include <stdlib.h>                   // for free, calloc
-#include <string.h>                   // for memset, strncmp, strndup
+#include <stdlib.h>                   // for free, calloc, malloc
+#include <string.h>                   // for memcpy, memset, strncmp, strndup
 #include <strings.h>                  // for strncasecmp
 #include <unistd.h>                   // for close, ssize_t
-#include "config.h"                   // for GS_ARG_NCHARS
-#include "pdf2laser_util.h"           // for pdf2laser_sendfile
+#include "config.h"                   // for BED_HEIGHT, BED_WIDTH, GS_ARG_NCHARS
+#include "pdf2laser_util.h"           // for pdf2laser_clock, pdf2laser_sendfile
+#include "type_estimate.h"            // for estimate_add_row
+#include "type_image.h"               // for image_device_size, image_render_row
+#include "type_optimizer_report.h"    // for optimizer_report_t, optimizer_report_layer, optimizer_report_record, OPTIMIZER_STAGE_DEDUP, OPTIMIZER_STAGE_INPUT, OPTIMIZER_STAGE_OPTIMIZE
 #include "type_point.h"               // for point_t, point_compare
 #include "type_print_job.h"           // for print_job_t, print_job_clone_last_vector_list_config, print_job_find_vector_list_config_by_rgb, PRINT_JOB_MODE_COMBINED, PRINT_JOB_MODE_RASTER, PRINT_JOB_MODE_VECTOR
-#include "type_raster.h"              // for raster_t
+#include "type_raster.h"              // for raster_t, raster_mode, RASTER_MODE_COLOR, RASTER_MODE_GREY_SCALE
+#include "type_timings.h"             // for timings_begin, timings_end
+#include "type_transform.h"           // for transform_t, transform_frame_clear, transform_frame_include, transform_point, transform_to_string, transform_turns
 #include "type_vector.h"              // for vector_t, vector_create
-#include "type_vector_list.h"         // for vector_list_append, vector_list_contains, vector_list_t, vector_list_optimize
+#include "type_vector_list.h"         // for vector_list_append, vector_list_dedup, vector_list_destroy, vector_list_stats, vector_list_t, vector_list_optimize, vector_list_repeat, vector_list_transform
 #include "type_vector_list_config.h"  // for vector_list_config_t, vector_list_config_id_to_rgb
 
 /**
@@ -273,11 +279,306 @@ int generate_eps(print_job_t *print_job, char *target_ps_file, char *target_eps_
 
 
 /**
+ * PackBits encode a run of raster bytes. Repeated bytes become a count of
+ * 257 - n followed by the byte, anything else a count of n - 1 followed by
+ * the literal bytes.
  *
+ * @param pack receives the encoded bytes, it must hold at least
+ * length * 5 / 4 + 1 bytes.
+ *
+ * @return The number of bytes written to pack.
  */
-int generate_raster(print_job_t *print_job, FILE *pjl_file, FILE *bitmap_file)
+int raster_pack(const unsigned char *row, int length, unsigned char *pack)
+{
+	int l = 0;
+	int n = 0;
+	while (l < length) {
+		int p;
+		for (p = l; p < length && p < l + 128 && row[p] == row[l]; p++) {
+			;
+		}
+		if (p - l >= 2) {
+			// run length
+			pack[n++] = 257 - (p - l);
+			pack[n++] = row[l];
+			l = p;
+		} else {
+			for (p = l;
+			     p < length && p < l + 127 &&
+				     (p + 1 == length || row[p] !=
+				      row[p + 1]);
+			     p++) {
+				;
+			}
+
+			pack[n++] = p - l - 1;
+			while (l < p) {
+				pack[n++] = row[l++];
+			}
+		}
+	}
+
+	return n;
+}
+
+/**
+ * Read the next bitmap row, from the bottom up, in the layout Ghostscript
+ * writes it for the raster mode. Rows of an image read without Ghostscript
+ * are scaled from the image instead, and rows of a bitmap held in memory
+ * are copied from it.
+ *
+ * @return The number of bytes read.
+ */
+static int raster_read_row(print_job_t *print_job, FILE *bitmap_file, const uint8_t *plane, int32_t y, char *buf, int32_t length)
+{
+	if (plane != NULL) {
+		memcpy(buf, plane + (size_t)y * length, length);
+		return length;
+	}
+
+	if (print_job->image == NULL)
+		return fread(buf, 1, length, bitmap_file);
+
+	image_render_row(print_job->image, print_job->raster->mode, print_job->raster->resolution, y, (uint8_t *)buf, length);
+	return length;
+}
+
+/**
+ * Size of the bed in device units. Copies of an array and moved jobs are
+ * kept on the bed rather than on the page of the source, which may well be
+ * smaller.
+ */
+static void generate_bed_size(uint32_t resolution, int32_t *width, int32_t *height)
+{
+	*width = BED_WIDTH * resolution / 72;
+	*height = BED_HEIGHT * resolution / 72;
+}
+
+/**
+ * Bytes in a bitmap row of the raster mode, padded to 4 bytes as BMP rows are.
+ */
+static size_t raster_row_bytes(raster_mode mode, int32_t width)
+{
+	if (mode == RASTER_MODE_COLOR)
+		return ((size_t)width * 3 + 3) / 4 * 4;
+	if (mode == RASTER_MODE_GREY_SCALE)
+		return ((size_t)width + 3) / 4 * 4;
+	return (((size_t)width + 7) / 8 + 3) / 4 * 4;
+}
+
+/**
+ * Whether a pixel of a bitmap row is engraved: any channel darker than the
+ * colour passes take for white, anything but white in grey-scale and a set
+ * bit in mono.
+ */
+static bool raster_pixel_ink(raster_mode mode, const uint8_t *row, int32_t x)
+{
+	switch (mode) {
+	case RASTER_MODE_COLOR:
+		return row[x * 3] <= 240 || row[x * 3 + 1] <= 240 || row[x * 3 + 2] <= 240;
+	case RASTER_MODE_GREY_SCALE:
+		return row[x] != 255;
+	default:
+		return (row[x / 8] & (0x80 >> (x % 8))) != 0;
+	}
+}
+
+static void raster_pixel_copy(raster_mode mode, const uint8_t *from, int32_t from_x, uint8_t *to, int32_t to_x)
+{
+	switch (mode) {
+	case RASTER_MODE_COLOR:
+		memcpy(to + to_x * 3, from + from_x * 3, 3);
+		break;
+	case RASTER_MODE_GREY_SCALE:
+		to[to_x] = from[from_x];
+		break;
+	default:
+		if (from[from_x / 8] & (0x80 >> (from_x % 8)))
+			to[to_x / 8] |= 0x80 >> (to_x % 8);
+		else
+			to[to_x / 8] &= ~(0x80 >> (to_x % 8));
+	}
+}
+
+/**
+ * Find the size of the raster in device pixels, reading the header of the
+ * bitmap written by Ghostscript, or scaling the image of the print job when
+ * it has one.
+ */
+static void raster_geometry(print_job_t *print_job, FILE *bitmap_file, int32_t *width, int32_t *height, int32_t *base_offset)
 {
 	uint8_t bitmap_header[BITMAP_HEADER_NBYTES];
+
+	if (print_job->image != NULL) {
+		int32_t bed_width = print_job->width * print_job->raster->resolution / 72;
+		int32_t bed_height = print_job->height * print_job->raster->resolution / 72;
+
+		/* Images are scaled to the resolution and cropped to the bed. */
+		image_device_size(print_job->image, print_job->raster->resolution, width, height);
+		if (*width > bed_width)
+			*width = bed_width;
+		if (*height > bed_height)
+			*height = bed_height;
+		*base_offset = 0;
+		return;
+	}
+
+	/* Read in the bitmap header. */
+	fread(bitmap_header, 1, BITMAP_HEADER_NBYTES, bitmap_file);
+
+	/* Re-load width/height from bmp as it is possible that someone used
+	 * setpagedevice or some such
+	 */
+	/* Bytes 18 - 21 are the bitmap width (little endian format). */
+	*width = big_to_little_endian(bitmap_header + 18, 4);
+
+	/* Bytes 22 - 25 are the bitmap height (little endian format). */
+	*height = big_to_little_endian(bitmap_header + 22, 4);
+
+	/* Bytes 10 - 13 base offset for the beginning of the bitmap data. */
+	*base_offset = big_to_little_endian(bitmap_header + 10, 4);
+}
+
+/**
+ * Grow the frame of a transform to take in every engraved pixel of the
+ * raster, leaving the bitmap to be read again from its start.
+ *
+ * @return 0 on success, -1 if the bitmap is short.
+ */
+static int raster_frame(print_job_t *print_job, FILE *bitmap_file, transform_t *transform)
+{
+	raster_mode mode = print_job->raster->mode;
+
+	int32_t width, height, base_offset;
+	raster_geometry(print_job, bitmap_file, &width, &height, &base_offset);
+
+	size_t stride = raster_row_bytes(mode, width);
+	uint8_t *row = malloc(stride);
+
+	if (bitmap_file != NULL)
+		fseek(bitmap_file, base_offset, SEEK_SET);
+	for (int32_t y = height - 1; y >= 0; y--) {
+		if (raster_read_row(print_job, bitmap_file, NULL, y, (char *)row, stride) != (int)stride) {
+			fprintf(stderr, "Bad bit data from gs (y=%"PRId32")\n", y);
+			free(row);
+			return -1;
+		}
+
+		int32_t left, right;
+		for (left = 0; left < width && !raster_pixel_ink(mode, row, left); left++)
+			;
+		if (left == width)
+			continue;
+		for (right = width - 1; right > left && !raster_pixel_ink(mode, row, right); right--)
+			;
+
+		transform_frame_include(transform, left, y);
+		transform_frame_include(transform, right + 1, y + 1);
+	}
+
+	free(row);
+	if (bitmap_file != NULL)
+		fseek(bitmap_file, 0, SEEK_SET);
+
+	return 0;
+}
+
+/**
+ * Turn and mirror the raster as the transform of the print job places it,
+ * into a bitmap held in memory in the layout of the raster mode. Only the
+ * part of the raster inside the frame of the transform is kept, and the
+ * size and position on the bed of what is kept replace the given ones.
+ *
+ * @return The bitmap, top row first, or NULL if the raster is short.
+ */
+static uint8_t *raster_transform(print_job_t *print_job, FILE *bitmap_file, int32_t base_offset, int32_t *width, int32_t *height, int32_t *basex, int32_t *basey)
+{
+	transform_t *transform = print_job->transform;
+	raster_mode mode = print_job->raster->mode;
+	uint32_t resolution = print_job->raster->resolution;
+
+	int32_t left = (transform->left > 0) ? transform->left : 0;
+	int32_t top = (transform->top > 0) ? transform->top : 0;
+	int32_t right = (transform->right < *width) ? transform->right : *width;
+	int32_t bottom = (transform->bottom < *height) ? transform->bottom : *height;
+	if (right <= left || bottom <= top) {
+		*width = 0;
+		*height = 0;
+		return calloc(1, 1);
+	}
+
+	/* The corners of what is kept give where it lands. */
+	int32_t corners[4][2] = {{left, top}, {right, top}, {left, bottom}, {right, bottom}};
+	int32_t placed_left = INT32_MAX;
+	int32_t placed_top = INT32_MAX;
+	int32_t placed_right = INT32_MIN;
+	int32_t placed_bottom = INT32_MIN;
+	for (size_t corner = 0; corner < 4; corner++) {
+		transform_point(transform, resolution, &corners[corner][0], &corners[corner][1]);
+		if (corners[corner][0] < placed_left)
+			placed_left = corners[corner][0];
+		if (corners[corner][0] > placed_right)
+			placed_right = corners[corner][0];
+		if (corners[corner][1] < placed_top)
+			placed_top = corners[corner][1];
+		if (corners[corner][1] > placed_bottom)
+			placed_bottom = corners[corner][1];
+	}
+
+	size_t stride = raster_row_bytes(mode, *width);
+	size_t placed_stride = raster_row_bytes(mode, placed_right - placed_left);
+	size_t placed_length = placed_stride * (placed_bottom - placed_top);
+
+	/* Colour and grey-scale are white at 255, mono at 0. */
+	uint8_t *plane = malloc(placed_length);
+	memset(plane, (mode == RASTER_MODE_COLOR || mode == RASTER_MODE_GREY_SCALE) ? 255 : 0, placed_length);
+	uint8_t *row = malloc(stride);
+
+	if (bitmap_file != NULL)
+		fseek(bitmap_file, base_offset, SEEK_SET);
+	for (int32_t y = *height - 1; y >= top; y--) {
+		if (raster_read_row(print_job, bitmap_file, NULL, y, (char *)row, stride) != (int)stride) {
+			fprintf(stderr, "Bad bit data from gs (y=%"PRId32")\n", y);
+			free(row);
+			free(plane);
+			return NULL;
+		}
+		if (y >= bottom)
+			continue;
+
+		for (int32_t x = left; x < right; x++) {
+			if (!raster_pixel_ink(mode, row, x))
+				continue;
+
+			/* A pixel lands where the nearer corner of its square does. */
+			int32_t x0 = x;
+			int32_t y0 = y;
+			int32_t x1 = x + 1;
+			int32_t y1 = y + 1;
+			transform_point(transform, resolution, &x0, &y0);
+			transform_point(transform, resolution, &x1, &y1);
+			int32_t to_x = ((x0 < x1) ? x0 : x1) - placed_left;
+			int32_t to_y = ((y0 < y1) ? y0 : y1) - placed_top;
+			raster_pixel_copy(mode, row, x, plane + (size_t)to_y * placed_stride, to_x);
+		}
+	}
+
+	free(row);
+
+	*width = placed_right - placed_left;
+	*height = placed_bottom - placed_top;
+	*basex = placed_left;
+	*basey = placed_top;
+
+	return plane;
+}
+
+/**
+ * Generate the raster passes of the print job from the bitmap written by
+ * Ghostscript, or from the image of the print job when it has one.
+ */
+int generate_raster(print_job_t *print_job, FILE *pjl_file, FILE *bitmap_file)
+{
 	char buf[102400];
 
 	bool invert = false;
@@ -292,20 +593,30 @@ int generate_raster(print_job_t *print_job, FILE *pjl_file, FILE *bitmap_file)
 		passes = 7;
 	}
 
-	/* Read in the bitmap header. */
-	fread(bitmap_header, 1, BITMAP_HEADER_NBYTES, bitmap_file);
+	int32_t width, height;
+	int32_t base_offset = 0;
 
-	/* Re-load width/height from bmp as it is possible that someone used
-	 * setpagedevice or some such
-	 */
-	/* Bytes 18 - 21 are the bitmap width (little endian format). */
-	int32_t width = big_to_little_endian(bitmap_header + 18, 4);
+	int32_t bed_width, bed_height;
+	generate_bed_size(print_job->raster->resolution, &bed_width, &bed_height);
 
-	/* Bytes 22 - 25 are the bitmap height (little endian format). */
-	int32_t height = big_to_little_endian(bitmap_header + 22, 4);
+	raster_geometry(print_job, bitmap_file, &width, &height, &base_offset);
 
-	/* Bytes 10 - 13 base offset for the beginning of the bitmap data. */
-	int32_t base_offset = big_to_little_endian(bitmap_header + 10, 4);
+	/* A moved job is engraved at its offset, a turned or mirrored one from a
+	 * copy of the raster laid out as it is placed.
+	 */
+	uint8_t *plane = NULL;
+	transform_t *transform = print_job->transform;
+	if (transform != NULL && transform_turns(transform)) {
+		timings_begin(print_job->timings, "raster_transform");
+		plane = raster_transform(print_job, bitmap_file, base_offset, &width, &height, &basex, &basey);
+		timings_end(print_job->timings);
+		if (plane == NULL)
+			return -1;
+	}
+	else if (transform != NULL) {
+		basex = lround(transform->offset_x * print_job->raster->resolution);
+		basey = lround(transform->offset_y * print_job->raster->resolution);
+	}
 
 	if (print_job->raster->mode == 'c' || print_job->raster->mode == 'g') {
 		/* colour/grey are byte per pixel power levels */
@@ -328,10 +639,26 @@ int generate_raster(print_job_t *print_job, FILE *pjl_file, FILE *bitmap_file)
 	/* Raster power -- color and gray scaled before, but scale with the user provided power */
 	fprintf(pjl_file, "\033&y%"PRId32"P", print_job->raster->power);
 
+	/* Copies of a step and repeat array are engraved from the same bitmap,
+	 * each read again at its own offset.
+	 */
+	int32_t pitch_x = lround(print_job->pitch_x * print_job->raster->resolution);
+	int32_t pitch_y = lround(print_job->pitch_y * print_job->raster->resolution);
+
+	/* The raster extents take in every copy where the transform puts it, up
+	 * to the edges of the bed.
+	 */
+	int32_t extent_width = ((basex > 0) ? basex : 0) + width + (print_job->array_columns - 1) * pitch_x;
+	int32_t extent_height = ((basey > 0) ? basey : 0) + height + (print_job->array_rows - 1) * pitch_y;
+	if (extent_width > bed_width)
+		extent_width = (width > bed_width) ? width : bed_width;
+	if (extent_height > bed_height)
+		extent_height = (height > bed_height) ? height : bed_height;
+
 	/* Raster speed */
 	fprintf(pjl_file, "\033&z%"PRId32"S", print_job->raster->speed);
-	fprintf(pjl_file, "\033*r%"PRId32"T", height);
-	fprintf(pjl_file, "\033*r%"PRId32"S", width);
+	fprintf(pjl_file, "\033*r%"PRId32"T", extent_height);
+	fprintf(pjl_file, "\033*r%"PRId32"S", extent_width);
 	/* Raster compression */
 	fprintf(pjl_file, "\033*b%"PRId32"M", (print_job->raster->mode == 'c' || print_job->raster->mode == 'g') ? 7 : 2);
 	/* Raster direction (1 = up) */
@@ -345,15 +672,25 @@ int generate_raster(print_job_t *print_job, FILE *pjl_file, FILE *bitmap_file)
 		       print_job->raster->speed);
 	}
 
+	bool cut_short = false;
+
 	/* start at current position */
 	fprintf(pjl_file, "\033*r1A");
-	for (int32_t offx = 0; offx >= 0; offx -= width) {
-		for (int32_t offy = 0; offy >= 0; offy -= height) {
+	for (int32_t column = 0; column < print_job->array_columns; column++) {
+		int32_t offx = column * pitch_x;
+		for (int32_t row = 0; row < print_job->array_rows; row++) {
+			int32_t offy = row * pitch_y;
 			for (int32_t pass = 0; pass < passes; pass++) {
+				/* a pass is timed and traced as a whole, which keeps the clock
+				 * and counter reads and the trace events out of the row loop
+				 */
+				timings_begin(print_job->timings, "raster_pass");
+
 				// raster (basic)
 				char dir = 0;
 
-				fseek(bitmap_file, base_offset, SEEK_SET);
+				if (bitmap_file != NULL)
+					fseek(bitmap_file, base_offset, SEEK_SET);
 				for (int y = height - 1; y >= 0; y--) {
 					int l;
 
@@ -363,12 +700,12 @@ int generate_raster(print_job_t *print_job, FILE *pjl_file, FILE *bitmap_file)
 						unsigned char *t = (unsigned char *) buf;
 						if (d > (int) sizeof (buf)) {
 							perror("Too wide");
-							return -1;
+							goto raster_pass_failed;
 						}
-						l = fread ((char *)buf, 1, d, bitmap_file);
+						l = raster_read_row(print_job, bitmap_file, plane, y, buf, d);
 						if (l != d) {
 							fprintf(stderr, "Bad bit data from gs %"PRId32"/%"PRId32" (y=%"PRId32")\n", l, d, y);
-							return -1;
+							goto raster_pass_failed;
 						}
 						while (l--) {
 							// pack and pass check RGB
@@ -403,12 +740,12 @@ int generate_raster(print_job_t *print_job, FILE *pjl_file, FILE *bitmap_file)
 						int d = (h + 3) / 4 * 4;
 						if (d > (int) sizeof (buf)) {
 							fprintf(stderr, "Too wide\n");
-							return -1;
+							goto raster_pass_failed;
 						}
-						l = fread((char *)buf, 1, d, bitmap_file);
+						l = raster_read_row(print_job, bitmap_file, plane, y, buf, d);
 						if (l != d) {
 							fprintf(stderr, "Bad bit data from gs %"PRId32"/%"PRId32" (y=%d)\n", l, d, y);
-							return -1;
+							goto raster_pass_failed;
 						}
 						for (l = 0; l < h; l++) {
 							if (invert)
@@ -426,12 +763,12 @@ int generate_raster(print_job_t *print_job, FILE *pjl_file, FILE *bitmap_file)
 						int d = (h + 3) / 4 * 4;  // BMP padded to 4 bytes per scan line
 						if (d > (int) sizeof (buf)) {
 							perror("Too wide");
-							return -1;
+							goto raster_pass_failed;
 						}
-						l = fread((char *) buf, 1, d, bitmap_file);
+						l = raster_read_row(print_job, bitmap_file, plane, y, buf, d);
 						if (l != d) {
 							fprintf(stderr, "Bad bit data from gs %"PRId32"/%"PRId32" (y=%"PRId32")\n", l, d, y);
-							return -1;
+							goto raster_pass_failed;
 						}
 					}
 					}
@@ -458,9 +795,25 @@ int generate_raster(print_job_t *print_job, FILE *pjl_file, FILE *bitmap_file)
 							;
 
 						r++;
+						int32_t scale = (print_job->raster->mode == 'c' || print_job->raster->mode == 'g') ? 1 : 8;
+						if (basex + offx != 0 || basey + offy != 0) {
+							/* moved rows and copies are cut short at the edges of the bed */
+							int32_t limit = (basey + offy + y >= 0 && basey + offy + y < bed_height) ? (bed_width - basex - offx) / scale : 0;
+							if (r > limit) {
+								r = limit;
+								cut_short = true;
+							}
+							if (basex + offx < 0 && l < (scale - 1 - basex - offx) / scale) {
+								l = (scale - 1 - basex - offx) / scale;
+								cut_short = true;
+							}
+							if (r <= l)
+								continue;
+						}
 						fprintf(pjl_file, "\033*p%"PRId32"Y", basey + offy + y);
 						fprintf(pjl_file, "\033*p%"PRId32"X", basex + offx +
 						        ((print_job->raster->mode == 'c' || print_job->raster->mode == 'g') ? l : l * 8));
+						estimate_add_row(print_job->estimate, basey + offy + y, basex + offx + l * scale, basex + offx + r * scale, dir);
 						if (dir) {
 							fprintf(pjl_file, "\033*b%"PRId32"A", -(r - l));
 							// reverse bytes!
@@ -474,32 +827,7 @@ int generate_raster(print_job_t *print_job, FILE *pjl_file, FILE *bitmap_file)
 						}
 						dir = 1 - dir;
 						// pack
-						n = 0;
-						while (l < r) {
-							int p;
-							for (p = l; p < r && p < l + 128 && buf[p] == buf[l]; p++) {
-								;
-							}
-							if (p - l >= 2) {
-								// run length
-								pack[n++] = 257 - (p - l);
-								pack[n++] = buf[l];
-								l = p;
-							} else {
-								for (p = l;
-								     p < r && p < l + 127 &&
-									     (p + 1 == r || buf[p] !=
-									      buf[p + 1]);
-								     p++) {
-									;
-								}
-
-								pack[n++] = p - l - 1;
-								while (l < p) {
-									pack[n++] = buf[l++];
-								}
-							}
-						}
+						n = raster_pack((unsigned char *)buf + l, r - l, pack);
 						fprintf(pjl_file, "\033*b%"PRId32"W", (n + 7) / 8 * 8);
 						r = 0;
 						while (r < n)
@@ -510,16 +838,28 @@ int generate_raster(print_job_t *print_job, FILE *pjl_file, FILE *bitmap_file)
 						}
 					}
 				}
+
+				timings_end(print_job->timings);
 			}
 		}
 	}
 
+	if (cut_short)
+		fprintf(stderr, "Raster rows cut short at the edge of the bed\n");
+
 	fprintf(pjl_file, "\033*rC");       // end raster
 	fputc(26, pjl_file);      // some end of file markers
 	fputc(4, pjl_file);
 	//}
 
+	free(plane);
+
 	return 0;
+
+ raster_pass_failed:
+	timings_end(print_job->timings);
+	free(plane);
+	return -1;
 }
 
 
@@ -536,7 +876,7 @@ int generate_raster(print_job_t *print_job, FILE *pjl_file, FILE *bitmap_file)
  * Multi segment vectors are split into individual vectors, which are
  * then passed into the topological sort routine.
  *
- * Exact duplictes will be deleted to try to avoid double hits..
+ * Duplicates are removed afterwards by vector_list_dedup.
  */
 int vectors_parse(print_job_t *print_job, FILE * const vector_file)
 {
@@ -575,29 +915,15 @@ int vectors_parse(print_job_t *print_job, FILE * const vector_file)
 		case 'L': {
 			int32_t x_next, y_next;
 			sscanf(line, "L%d,%d", &x_next, &y_next);
-			vector_t *vector = vector_create(x_current, y_current, x_next, y_next);
-			if (print_job->vector_optimize &&
-			    vector_list_contains(current_list, vector) >= 0) {
-				free(vector);
-			}
-			else {
-				vector_list_append(current_list, vector);
-				vector_count += 1;
-			}
+			vector_list_append(current_list, vector_create(x_current, y_current, x_next, y_next));
+			vector_count += 1;
 			x_current = x_next;
 			y_current = y_next;
 			break;
 		}
 		case 'C': {
 			// Closing statment from current point to starting point.
-			vector_t *vector = vector_create(x_current, y_current, x_start, y_start);
-			if (print_job->vector_optimize &&
-			    vector_list_contains(current_list, vector) >= 0) {
-				free(vector);
-			}
-			else {
-				vector_list_append(current_list, vector);
-			}
+			vector_list_append(current_list, vector_create(x_current, y_current, x_start, y_start));
 			x_current = x_start;
 			y_current = y_start;
 			break;
@@ -615,7 +941,11 @@ int vectors_parse(print_job_t *print_job, FILE * const vector_file)
 	return 0;
 }
 
-static void output_vector(vector_list_t *list, FILE * const pjl_file)
+/**
+ * Emit the vectors of a list as HPGL pen moves, only lifting the pen between
+ * vectors which do not connect.
+ */
+void output_vector(vector_list_t *list, FILE * const pjl_file)
 {
 	int32_t current_x = 0;
 	int32_t current_y = 0;
@@ -647,8 +977,98 @@ static void output_vector(vector_list_t *list, FILE * const pjl_file)
 
 int generate_vector(print_job_t *print_job, FILE * const pjl_file, FILE * const vector_file)
 {
+	optimizer_report_t *report = print_job->optimizer_report;
+
 	// this mutates vectors parser in print_job
-	vectors_parse(print_job, vector_file);
+	if (vector_file != NULL) {
+		timings_begin(print_job->timings, "vectors_parse");
+		vectors_parse(print_job, vector_file);
+		timings_end(print_job->timings);
+	}
+
+	// Moved, turned and mirrored jobs are placed before anything else sees
+	// their vectors, so that the report and the array take them as they cut
+	if (print_job->transform != NULL) {
+		timings_begin(print_job->timings, "vector_list_transform");
+		uint32_t resolution = print_job->raster->resolution;
+		int32_t bed_width, bed_height;
+		generate_bed_size(resolution, &bed_width, &bed_height);
+		size_t total = 0;
+		size_t dropped = 0;
+		for (vector_list_config_t *vector_list_config = print_job->configs;
+		     vector_list_config != NULL;
+		     vector_list_config = vector_list_config->next) {
+			total += vector_list_config->vector_list->length;
+			dropped += vector_list_transform(vector_list_config->vector_list, print_job->transform, resolution, bed_width, bed_height);
+		}
+		timings_end(print_job->timings);
+
+		if (total > 0 && dropped == total) {
+			fprintf(stderr, "Transform moves every vector off the bed\n");
+			return -1;
+		}
+		if (dropped > 0)
+			fprintf(stderr, "Transform moves %zu of %zu vectors off the bed, leaving them out\n", dropped, total);
+	}
+
+	bool repeat = print_job->array_columns > 1 || print_job->array_rows > 1;
+
+	if (report != NULL) {
+		report->resolution = print_job->raster->resolution;
+		report->kinematics = print_job->kinematics;
+		for (vector_list_config_t *vector_list_config = print_job->configs;
+		     vector_list_config != NULL && !repeat;
+		     vector_list_config = vector_list_config->next) {
+			optimizer_report_record(report, vector_list_config->id, OPTIMIZER_STAGE_INPUT, vector_list_config->vector_list, 0.0);
+		}
+	}
+
+	// Exact duplicates are deleted to try to avoid double hits
+	if (print_job->vector_optimize) {
+		timings_begin(print_job->timings, "vector_list_dedup");
+		for (vector_list_config_t *vector_list_config = print_job->configs;
+		     vector_list_config != NULL;
+		     vector_list_config = vector_list_config->next) {
+			double start = pdf2laser_clock();
+			vector_list_dedup(vector_list_config->vector_list);
+			optimizer_report_record(report, vector_list_config->id, OPTIMIZER_STAGE_DEDUP, vector_list_config->vector_list, pdf2laser_clock() - start);
+		}
+		timings_end(print_job->timings);
+	}
+
+	// Copies of a step and repeat array are laid out from the single render
+	// once its duplicates are gone, as dedup would take every copy for one,
+	// and ahead of the optimizer so that it orders them all as one job
+	if (repeat) {
+		timings_begin(print_job->timings, "vector_list_repeat");
+		uint32_t resolution = print_job->raster->resolution;
+		int32_t pitch_x = lround(print_job->pitch_x * resolution);
+		int32_t pitch_y = lround(print_job->pitch_y * resolution);
+		int32_t bed_width, bed_height;
+		generate_bed_size(resolution, &bed_width, &bed_height);
+		for (vector_list_config_t *vector_list_config = print_job->configs;
+		     vector_list_config != NULL;
+		     vector_list_config = vector_list_config->next) {
+			double start = pdf2laser_clock();
+			size_t expected = (size_t)vector_list_config->vector_list->length * (print_job->array_columns * print_job->array_rows - 1);
+			size_t appended = vector_list_repeat(vector_list_config->vector_list, print_job->array_columns, print_job->array_rows,
+			                                     pitch_x, pitch_y, bed_width, bed_height);
+			if (appended < expected)
+				fprintf(stderr, "Array copies of %06"PRIx32" cut short at the edge of the bed: %zu of %zu vectors left out\n",
+				        vector_list_config->id, expected - appended, expected);
+
+			// the report measures every copy, from the input on
+			if (report != NULL) {
+				double seconds = pdf2laser_clock() - start;
+				optimizer_report_record(report, vector_list_config->id, OPTIMIZER_STAGE_INPUT, vector_list_config->vector_list, 0.0);
+				if (print_job->vector_optimize) {
+					seconds += optimizer_report_layer(report, vector_list_config->id)->stages[OPTIMIZER_STAGE_DEDUP].seconds;
+					optimizer_report_record(report, vector_list_config->id, OPTIMIZER_STAGE_DEDUP, vector_list_config->vector_list, seconds);
+				}
+			}
+		}
+		timings_end(print_job->timings);
+	}
 
 	fprintf(pjl_file, "IN;");
 
@@ -659,17 +1079,25 @@ int generate_vector(print_job_t *print_job, FILE * const pjl_file, FILE * const
 		fprintf(pjl_file, "XR%04"PRId32";", vector_list_config->frequency);
 
 		if (print_job->vector_optimize) {
+			timings_begin(print_job->timings, "vector_list_optimize");
+			double start = pdf2laser_clock();
 			vector_list_t *vector_list = vector_list_config->vector_list;
 			vector_list_config->vector_list = vector_list_optimize(vector_list);
-			free(vector_list);
+			vector_list_destroy(vector_list);
+			optimizer_report_record(report, vector_list_config->id, OPTIMIZER_STAGE_OPTIMIZE, vector_list_config->vector_list, pdf2laser_clock() - start);
+			if (print_job->vector_stats || print_job->debug)
+				vector_list_stats(vector_list_config->vector_list);
+			timings_end(print_job->timings);
 		}
 
 		fprintf(pjl_file, "YP%03"PRId32";", vector_list_config->power);
 		fprintf(pjl_file, "ZS%03"PRId32"", vector_list_config->speed); // NB. no ";"
 
+		timings_begin(print_job->timings, "output_vector");
 		for (int pass = 0; pass < vector_list_config->multipass; pass++) {
 			output_vector(vector_list_config->vector_list, pjl_file);
 		}
+		timings_end(print_job->timings);
 	}
 
 	fprintf(pjl_file, "\033%%0B");   // end HLGL
@@ -685,10 +1113,58 @@ int generate_vector(print_job_t *print_job, FILE * const pjl_file, FILE * const
 //print_job, target_bmp, target_vector, target_pjl)) {
 int generate_pjl(print_job_t *print_job, char *bmp_target, char *vector_target, char *pjl_target)
 {
-	FILE *bmp_target_fh = fopen(bmp_target, "r");
-	FILE *vector_target_fh = fopen(vector_target, "r");
+	// sources read without Ghostscript have no bitmap and their vectors loaded
+	FILE *bmp_target_fh = (bmp_target != NULL) ? fopen(bmp_target, "r") : NULL;
+	FILE *vector_target_fh = (vector_target != NULL) ? fopen(vector_target, "r") : NULL;
 	FILE *pjl_target_fh = fopen(pjl_target, "w");
 
+	/* A turned or mirrored job turns in the frame of everything it engraves
+	 * and cuts, which takes reading the bitmap and the vectors ahead of the
+	 * passes.
+	 */
+	transform_t *transform = print_job->transform;
+	if (transform != NULL && transform_turns(transform)) {
+		timings_begin(print_job->timings, "transform_frame");
+		transform_frame_clear(transform);
+
+		if ((print_job->mode == PRINT_JOB_MODE_RASTER || print_job->mode == PRINT_JOB_MODE_COMBINED) &&
+		    (bmp_target_fh != NULL || print_job->image != NULL)) {
+			if (raster_frame(print_job, bmp_target_fh, transform)) {
+				timings_end(print_job->timings);
+				if (bmp_target_fh != NULL)
+					fclose(bmp_target_fh);
+				if (vector_target_fh != NULL)
+					fclose(vector_target_fh);
+				fclose(pjl_target_fh);
+				return -1;
+			}
+		}
+
+		if (print_job->mode == PRINT_JOB_MODE_VECTOR || print_job->mode == PRINT_JOB_MODE_COMBINED) {
+			if (vector_target_fh != NULL) {
+				vectors_parse(print_job, vector_target_fh);
+				fclose(vector_target_fh);
+				vector_target_fh = NULL;
+			}
+
+			for (vector_list_config_t *config = print_job->configs; config != NULL; config = config->next) {
+				for (vector_t *vector = config->vector_list->head; vector != NULL; vector = vector->next) {
+					transform_frame_include(transform, vector->start->x, vector->start->y);
+					transform_frame_include(transform, vector->end->x, vector->end->y);
+				}
+			}
+		}
+
+		timings_end(print_job->timings);
+	}
+
+	if (transform != NULL && print_job->debug) {
+		char *transform_string = transform_to_string(transform);
+		printf("%s frame=%"PRId32",%"PRId32"-%"PRId32",%"PRId32"\n", transform_string,
+		       transform->left, transform->top, transform->right, transform->bottom);
+		free(transform_string);
+	}
+
 	/* Print the printer job language header. */
 	fprintf(pjl_target_fh, "%s", "\033%-12345X@PJL COMMENT *Job Start*\r\n");
 	fprintf(pjl_target_fh, "@PJL JOB NAME=%s\r\n", print_job->name);
@@ -722,7 +1198,17 @@ int generate_pjl(print_job_t *print_job, char *bmp_target, char *vector_target,
 		fprintf(pjl_target_fh, "\033&y0C");
 
 		/* We're going to perform a raster print. */
-		generate_raster(print_job, pjl_target_fh, bmp_target_fh);
+		timings_begin(print_job->timings, "generate_raster");
+		int rc = generate_raster(print_job, pjl_target_fh, bmp_target_fh);
+		timings_end(print_job->timings);
+		if (rc) {
+			if (bmp_target_fh != NULL)
+				fclose(bmp_target_fh);
+			if (vector_target_fh != NULL)
+				fclose(vector_target_fh);
+			fclose(pjl_target_fh);
+			return -1;
+		}
 	}
 
 	/* If vector power is > 0 then add vector information to the print job. */
@@ -744,7 +1230,17 @@ int generate_pjl(print_job_t *print_job, char *bmp_target, char *vector_target,
 		}
 
 		/* We're going to perform a vector print. */
-		generate_vector(print_job, pjl_target_fh, vector_target_fh);
+		timings_begin(print_job->timings, "generate_vector");
+		int rc = generate_vector(print_job, pjl_target_fh, vector_target_fh);
+		timings_end(print_job->timings);
+		if (rc) {
+			if (bmp_target_fh != NULL)
+				fclose(bmp_target_fh);
+			if (vector_target_fh != NULL)
+				fclose(vector_target_fh);
+			fclose(pjl_target_fh);
+			return -1;
+		}
 	}
 
 	/* Footer for printer job language. */
@@ -763,8 +1259,10 @@ int generate_pjl(print_job_t *print_job, char *bmp_target, char *vector_target,
 	// for(int i = 0; i < 4096; i++)
 	//	fputc(0, pjl_target_fh);
 
-	fclose(bmp_target_fh);
-	fclose(vector_target_fh);
+	if (bmp_target_fh != NULL)
+		fclose(bmp_target_fh);
+	if (vector_target_fh != NULL)
+		fclose(vector_target_fh);
 	fclose(pjl_target_fh);
 
 	return 0;
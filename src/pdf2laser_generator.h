@@ -1,9 +1,10 @@
 #ifndef __PDF2LASER_GENERATOR_H__
 #define __PDF2LASER_GENERATOR_H__ 1
 
-#include <stdbool.h>         // for bool
-#include <stdio.h>           // for FILE
-#include "type_print_job.h"  // for print_job_t
+#include <stdbool.h>           // for bool
+#include <stdio.h>             // for FILE
+#include "type_print_job.h"    // for print_job_t
+#include "type_vector_list.h"  // for vector_list_t
 
 #ifdef __cplusplus
 extern "C" {
@@ -21,7 +22,10 @@ extern "C" {
 int generate_pdf(const char * source_pdf, const char *target_pdf);
 int generate_ps(const char *target_pdf, const char *target_ps);
 int generate_eps(print_job_t *print_job, char *target_ps_file, char *target_eps_file);
+int raster_pack(const unsigned char *row, int length, unsigned char *pack);
 int generate_raster(print_job_t *print_job, FILE *pjl_file, FILE *bitmap_file);
+int vectors_parse(print_job_t *print_job, FILE *vector_file);
+void output_vector(vector_list_t *list, FILE *pjl_file);
 int generate_vector(print_job_t *print_job, FILE *pjl_file, FILE *vector_file);
 int generate_pjl(print_job_t *print_job, char *bmp_target, char *vector_target, char *pjl_target);
 
@@ -0,0 +1,326 @@
+#include "pdf2laser_hpgl.h"
+#include <ctype.h>                    // for isalpha, isdigit, toupper
+#include <inttypes.h>                 // for PRId32
+#include <math.h>                     // for lround
+#include <stdbool.h>                  // for bool, false, true
+#include <stddef.h>                   // for NULL, size_t
+#include <stdint.h>                   // for int32_t
+#include <stdio.h>                    // for fprintf, getc, printf, ungetc, ferror, stderr, EOF, FILE
+#include <stdlib.h>                   // for calloc, free, strtod
+#include <string.h>                   // for strcmp
+#include "type_print_job.h"           // for print_job_t, print_job_clone_last_vector_list_config, print_job_find_vector_list_config_by_rgb
+#include "type_raster.h"              // for raster_t
+#include "type_vector.h"              // for vector_create
+#include "type_vector_list.h"         // for vector_list_append, vector_list_t
+#include "type_vector_list_config.h"  // for vector_list_config_t
+
+// character ending the text of a label unless changed by DT
+#define HPGL_LABEL_TERMINATOR ('\003')
+
+typedef struct hpgl_parser hpgl_parser_t;
+struct hpgl_parser {
+	print_job_t *print_job;
+	FILE *file;
+
+	char mnemonic[3];
+	double parameters[HPGL_PARAMETERS_MAX];
+	size_t parameters_length;
+	int label_terminator;
+
+	double scale;          // device units per plotter unit
+	double bed_height;     // in device units
+	bool pen_down;
+	bool relative;         // coordinates of PU, PD and PA/PR are relative
+	int32_t pen;           // selected pen, 0 when none is
+	bool list_found;       // whether list is the one of the selected pen
+	vector_list_t *list;   // where the selected pen cuts, NULL to skip its moves
+	double x;              // current position in plotter units
+	double y;
+
+	int32_t instructions;
+	int32_t ignored;
+	int32_t vectors;
+};
+
+/**
+ * Colour a pen cuts in, from the default HP-GL/2 palette: black, red, green,
+ * yellow, blue, magenta and cyan for pens 1 to 7, repeated for higher pens.
+ */
+static void hpgl_pen_to_rgb(int32_t pen, int32_t *red, int32_t *green, int32_t *blue)
+{
+	static const int32_t palette[7][3] = {
+		{0, 0, 0}, {255, 0, 0}, {0, 255, 0}, {255, 255, 0},
+		{0, 0, 255}, {255, 0, 255}, {0, 255, 255},
+	};
+
+	int32_t index = (pen - 1) % 7;
+	*red = palette[index][0];
+	*green = palette[index][1];
+	*blue = palette[index][2];
+}
+
+/**
+ * Find the vector list the selected pen cuts into, following the same
+ * fallthrough rules as colours found by Ghostscript. It is looked up on the
+ * first move drawn, so that pens which are selected but never lowered do not
+ * get settings of their own.
+ */
+static vector_list_t *hpgl_vector_list(hpgl_parser_t *self)
+{
+	if (self->list_found)
+		return self->list;
+
+	self->list_found = true;
+	self->list = NULL;
+	if (self->pen <= 0)
+		return NULL;
+
+	int32_t red, green, blue;
+	hpgl_pen_to_rgb(self->pen, &red, &green, &blue);
+
+	print_job_t *print_job = self->print_job;
+	vector_list_config_t *config = print_job_find_vector_list_config_by_rgb(print_job, red, green, blue);
+	if (config == NULL && print_job->vector_fallthrough)
+		config = print_job_clone_last_vector_list_config(print_job, red, green, blue);
+
+	self->list = (config != NULL) ? config->vector_list : NULL;
+	return self->list;
+}
+
+static void hpgl_device(hpgl_parser_t *self, double x, double y, int32_t *device_x, int32_t *device_y)
+{
+	*device_x = lround(x * self->scale);
+	*device_y = lround(self->bed_height - y * self->scale);
+}
+
+/**
+ * Move the pen to a point, cutting on the way when it is down.
+ */
+static void hpgl_move_to(hpgl_parser_t *self, double x, double y)
+{
+	if (self->relative) {
+		x += self->x;
+		y += self->y;
+	}
+
+	if (self->pen_down) {
+		vector_list_t *list = hpgl_vector_list(self);
+		int32_t start_x, start_y, end_x, end_y;
+		hpgl_device(self, self->x, self->y, &start_x, &start_y);
+		hpgl_device(self, x, y, &end_x, &end_y);
+
+		if (list != NULL && (start_x != end_x || start_y != end_y)) {
+			vector_list_append(list, vector_create(start_x, start_y, end_x, end_y));
+			self->vectors += 1;
+		}
+	}
+
+	self->x = x;
+	self->y = y;
+}
+
+static void hpgl_move_parameters(hpgl_parser_t *self)
+{
+	// a dangling coordinate without its pair is ignored
+	for (size_t index = 0; index + 1 < self->parameters_length; index += 2)
+		hpgl_move_to(self, self->parameters[index], self->parameters[index + 1]);
+}
+
+static void hpgl_select_pen(hpgl_parser_t *self, int32_t pen)
+{
+	if (pen != self->pen)
+		self->list_found = false;
+	self->pen = pen;
+}
+
+/**
+ * Run the instruction whose mnemonic and parameters were just read.
+ */
+static void hpgl_execute(hpgl_parser_t *self)
+{
+	const char *mnemonic = self->mnemonic;
+	self->instructions += 1;
+
+	if (strcmp(mnemonic, "PU") == 0) {
+		self->pen_down = false;
+		hpgl_move_parameters(self);
+	}
+	else if (strcmp(mnemonic, "PD") == 0) {
+		self->pen_down = true;
+		hpgl_move_parameters(self);
+	}
+	else if (strcmp(mnemonic, "PA") == 0) {
+		self->relative = false;
+		hpgl_move_parameters(self);
+	}
+	else if (strcmp(mnemonic, "PR") == 0) {
+		self->relative = true;
+		hpgl_move_parameters(self);
+	}
+	else if (strcmp(mnemonic, "SP") == 0) {
+		hpgl_select_pen(self, (self->parameters_length > 0) ? (int32_t)self->parameters[0] : 0);
+	}
+	else if (strcmp(mnemonic, "IN") == 0 || strcmp(mnemonic, "DF") == 0) {
+		// both reset to absolute moves with the pen up, IN also homes it
+		self->pen_down = false;
+		self->relative = false;
+		if (mnemonic[0] == 'I')
+			self->x = self->y = 0.0;
+	}
+	else {
+		self->ignored += 1;
+	}
+}
+
+/**
+ * Skip a PCL or device control escape sequence, which plotter files are often
+ * wrapped in.
+ */
+static void hpgl_skip_escape(hpgl_parser_t *self)
+{
+	int c = getc(self->file);
+
+	if (c == '.') {
+		// device control: ESC . ( and the like take no parameters
+		c = getc(self->file);
+		if (c == EOF || !(c == '@' || isalpha(c)))
+			return;
+		if (c == 'Y' || c == 'Z' || c == 'K' || c == 'L' || c == 'O' || c == 'E' || c == 'B' || c == 'J')
+			return;
+	}
+
+	// PCL: parameters up to a final upper case letter, or a colon for device control
+	while (c != EOF && !(c >= 'A' && c <= 'Z') && c != ':')
+		c = getc(self->file);
+}
+
+/**
+ * Skip the text of a label, which is not cut.
+ */
+static void hpgl_skip_label(hpgl_parser_t *self)
+{
+	int c;
+	while ((c = getc(self->file)) != EOF && c != self->label_terminator);
+}
+
+/**
+ * Read the parameters of an instruction, up to its terminating semicolon or
+ * the next mnemonic.
+ */
+static void hpgl_read_parameters(hpgl_parser_t *self)
+{
+	char number[HPGL_NUMBER_NCHARS];
+	size_t length = 0;
+	self->parameters_length = 0;
+
+	for (;;) {
+		int c = getc(self->file);
+		bool numeric = c != EOF && (isdigit(c) || c == '.' || c == '-' || c == '+');
+
+		// a sign starts a new number, as in PD10-20
+		if (length > 0 && (!numeric || c == '-' || c == '+')) {
+			number[length] = '\0';
+			if (self->parameters_length < HPGL_PARAMETERS_MAX) {
+				self->parameters[self->parameters_length] = strtod(number, NULL);
+				self->parameters_length += 1;
+			}
+			length = 0;
+		}
+
+		if (numeric) {
+			if (length + 1 < sizeof(number)) {
+				number[length] = (char)c;
+				length += 1;
+			}
+			continue;
+		}
+
+		if (c == EOF || c == ';')
+			break;
+
+		if (isalpha(c) || c == '\033') {
+			ungetc(c, self->file);
+			break;
+		}
+	}
+}
+
+/**
+ * Read the pen moves of an HP-GL plotter file straight into the vector lists
+ * of a print job, without going through Ghostscript.
+ *
+ * PU, PD, PA, PR, SP, IN and DF are followed, each pen cutting in its colour
+ * of the default palette, and every other instruction is skipped. The
+ * plotter origin is placed at the bottom left corner of the bed.
+ *
+ * @return 0 on success, -1 if the file could not be read.
+ */
+int hpgl_parse(print_job_t *print_job, FILE *hpgl_file)
+{
+	hpgl_parser_t *self = calloc(1, sizeof(hpgl_parser_t));
+	self->print_job = print_job;
+	self->file = hpgl_file;
+	self->label_terminator = HPGL_LABEL_TERMINATOR;
+	self->scale = print_job->raster->resolution / HPGL_UNITS_PER_INCH;
+	self->bed_height = print_job->height / 72.0 * print_job->raster->resolution;
+
+	// files written for a single pen cutter often never select one
+	self->pen = 1;
+
+	int c;
+	while ((c = getc(hpgl_file)) != EOF) {
+		if (c == '\033') {
+			hpgl_skip_escape(self);
+			continue;
+		}
+
+		if (!isalpha(c))
+			continue;
+
+		int next = getc(hpgl_file);
+		if (next == EOF || !isalpha(next)) {
+			if (next != EOF)
+				ungetc(next, hpgl_file);
+			continue;
+		}
+
+		self->mnemonic[0] = (char)toupper(c);
+		self->mnemonic[1] = (char)toupper(next);
+		self->mnemonic[2] = '\0';
+
+		if (strcmp(self->mnemonic, "LB") == 0) {
+			self->instructions += 1;
+			self->ignored += 1;
+			hpgl_skip_label(self);
+		}
+		else if (strcmp(self->mnemonic, "DT") == 0) {
+			// the new label terminator follows immediately
+			self->instructions += 1;
+			int terminator = getc(hpgl_file);
+			if (terminator == EOF || terminator == ';') {
+				self->label_terminator = HPGL_LABEL_TERMINATOR;
+			}
+			else {
+				self->label_terminator = terminator;
+				hpgl_read_parameters(self);
+			}
+		}
+		else {
+			hpgl_read_parameters(self);
+			hpgl_execute(self);
+		}
+	}
+
+	int rc = 0;
+	if (ferror(hpgl_file)) {
+		fprintf(stderr, "Error reading HPGL file\n");
+		rc = -1;
+	}
+
+	if (print_job->debug)
+		printf("HPGL instructions: %"PRId32" ignored: %"PRId32" vectors: %"PRId32"\n", self->instructions, self->ignored, self->vectors);
+
+	free(self);
+
+	return rc;
+}
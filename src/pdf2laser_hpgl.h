@@ -0,0 +1,29 @@
+#ifndef __PDF2LASER_HPGL_H__
+#define __PDF2LASER_HPGL_H__ 1
+
+#include <stdio.h>           // for FILE
+#include "type_print_job.h"  // for print_job_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+// plotter units in an inch, 40 to the millimetre
+#define HPGL_UNITS_PER_INCH (1016.0)
+
+// parameters kept for one instruction, extra ones are ignored
+#define HPGL_PARAMETERS_MAX (256)
+
+// longest parameter, longer numbers are truncated
+#define HPGL_NUMBER_NCHARS (64)
+
+int hpgl_parse(print_job_t *print_job, FILE *hpgl_file);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,492 @@
+#include "pdf2laser_image.h"
+#include <ctype.h>           // for isdigit, isspace
+#include <inttypes.h>        // for PRId32
+#include <stdbool.h>         // for bool, false, true
+#include <stddef.h>          // for NULL, size_t
+#include <stdint.h>          // for int32_t, uint8_t, uint32_t
+#include <stdio.h>           // for fprintf, fread, getc, printf, stderr, EOF, FILE
+#include <stdlib.h>          // for abs, calloc, free, malloc, realloc
+#include <string.h>          // for memcmp, memcpy, memset
+#include <zlib.h>            // for crc32, inflate, inflateEnd, inflateInit, uInt, uLong, z_stream, Z_BUF_ERROR, Z_NO_FLUSH, Z_NULL, Z_OK, Z_STREAM_END
+#include "type_image.h"      // for image_t, image_create, image_destroy, image_to_string
+#include "type_print_job.h"  // for print_job_t
+
+static const uint8_t png_signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+static uint32_t image_big_endian(const uint8_t *bytes)
+{
+	return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+/**
+ * Read the next number of a PNM header, skipping white space and comments.
+ *
+ * @return The number or -1 if there is none.
+ */
+static int32_t image_pnm_number(FILE *file)
+{
+	int c = getc(file);
+	while (c != EOF && (isspace(c) || c == '#')) {
+		if (c == '#') {
+			while (c != EOF && c != '\n')
+				c = getc(file);
+		}
+		c = getc(file);
+	}
+
+	if (c == EOF || !isdigit(c))
+		return -1;
+
+	int32_t value = 0;
+	while (c != EOF && isdigit(c)) {
+		if (value < IMAGE_SIDE_MAX)
+			value = value * 10 + (c - '0');
+		c = getc(file);
+	}
+
+	// the character ending the number is used up, which for raw formats is
+	// the single white space character between the header and the data
+	return value;
+}
+
+/**
+ * Read a PNM image (PBM, PGM or PPM, plain or raw) after its magic number.
+ */
+static image_t *image_parse_pnm(FILE *file, int format)
+{
+	bool bits = (format == 1 || format == 4);
+	bool plain = (format <= 3);
+	int32_t channels = (format == 3 || format == 6) ? 3 : 1;
+
+	int32_t width = image_pnm_number(file);
+	int32_t height = image_pnm_number(file);
+	int32_t maxval = bits ? 1 : image_pnm_number(file);
+
+	if (width < 1 || height < 1 || width > IMAGE_SIDE_MAX || height > IMAGE_SIDE_MAX || maxval < 1 || maxval > 65535) {
+		fprintf(stderr, "Bad PNM header\n");
+		return NULL;
+	}
+
+	image_t *image = image_create(width, height, channels);
+	uint8_t *pixel = image->pixels;
+
+	size_t row_nbytes = bits ? (size_t)(width + 7) / 8 : (size_t)width * channels * (maxval > 255 ? 2 : 1);
+	uint8_t *row = malloc(row_nbytes);
+
+	for (int32_t y = 0; y < height; y += 1) {
+		if (plain) {
+			for (int32_t index = 0; index < width * channels; index += 1) {
+				int32_t value;
+				if (bits) {
+					// plain bitmaps may run their digits together
+					int c;
+					do {
+						c = getc(file);
+					} while (c != EOF && c != '0' && c != '1');
+					value = (c == '1') ? 0 : 255;
+					if (c == EOF)
+						value = -1;
+				}
+				else {
+					value = image_pnm_number(file);
+					if (value >= 0)
+						value = value * 255 / maxval;
+				}
+				if (value < 0)
+					goto truncated;
+				*pixel++ = (uint8_t)value;
+			}
+			continue;
+		}
+
+		if (fread(row, 1, row_nbytes, file) != row_nbytes)
+			goto truncated;
+
+		if (bits) {
+			for (int32_t x = 0; x < width; x += 1)
+				*pixel++ = (row[x / 8] & (0x80 >> (x % 8))) ? 0 : 255;
+		}
+		else if (maxval > 255) {
+			for (size_t index = 0; index < row_nbytes; index += 2)
+				*pixel++ = (uint8_t)((((uint32_t)row[index] << 8) | row[index + 1]) * 255 / maxval);
+		}
+		else {
+			for (size_t index = 0; index < row_nbytes; index += 1)
+				*pixel++ = (uint8_t)(row[index] * 255 / maxval);
+		}
+	}
+
+	free(row);
+	return image;
+
+ truncated:
+	fprintf(stderr, "PNM image data is truncated\n");
+	free(row);
+	return image_destroy(image);
+}
+
+/**
+ * State of a PNG file being decoded. Image data is inflated a chunk at a time
+ * and every scanline is unfiltered and converted as soon as it is complete.
+ */
+typedef struct image_png image_png_t;
+struct image_png {
+	image_t *image;
+	int32_t width;
+	int32_t height;
+	int32_t depth;            // bits per sample
+	int32_t color_type;
+	int32_t samples;          // samples per pixel
+	size_t stride;            // bytes per scanline, without the filter byte
+	size_t bpp;               // bytes per complete pixel, at least one
+
+	uint8_t palette[256][4];  // rgba
+	bool transparent_key;     // tRNS gives a colour for grey or rgb images
+	uint32_t key[3];
+
+	z_stream stream;
+	uint8_t *scanline;        // the filter byte followed by the scanline
+	uint8_t *previous;
+	size_t filled;
+	int32_t y;
+};
+
+static uint8_t image_paeth(uint8_t a, uint8_t b, uint8_t c)
+{
+	int p = a + b - c;
+	int pa = abs(p - a);
+	int pb = abs(p - b);
+	int pc = abs(p - c);
+
+	if (pa <= pb && pa <= pc)
+		return a;
+	return (pb <= pc) ? b : c;
+}
+
+static bool image_png_unfilter(image_png_t *self)
+{
+	uint8_t filter = self->scanline[0];
+	uint8_t *row = self->scanline + 1;
+	const uint8_t *up = self->previous;
+	size_t bpp = self->bpp;
+
+	for (size_t index = 0; index < self->stride; index += 1) {
+		uint8_t a = (index >= bpp) ? row[index - bpp] : 0;
+		uint8_t b = up[index];
+		uint8_t c = (index >= bpp) ? up[index - bpp] : 0;
+
+		switch (filter) {
+		case 0: break;
+		case 1: row[index] += a; break;
+		case 2: row[index] += b; break;
+		case 3: row[index] += (a + b) / 2; break;
+		case 4: row[index] += image_paeth(a, b, c); break;
+		default: return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Sample of a pixel in an unfiltered scanline, scaled to eight bits unless
+ * it is a palette index.
+ */
+static uint32_t image_png_sample(image_png_t *self, const uint8_t *row, size_t index, bool raw)
+{
+	uint32_t value;
+	switch (self->depth) {
+	case 16:
+		value = ((uint32_t)row[2 * index] << 8) | row[2 * index + 1];
+		return raw ? value : value >> 8;
+	case 8:
+		return row[index];
+	default: {
+		size_t bit = index * self->depth;
+		uint32_t mask = (1u << self->depth) - 1;
+		value = (row[bit / 8] >> (8 - self->depth - bit % 8)) & mask;
+		return raw ? value : value * 255 / mask;
+	}
+	}
+}
+
+/**
+ * Store a complete scanline in the image, compositing any transparency on
+ * white so that transparent pixels are not engraved.
+ */
+static void image_png_store(image_png_t *self)
+{
+	const uint8_t *row = self->scanline + 1;
+	image_t *image = self->image;
+	uint8_t *pixel = image->pixels + (size_t)self->y * image->width * image->channels;
+
+	for (int32_t x = 0; x < self->width; x += 1) {
+		uint32_t rgb[3];
+		uint32_t alpha = 255;
+		size_t sample = (size_t)x * self->samples;
+
+		switch (self->color_type) {
+		case 3: {
+			uint32_t entry = image_png_sample(self, row, sample, true) & 0xff;
+			rgb[0] = self->palette[entry][0];
+			rgb[1] = self->palette[entry][1];
+			rgb[2] = self->palette[entry][2];
+			alpha = self->palette[entry][3];
+			break;
+		}
+		case 0:
+		case 4:
+			rgb[0] = rgb[1] = rgb[2] = image_png_sample(self, row, sample, false);
+			if (self->color_type == 4)
+				alpha = image_png_sample(self, row, sample + 1, false);
+			else if (self->transparent_key && image_png_sample(self, row, sample, true) == self->key[0])
+				alpha = 0;
+			break;
+		default:
+			for (int channel = 0; channel < 3; channel += 1)
+				rgb[channel] = image_png_sample(self, row, sample + channel, false);
+			if (self->color_type == 6)
+				alpha = image_png_sample(self, row, sample + 3, false);
+			else if (self->transparent_key &&
+			         image_png_sample(self, row, sample, true) == self->key[0] &&
+			         image_png_sample(self, row, sample + 1, true) == self->key[1] &&
+			         image_png_sample(self, row, sample + 2, true) == self->key[2])
+				alpha = 0;
+			break;
+		}
+
+		for (int32_t channel = 0; channel < image->channels; channel += 1)
+			*pixel++ = (uint8_t)((rgb[channel] * alpha + 255 * (255 - alpha)) / 255);
+	}
+}
+
+/**
+ * Inflate the data of an IDAT chunk, handling each scanline as it completes.
+ *
+ * @return 0 on success, -1 on a corrupt stream.
+ */
+static int image_png_inflate(image_png_t *self, uint8_t *data, size_t length)
+{
+	self->stream.next_in = data;
+	self->stream.avail_in = (uInt)length;
+
+	while (self->stream.avail_in > 0 && self->y < self->height) {
+		self->stream.next_out = self->scanline + self->filled;
+		self->stream.avail_out = (uInt)(self->stride + 1 - self->filled);
+
+		int rc = inflate(&self->stream, Z_NO_FLUSH);
+		if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+			fprintf(stderr, "Corrupt PNG image data\n");
+			return -1;
+		}
+
+		self->filled = self->stride + 1 - self->stream.avail_out;
+		if (self->filled == self->stride + 1) {
+			if (!image_png_unfilter(self)) {
+				fprintf(stderr, "Bad PNG filter type %d\n", self->scanline[0]);
+				return -1;
+			}
+			image_png_store(self);
+			memcpy(self->previous, self->scanline + 1, self->stride);
+			self->filled = 0;
+			self->y += 1;
+		}
+
+		if (rc == Z_STREAM_END || (rc == Z_BUF_ERROR && self->stream.avail_in == 0))
+			break;
+	}
+
+	return 0;
+}
+
+/**
+ * Read the header of a PNG image from its IHDR chunk.
+ */
+static int image_png_header(image_png_t *self, const uint8_t *data, size_t length)
+{
+	if (length != 13) {
+		fprintf(stderr, "Bad PNG header\n");
+		return -1;
+	}
+
+	self->width = (int32_t)image_big_endian(data);
+	self->height = (int32_t)image_big_endian(data + 4);
+	self->depth = data[8];
+	self->color_type = data[9];
+
+	static const int32_t samples[7] = {1, 0, 3, 1, 2, 0, 4};
+	if (self->color_type > 6 || samples[self->color_type] == 0 ||
+	    self->width < 1 || self->height < 1 || self->width > IMAGE_SIDE_MAX || self->height > IMAGE_SIDE_MAX ||
+	    (self->depth != 1 && self->depth != 2 && self->depth != 4 && self->depth != 8 && self->depth != 16)) {
+		fprintf(stderr, "Unsupported PNG format (color type %"PRId32", depth %"PRId32")\n", self->color_type, self->depth);
+		return -1;
+	}
+
+	if (data[12] != 0) {
+		fprintf(stderr, "Interlaced PNG images are not supported\n");
+		return -1;
+	}
+
+	self->samples = samples[self->color_type];
+	self->stride = ((size_t)self->width * self->samples * self->depth + 7) / 8;
+	self->bpp = (self->samples * self->depth + 7) / 8;
+
+	bool grey = (self->color_type == 0 || self->color_type == 4);
+	self->image = image_create(self->width, self->height, grey ? 1 : 3);
+	self->scanline = calloc(self->stride + 1, sizeof(uint8_t));
+	self->previous = calloc(self->stride, sizeof(uint8_t));
+
+	for (int index = 0; index < 256; index += 1) {
+		self->palette[index][0] = self->palette[index][1] = self->palette[index][2] = 0;
+		self->palette[index][3] = 255;
+	}
+
+	return 0;
+}
+
+/**
+ * Read a PNG image after its signature, one chunk at a time.
+ */
+static image_t *image_parse_png(FILE *file)
+{
+	image_png_t *self = calloc(1, sizeof(image_png_t));
+	if (inflateInit(&self->stream) != Z_OK) {
+		free(self);
+		return NULL;
+	}
+
+	size_t data_capacity = IMAGE_CHUNK_NBYTES;
+	uint8_t *data = malloc(data_capacity);
+	int rc = -1;
+
+	for (;;) {
+		uint8_t header[8];
+		if (fread(header, 1, 8, file) != 8) {
+			fprintf(stderr, "PNG file ends without IEND\n");
+			break;
+		}
+
+		uint32_t length = image_big_endian(header);
+		const uint8_t *type = header + 4;
+
+		if (length > 0x7fffffff) {
+			fprintf(stderr, "Bad PNG chunk length\n");
+			break;
+		}
+		if (length > data_capacity) {
+			data_capacity = length;
+			data = realloc(data, data_capacity);
+		}
+
+		uint8_t crc[4];
+		if (fread(data, 1, length, file) != length || fread(crc, 1, 4, file) != 4) {
+			fprintf(stderr, "PNG file is truncated\n");
+			break;
+		}
+
+		uLong check = crc32(crc32(0L, Z_NULL, 0), type, 4);
+		check = crc32(check, data, length);
+		if (check != image_big_endian(crc)) {
+			fprintf(stderr, "Bad PNG checksum in %.4s chunk\n", (const char *)type);
+			break;
+		}
+
+		if (memcmp(type, "IHDR", 4) == 0) {
+			if (self->image != NULL || image_png_header(self, data, length) != 0)
+				break;
+			continue;
+		}
+
+		if (self->image == NULL) {
+			fprintf(stderr, "PNG file does not start with IHDR\n");
+			break;
+		}
+
+		if (memcmp(type, "IEND", 4) == 0) {
+			if (self->y < self->height)
+				fprintf(stderr, "PNG image data is truncated\n");
+			else
+				rc = 0;
+			break;
+		}
+		else if (memcmp(type, "IDAT", 4) == 0) {
+			if (image_png_inflate(self, data, length) != 0)
+				break;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0) {
+			for (uint32_t index = 0; index < length / 3 && index < 256; index += 1)
+				memcpy(self->palette[index], data + 3 * index, 3);
+		}
+		else if (memcmp(type, "tRNS", 4) == 0) {
+			if (self->color_type == 3) {
+				for (uint32_t index = 0; index < length && index < 256; index += 1)
+					self->palette[index][3] = data[index];
+			}
+			else if (length >= 2) {
+				self->transparent_key = true;
+				for (uint32_t index = 0; index < 3 && 2 * index + 1 < length; index += 1)
+					self->key[index] = ((uint32_t)data[2 * index] << 8) | data[2 * index + 1];
+			}
+		}
+		else if (memcmp(type, "pHYs", 4) == 0) {
+			// pixels per metre when the unit is 1, otherwise only an aspect ratio
+			if (length == 9 && data[8] == 1 && image_big_endian(data) > 0)
+				self->image->resolution = image_big_endian(data) * 0.0254;
+		}
+		else if (!(type[0] & 0x20)) {
+			fprintf(stderr, "Unknown critical PNG chunk %.4s\n", (const char *)type);
+			break;
+		}
+	}
+
+	image_t *image = self->image;
+	if (rc != 0)
+		image = image_destroy(image);
+
+	inflateEnd(&self->stream);
+	free(self->scanline);
+	free(self->previous);
+	free(self);
+	free(data);
+
+	return image;
+}
+
+/**
+ * Read a PNG or PNM image into the print job, to be engraved without going
+ * through Ghostscript. The format is recognised from the start of the file.
+ * The image is placed at the top left corner of the bed and keeps its own
+ * resolution when the file gives one.
+ *
+ * @return 0 on success, -1 if the image could not be read.
+ */
+int image_parse(print_job_t *print_job, FILE *image_file)
+{
+	uint8_t magic[8];
+	size_t magic_nbytes = fread(magic, 1, 2, image_file);
+
+	image_t *image = NULL;
+	if (magic_nbytes == 2 && magic[0] == 'P' && magic[1] >= '1' && magic[1] <= '6') {
+		image = image_parse_pnm(image_file, magic[1] - '0');
+	}
+	else if (magic_nbytes == 2 && fread(magic + 2, 1, 6, image_file) == 6 && memcmp(magic, png_signature, 8) == 0) {
+		image = image_parse_png(image_file);
+	}
+	else {
+		fprintf(stderr, "Unknown image format\n");
+	}
+
+	if (image == NULL)
+		return -1;
+
+	if (print_job->debug) {
+		char *s = image_to_string(image);
+		printf("%s\n", s);
+		free(s);
+	}
+
+	image_destroy(print_job->image);
+	print_job->image = image;
+
+	return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef __PDF2LASER_IMAGE_H__
+#define __PDF2LASER_IMAGE_H__ 1
+
+#include <stdio.h>           // for FILE
+#include "type_print_job.h"  // for print_job_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+// largest width or height in pixels of an image read
+#define IMAGE_SIDE_MAX (65536)
+
+// compressed bytes read from a PNG file at a time
+#define IMAGE_CHUNK_NBYTES (65536)
+
+int image_parse(print_job_t *print_job, FILE *image_file);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,203 @@
+#include "pdf2laser_make_workload.h"
+#include <stddef.h>              // for size_t, NULL
+#include <stdint.h>              // for uint32_t
+#include <stdio.h>               // for fprintf, fclose, fopen, FILE, perror, stderr, stdout
+#include <stdlib.h>              // for atof, exit, strtoul, strtoull, EXIT_FAILURE, EXIT_SUCCESS
+#include <string.h>              // for strchr, strcmp
+#include "config.h"              // for PACKAGE, VERSION
+#define OPTPARSE_IMPLEMENTATION
+#define OPTPARSE_API static
+#include "optparse.h"            // for OPTPARSE_REQUIRED, optparse, OPTPARSE_NONE, optparse_long, optparse_init
+#include "pdf2laser_workload.h"  // for workload_t, workload_create, workload_destroy, workload_fill_from_string, workload_shape_from_string, workload_write_bitmap, workload_write_pdf, workload_write_vectors
+#include "type_raster.h"         // for raster_mode, RASTER_MODE_MONO
+
+static const struct optparse_long long_options[] = {
+	{"format",        'f',  OPTPARSE_REQUIRED},
+	{"output",        'o',  OPTPARSE_REQUIRED},
+	{"shape",         's',  OPTPARSE_REQUIRED},
+	{"segments",      'n',  OPTPARSE_REQUIRED},
+	{"connectivity",  'k',  OPTPARSE_REQUIRED},
+	{"colors",        'c',  OPTPARSE_REQUIRED},
+	{"field",         'F',  OPTPARSE_REQUIRED},
+	{"fill",          'b',  OPTPARSE_REQUIRED},
+	{"density",       'D',  OPTPARSE_REQUIRED},
+	{"width",         'W',  OPTPARSE_REQUIRED},
+	{"height",        'H',  OPTPARSE_REQUIRED},
+	{"dpi",           'd',  OPTPARSE_REQUIRED},
+	{"mode",          'm',  OPTPARSE_REQUIRED},
+	{"seed",          'r',  OPTPARSE_REQUIRED},
+	{"help",          'h',  OPTPARSE_NONE},
+	{"version",       '@',  OPTPARSE_NONE},
+	{0}
+};
+
+static void usage(int rc, const char * const msg)
+{
+	static const char usage_str[] =
+		"Usage: " PACKAGE "-make-workload [OPTION]...\n"
+		"\n"
+		"Write a synthetic job for benchmarks and stress tests. The same options\n"
+		"always give the same output.\n"
+		"\n"
+		"  -f, --format=FORMAT            One of vector, bmp, pdf (default pdf)\n"
+		"  -o, --output=FILE              Write to FILE instead of standard output\n"
+		"  -s, --shape=SHAPE              One of random, grid, circles, text\n"
+		"  -n, --segments=N               Number of vector segments, 0 for none\n"
+		"  -k, --connectivity=CHANCE      Chance a random segment continues the last\n"
+		"  -c, --colors=N                 Number of vector colours\n"
+		"  -F, --field=UNITS              Side of the square vectors are drawn in\n"
+		"  -b, --fill=FILL                One of blank, text, photo, noise\n"
+		"  -D, --density=SHARE            Share of pixels inked by the noise fill\n"
+		"  -W, --width=INCHES             Width of the page\n"
+		"  -H, --height=INCHES            Height of the page\n"
+		"  -d, --dpi=DPI                  Resolution of the bitmap or pdf image\n"
+		"  -m, --mode=MODE                Bitmap mode, one of m, g, c (default m)\n"
+		"  -r, --seed=SEED                Seed of the generator\n"
+		"  -h, --help                     Output a usage message and exit\n"
+		"      --version                  Output the version number and exit\n"
+		"";
+
+	fprintf(stderr, "%s%s\n", msg, usage_str);
+
+	exit(rc);
+}
+
+/**
+ * Entry point for the workload generator.
+ */
+int main(int argc, char *argv[])
+{
+	const char *format = "pdf";
+	const char *output_filename = NULL;
+	uint32_t dpi = MAKE_WORKLOAD_DPI;
+	raster_mode mode = RASTER_MODE_MONO;
+	workload_t *workload = workload_create(MAKE_WORKLOAD_SEED);
+
+	struct optparse options;
+	int option;
+	char *end;
+
+	optparse_init(&options, argv);
+	while ((option = optparse_long(&options, long_options, NULL)) != -1) {
+		switch (option) {
+		case 'f':
+			format = options.optarg;
+			break;
+
+		case 'o':
+			output_filename = options.optarg;
+			break;
+
+		case 's':
+			if (workload_shape_from_string(options.optarg, &(workload->shape)))
+				usage(EXIT_FAILURE, "Unknown shape\n");
+			break;
+
+		case 'n':
+			workload->segments = strtoull(options.optarg, &end, 10);
+			if (end == options.optarg || *end != '\0' || strchr(options.optarg, '-') != NULL)
+				usage(EXIT_FAILURE, "Segments must be a whole number\n");
+			break;
+
+		case 'k':
+			workload->connectivity = atof(options.optarg);
+			break;
+
+		case 'c':
+			workload->colors = strtoul(options.optarg, NULL, 10);
+			if (workload->colors == 0)
+				usage(EXIT_FAILURE, "Colors must be at least 1\n");
+			break;
+
+		case 'F':
+			workload->field = strtoul(options.optarg, NULL, 10);
+			if (workload->field <= 0)
+				usage(EXIT_FAILURE, "Field must be positive\n");
+			break;
+
+		case 'b':
+			if (workload_fill_from_string(options.optarg, &(workload->fill)))
+				usage(EXIT_FAILURE, "Unknown fill\n");
+			break;
+
+		case 'D':
+			workload->density = atof(options.optarg);
+			break;
+
+		case 'W':
+			workload->width = atof(options.optarg);
+			break;
+
+		case 'H':
+			workload->height = atof(options.optarg);
+			break;
+
+		case 'd':
+			dpi = strtoul(options.optarg, NULL, 10);
+			break;
+
+		case 'm':
+			if (options.optarg[0] == '\0' || options.optarg[1] != '\0' || strchr("mgc", options.optarg[0]) == NULL)
+				usage(EXIT_FAILURE, "Unknown raster mode\n");
+			mode = (raster_mode)options.optarg[0];
+			break;
+
+		case 'r':
+			workload->seed = strtoull(options.optarg, NULL, 10);
+			break;
+
+		case 'h':
+			usage(EXIT_SUCCESS, "");
+			break;
+
+		case '@':
+			fprintf(stdout, "%s\n", VERSION);
+			exit(EXIT_SUCCESS);
+
+		case '?':
+			fprintf(stderr, "%s: %s\n", argv[0], options.errmsg);
+			exit(EXIT_FAILURE);
+
+		default:
+			usage(EXIT_FAILURE, "Unknown argument\n");
+		}
+	}
+
+	if (argc > options.optind)
+		usage(EXIT_FAILURE, "Unexpected argument\n");
+
+	if (workload->width <= 0.0 || workload->height <= 0.0)
+		usage(EXIT_FAILURE, "Page size must be positive\n");
+
+	FILE *file = stdout;
+	if (output_filename != NULL) {
+		file = fopen(output_filename, "wb");
+		if (file == NULL) {
+			perror(output_filename);
+			workload_destroy(workload);
+			return EXIT_FAILURE;
+		}
+	}
+
+	int rc = 0;
+	if (!strcmp(format, "vector")) {
+		workload_write_vectors(workload, file);
+	}
+	else if (!strcmp(format, "bmp")) {
+		if (dpi == 0 || workload_write_bitmap(workload, file, mode, dpi) == 0)
+			rc = -1;
+	}
+	else if (!strcmp(format, "pdf")) {
+		rc = workload_write_pdf(workload, file, dpi);
+	}
+	else {
+		fprintf(stderr, "Unknown format '%s'\n", format);
+		rc = -1;
+	}
+
+	if (file != stdout)
+		fclose(file);
+	workload_destroy(workload);
+
+	return rc ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,23 @@
+#ifndef __PDF2LASER_MAKE_WORKLOAD_H__
+#define __PDF2LASER_MAKE_WORKLOAD_H__ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/** Resolution of bitmaps and pdf images unless -d is given. */
+#define MAKE_WORKLOAD_DPI (300)
+
+/** Seed of the generator unless -r is given. */
+#define MAKE_WORKLOAD_SEED (1)
+
+int main(int argc, char *argv[]);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,107 @@
+#include "pdf2laser_memory.h"
+#include <stdint.h>        // for uint64_t
+#include <stdlib.h>        // for calloc, free
+#include <string.h>        // for strlen, strndup
+#include <sys/resource.h>  // for getrusage, rusage, RUSAGE_SELF
+
+/*
+ * Allocations are only made from the main thread, so the counters are plain
+ * integers.
+ */
+static memory_stats_t memory_categories[MEMORY_CATEGORIES_LENGTH];
+
+static void memory_account(memory_category category, size_t size)
+{
+	memory_stats_t *stats = &(memory_categories[category]);
+
+	stats->allocations += 1;
+	stats->bytes += size;
+	if (stats->bytes > stats->peak_bytes)
+		stats->peak_bytes = stats->bytes;
+}
+
+/**
+ * calloc which accounts the allocation to the given category.
+ */
+void *memory_calloc(memory_category category, size_t count, size_t size)
+{
+	void *ptr = calloc(count, size);
+	if (ptr != NULL)
+		memory_account(category, count * size);
+
+	return ptr;
+}
+
+/**
+ * strndup which accounts the copy to the given category. Release it with
+ * memory_free_string.
+ */
+char *memory_strndup(memory_category category, const char *s, size_t n)
+{
+	char *copy = strndup(s, n);
+	if (copy != NULL)
+		memory_account(category, strlen(copy) + 1);
+
+	return copy;
+}
+
+/**
+ * Release an allocation made with memory_calloc.
+ *
+ * @param size the number of bytes which were requested for ptr.
+ */
+void memory_free(memory_category category, void *ptr, size_t size)
+{
+	if (ptr == NULL)
+		return;
+
+	memory_stats_t *stats = &(memory_categories[category]);
+	stats->frees += 1;
+	stats->bytes -= size;
+
+	free(ptr);
+}
+
+void memory_free_string(memory_category category, char *s)
+{
+	if (s == NULL)
+		return;
+
+	memory_free(category, s, strlen(s) + 1);
+}
+
+memory_stats_t *memory_stats(memory_category category)
+{
+	return &(memory_categories[category]);
+}
+
+const char *memory_category_to_string(memory_category category)
+{
+	switch (category) {
+	case MEMORY_VECTOR:
+		return "vector";
+	case MEMORY_PRESET:
+		return "preset";
+	case MEMORY_INI:
+		return "ini";
+	default:
+		return "unknown";
+	}
+}
+
+/**
+ * Largest resident set size of the process so far, in KiB.
+ */
+uint64_t memory_peak_rss(void)
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage))
+		return 0;
+
+#ifdef __APPLE__
+	// Darwin reports bytes rather than KiB
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+}
@@ -0,0 +1,43 @@
+#ifndef __PDF2LASER_MEMORY_H__
+#define __PDF2LASER_MEMORY_H__ 1
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint64_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+typedef enum {
+	MEMORY_VECTOR,  // vector_t, point_t and vector_list_t
+	MEMORY_PRESET,  // preset_t and preset_file_t
+	MEMORY_INI,     // parsed INI files, sections and entries
+	MEMORY_CATEGORIES_LENGTH,
+} memory_category;
+
+typedef struct memory_stats memory_stats_t;
+struct memory_stats {
+	uint64_t allocations;  // number of allocations made
+	uint64_t frees;        // number of allocations released
+	uint64_t bytes;        // bytes currently allocated
+	uint64_t peak_bytes;   // largest value bytes has reached
+};
+
+void *memory_calloc(memory_category category, size_t count, size_t size);
+char *memory_strndup(memory_category category, const char *s, size_t n);
+void memory_free(memory_category category, void *ptr, size_t size);
+void memory_free_string(memory_category category, char *s);
+
+memory_stats_t *memory_stats(memory_category category);
+const char *memory_category_to_string(memory_category category);
+
+uint64_t memory_peak_rss(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
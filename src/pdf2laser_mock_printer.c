@@ -0,0 +1,384 @@
+#include "pdf2laser_mock_printer.h"
+#include <fcntl.h>           // for open, O_CREAT, O_TRUNC, O_WRONLY
+#include <inttypes.h>        // for PRIu32
+#include <netdb.h>           // for addrinfo, freeaddrinfo, gai_strerror, getaddrinfo, AI_PASSIVE
+#include <signal.h>          // for signal, SIGPIPE, SIG_IGN
+#include <stdbool.h>         // for bool, false, true
+#include <stddef.h>          // for size_t, NULL
+#include <stdint.h>          // for uint32_t, uint64_t, uint8_t
+#include <stdio.h>           // for dprintf, fflush, fprintf, perror, printf, sscanf, stderr, stdout
+#include <stdlib.h>          // for atoi, exit, free, strtoull, EXIT_FAILURE, EXIT_SUCCESS
+#include <sys/socket.h>      // for accept, bind, listen, recv, setsockopt, socket, AF_UNSPEC, SOL_SOCKET, SO_REUSEADDR, SOCK_STREAM
+#include <time.h>            // for nanosleep, timespec
+#include <unistd.h>          // for close, read, write, ssize_t
+#include "config.h"          // for PACKAGE, VERSION
+#define OPTPARSE_IMPLEMENTATION
+#define OPTPARSE_API static
+#include "optparse.h"        // for OPTPARSE_REQUIRED, optparse, OPTPARSE_NONE, optparse_long, optparse_init
+#include "pdf2laser_util.h"  // for pdf2laser_clock, pdf2laser_format_string
+
+typedef struct mock_printer mock_printer_t;
+struct mock_printer {
+	char *port;
+	char *output_directory;
+
+	uint64_t bandwidth;    // bytes per second accepted, 0 is unlimited
+	uint32_t latency;      // milliseconds before each acknowledgement
+	uint32_t queue_depth;  // number of jobs to report as queued
+
+	uint32_t job_limit;    // exit after this many jobs, 0 runs forever
+	uint32_t job_count;
+};
+
+static const struct optparse_long long_options[] = {
+	{"port",        'p',  OPTPARSE_REQUIRED},
+	{"output",      'o',  OPTPARSE_REQUIRED},
+	{"bandwidth",   'b',  OPTPARSE_REQUIRED},
+	{"latency",     'l',  OPTPARSE_REQUIRED},
+	{"queue-depth", 'q',  OPTPARSE_REQUIRED},
+	{"jobs",        'n',  OPTPARSE_REQUIRED},
+	{"help",        'h',  OPTPARSE_NONE},
+	{"version",     '@',  OPTPARSE_NONE},
+	{0}
+};
+
+static void usage(int rc, const char * const msg)
+{
+	static const char usage_str[] =
+		"Usage: " PACKAGE "-mock-printer [OPTION]...\n"
+		"\n"
+		"Stand-in for an Epilog laser cutter which accepts LPD print jobs and\n"
+		"writes the received pjl to disk.\n"
+		"\n"
+		"  -p, --port=PORT                Port to listen on (default " MOCK_PRINTER_PORT ")\n"
+		"  -o, --output=DIRECTORY         Where to store received jobs (default .)\n"
+		"  -b, --bandwidth=BYTES          Bytes per second to accept (default unlimited)\n"
+		"  -l, --latency=MILLISECONDS     Delay before each acknowledgement\n"
+		"  -q, --queue-depth=JOBS         Number of jobs to report as queued\n"
+		"  -n, --jobs=COUNT               Exit after receiving COUNT jobs\n"
+		"  -h, --help                     Output a usage message and exit\n"
+		"      --version                  Output the version number and exit\n"
+		"";
+
+	fprintf(stderr, "%s%s\n", msg, usage_str);
+
+	exit(rc);
+}
+
+static void mock_printer_sleep(double seconds)
+{
+	if (seconds <= 0.0)
+		return;
+
+	struct timespec duration = {
+		.tv_sec = (time_t)seconds,
+		.tv_nsec = (long)((seconds - (time_t)seconds) * 1e9),
+	};
+	while (nanosleep(&duration, &duration) == -1)
+		;
+}
+
+static bool mock_printer_ack(mock_printer_t *self, int client_fd, uint8_t code)
+{
+	mock_printer_sleep(self->latency / 1000.0);
+	return write(client_fd, &code, 1) == 1;
+}
+
+/**
+ * Read a single LPD command line, without its terminating newline.
+ *
+ * @return The length of the line, or -1 if the client went away first.
+ */
+static ssize_t mock_printer_read_line(int client_fd, char *line, size_t size)
+{
+	size_t length = 0;
+	while (length + 1 < size) {
+		char c;
+		if (read(client_fd, &c, 1) != 1)
+			return -1;
+		if (c == '\n')
+			break;
+		line[length++] = c;
+	}
+
+	// strip the carriage return pdf2laser sends along
+	if (length > 0 && line[length - 1] == '\r')
+		length -= 1;
+
+	line[length] = '\0';
+	return length;
+}
+
+/**
+ * Receive count bytes from the client at no more than the configured
+ * bandwidth, writing them to out_fd if it is valid.
+ *
+ * @return The number of bytes received.
+ */
+static uint64_t mock_printer_receive(mock_printer_t *self, int client_fd, uint64_t count, int out_fd)
+{
+	char buffer[MOCK_PRINTER_CHUNK];
+
+	// Read in slices of about 50ms worth of data so throttling stays smooth
+	size_t chunk = MOCK_PRINTER_CHUNK;
+	if (self->bandwidth > 0 && self->bandwidth / 20 + 1 < chunk)
+		chunk = self->bandwidth / 20 + 1;
+
+	double start = pdf2laser_clock();
+	uint64_t received = 0;
+	while (received < count) {
+		size_t want = (count - received < chunk) ? (size_t)(count - received) : chunk;
+		ssize_t rc = recv(client_fd, buffer, want, 0);
+		if (rc <= 0)
+			break;
+
+		if (out_fd >= 0 && write(out_fd, buffer, rc) != rc) {
+			perror("Error writing job");
+			out_fd = -1;
+		}
+
+		received += rc;
+
+		if (self->bandwidth > 0)
+			mock_printer_sleep((double)received / self->bandwidth - (pdf2laser_clock() - start));
+	}
+
+	return received;
+}
+
+static void mock_printer_receive_data_file(mock_printer_t *self, int client_fd, uint64_t count, const char *name)
+{
+	self->job_count += 1;
+
+	char *path = pdf2laser_format_string("%s/job-%04"PRIu32".pjl", self->output_directory, self->job_count);
+	int out_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (out_fd < 0)
+		perror(path);
+
+	double start = pdf2laser_clock();
+	uint64_t received = mock_printer_receive(self, client_fd, count, out_fd);
+	double elapsed = pdf2laser_clock() - start;
+
+	if (out_fd >= 0)
+		close(out_fd);
+
+	printf("job %"PRIu32": %s %llu/%llu bytes in %.3fs (%.1f KiB/s) -> %s\n",
+	       self->job_count, name, (unsigned long long)received, (unsigned long long)count,
+	       elapsed, (elapsed > 0.0) ? (received / elapsed / 1024.0) : 0.0, path);
+	fflush(stdout);
+
+	free(path);
+
+	// RFC 1179 clients terminate the file with a zero byte and wait for an
+	// acknowledgement; pdf2laser simply hangs up instead.
+	uint8_t terminator;
+	if (received == count && recv(client_fd, &terminator, 1, 0) == 1)
+		mock_printer_ack(self, client_fd, 0);
+}
+
+/**
+ * Handle the "receive a printer job" command and its subcommands.
+ */
+static void mock_printer_receive_job(mock_printer_t *self, int client_fd)
+{
+	if (!mock_printer_ack(self, client_fd, 0))
+		return;
+
+	char line[MOCK_PRINTER_LINE_NCHARS];
+	while (mock_printer_read_line(client_fd, line, MOCK_PRINTER_LINE_NCHARS) > 0) {
+		unsigned long long count;
+		char name[MOCK_PRINTER_LINE_NCHARS];
+		if (sscanf(line + 1, "%llu %1023s", &count, name) != 2) {
+			mock_printer_ack(self, client_fd, 1);
+			return;
+		}
+
+		switch (line[0]) {
+		case '\002': { // receive control file
+			mock_printer_ack(self, client_fd, 0);
+			mock_printer_receive(self, client_fd, count + 1, -1);
+			mock_printer_ack(self, client_fd, 0);
+			break;
+		}
+		case '\003': { // receive data file
+			mock_printer_ack(self, client_fd, 0);
+			mock_printer_receive_data_file(self, client_fd, count, name);
+			break;
+		}
+		default: { // abort job, or unknown
+			return;
+		}
+		}
+	}
+}
+
+/**
+ * Answer a "send queue state" command with a BSD style listing.
+ */
+static void mock_printer_send_queue_state(mock_printer_t *self, int client_fd)
+{
+	static const char *ordinals[] = { "th", "st", "nd", "rd" };
+
+	mock_printer_sleep(self->latency / 1000.0);
+
+	if (self->queue_depth == 0) {
+		dprintf(client_fd, "no entries\n");
+		return;
+	}
+
+	dprintf(client_fd, "mock is ready and printing\n");
+	dprintf(client_fd, "Rank   Owner      Job  Files                                 Total Size\n");
+	for (uint32_t index = 0; index < self->queue_depth; index += 1) {
+		if (index == 0) {
+			dprintf(client_fd, "active ");
+		}
+		else {
+			uint32_t suffix = (index % 10 < 4 && (index / 10) % 10 != 1) ? index % 10 : 0;
+			dprintf(client_fd, "%"PRIu32"%-4s", index, ordinals[suffix]);
+		}
+		dprintf(client_fd, " mock       %-4"PRIu32" job-%04"PRIu32".pjl                          0 bytes\n", index + 1, index + 1);
+	}
+}
+
+static void mock_printer_serve(mock_printer_t *self, int client_fd)
+{
+	char line[MOCK_PRINTER_LINE_NCHARS];
+	if (mock_printer_read_line(client_fd, line, MOCK_PRINTER_LINE_NCHARS) < 1)
+		return;
+
+	switch (line[0]) {
+	case '\002': { // receive a printer job
+		mock_printer_receive_job(self, client_fd);
+		break;
+	}
+	case '\003':   // send queue state (short)
+	case '\004': { // send queue state (long)
+		mock_printer_send_queue_state(self, client_fd);
+		break;
+	}
+	default: {
+		mock_printer_ack(self, client_fd, 1);
+	}
+	}
+}
+
+static int mock_printer_listen(mock_printer_t *self)
+{
+	struct addrinfo *res;
+	struct addrinfo base = { .ai_flags = AI_PASSIVE, .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+
+	int error_code = getaddrinfo(NULL, self->port, &base, &res);
+	if (error_code) {
+		fprintf(stderr, "Invalid port %s: %s\n", self->port, gai_strerror(error_code));
+		return -1;
+	}
+
+	int server_fd = -1;
+	for (struct addrinfo *addr = res; addr != NULL; addr = addr->ai_next) {
+		server_fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+		if (server_fd < 0)
+			continue;
+
+		int value = 1;
+		setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value));
+
+		if (!bind(server_fd, addr->ai_addr, addr->ai_addrlen) && !listen(server_fd, 8))
+			break;
+
+		close(server_fd);
+		server_fd = -1;
+	}
+	freeaddrinfo(res);
+
+	if (server_fd < 0)
+		perror("Unable to listen");
+
+	return server_fd;
+}
+
+/**
+ * Entry point for the mock printer. Accepts one LPD connection at a time,
+ * storing every data file it receives as DIRECTORY/job-NNNN.pjl.
+ */
+int main(int argc, char *argv[])
+{
+	mock_printer_t mock_printer = {
+		.port = MOCK_PRINTER_PORT,
+		.output_directory = ".",
+	};
+
+	struct optparse options;
+	int option;
+
+	optparse_init(&options, argv);
+	while ((option = optparse_long(&options, long_options, NULL)) != -1) {
+		switch (option) {
+		case 'p':
+			mock_printer.port = options.optarg;
+			break;
+
+		case 'o':
+			mock_printer.output_directory = options.optarg;
+			break;
+
+		case 'b':
+			mock_printer.bandwidth = strtoull(options.optarg, NULL, 10);
+			break;
+
+		case 'l':
+			mock_printer.latency = atoi(options.optarg);
+			break;
+
+		case 'q':
+			mock_printer.queue_depth = atoi(options.optarg);
+			break;
+
+		case 'n':
+			mock_printer.job_limit = atoi(options.optarg);
+			break;
+
+		case 'h':
+			usage(EXIT_SUCCESS, "");
+			break;
+
+		case '@':
+			fprintf(stdout, "%s\n", VERSION);
+			exit(EXIT_SUCCESS);
+
+		case '?':
+			fprintf(stderr, "%s: %s\n", argv[0], options.errmsg);
+			exit(EXIT_FAILURE);
+
+		default:
+			usage(EXIT_FAILURE, "Unknown argument\n");
+		}
+	}
+
+	if (argc > options.optind)
+		usage(EXIT_FAILURE, "Unexpected argument\n");
+
+	// A client hanging up early must not take the server down with it
+	signal(SIGPIPE, SIG_IGN);
+
+	int server_fd = mock_printer_listen(&mock_printer);
+	if (server_fd < 0)
+		return EXIT_FAILURE;
+
+	printf("listening on port %s\n", mock_printer.port);
+	fflush(stdout);
+
+	while (mock_printer.job_limit == 0 || mock_printer.job_count < mock_printer.job_limit) {
+		int client_fd = accept(server_fd, NULL, NULL);
+		if (client_fd < 0) {
+			perror("accept failed");
+			continue;
+		}
+
+		mock_printer_serve(&mock_printer, client_fd);
+		close(client_fd);
+	}
+
+	close(server_fd);
+
+	return EXIT_SUCCESS;
+}
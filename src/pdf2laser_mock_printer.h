@@ -0,0 +1,26 @@
+#ifndef __PDF2LASER_MOCK_PRINTER_H__
+#define __PDF2LASER_MOCK_PRINTER_H__ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/** Default port to listen on, the standard printer port needs root. */
+#define MOCK_PRINTER_PORT "5515"
+
+/** Largest LPD command line accepted. */
+#define MOCK_PRINTER_LINE_NCHARS (1024)
+
+/** Number of bytes read from the client at a time. */
+#define MOCK_PRINTER_CHUNK (65536)
+
+int main(int argc, char *argv[]);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,1617 @@
+#include "pdf2laser_pdf.h"
+#include <math.h>                     // for ceil, fabs, floor, fmax, fmin, hypot, lround, sqrt
+#include <stdbool.h>                  // for bool, false, true
+#include <stddef.h>                   // for NULL, size_t
+#include <stdint.h>                   // for int32_t, uint8_t, uint32_t
+#include <stdio.h>                    // for fread, fseek, ftell, printf, FILE, SEEK_END, SEEK_SET
+#include <stdlib.h>                   // for abs, calloc, free, malloc, realloc, strtod
+#include <string.h>                   // for memcmp, memcpy, memmove, memset, strcmp, strlen
+#include <zlib.h>                     // for inflate, inflateEnd, inflateInit, uInt, z_stream, Z_BUF_ERROR, Z_NO_FLUSH, Z_OK, Z_STREAM_END
+#include "type_print_job.h"           // for print_job_t, print_job_clone_last_vector_list_config, print_job_find_vector_list_config_by_rgb, PRINT_JOB_MODE_COMBINED
+#include "type_raster.h"              // for raster_t
+#include "type_vector.h"              // for vector_create
+#include "type_vector_list.h"         // for vector_list_append
+#include "type_vector_list_config.h"  // for vector_list_config_t
+
+typedef enum {
+	PDF_NULL,
+	PDF_BOOLEAN,
+	PDF_NUMBER,
+	PDF_NAME,
+	PDF_STRING,
+	PDF_ARRAY,
+	PDF_DICTIONARY,
+	PDF_REFERENCE,
+	PDF_STREAM,
+	PDF_OPERATOR,  // a bare keyword: an operator in a content stream, or obj, R, stream and the like
+} pdf_kind;
+
+/**
+ * A parsed PDF object. Dictionaries and streams keep their keys and values
+ * alternating in items, streams point at their raw data in the file.
+ */
+typedef struct pdf_object pdf_object_t;
+struct pdf_object {
+	pdf_kind kind;
+	double number;          // numbers, booleans and the object number of references
+	int32_t generation;     // references
+	char *text;             // names, strings and operators
+	size_t length;
+	pdf_object_t *items;    // arrays, dictionaries and streams
+	size_t count;
+	const uint8_t *data;    // streams
+	size_t data_length;
+};
+
+typedef struct pdf_lexer pdf_lexer_t;
+struct pdf_lexer {
+	const uint8_t *data;
+	size_t length;
+	size_t position;
+};
+
+/** Where an object is found: at an offset of the file, or inside an object stream. */
+typedef struct pdf_xref pdf_xref_t;
+struct pdf_xref {
+	uint8_t type;    // 0 free, 1 in the file, 2 in an object stream
+	bool set;        // filled in by the newest section declaring it
+	size_t offset;   // file offset, or the number of the object stream
+	uint32_t index;  // index in the object stream
+};
+
+/** A segment of the path being built, in the vector file notation. */
+typedef struct pdf_segment pdf_segment_t;
+struct pdf_segment {
+	char operation;  // 'M'ove, 'L'ine or 'C'lose
+	int32_t x;
+	int32_t y;
+};
+
+/** A stroked vector waiting for the whole page to be read. */
+typedef struct pdf_vector pdf_vector_t;
+struct pdf_vector {
+	int32_t red;
+	int32_t green;
+	int32_t blue;
+	int32_t x[2];
+	int32_t y[2];
+};
+
+typedef struct pdf_state pdf_state_t;
+struct pdf_state {
+	double ctm[6];
+	int32_t components;   // of the stroke colour space: 1 grey, 3 rgb, 4 cmyk
+	int32_t stroke[3];    // rgb in 0 - 255
+	int32_t render_mode;  // text rendering mode
+};
+
+typedef struct pdf pdf_t;
+struct pdf {
+	print_job_t *print_job;
+	const char *failure;  // why the document cannot be read without Ghostscript
+
+	uint8_t *data;
+	size_t length;
+	size_t base;          // offset of the header, which file offsets are relative to
+
+	pdf_xref_t *xref;
+	size_t xref_length;
+	pdf_object_t **objects;  // cache of the objects loaded, by object number
+	bool *loading;
+	uint8_t **decoded;       // decoded object streams, by object number
+	size_t *decoded_length;
+	pdf_object_t trailer;
+
+	double box[4];           // page box in default user space
+	double scale;            // device units per point
+	pdf_object_t *resources;
+
+	pdf_state_t stack[PDF_DEPTH_MAX];
+	size_t depth;
+	pdf_object_t operands[PDF_OPERANDS_MAX];
+	size_t operands_length;
+
+	pdf_segment_t *path;
+	size_t path_length;
+	size_t path_capacity;
+	double current[2];       // current point in user space
+	double start[2];         // start of the subpath in user space
+
+	pdf_vector_t *vectors;
+	size_t vectors_length;
+	size_t vectors_capacity;
+};
+
+static int pdf_fail(pdf_t *self, const char *reason)
+{
+	if (self->failure == NULL)
+		self->failure = reason;
+	return -1;
+}
+
+static void pdf_object_clear(pdf_object_t *object)
+{
+	free(object->text);
+	for (size_t index = 0; index < object->count; index += 1)
+		pdf_object_clear(&(object->items[index]));
+	free(object->items);
+	*object = (pdf_object_t){ .kind = PDF_NULL };
+}
+
+static void pdf_object_push(pdf_object_t *object, pdf_object_t *item)
+{
+	object->items = realloc(object->items, (object->count + 1) * sizeof(pdf_object_t));
+	object->items[object->count] = *item;
+	object->count += 1;
+}
+
+static bool pdf_is_white(uint8_t c)
+{
+	return c == 0 || c == '\t' || c == '\n' || c == '\f' || c == '\r' || c == ' ';
+}
+
+static bool pdf_is_delimiter(uint8_t c)
+{
+	return c == '(' || c == ')' || c == '<' || c == '>' || c == '[' || c == ']' ||
+		c == '{' || c == '}' || c == '/' || c == '%';
+}
+
+static bool pdf_is_regular(uint8_t c)
+{
+	return !pdf_is_white(c) && !pdf_is_delimiter(c);
+}
+
+static int pdf_hex(uint8_t c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+static void pdf_skip_white(pdf_lexer_t *lexer)
+{
+	while (lexer->position < lexer->length) {
+		uint8_t c = lexer->data[lexer->position];
+		if (c == '%') {
+			while (lexer->position < lexer->length &&
+			       lexer->data[lexer->position] != '\n' && lexer->data[lexer->position] != '\r')
+				lexer->position += 1;
+		}
+		else if (pdf_is_white(c)) {
+			lexer->position += 1;
+		}
+		else {
+			break;
+		}
+	}
+}
+
+/**
+ * Whether the lexer is at the given keyword, which must not run on into
+ * further regular characters.
+ */
+static bool pdf_at_keyword(pdf_lexer_t *lexer, const char *keyword)
+{
+	size_t length = strlen(keyword);
+	if (lexer->position + length > lexer->length ||
+	    memcmp(lexer->data + lexer->position, keyword, length) != 0)
+		return false;
+	return lexer->position + length == lexer->length || !pdf_is_regular(lexer->data[lexer->position + length]);
+}
+
+static char *pdf_text_append(char *text, size_t *length, size_t *capacity, uint8_t c)
+{
+	if (*length + 1 >= *capacity) {
+		*capacity = *capacity ? 2 * *capacity : 32;
+		text = realloc(text, *capacity);
+	}
+	text[*length] = (char)c;
+	*length += 1;
+	text[*length] = '\0';
+	return text;
+}
+
+static void pdf_parse_name(pdf_lexer_t *lexer, pdf_object_t *object)
+{
+	size_t capacity = 0;
+	object->kind = PDF_NAME;
+	object->text = pdf_text_append(NULL, &object->length, &capacity, '\0');
+	object->length = 0;
+
+	while (lexer->position < lexer->length && pdf_is_regular(lexer->data[lexer->position])) {
+		uint8_t c = lexer->data[lexer->position];
+		lexer->position += 1;
+		if (c == '#' && lexer->position + 1 < lexer->length &&
+		    pdf_hex(lexer->data[lexer->position]) >= 0 && pdf_hex(lexer->data[lexer->position + 1]) >= 0) {
+			c = pdf_hex(lexer->data[lexer->position]) * 16 + pdf_hex(lexer->data[lexer->position + 1]);
+			lexer->position += 2;
+		}
+		object->text = pdf_text_append(object->text, &object->length, &capacity, c);
+	}
+}
+
+static bool pdf_parse_literal_string(pdf_lexer_t *lexer, pdf_object_t *object)
+{
+	size_t capacity = 0;
+	object->kind = PDF_STRING;
+	object->text = pdf_text_append(NULL, &object->length, &capacity, '\0');
+	object->length = 0;
+
+	int nesting = 1;
+	while (lexer->position < lexer->length) {
+		uint8_t c = lexer->data[lexer->position];
+		lexer->position += 1;
+
+		if (c == '(') {
+			nesting += 1;
+		}
+		else if (c == ')') {
+			nesting -= 1;
+			if (nesting == 0)
+				return true;
+		}
+		else if (c == '\\' && lexer->position < lexer->length) {
+			c = lexer->data[lexer->position];
+			lexer->position += 1;
+			switch (c) {
+			case 'n': c = '\n'; break;
+			case 'r': c = '\r'; break;
+			case 't': c = '\t'; break;
+			case 'b': c = '\b'; break;
+			case 'f': c = '\f'; break;
+			case '\r':
+				if (lexer->position < lexer->length && lexer->data[lexer->position] == '\n')
+					lexer->position += 1;
+				continue;
+			case '\n':
+				continue;
+			default:
+				if (c >= '0' && c <= '7') {
+					int value = c - '0';
+					for (int digit = 1; digit < 3 && lexer->position < lexer->length &&
+						     lexer->data[lexer->position] >= '0' && lexer->data[lexer->position] <= '7'; digit += 1) {
+						value = value * 8 + lexer->data[lexer->position] - '0';
+						lexer->position += 1;
+					}
+					c = (uint8_t)value;
+				}
+				break;
+			}
+		}
+
+		object->text = pdf_text_append(object->text, &object->length, &capacity, c);
+	}
+
+	return false;
+}
+
+static bool pdf_parse_hex_string(pdf_lexer_t *lexer, pdf_object_t *object)
+{
+	size_t capacity = 0;
+	object->kind = PDF_STRING;
+	object->text = pdf_text_append(NULL, &object->length, &capacity, '\0');
+	object->length = 0;
+
+	int high = -1;
+	while (lexer->position < lexer->length) {
+		uint8_t c = lexer->data[lexer->position];
+		lexer->position += 1;
+
+		if (c == '>') {
+			if (high >= 0)
+				object->text = pdf_text_append(object->text, &object->length, &capacity, (uint8_t)(high * 16));
+			return true;
+		}
+
+		int value = pdf_hex(c);
+		if (value < 0) {
+			if (pdf_is_white(c))
+				continue;
+			return false;
+		}
+
+		if (high < 0) {
+			high = value;
+		}
+		else {
+			object->text = pdf_text_append(object->text, &object->length, &capacity, (uint8_t)(high * 16 + value));
+			high = -1;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Parse a number, or a reference when the number is followed by a
+ * generation and R.
+ */
+static void pdf_parse_number(pdf_lexer_t *lexer, pdf_object_t *object)
+{
+	char buffer[64];
+	size_t length = 0;
+	while (lexer->position < lexer->length && length + 1 < sizeof(buffer) &&
+	       pdf_is_regular(lexer->data[lexer->position])) {
+		buffer[length] = (char)lexer->data[lexer->position];
+		length += 1;
+		lexer->position += 1;
+	}
+	buffer[length] = '\0';
+
+	object->kind = PDF_NUMBER;
+	object->number = strtod(buffer, NULL);
+
+	bool integer = true;
+	for (size_t index = 0; index < length; index += 1)
+		integer = integer && buffer[index] >= '0' && buffer[index] <= '9';
+	if (!integer || length == 0)
+		return;
+
+	// look ahead for "generation R"
+	size_t position = lexer->position;
+	pdf_skip_white(lexer);
+	size_t digits = 0;
+	int32_t generation = 0;
+	while (lexer->position < lexer->length && lexer->data[lexer->position] >= '0' && lexer->data[lexer->position] <= '9') {
+		generation = generation * 10 + (lexer->data[lexer->position] - '0');
+		lexer->position += 1;
+		digits += 1;
+	}
+	if (digits > 0 && digits < 10 && lexer->position < lexer->length && !pdf_is_regular(lexer->data[lexer->position])) {
+		pdf_skip_white(lexer);
+		if (pdf_at_keyword(lexer, "R")) {
+			lexer->position += 1;
+			object->kind = PDF_REFERENCE;
+			object->generation = generation;
+			return;
+		}
+	}
+
+	lexer->position = position;
+}
+
+/**
+ * Parse the next object. Keywords which are not objects come back as
+ * operators, which lets the same parser read content streams.
+ *
+ * @return false at the end of the data or on a syntax error.
+ */
+static bool pdf_parse_object(pdf_lexer_t *lexer, pdf_object_t *object, size_t depth)
+{
+	*object = (pdf_object_t){ .kind = PDF_NULL };
+
+	pdf_skip_white(lexer);
+	if (lexer->position >= lexer->length || depth > PDF_DEPTH_MAX)
+		return false;
+
+	uint8_t c = lexer->data[lexer->position];
+
+	if (c == '/') {
+		lexer->position += 1;
+		pdf_parse_name(lexer, object);
+		return true;
+	}
+
+	if (c == '(') {
+		lexer->position += 1;
+		return pdf_parse_literal_string(lexer, object);
+	}
+
+	if (c == '<' && lexer->position + 1 < lexer->length && lexer->data[lexer->position + 1] == '<') {
+		lexer->position += 2;
+		object->kind = PDF_DICTIONARY;
+		for (;;) {
+			pdf_skip_white(lexer);
+			if (lexer->position + 1 < lexer->length &&
+			    lexer->data[lexer->position] == '>' && lexer->data[lexer->position + 1] == '>') {
+				lexer->position += 2;
+				return true;
+			}
+
+			pdf_object_t key, value;
+			if (!pdf_parse_object(lexer, &key, depth + 1))
+				return false;
+			if (key.kind != PDF_NAME || !pdf_parse_object(lexer, &value, depth + 1)) {
+				pdf_object_clear(&key);
+				return false;
+			}
+			pdf_object_push(object, &key);
+			pdf_object_push(object, &value);
+		}
+	}
+
+	if (c == '<') {
+		lexer->position += 1;
+		return pdf_parse_hex_string(lexer, object);
+	}
+
+	if (c == '[') {
+		lexer->position += 1;
+		object->kind = PDF_ARRAY;
+		for (;;) {
+			pdf_skip_white(lexer);
+			if (lexer->position < lexer->length && lexer->data[lexer->position] == ']') {
+				lexer->position += 1;
+				return true;
+			}
+
+			pdf_object_t item;
+			if (!pdf_parse_object(lexer, &item, depth + 1))
+				return false;
+			pdf_object_push(object, &item);
+		}
+	}
+
+	if ((c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.') {
+		pdf_parse_number(lexer, object);
+		return true;
+	}
+
+	if (!pdf_is_regular(c)) {
+		// a stray delimiter such as ] or >
+		lexer->position += 1;
+		return false;
+	}
+
+	size_t start = lexer->position;
+	while (lexer->position < lexer->length && pdf_is_regular(lexer->data[lexer->position]))
+		lexer->position += 1;
+	size_t length = lexer->position - start;
+
+	if (length == 4 && memcmp(lexer->data + start, "true", 4) == 0) {
+		object->kind = PDF_BOOLEAN;
+		object->number = 1.0;
+	}
+	else if (length == 5 && memcmp(lexer->data + start, "false", 5) == 0) {
+		object->kind = PDF_BOOLEAN;
+		object->number = 0.0;
+	}
+	else if (length == 4 && memcmp(lexer->data + start, "null", 4) == 0) {
+		object->kind = PDF_NULL;
+	}
+	else {
+		object->kind = PDF_OPERATOR;
+		object->text = malloc(length + 1);
+		memcpy(object->text, lexer->data + start, length);
+		object->text[length] = '\0';
+		object->length = length;
+	}
+
+	return true;
+}
+
+static pdf_object_t *pdf_get(pdf_object_t *dictionary, const char *key)
+{
+	if (dictionary == NULL || (dictionary->kind != PDF_DICTIONARY && dictionary->kind != PDF_STREAM))
+		return NULL;
+
+	for (size_t index = 0; index + 1 < dictionary->count; index += 2) {
+		if (strcmp(dictionary->items[index].text, key) == 0)
+			return &(dictionary->items[index + 1]);
+	}
+
+	return NULL;
+}
+
+static bool pdf_is_name(pdf_object_t *object, const char *name)
+{
+	return object != NULL && object->kind == PDF_NAME && strcmp(object->text, name) == 0;
+}
+
+/**
+ * Whether an object is a whole number from 0 to a limit, as the object
+ * numbers, counts and offsets of cross-reference sections must be before
+ * they are taken as sizes.
+ */
+static bool pdf_is_whole(pdf_object_t *object, double limit)
+{
+	return object != NULL && object->kind == PDF_NUMBER && object->number >= 0.0 &&
+	       object->number <= limit && object->number == floor(object->number);
+}
+
+static pdf_object_t *pdf_load(pdf_t *self, size_t number);
+
+/**
+ * Follow a reference to the object it names.
+ *
+ * @return The object, or NULL for a reference to a missing object.
+ */
+static pdf_object_t *pdf_resolve(pdf_t *self, pdf_object_t *object)
+{
+	if (object != NULL && object->kind == PDF_REFERENCE)
+		return pdf_load(self, (size_t)object->number);
+	return object;
+}
+
+static pdf_object_t *pdf_lookup(pdf_t *self, pdf_object_t *dictionary, const char *key)
+{
+	return pdf_resolve(self, pdf_get(dictionary, key));
+}
+
+static bool pdf_number(pdf_t *self, pdf_object_t *dictionary, const char *key, double *value)
+{
+	pdf_object_t *object = pdf_lookup(self, dictionary, key);
+	if (object == NULL || object->kind != PDF_NUMBER)
+		return false;
+	*value = object->number;
+	return true;
+}
+
+/**
+ * Undo the PNG predictors of a decoded stream in place.
+ *
+ * @return The length of the unpredicted data.
+ */
+static size_t pdf_unpredict(uint8_t *data, size_t length, size_t columns, size_t colors, size_t bits)
+{
+	size_t bpp = (colors * bits + 7) / 8;
+	size_t stride = (columns * colors * bits + 7) / 8;
+	if (bpp == 0 || stride == 0)
+		return 0;
+
+	uint8_t *previous = calloc(stride, sizeof(uint8_t));
+	size_t output = 0;
+
+	for (size_t row = 0; row + stride + 1 <= length; row += stride + 1) {
+		uint8_t filter = data[row];
+		uint8_t *line = data + row + 1;
+
+		for (size_t index = 0; index < stride; index += 1) {
+			uint8_t a = (index >= bpp) ? line[index - bpp] : 0;
+			uint8_t b = previous[index];
+			uint8_t c = (index >= bpp) ? previous[index - bpp] : 0;
+
+			switch (filter) {
+			case 1: line[index] += a; break;
+			case 2: line[index] += b; break;
+			case 3: line[index] += (a + b) / 2; break;
+			case 4: {
+				int p = a + b - c;
+				int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+				line[index] += (pa <= pb && pa <= pc) ? a : ((pb <= pc) ? b : c);
+				break;
+			}
+			}
+		}
+
+		memcpy(previous, line, stride);
+		memmove(data + output, line, stride);
+		output += stride;
+	}
+
+	free(previous);
+	return output;
+}
+
+/**
+ * Decode the data of a stream. Only Flate, optionally with PNG predictors,
+ * is supported, which covers what is written by nearly every producer of
+ * cut files.
+ *
+ * @return 0 on success, -1 if the stream cannot be decoded.
+ */
+static int pdf_decode(pdf_t *self, pdf_object_t *stream, uint8_t **output, size_t *output_length)
+{
+	pdf_object_t *filter = pdf_lookup(self, stream, "Filter");
+	pdf_object_t *parameters = pdf_lookup(self, stream, "DecodeParms");
+
+	if (filter != NULL && filter->kind == PDF_ARRAY) {
+		if (filter->count > 1)
+			return pdf_fail(self, "chained stream filters");
+		filter = (filter->count == 1) ? pdf_resolve(self, &(filter->items[0])) : NULL;
+		if (parameters != NULL && parameters->kind == PDF_ARRAY)
+			parameters = (parameters->count == 1) ? pdf_resolve(self, &(parameters->items[0])) : NULL;
+	}
+
+	if (filter == NULL || filter->kind == PDF_NULL) {
+		*output = malloc(stream->data_length + 1);
+		memcpy(*output, stream->data, stream->data_length);
+		*output_length = stream->data_length;
+		return 0;
+	}
+
+	if (!pdf_is_name(filter, "FlateDecode") && !pdf_is_name(filter, "Fl"))
+		return pdf_fail(self, "unsupported stream filter");
+
+	z_stream z = { .next_in = NULL };
+	if (inflateInit(&z) != Z_OK)
+		return pdf_fail(self, "zlib could not be initialised");
+
+	size_t capacity = stream->data_length * 4 + 1024;
+	size_t length = 0;
+	uint8_t *data = malloc(capacity);
+
+	z.next_in = (uint8_t *)stream->data;
+	z.avail_in = (uInt)stream->data_length;
+
+	int rc = Z_OK;
+	while (rc != Z_STREAM_END) {
+		if (length == capacity) {
+			capacity *= 2;
+			data = realloc(data, capacity);
+		}
+		z.next_out = data + length;
+		z.avail_out = (uInt)(capacity - length);
+
+		rc = inflate(&z, Z_NO_FLUSH);
+		length = capacity - z.avail_out;
+
+		if (rc == Z_BUF_ERROR && z.avail_in == 0)
+			break;  // truncated, keep what was inflated as readers do
+		if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+			inflateEnd(&z);
+			free(data);
+			return pdf_fail(self, "corrupt flate stream");
+		}
+	}
+	inflateEnd(&z);
+
+	double predictor = 1.0;
+	if (pdf_number(self, parameters, "Predictor", &predictor) && predictor >= 2.0) {
+		if (predictor < 10.0) {
+			free(data);
+			return pdf_fail(self, "TIFF predictors");
+		}
+
+		double columns = 1.0, colors = 1.0, bits = 8.0;
+		pdf_number(self, parameters, "Columns", &columns);
+		pdf_number(self, parameters, "Colors", &colors);
+		pdf_number(self, parameters, "BitsPerComponent", &bits);
+		length = pdf_unpredict(data, length, (size_t)columns, (size_t)colors, (size_t)bits);
+	}
+
+	*output = data;
+	*output_length = length;
+	return 0;
+}
+
+/**
+ * Parse the indirect object at an offset of the file, along with its stream
+ * data when it has some.
+ */
+static bool pdf_parse_indirect(pdf_t *self, size_t offset, pdf_object_t *object)
+{
+	pdf_lexer_t lexer = { .data = self->data, .length = self->length, .position = self->base + offset };
+	pdf_object_t header;
+
+	for (int index = 0; index < 3; index += 1) {
+		if (!pdf_parse_object(&lexer, &header, 0))
+			return false;
+		bool expected = (index < 2) ? header.kind == PDF_NUMBER : (header.kind == PDF_OPERATOR && strcmp(header.text, "obj") == 0);
+		pdf_object_clear(&header);
+		if (!expected)
+			return false;
+	}
+
+	if (!pdf_parse_object(&lexer, object, 0))
+		return false;
+
+	pdf_skip_white(&lexer);
+	if (object->kind != PDF_DICTIONARY || !pdf_at_keyword(&lexer, "stream"))
+		return true;
+
+	lexer.position += 6;
+	if (lexer.position < lexer.length && lexer.data[lexer.position] == '\r')
+		lexer.position += 1;
+	if (lexer.position < lexer.length && lexer.data[lexer.position] == '\n')
+		lexer.position += 1;
+
+	object->kind = PDF_STREAM;
+	object->data = lexer.data + lexer.position;
+
+	double length = -1.0;
+	pdf_number(self, object, "Length", &length);
+	if (length >= 0.0 && lexer.position + (size_t)length <= lexer.length) {
+		object->data_length = (size_t)length;
+		return true;
+	}
+
+	// a missing or wrong length, look for the end of the stream instead
+	for (size_t position = lexer.position; position + 9 <= lexer.length; position += 1) {
+		if (memcmp(lexer.data + position, "endstream", 9) == 0) {
+			object->data_length = position - lexer.position;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Find an object of an object stream, decoding the stream the first time it
+ * is used.
+ */
+static bool pdf_parse_compressed(pdf_t *self, size_t stream_number, uint32_t index, pdf_object_t *object)
+{
+	if (stream_number >= self->xref_length || self->xref[stream_number].type != 1)
+		return false;
+
+	pdf_object_t *stream = pdf_load(self, stream_number);
+	if (stream == NULL || stream->kind != PDF_STREAM)
+		return false;
+
+	if (self->decoded[stream_number] == NULL &&
+	    pdf_decode(self, stream, &(self->decoded[stream_number]), &(self->decoded_length[stream_number])) != 0)
+		return false;
+
+	double count = 0.0, first = 0.0;
+	if (!pdf_number(self, stream, "N", &count) || !pdf_number(self, stream, "First", &first) || index >= count)
+		return false;
+
+	pdf_lexer_t lexer = { .data = self->decoded[stream_number], .length = self->decoded_length[stream_number], .position = 0 };
+	double offset = -1.0;
+	for (uint32_t pair = 0; pair <= index; pair += 1) {
+		pdf_object_t number, position;
+		if (!pdf_parse_object(&lexer, &number, 0))
+			return false;
+		if (!pdf_parse_object(&lexer, &position, 0)) {
+			pdf_object_clear(&number);
+			return false;
+		}
+		offset = position.number;
+		pdf_object_clear(&number);
+		pdf_object_clear(&position);
+	}
+
+	lexer.position = (size_t)(first + offset);
+	return lexer.position < lexer.length && pdf_parse_object(&lexer, object, 0);
+}
+
+/**
+ * Load an object by number, parsing it the first time it is asked for.
+ *
+ * @return The object, or NULL if it is missing or cannot be parsed.
+ */
+static pdf_object_t *pdf_load(pdf_t *self, size_t number)
+{
+	// objects cannot be loaded while the cross-reference sections are read
+	if (self->objects == NULL || number >= self->xref_length || self->loading[number])
+		return NULL;
+	if (self->objects[number] != NULL)
+		return self->objects[number];
+
+	pdf_xref_t *xref = &(self->xref[number]);
+	if (xref->type == 0)
+		return NULL;
+
+	self->loading[number] = true;
+	pdf_object_t *object = calloc(1, sizeof(pdf_object_t));
+	bool parsed = (xref->type == 1) ?
+		pdf_parse_indirect(self, xref->offset, object) :
+		pdf_parse_compressed(self, xref->offset, xref->index, object);
+	self->loading[number] = false;
+
+	if (!parsed) {
+		pdf_object_clear(object);
+		free(object);
+		return NULL;
+	}
+
+	self->objects[number] = object;
+	return object;
+}
+
+static void pdf_xref_reserve(pdf_t *self, size_t length)
+{
+	if (length <= self->xref_length)
+		return;
+
+	self->xref = realloc(self->xref, length * sizeof(pdf_xref_t));
+	memset(self->xref + self->xref_length, 0, (length - self->xref_length) * sizeof(pdf_xref_t));
+	self->xref_length = length;
+}
+
+static void pdf_xref_set(pdf_t *self, size_t number, uint8_t type, size_t offset, uint32_t index)
+{
+	pdf_xref_reserve(self, number + 1);
+
+	// sections are read from the newest, which take precedence
+	if (self->xref[number].set)
+		return;
+
+	self->xref[number] = (pdf_xref_t){ .type = type, .set = true, .offset = offset, .index = index };
+}
+
+static int pdf_read_xref(pdf_t *self, size_t offset, size_t depth);
+
+/**
+ * Read a cross-reference stream, whose dictionary doubles as the trailer.
+ */
+static int pdf_read_xref_stream(pdf_t *self, size_t offset, pdf_object_t *trailer)
+{
+	if (!pdf_parse_indirect(self, offset, trailer) || trailer->kind != PDF_STREAM ||
+	    !pdf_is_name(pdf_get(trailer, "Type"), "XRef"))
+		return pdf_fail(self, "unreadable cross-reference section");
+
+	pdf_object_t *widths = pdf_get(trailer, "W");
+	pdf_object_t *size = pdf_lookup(self, trailer, "Size");
+	if (widths == NULL || widths->kind != PDF_ARRAY || widths->count != 3 || !pdf_is_whole(size, PDF_OBJECTS_MAX))
+		return pdf_fail(self, "unreadable cross-reference stream");
+
+	size_t w[3];
+	for (int index = 0; index < 3; index += 1) {
+		if (!pdf_is_whole(&widths->items[index], 8))
+			return pdf_fail(self, "unreadable cross-reference stream");
+		w[index] = (size_t)widths->items[index].number;
+	}
+
+	uint8_t *data;
+	size_t length;
+	if (pdf_decode(self, trailer, &data, &length) != 0)
+		return -1;
+
+	pdf_object_t *sections = pdf_get(trailer, "Index");
+	size_t sections_count = (sections != NULL && sections->kind == PDF_ARRAY) ? sections->count / 2 : 1;
+	size_t entry_length = w[0] + w[1] + w[2];
+	size_t position = 0;
+
+	for (size_t section = 0; section < sections_count; section += 1) {
+		size_t start = 0;
+		size_t count = (size_t)size->number;
+		if (sections != NULL && sections->kind == PDF_ARRAY) {
+			if (!pdf_is_whole(&sections->items[2 * section], PDF_OBJECTS_MAX) ||
+			    !pdf_is_whole(&sections->items[2 * section + 1], PDF_OBJECTS_MAX)) {
+				free(data);
+				return pdf_fail(self, "unreadable cross-reference stream");
+			}
+			start = (size_t)sections->items[2 * section].number;
+			count = (size_t)sections->items[2 * section + 1].number;
+		}
+		if (count > PDF_OBJECTS_MAX - start) {
+			free(data);
+			return pdf_fail(self, "too many objects");
+		}
+
+		for (size_t entry = 0; entry < count && position + entry_length <= length; entry += 1) {
+			size_t fields[3] = {1, 0, 0};
+			for (int field = 0; field < 3; field += 1) {
+				if (w[field] == 0)
+					continue;
+				fields[field] = 0;
+				for (size_t byte = 0; byte < w[field]; byte += 1)
+					fields[field] = (fields[field] << 8) | data[position++];
+			}
+			if (fields[0] <= 2)
+				pdf_xref_set(self, start + entry, (uint8_t)fields[0], fields[1], (uint32_t)fields[2]);
+		}
+	}
+
+	free(data);
+	return 0;
+}
+
+/**
+ * Read a classic cross-reference table and its trailer.
+ */
+static int pdf_read_xref_table(pdf_t *self, pdf_lexer_t *lexer, pdf_object_t *trailer)
+{
+	lexer->position += 4;
+
+	for (;;) {
+		pdf_skip_white(lexer);
+		if (pdf_at_keyword(lexer, "trailer")) {
+			lexer->position += 7;
+			if (!pdf_parse_object(lexer, trailer, 0) || trailer->kind != PDF_DICTIONARY)
+				return pdf_fail(self, "unreadable trailer");
+			return 0;
+		}
+
+		pdf_object_t start = { .kind = PDF_NULL };
+		pdf_object_t count = { .kind = PDF_NULL };
+		if (!pdf_parse_object(lexer, &start, 0) || !pdf_is_whole(&start, PDF_OBJECTS_MAX) ||
+		    !pdf_parse_object(lexer, &count, 0) || !pdf_is_whole(&count, PDF_OBJECTS_MAX - start.number)) {
+			pdf_object_clear(&start);
+			pdf_object_clear(&count);
+			return pdf_fail(self, "unreadable cross-reference table");
+		}
+
+		for (size_t entry = 0; entry < (size_t)count.number; entry += 1) {
+			pdf_object_t offset = { .kind = PDF_NULL };
+			pdf_object_t generation = { .kind = PDF_NULL };
+			pdf_object_t type = { .kind = PDF_NULL };
+			bool parsed = pdf_parse_object(lexer, &offset, 0) && pdf_parse_object(lexer, &generation, 0) &&
+			              pdf_parse_object(lexer, &type, 0);
+			if (!parsed || !pdf_is_whole(&offset, (double)self->length) || type.kind != PDF_OPERATOR) {
+				pdf_object_clear(&offset);
+				pdf_object_clear(&generation);
+				pdf_object_clear(&type);
+				return pdf_fail(self, "unreadable cross-reference table");
+			}
+			bool used = strcmp(type.text, "n") == 0;
+			pdf_xref_set(self, (size_t)start.number + entry, used ? 1 : 0, (size_t)offset.number, 0);
+			pdf_object_clear(&offset);
+			pdf_object_clear(&generation);
+			pdf_object_clear(&type);
+		}
+	}
+}
+
+/**
+ * Read the cross-reference section at an offset and every older section it
+ * points to. The newest trailer is kept.
+ */
+static int pdf_read_xref(pdf_t *self, size_t offset, size_t depth)
+{
+	if (depth > PDF_DEPTH_MAX || self->base + offset >= self->length)
+		return pdf_fail(self, "unreadable cross-reference section");
+
+	pdf_lexer_t lexer = { .data = self->data, .length = self->length, .position = self->base + offset };
+	pdf_skip_white(&lexer);
+
+	pdf_object_t trailer = { .kind = PDF_NULL };
+	int rc = pdf_at_keyword(&lexer, "xref") ?
+		pdf_read_xref_table(self, &lexer, &trailer) :
+		pdf_read_xref_stream(self, offset, &trailer);
+
+	double previous = -1.0, stream = -1.0;
+	if (rc == 0) {
+		pdf_number(self, &trailer, "Prev", &previous);
+		pdf_number(self, &trailer, "XRefStm", &stream);
+	}
+
+	if (self->trailer.kind == PDF_NULL) {
+		self->trailer = trailer;
+	}
+	else {
+		pdf_object_clear(&trailer);
+	}
+
+	if (rc == 0 && stream >= 0.0)
+		rc = pdf_read_xref(self, (size_t)stream, depth + 1);
+	if (rc == 0 && previous >= 0.0)
+		rc = pdf_read_xref(self, (size_t)previous, depth + 1);
+
+	return rc;
+}
+
+static void pdf_transform(double m[6], double x, double y, double *tx, double *ty)
+{
+	*tx = m[0] * x + m[2] * y + m[4];
+	*ty = m[1] * x + m[3] * y + m[5];
+}
+
+/**
+ * Device position of a point in user space, rounded as the Ghostscript path
+ * does: the top left corner of the page box is the origin and y runs down.
+ */
+static void pdf_device(pdf_t *self, double x, double y, double *device_x, double *device_y)
+{
+	pdf_state_t *state = &(self->stack[self->depth]);
+	double page_x, page_y;
+	pdf_transform(state->ctm, x, y, &page_x, &page_y);
+	*device_x = (page_x - self->box[0]) * self->scale;
+	*device_y = (self->box[3] - page_y) * self->scale;
+}
+
+static void pdf_path_append(pdf_t *self, char operation, double device_x, double device_y)
+{
+	if (self->path_length == self->path_capacity) {
+		self->path_capacity = self->path_capacity ? 2 * self->path_capacity : 256;
+		self->path = realloc(self->path, self->path_capacity * sizeof(pdf_segment_t));
+	}
+
+	self->path[self->path_length] = (pdf_segment_t){ .operation = operation, .x = lround(device_x), .y = lround(device_y) };
+	self->path_length += 1;
+}
+
+static void pdf_move_to(pdf_t *self, double x, double y)
+{
+	double device_x, device_y;
+	pdf_device(self, x, y, &device_x, &device_y);
+	pdf_path_append(self, 'M', device_x, device_y);
+
+	self->current[0] = self->start[0] = x;
+	self->current[1] = self->start[1] = y;
+}
+
+static void pdf_line_to(pdf_t *self, double x, double y)
+{
+	double device_x, device_y;
+	pdf_device(self, x, y, &device_x, &device_y);
+	pdf_path_append(self, 'L', device_x, device_y);
+
+	self->current[0] = x;
+	self->current[1] = y;
+}
+
+/**
+ * Flatten a cubic Bézier curve from the current point, with enough segments
+ * to keep within PDF_FLATNESS device units of the curve.
+ */
+static void pdf_curve_to(pdf_t *self, double x1, double y1, double x2, double y2, double x3, double y3)
+{
+	double px[4], py[4];
+	pdf_device(self, self->current[0], self->current[1], &px[0], &py[0]);
+	pdf_device(self, x1, y1, &px[1], &py[1]);
+	pdf_device(self, x2, y2, &px[2], &py[2]);
+	pdf_device(self, x3, y3, &px[3], &py[3]);
+
+	double bend = fmax(hypot(px[0] - 2 * px[1] + px[2], py[0] - 2 * py[1] + py[2]),
+	                   hypot(px[1] - 2 * px[2] + px[3], py[1] - 2 * py[2] + py[3]));
+	int segments = (int)ceil(sqrt(0.75 * bend / PDF_FLATNESS));
+	if (segments < 1)
+		segments = 1;
+	if (segments > PDF_SEGMENTS_MAX)
+		segments = PDF_SEGMENTS_MAX;
+
+	for (int index = 1; index <= segments; index += 1) {
+		double t = (double)index / segments;
+		double u = 1.0 - t;
+		double a = u * u * u, b = 3 * u * u * t, c = 3 * u * t * t, d = t * t * t;
+		pdf_path_append(self, 'L',
+		                a * px[0] + b * px[1] + c * px[2] + d * px[3],
+		                a * py[0] + b * py[1] + c * py[2] + d * py[3]);
+	}
+
+	self->current[0] = x3;
+	self->current[1] = y3;
+}
+
+static void pdf_close_path(pdf_t *self)
+{
+	if (self->path_length == 0)
+		return;
+
+	pdf_path_append(self, 'C', 0.0, 0.0);
+	self->current[0] = self->start[0];
+	self->current[1] = self->start[1];
+}
+
+static void pdf_vector_append(pdf_t *self, int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+	if (self->vectors_length == self->vectors_capacity) {
+		self->vectors_capacity = self->vectors_capacity ? 2 * self->vectors_capacity : 1024;
+		self->vectors = realloc(self->vectors, self->vectors_capacity * sizeof(pdf_vector_t));
+	}
+
+	pdf_state_t *state = &(self->stack[self->depth]);
+	self->vectors[self->vectors_length] = (pdf_vector_t){
+		.red = state->stroke[0], .green = state->stroke[1], .blue = state->stroke[2],
+		.x = {x0, x1}, .y = {y0, y1},
+	};
+	self->vectors_length += 1;
+}
+
+/**
+ * Stroke the current path. Strokes Ghostscript would leave to the raster
+ * pass, in a colour with no vector settings, cannot be read here.
+ */
+static int pdf_stroke(pdf_t *self)
+{
+	print_job_t *print_job = self->print_job;
+	pdf_state_t *state = &(self->stack[self->depth]);
+
+	if (print_job->mode == PRINT_JOB_MODE_COMBINED && !print_job->vector_fallthrough && self->path_length > 0 &&
+	    print_job_find_vector_list_config_by_rgb(print_job, state->stroke[0], state->stroke[1], state->stroke[2]) == NULL)
+		return pdf_fail(self, "strokes left to the raster pass");
+
+	int32_t start_x = 0, start_y = 0, current_x = 0, current_y = 0;
+	for (size_t index = 0; index < self->path_length; index += 1) {
+		pdf_segment_t *segment = &(self->path[index]);
+		switch (segment->operation) {
+		case 'M':
+			start_x = current_x = segment->x;
+			start_y = current_y = segment->y;
+			break;
+		case 'L':
+			pdf_vector_append(self, current_x, current_y, segment->x, segment->y);
+			current_x = segment->x;
+			current_y = segment->y;
+			break;
+		case 'C':
+			pdf_vector_append(self, current_x, current_y, start_x, start_y);
+			current_x = start_x;
+			current_y = start_y;
+			break;
+		}
+	}
+
+	self->path_length = 0;
+	return 0;
+}
+
+/**
+ * Take the last count operands, which must all be numbers.
+ */
+static bool pdf_operands(pdf_t *self, size_t count, double *values)
+{
+	if (self->operands_length < count)
+		return false;
+
+	for (size_t index = 0; index < count; index += 1) {
+		pdf_object_t *operand = &(self->operands[self->operands_length - count + index]);
+		if (operand->kind != PDF_NUMBER)
+			return false;
+		values[index] = operand->number;
+	}
+
+	return true;
+}
+
+static int32_t pdf_color_byte(double value)
+{
+	return lround(fmin(1.0, fmax(0.0, value)) * 255.0);
+}
+
+/**
+ * Set the stroke colour from components in the stroke colour space, converted
+ * to rgb as PostScript does.
+ */
+static void pdf_set_stroke(pdf_state_t *state, const double *values)
+{
+	switch (state->components) {
+	case 1:
+		state->stroke[0] = state->stroke[1] = state->stroke[2] = pdf_color_byte(values[0]);
+		break;
+	case 3:
+		for (int index = 0; index < 3; index += 1)
+			state->stroke[index] = pdf_color_byte(values[index]);
+		break;
+	default:
+		for (int index = 0; index < 3; index += 1)
+			state->stroke[index] = pdf_color_byte(1.0 - fmin(1.0, values[index] + values[3]));
+		break;
+	}
+}
+
+/**
+ * Whether painting something other than a stroke can be left out: it can in a
+ * vector job, which has no raster pass for it to appear in.
+ */
+static int pdf_raster_only(pdf_t *self, const char *reason)
+{
+	if (self->print_job->mode == PRINT_JOB_MODE_COMBINED)
+		return pdf_fail(self, reason);
+	return 0;
+}
+
+/**
+ * Run one content stream operator on the operands collected for it.
+ *
+ * @return 0 on success, -1 if the page cannot be read here.
+ */
+static int pdf_operator(pdf_t *self, const char *name)
+{
+	pdf_state_t *state = &(self->stack[self->depth]);
+	double v[6];
+
+	if (strcmp(name, "q") == 0) {
+		if (self->depth + 1 >= PDF_DEPTH_MAX)
+			return pdf_fail(self, "graphics states nested too deeply");
+		self->stack[self->depth + 1] = *state;
+		self->depth += 1;
+	}
+	else if (strcmp(name, "Q") == 0) {
+		if (self->depth > 0)
+			self->depth -= 1;
+	}
+	else if (strcmp(name, "cm") == 0) {
+		if (!pdf_operands(self, 6, v))
+			return pdf_fail(self, "bad operands");
+		double m[6];
+		memcpy(m, state->ctm, sizeof(m));
+		state->ctm[0] = v[0] * m[0] + v[1] * m[2];
+		state->ctm[1] = v[0] * m[1] + v[1] * m[3];
+		state->ctm[2] = v[2] * m[0] + v[3] * m[2];
+		state->ctm[3] = v[2] * m[1] + v[3] * m[3];
+		state->ctm[4] = v[4] * m[0] + v[5] * m[2] + m[4];
+		state->ctm[5] = v[4] * m[1] + v[5] * m[3] + m[5];
+	}
+	else if (strcmp(name, "m") == 0) {
+		if (!pdf_operands(self, 2, v))
+			return pdf_fail(self, "bad operands");
+		pdf_move_to(self, v[0], v[1]);
+	}
+	else if (strcmp(name, "l") == 0) {
+		if (!pdf_operands(self, 2, v))
+			return pdf_fail(self, "bad operands");
+		pdf_line_to(self, v[0], v[1]);
+	}
+	else if (strcmp(name, "c") == 0) {
+		if (!pdf_operands(self, 6, v))
+			return pdf_fail(self, "bad operands");
+		pdf_curve_to(self, v[0], v[1], v[2], v[3], v[4], v[5]);
+	}
+	else if (strcmp(name, "v") == 0) {
+		if (!pdf_operands(self, 4, v))
+			return pdf_fail(self, "bad operands");
+		pdf_curve_to(self, self->current[0], self->current[1], v[0], v[1], v[2], v[3]);
+	}
+	else if (strcmp(name, "y") == 0) {
+		if (!pdf_operands(self, 4, v))
+			return pdf_fail(self, "bad operands");
+		pdf_curve_to(self, v[0], v[1], v[2], v[3], v[2], v[3]);
+	}
+	else if (strcmp(name, "re") == 0) {
+		if (!pdf_operands(self, 4, v))
+			return pdf_fail(self, "bad operands");
+		pdf_move_to(self, v[0], v[1]);
+		pdf_line_to(self, v[0] + v[2], v[1]);
+		pdf_line_to(self, v[0] + v[2], v[1] + v[3]);
+		pdf_line_to(self, v[0], v[1] + v[3]);
+		pdf_close_path(self);
+	}
+	else if (strcmp(name, "h") == 0) {
+		pdf_close_path(self);
+	}
+	else if (strcmp(name, "S") == 0) {
+		return pdf_stroke(self);
+	}
+	else if (strcmp(name, "s") == 0) {
+		pdf_close_path(self);
+		return pdf_stroke(self);
+	}
+	else if (strcmp(name, "f") == 0 || strcmp(name, "F") == 0 || strcmp(name, "f*") == 0 || strcmp(name, "n") == 0) {
+		if (name[0] != 'n' && self->path_length > 0 && pdf_raster_only(self, "filled paths") != 0)
+			return -1;
+		self->path_length = 0;
+	}
+	else if (strcmp(name, "B") == 0 || strcmp(name, "B*") == 0 || strcmp(name, "b") == 0 || strcmp(name, "b*") == 0) {
+		if (pdf_raster_only(self, "filled paths") != 0)
+			return -1;
+		if (name[0] == 'b')
+			pdf_close_path(self);
+		return pdf_stroke(self);
+	}
+	else if (strcmp(name, "RG") == 0) {
+		if (!pdf_operands(self, 3, v))
+			return pdf_fail(self, "bad operands");
+		state->components = 3;
+		pdf_set_stroke(state, v);
+	}
+	else if (strcmp(name, "G") == 0) {
+		if (!pdf_operands(self, 1, v))
+			return pdf_fail(self, "bad operands");
+		state->components = 1;
+		pdf_set_stroke(state, v);
+	}
+	else if (strcmp(name, "K") == 0) {
+		if (!pdf_operands(self, 4, v))
+			return pdf_fail(self, "bad operands");
+		state->components = 4;
+		pdf_set_stroke(state, v);
+	}
+	else if (strcmp(name, "CS") == 0) {
+		pdf_object_t *space = (self->operands_length > 0) ? &(self->operands[self->operands_length - 1]) : NULL;
+		if (pdf_is_name(space, "DeviceGray"))
+			state->components = 1;
+		else if (pdf_is_name(space, "DeviceRGB"))
+			state->components = 3;
+		else if (pdf_is_name(space, "DeviceCMYK"))
+			state->components = 4;
+		else
+			return pdf_fail(self, "stroke colour spaces other than device ones");
+		double black[4] = {0.0, 0.0, 0.0, 1.0};
+		if (state->components != 4)
+			black[3] = 0.0;
+		pdf_set_stroke(state, black);
+	}
+	else if (strcmp(name, "SC") == 0 || strcmp(name, "SCN") == 0) {
+		if (!pdf_operands(self, state->components, v))
+			return pdf_fail(self, "stroke colours other than device ones");
+		pdf_set_stroke(state, v);
+	}
+	else if (strcmp(name, "Tr") == 0) {
+		if (pdf_operands(self, 1, v))
+			state->render_mode = (int32_t)v[0];
+	}
+	else if (strcmp(name, "Tj") == 0 || strcmp(name, "TJ") == 0 || strcmp(name, "'") == 0 || strcmp(name, "\"") == 0) {
+		// text drawn with its outline stroked is cut by Ghostscript
+		bool stroked = state->render_mode == 1 || state->render_mode == 2 || state->render_mode == 5 || state->render_mode == 6;
+		if (stroked)
+			return pdf_fail(self, "stroked text");
+		return pdf_raster_only(self, "text");
+	}
+	else if (strcmp(name, "Do") == 0) {
+		pdf_object_t *xobject = NULL;
+		if (self->operands_length > 0 && self->operands[self->operands_length - 1].kind == PDF_NAME)
+			xobject = pdf_lookup(self, pdf_lookup(self, self->resources, "XObject"), self->operands[self->operands_length - 1].text);
+		if (!pdf_is_name(pdf_lookup(self, xobject, "Subtype"), "Image"))
+			return pdf_fail(self, "form XObjects");
+		return pdf_raster_only(self, "images");
+	}
+	else if (strcmp(name, "sh") == 0) {
+		return pdf_raster_only(self, "shadings");
+	}
+	else if (strcmp(name, "BI") == 0 || strcmp(name, "ID") == 0 || strcmp(name, "EI") == 0) {
+		return pdf_fail(self, "inline images");
+	}
+	else {
+		// state which does not change where or in which colour strokes are cut
+		static const char *ignored[] = {
+			"w", "J", "j", "M", "d", "ri", "i", "gs", "W", "W*",
+			"cs", "sc", "scn", "rg", "g", "k",
+			"BT", "ET", "Tc", "Tw", "Tz", "TL", "Tf", "Ts", "Td", "TD", "Tm", "T*",
+			"BX", "EX", "MP", "DP", "BMC", "BDC", "EMC", "d0", "d1",
+			NULL,
+		};
+		for (size_t index = 0; ignored[index] != NULL; index += 1) {
+			if (strcmp(name, ignored[index]) == 0)
+				return 0;
+		}
+		return pdf_fail(self, "unknown content operators");
+	}
+
+	return 0;
+}
+
+static void pdf_operands_clear(pdf_t *self)
+{
+	for (size_t index = 0; index < self->operands_length; index += 1)
+		pdf_object_clear(&(self->operands[index]));
+	self->operands_length = 0;
+}
+
+/**
+ * Interpret the content of the page, collecting its strokes.
+ */
+static int pdf_interpret(pdf_t *self, const uint8_t *content, size_t length)
+{
+	pdf_lexer_t lexer = { .data = content, .length = length, .position = 0 };
+
+	for (;;) {
+		pdf_object_t object;
+		if (!pdf_parse_object(&lexer, &object, 0)) {
+			pdf_object_clear(&object);
+			pdf_skip_white(&lexer);
+			if (lexer.position >= lexer.length)
+				break;
+			pdf_operands_clear(self);
+			return pdf_fail(self, "syntax errors in the page content");
+		}
+
+		if (object.kind != PDF_OPERATOR) {
+			if (self->operands_length == PDF_OPERANDS_MAX) {
+				pdf_object_clear(&object);
+				pdf_operands_clear(self);
+				return pdf_fail(self, "too many operands");
+			}
+			self->operands[self->operands_length] = object;
+			self->operands_length += 1;
+			continue;
+		}
+
+		int rc = pdf_operator(self, object.text);
+		pdf_object_clear(&object);
+		pdf_operands_clear(self);
+		if (rc != 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Look up a page attribute, which may be inherited from the page tree.
+ */
+static pdf_object_t *pdf_inherited(pdf_t *self, pdf_object_t *page, const char *key)
+{
+	for (size_t depth = 0; page != NULL && depth < PDF_DEPTH_MAX; depth += 1) {
+		pdf_object_t *value = pdf_lookup(self, page, key);
+		if (value != NULL)
+			return value;
+		page = pdf_lookup(self, page, "Parent");
+	}
+
+	return NULL;
+}
+
+/**
+ * Find the first page of the document, the only one pdf2laser sends.
+ */
+static pdf_object_t *pdf_first_page(pdf_t *self)
+{
+	pdf_object_t *root = pdf_lookup(self, &(self->trailer), "Root");
+	pdf_object_t *node = pdf_lookup(self, root, "Pages");
+
+	for (size_t depth = 0; node != NULL && depth < PDF_DEPTH_MAX; depth += 1) {
+		pdf_object_t *kids = pdf_lookup(self, node, "Kids");
+		if (pdf_is_name(pdf_lookup(self, node, "Type"), "Page") || kids == NULL)
+			return node;
+		if (kids->kind != PDF_ARRAY || kids->count == 0)
+			return NULL;
+		node = pdf_resolve(self, &(kids->items[0]));
+	}
+
+	return NULL;
+}
+
+/**
+ * Read the first page and collect its stroked paths.
+ */
+static int pdf_read(pdf_t *self)
+{
+	size_t header_limit = (self->length < 1024) ? self->length : 1024;
+	for (self->base = 0; self->base + 5 <= header_limit; self->base += 1) {
+		if (memcmp(self->data + self->base, "%PDF-", 5) == 0)
+			break;
+	}
+	if (self->base + 5 > header_limit)
+		return pdf_fail(self, "no PDF header");
+
+	size_t tail = (self->length > 1024) ? self->length - 1024 : 0;
+	size_t startxref = self->length;
+	for (size_t position = tail; position + 9 <= self->length; position += 1) {
+		if (memcmp(self->data + position, "startxref", 9) == 0)
+			startxref = position;
+	}
+	if (startxref == self->length)
+		return pdf_fail(self, "no startxref");
+
+	pdf_lexer_t lexer = { .data = self->data, .length = self->length, .position = startxref + 9 };
+	pdf_object_t offset;
+	if (!pdf_parse_object(&lexer, &offset, 0) || offset.kind != PDF_NUMBER)
+		return pdf_fail(self, "no startxref");
+
+	if (pdf_read_xref(self, (size_t)offset.number, 0) != 0)
+		return -1;
+
+	if (pdf_get(&(self->trailer), "Encrypt") != NULL)
+		return pdf_fail(self, "encryption");
+
+	self->objects = calloc(self->xref_length, sizeof(pdf_object_t *));
+	self->loading = calloc(self->xref_length, sizeof(bool));
+	self->decoded = calloc(self->xref_length, sizeof(uint8_t *));
+	self->decoded_length = calloc(self->xref_length, sizeof(size_t));
+
+	pdf_object_t *page = pdf_first_page(self);
+	if (page == NULL)
+		return pdf_fail(self, "no pages");
+
+	pdf_object_t *box = pdf_inherited(self, page, "CropBox");
+	if (box == NULL)
+		box = pdf_inherited(self, page, "MediaBox");
+	if (box == NULL || box->kind != PDF_ARRAY || box->count != 4)
+		return pdf_fail(self, "no page box");
+	for (int index = 0; index < 4; index += 1) {
+		pdf_object_t *corner = pdf_resolve(self, &(box->items[index]));
+		if (corner == NULL || corner->kind != PDF_NUMBER)
+			return pdf_fail(self, "no page box");
+		self->box[index] = corner->number;
+	}
+	double corners[4] = {fmin(self->box[0], self->box[2]), fmin(self->box[1], self->box[3]),
+	                     fmax(self->box[0], self->box[2]), fmax(self->box[1], self->box[3])};
+	memcpy(self->box, corners, sizeof(corners));
+
+	double rotate = 0.0;
+	pdf_object_t *rotation = pdf_inherited(self, page, "Rotate");
+	if (rotation != NULL && rotation->kind == PDF_NUMBER)
+		rotate = rotation->number;
+	if (fabs(rotate - 360.0 * lround(rotate / 360.0)) > 0.5)
+		return pdf_fail(self, "rotated pages");
+
+	self->resources = pdf_inherited(self, page, "Resources");
+	self->scale = self->print_job->raster->resolution / 72.0;
+
+	pdf_state_t *state = &(self->stack[0]);
+	*state = (pdf_state_t){ .ctm = {1.0, 0.0, 0.0, 1.0, 0.0, 0.0}, .components = 1 };
+
+	pdf_object_t *contents = pdf_lookup(self, page, "Contents");
+	size_t count = 0;
+	if (contents != NULL && contents->kind == PDF_ARRAY)
+		count = contents->count;
+	else if (contents != NULL && contents->kind == PDF_STREAM)
+		count = 1;
+
+	// the streams of a page are read as one, the split may fall anywhere
+	uint8_t *content = NULL;
+	size_t content_length = 0;
+	for (size_t index = 0; index < count; index += 1) {
+		pdf_object_t *stream = (contents->kind == PDF_ARRAY) ? pdf_resolve(self, &(contents->items[index])) : contents;
+		if (stream == NULL || stream->kind != PDF_STREAM) {
+			free(content);
+			return pdf_fail(self, "unreadable page content");
+		}
+
+		uint8_t *data;
+		size_t length;
+		if (pdf_decode(self, stream, &data, &length) != 0) {
+			free(content);
+			return -1;
+		}
+
+		content = realloc(content, content_length + length + 1);
+		memcpy(content + content_length, data, length);
+		content_length += length;
+		content[content_length] = '\n';
+		content_length += 1;
+		free(data);
+	}
+
+	int rc = pdf_interpret(self, content, content_length);
+	free(content);
+
+	return rc;
+}
+
+/**
+ * Hand the strokes read over to the vector lists of the print job, once the
+ * whole page is known to be readable.
+ */
+static void pdf_commit(pdf_t *self)
+{
+	print_job_t *print_job = self->print_job;
+	vector_list_config_t *config = NULL;
+	int32_t red = -1, green = -1, blue = -1;
+
+	for (size_t index = 0; index < self->vectors_length; index += 1) {
+		pdf_vector_t *vector = &(self->vectors[index]);
+		if (vector->red != red || vector->green != green || vector->blue != blue) {
+			red = vector->red;
+			green = vector->green;
+			blue = vector->blue;
+			config = print_job_find_vector_list_config_by_rgb(print_job, red, green, blue);
+			if (config == NULL && print_job->vector_fallthrough)
+				config = print_job_clone_last_vector_list_config(print_job, red, green, blue);
+		}
+
+		if (config != NULL)
+			vector_list_append(config->vector_list, vector_create(vector->x[0], vector->y[0], vector->x[1], vector->y[1]));
+	}
+
+	print_job->width = lround(self->box[2] - self->box[0]);
+	print_job->height = lround(self->box[3] - self->box[1]);
+}
+
+/**
+ * Read the stroked paths of the first page of a PDF file straight into the
+ * vector lists of a print job, without going through Ghostscript.
+ *
+ * Only documents whose page is made of stroked paths in device colours can be
+ * read this way, along with fills, text and images in vector jobs where they
+ * would not be sent anyway. Nothing is added to the print job unless the
+ * whole page could be read, so that the caller can fall back to Ghostscript.
+ *
+ * @return 0 on success, -1 if the document needs Ghostscript.
+ */
+int pdf_parse(print_job_t *print_job, FILE *pdf_file)
+{
+	pdf_t *self = calloc(1, sizeof(pdf_t));
+	self->print_job = print_job;
+
+	int rc = -1;
+	if (fseek(pdf_file, 0, SEEK_END) == 0) {
+		long length = ftell(pdf_file);
+		if (length > 0 && fseek(pdf_file, 0, SEEK_SET) == 0) {
+			self->data = malloc(length);
+			self->length = fread(self->data, 1, length, pdf_file);
+			rc = pdf_read(self);
+		}
+	}
+	if (self->data == NULL)
+		pdf_fail(self, "unreadable file");
+
+	if (rc == 0)
+		pdf_commit(self);
+
+	if (print_job->debug) {
+		if (rc == 0)
+			printf("PDF vectors: %zu\n", self->vectors_length);
+		else
+			printf("PDF reader: %s, using Ghostscript\n", self->failure ? self->failure : "unreadable document");
+	}
+
+	for (size_t number = 0; self->objects != NULL && number < self->xref_length; number += 1) {
+		if (self->objects[number] != NULL) {
+			pdf_object_clear(self->objects[number]);
+			free(self->objects[number]);
+		}
+		free(self->decoded[number]);
+	}
+	pdf_object_clear(&(self->trailer));
+	free(self->objects);
+	free(self->loading);
+	free(self->decoded);
+	free(self->decoded_length);
+	free(self->xref);
+	free(self->path);
+	free(self->vectors);
+	free(self->data);
+	free(self);
+
+	return rc;
+}
@@ -0,0 +1,35 @@
+#ifndef __PDF2LASER_PDF_H__
+#define __PDF2LASER_PDF_H__ 1
+
+#include <stdio.h>           // for FILE
+#include "type_print_job.h"  // for print_job_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+// largest distance in device units between a curve and its flattened segments
+#define PDF_FLATNESS (0.5)
+
+// most segments a single curve is flattened into
+#define PDF_SEGMENTS_MAX (4096)
+
+// deepest nesting of objects, graphics states and page tree nodes followed
+#define PDF_DEPTH_MAX (64)
+
+// operands kept for a content stream operator, extra ones are an error
+#define PDF_OPERANDS_MAX (64)
+
+// most objects a document may declare in its cross-reference sections
+#define PDF_OBJECTS_MAX (8388608)
+
+int pdf_parse(print_job_t *print_job, FILE *pdf_file);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -1,28 +1,56 @@
 #include "pdf2laser_printer.h"
-#include <arpa/inet.h>       // for inet_ntoa
-#include <errno.h>           // for EBADF, EINTR, EIO, errno
-#include <fcntl.h>           // for open, O_RDONLY
-#include <inttypes.h>        // for PRIu32, PRIu8
-#include <netdb.h>           // for addrinfo, freeaddrinfo, getaddrinfo
-#include <netinet/in.h>      // for sockaddr_in, ntohs
-#include <stdbool.h>         // for bool, false, true
-#include <stdint.h>          // for int32_t, uint32_t, uint8_t
-#include <stdio.h>           // for perror, fprintf, snprintf, NULL, printf, stderr, size_t
-#include <string.h>          // for strchr, strlen
-#include <sys/socket.h>      // for connect, socket, PF_UNSPEC, SOCK_STREAM
-#include <sys/stat.h>        // for fstat, stat
-#include <unistd.h>          // for alarm, close, read, write, gethostname, sleep
-#include "config.h"          // for HOSTNAME_NCHARS
-#include "pdf2laser_util.h"  // for pdf2laser_sendfile
+#include <arpa/inet.h>         // for inet_ntoa
+#include <errno.h>             // for EAGAIN, EBADF, EINTR, EIO, EWOULDBLOCK, errno
+#include <netdb.h>             // for addrinfo, freeaddrinfo, getaddrinfo
+#include <netinet/in.h>        // for sockaddr_in, ntohs
+#include <stdbool.h>           // for bool, false, true
+#include <stdint.h>            // for int32_t, uint32_t
+#include <stdio.h>             // for perror, fprintf, snprintf, NULL, printf, stderr, size_t, fflush, stdout
+#include <stdlib.h>            // for calloc, free
+#include <string.h>            // for memchr, strchr, strncmp
+#include <sys/socket.h>        // for connect, setsockopt, socket, PF_UNSPEC, SOCK_STREAM, SOL_SOCKET, SO_RCVTIMEO, SO_SNDTIMEO
+#include <sys/time.h>          // for timeval
+#include <unistd.h>            // for close, read, write, sleep, ssize_t, isatty, STDOUT_FILENO
+#include "config.h"            // for HOSTNAME_NCHARS
+#include "pdf2laser_sender.h"  // for sender_create, sender_destroy, sender_run, sender_progress_t
+#include "pdf2laser_util.h"    // for pdf2laser_clock
 
 char *queue = "";
 
+/**
+ * Resolve the address of a printer.
+ *
+ * @param host The hostname or IP address of the printer, optionally followed
+ * by ":PORT" to reach an LPD server which is not on the standard printer port.
+ * @param addresses Set to the resolved addresses, to be released with
+ * freeaddrinfo.
+ * @return 0 on success, a getaddrinfo error code otherwise.
+ */
+int printer_resolve(const char *host, struct addrinfo **addresses)
+{
+	char hostname[HOSTNAME_NCHARS];
+	snprintf(hostname, HOSTNAME_NCHARS, "%s", host);
+
+	// A single colon separates the port, more than one is an IPv6 address
+	const char *service = "printer";
+	char *colon = strchr(hostname, ':');
+	if (colon != NULL && strchr(colon + 1, ':') == NULL) {
+		*colon = '\0';
+		service = colon + 1;
+	}
+
+	struct addrinfo base = { 0, PF_UNSPEC, SOCK_STREAM, 0, 0, NULL, NULL, NULL };
+
+	return getaddrinfo(hostname, service, &base, addresses);
+}
+
 /**
  * Connect to a printer.
  *
- * @param host The hostname or IP address of the printer to connect to.
+ * @param host The hostname or IP address of the printer to connect to,
+ * optionally followed by ":PORT".
  * @param timeout The number of seconds to wait before timing out on the
- * connect operation.
+ * connect operation, and on any read or write of the socket.
  * @return A socket descriptor to the printer.
  */
 static int32_t printer_connect(const char *host, const uint32_t timeout)
@@ -33,12 +61,8 @@ static int32_t printer_connect(const char *host, const uint32_t timeout)
 	for (; i < timeout; i++) {
 		struct addrinfo *res;
 		struct addrinfo *addr;
-		struct addrinfo base = { 0, PF_UNSPEC, SOCK_STREAM, 0, 0, NULL, NULL, NULL };
 
-		int32_t error_code = getaddrinfo(host, "printer", &base, &res);
-
-		/* Set an alarm to go off if the program has gone out to lunch. */
-		alarm(SECONDS_PER_MIN);
+		int32_t error_code = printer_resolve(host, &res);
 
 		/* if getaddrinfo did not return an error code then we attempt to
 		 * connect to the printer and establish a socket.
@@ -54,6 +78,14 @@ static int32_t printer_connect(const char *host, const uint32_t timeout)
 				socket_descriptor = socket(addr->ai_family, addr->ai_socktype,
 				                           addr->ai_protocol);
 				if (socket_descriptor >= 0) {
+					/* Bound the connect, and every read and write after
+					 * it, so that a printer which has gone out to lunch
+					 * gives an error rather than hanging the job.
+					 */
+					struct timeval wait = { .tv_sec = timeout, .tv_usec = 0 };
+					setsockopt(socket_descriptor, SOL_SOCKET, SO_SNDTIMEO, &wait, sizeof(wait));
+					setsockopt(socket_descriptor, SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait));
+
 					if (!connect(socket_descriptor, addr->ai_addr,
 					             addr->ai_addrlen)) {
 						break;
@@ -78,9 +110,6 @@ static int32_t printer_connect(const char *host, const uint32_t timeout)
 		return -1;
 	}
 
-	/* Disable the timeout alarm. */
-	alarm(0);
-
 	/* Return the newly opened socket descriptor */
 	return socket_descriptor;
 }
@@ -120,49 +149,169 @@ static bool printer_disconnect(int32_t socket_descriptor)
 	}
 }
 
+char *printer_transfer_to_string(printer_transfer_t *self)
+{
+	static char *template = "Sent %zu bytes in %.3fs (%.1f KiB/s): connect %.3fs, handshake %.3fs, first byte %.3fs, payload %.3fs";
+
+	double payload_seconds = self->total_seconds - self->first_byte_seconds;
+	double rate = (payload_seconds > 0.0) ? (self->bytes / payload_seconds / 1024.0) : 0.0;
+
+	size_t s_len = 1 + snprintf(NULL, 0, template, self->bytes, self->total_seconds, rate, self->connect_seconds, self->handshake_seconds, self->first_byte_seconds, payload_seconds);
+
+	char *s = calloc(s_len, sizeof(char));
+	snprintf(s, s_len, template, self->bytes, self->total_seconds, rate, self->connect_seconds, self->handshake_seconds, self->first_byte_seconds, payload_seconds);
+	return s;
+}
+
 /**
- *
+ * Print the progress of a transfer on a single, continuously updated line.
+ */
+static void printer_send_progress(sender_progress_t *progress, void *data)
+{
+	(void)data;
+
+	printf("\rSending %zu/%zu bytes (%5.1f%%) %.1f KiB/s", progress->bytes, progress->total, progress->percent, progress->rate / 1024.0);
+	if (progress->done)
+		printf("\n");
+	fflush(stdout);
+}
+
+/**
+ * Send a generated pjl file to the printer as an LPD print job and report
+ * how the transfer went.
  */
 int printer_send(print_job_t *print_job, char *target_pjl)
 {
-	char local_hostname[HOSTNAME_NCHARS];
-	char *first_dot;
+	sender_progress_callback progress = isatty(STDOUT_FILENO) ? printer_send_progress : NULL;
+
+	sender_t *sender = sender_create(print_job, target_pjl, progress, NULL);
+	if (sender == NULL)
+		return -1;
+
+	int rc = sender_run(sender);
+	if (!rc) {
+		char *transfer_string = printer_transfer_to_string(&sender->transfer);
+		printf("%s\n", transfer_string);
+		free(transfer_string);
+	}
 
-	gethostname(local_hostname, HOSTNAME_NCHARS);
-	if ((first_dot = strchr(local_hostname, '.'))) {
-		*first_dot = '\0';
+	sender_destroy(sender);
+
+	return rc;
+}
+
+/**
+ * Check if the line of an LPD short queue listing describes a job. Job lines
+ * start with their rank, which is either "active" or an ordinal such as
+ * "1st", "2nd" or "13th".
+ */
+static bool printer_status_is_job_line(const char *line, const char *end, bool *active)
+{
+	if (end - line >= 6 && !strncmp(line, "active", 6)) {
+		*active = true;
+		return true;
 	}
 
-	uint8_t lpdres;
-	int32_t p_sock = printer_connect(print_job->host, PRINTER_MAX_WAIT);
+	const char *position = line;
+	while (position < end && *position >= '0' && *position <= '9')
+		position += 1;
+
+	if (position == line || end - position < 2)
+		return false;
+
+	return (!strncmp(position, "st", 2) || !strncmp(position, "nd", 2) ||
+	        !strncmp(position, "rd", 2) || !strncmp(position, "th", 2));
+}
+
+/**
+ * Parse the response to an LPD "send queue state (short)" command.
+ *
+ * @param buffer the raw response from the printer.
+ * @param length the number of bytes in buffer.
+ * @param status the structure to fill in.
+ * @return 0 on success, -1 if the response is empty.
+ */
+int printer_status_parse(const char *buffer, size_t length, printer_status_t *status)
+{
+	status->queue_depth = 0;
+	status->active = false;
 
-	write(p_sock, "\002\r\n", 3);
-	read(p_sock, &lpdres, 1);
-	if (lpdres) {
-		fprintf(stderr, "Bad response from %s, %"PRIu8"\n", print_job->host, lpdres);
+	if (length == 0)
 		return -1;
+
+	const char *end = buffer + length;
+	const char *line = buffer;
+	while (line < end) {
+		const char *line_end = memchr(line, '\n', end - line);
+		if (line_end == NULL)
+			line_end = end;
+
+		// skip leading blanks
+		while (line < line_end && (*line == ' ' || *line == '\t'))
+			line += 1;
+
+		if (printer_status_is_job_line(line, line_end, &status->active))
+			status->queue_depth += 1;
+
+		line = line_end + 1;
 	}
 
-	int pjl_fno = open(target_pjl, O_RDONLY);
+	return 0;
+}
 
-	struct stat file_stat;
-	if (fstat(pjl_fno, &file_stat)) {
-		perror("Error reading pjl file\n");
+/**
+ * Ask a printer for its queue state without submitting anything.
+ *
+ * @param host The hostname or IP address of the printer to query.
+ * @param status Filled in with the parsed queue state.
+ * @param response If not NULL, set to a newly allocated copy of the raw
+ * response which the caller must free.
+ * @return 0 on success, -1 otherwise.
+ */
+int printer_query_status(const char *host, printer_status_t *status, char **response)
+{
+	int32_t p_sock = printer_connect(host, PRINTER_STATUS_WAIT);
+	if (p_sock < 0)
+		return -1;
+
+	size_t command_size = 1 + snprintf(NULL, 0, "\003%s\n", queue);
+	char command[command_size];
+	snprintf(command, command_size, "\003%s\n", queue);
+
+	if (write(p_sock, command, command_size - 1) != (ssize_t)(command_size - 1)) {
+		perror("Error querying printer");
+		printer_disconnect(p_sock);
 		return -1;
 	}
 
-	size_t job_header_size = snprintf(NULL, 0, "\003%"PRIu32" dfA%s%s\r\n", (uint32_t)file_stat.st_size, print_job->name, local_hostname);
-	char job_header[job_header_size];
-	snprintf(job_header, 10240, "\003%"PRIu32" dfA%s%s\r\n", (uint32_t)file_stat.st_size, print_job->name, local_hostname);
+	char *buffer = calloc(PRINTER_STATUS_NBYTES + 1, sizeof(char));
+	size_t length = 0;
+	ssize_t rc = 0;
+	double deadline = pdf2laser_clock() + PRINTER_STATUS_WAIT;
+	while (length < PRINTER_STATUS_NBYTES && pdf2laser_clock() < deadline &&
+	       (rc = read(p_sock, buffer + length, PRINTER_STATUS_NBYTES - length)) > 0)
+		length += rc;
+
+	printer_disconnect(p_sock);
 
-	write(p_sock, job_header, strlen(job_header));
-	read(p_sock, &lpdres, 1);
-	if (lpdres) {
-		fprintf(stderr, "Bad response from %s, %"PRIu8"\n", print_job->host, lpdres);
+	// a read which timed out, or a response still trickling in at the deadline
+	if (rc < 0 || (rc > 0 && length < PRINTER_STATUS_NBYTES)) {
+		if (rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+			perror("Error reading queue state");
+		else
+			fprintf(stderr, "Timed out waiting for queue state from %s\n", host);
+		free(buffer);
 		return -1;
 	}
 
-	pdf2laser_sendfile(p_sock, pjl_fno);
+	int parse_rc = printer_status_parse(buffer, length, status);
+	if (parse_rc)
+		fprintf(stderr, "Empty queue state from %s\n", host);
+
+	if (response != NULL)
+		*response = buffer;
+	else
+		free(buffer);
 
-	return (printer_disconnect(p_sock) ? 0 : -1);
+	return parse_rc;
 }
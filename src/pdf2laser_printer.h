@@ -2,6 +2,10 @@
 #define __PDF2LASER_PRINTER_H__ 1
 
 #include "type_print_job.h"
+#include <netdb.h>    // For addrinfo
+#include <stdbool.h>  // For bool
+#include <stddef.h>   // For size_t
+#include <stdint.h>   // For int32_t
 #include <stdio.h>    // For FILE
 
 #ifdef __cplusplus
@@ -17,7 +21,37 @@ extern "C" {
 /** Maximum wait before timing out on connecting to the printer (in seconds). */
 #define PRINTER_MAX_WAIT (300)
 
+/** Number of bytes handed to the socket per send call. */
+#define PRINTER_SEND_CHUNK (65536)
+
+/** Maximum wait before giving up on a queue state query (in seconds). */
+#define PRINTER_STATUS_WAIT (5)
+
+/** Largest queue state response that will be read from the printer. */
+#define PRINTER_STATUS_NBYTES (65536)
+
+typedef struct printer_status printer_status_t;
+struct printer_status {
+	int32_t queue_depth;  // number of jobs waiting or printing
+	bool active;          // a job is currently being printed
+};
+
+typedef struct printer_transfer printer_transfer_t;
+struct printer_transfer {
+	size_t bytes;               // pjl bytes handed to the socket
+	double start;               // monotonic clock at the start of the job
+	double connect_seconds;     // time to establish the connection
+	double handshake_seconds;   // time spent waiting on the LPD acknowledgements
+	double first_byte_seconds;  // time from start until the first pjl byte left
+	double total_seconds;       // time from start until the last pjl byte left
+};
+
+int printer_resolve(const char *host, struct addrinfo **addresses);
 int printer_send(print_job_t *print_job, char *target_pjl);
+char *printer_transfer_to_string(printer_transfer_t *self);
+
+int printer_status_parse(const char *buffer, size_t length, printer_status_t *status);
+int printer_query_status(const char *host, printer_status_t *status, char **response);
 
 #ifdef __cplusplus
 };
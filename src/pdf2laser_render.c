@@ -0,0 +1,303 @@
+#include "pdf2laser_render.h"
+#include <ghostscript/gserrors.h>  // for gs_error_Quit
+#include <ghostscript/iapi.h>      // for gsapi_delete_instance, gsapi_exit, gsapi_init_with_args, gsapi_new_instance, gsapi_set_arg_encoding, gsapi_set_stdio, GSDLLCALL, GS_ARG_ENCODING_UTF8
+#include <stddef.h>                // for NULL
+#include <stdint.h>                // for int32_t
+#include <stdio.h>                 // for fclose, fflush, fopen, fprintf, fwrite, perror, stderr, FILE
+#include <stdlib.h>                // for free
+#include <string.h>                // for strcmp, strndup, strrchr
+#include <strings.h>               // for strcasecmp
+#include <unistd.h>                // for unlink
+#include "config.h"                // for FILENAME_NCHARS
+#include "pdf2laser_dxf.h"         // for dxf_parse
+#include "pdf2laser_generator.h"   // for generate_eps, generate_pdf, generate_ps
+#include "pdf2laser_hpgl.h"        // for hpgl_parse
+#include "pdf2laser_image.h"       // for image_parse
+#include "pdf2laser_pdf.h"         // for pdf_parse
+#include "pdf2laser_svg.h"         // for svg_parse
+#include "pdf2laser_util.h"        // for pdf2laser_format_string
+#include "type_print_job.h"        // for print_job_t, PRINT_JOB_MODE_COMBINED, PRINT_JOB_MODE_RASTER, PRINT_JOB_MODE_VECTOR, print_job_mode
+#include "type_raster.h"           // for raster_t, raster_mode_to_device_string
+#include "type_timings.h"          // for timings_begin, timings_end
+
+static FILE *fh_vector;
+static int GSDLLCALL gsdll_stdout(__attribute__ ((unused)) void *minst, const char *str, int len)
+{
+	size_t rc = fwrite(str, 1, len, fh_vector);
+	fflush(fh_vector);
+	return rc;
+}
+
+/**
+ * Execute ghostscript feeding it an ecapsulated postscript file which is then
+ * converted into a bitmap image. As a byproduct output of the ghostscript
+ * process is redirected to a .vector file which will contain instructions on
+ * how to perform a vector cut of lines within the postscript.
+ *
+ * @param filename_bitmap the filename to use for the resulting bitmap file.
+ * @param filename_eps the filename to read in encapsulated postscript from.
+ * @param filename_vector the filename that will contain the vector
+ * information.
+ * @param bmp_mode a string which is one of bmp16m, bmpgray, or bmpmono.
+ * @param resolution the encapsulated postscript resolution.
+ *
+ * @return Return true if the execution of ghostscript succeeds, false
+ * otherwise.
+ */
+static int execute_ghostscript(print_job_t *print_job, const char *const target_eps, const char *const target_bmp, const char *const target_vector) //, const char *const raster_string)
+{
+	int gs_argc = 8;
+	char *gs_argv[8];
+
+	gs_argv[0] = "gs";
+	gs_argv[1] = "-q";
+	gs_argv[2] = "-dBATCH";
+	gs_argv[3] = "-dNOPAUSE";
+	gs_argv[4] = pdf2laser_format_string("-r%d", print_job->raster->resolution);
+	gs_argv[5] = pdf2laser_format_string("-sDEVICE=%s", raster_mode_to_device_string(print_job->raster->mode));
+	gs_argv[6] = pdf2laser_format_string("-sOutputFile=%s", target_bmp);
+	gs_argv[7] = strndup(target_eps, FILENAME_NCHARS);
+
+	fh_vector = fopen(target_vector, "w");
+
+	int32_t rc;
+
+	void *minst = NULL;
+	rc = gsapi_new_instance(&minst, NULL);
+
+	if (rc < 0)
+		goto terminate_execute_ghostscript;
+
+	rc = gsapi_set_arg_encoding(minst, GS_ARG_ENCODING_UTF8);
+	if (rc == 0) {
+		gsapi_set_stdio(minst, NULL, gsdll_stdout, NULL);
+		rc = gsapi_init_with_args(minst, gs_argc, gs_argv);
+	}
+
+	int32_t rc2 = gsapi_exit(minst);
+	if ((rc == 0) || (rc2 == gs_error_Quit))
+		rc = rc2;
+
+	gsapi_delete_instance(minst);
+
+ terminate_execute_ghostscript:
+	fclose(fh_vector);
+
+	free(gs_argv[4]);
+	free(gs_argv[5]);
+	free(gs_argv[6]);
+	free(gs_argv[7]);
+
+	return rc;
+}
+
+/**
+ * Render the source document with Ghostscript into a bitmap for the raster
+ * pass and a list of stroked paths for the vector pass.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+static int render_interpret(print_job_t *print_job, const char *const source_filename, const char *const target_base, const char *const target_bmp, const char *const target_vector)
+{
+	int rc;
+
+	char *target_pdf = pdf2laser_format_string("%s.pdf", target_base);
+	timings_begin(print_job->timings, "generate_pdf");
+	rc = generate_pdf(source_filename, target_pdf);
+	timings_end(print_job->timings);
+	if (rc) {
+		perror("Failed to clone pdf file");
+		return -1;
+	}
+
+	char *target_ps = pdf2laser_format_string("%s.ps", target_base);
+	timings_begin(print_job->timings, "generate_ps");
+	rc = generate_ps(target_pdf, target_ps);
+	timings_end(print_job->timings);
+	if (rc) {
+		perror("Failed to generate ps file");
+		return -1;
+	}
+
+	if (!print_job->debug) {
+		if (unlink(target_pdf)) {
+			perror("Error deleting pdf file");
+			return -1;
+		}
+	}
+	free(target_pdf);
+
+	char *target_eps = pdf2laser_format_string("%s.eps", target_base);
+	timings_begin(print_job->timings, "generate_eps");
+	rc = generate_eps(print_job, target_ps, target_eps);
+	timings_end(print_job->timings);
+	if (rc) {
+		perror("Failed to generate eps file");
+		return -1;
+	}
+
+	if (!print_job->debug) {
+		if (unlink(target_ps)) {
+			perror("Error deleting ps file");
+			return -1;
+		}
+	}
+	free(target_ps);
+
+	timings_begin(print_job->timings, "execute_ghostscript");
+	rc = execute_ghostscript(print_job, target_eps, target_bmp, target_vector);
+	timings_end(print_job->timings);
+	if (rc) {
+		perror("Failed to execute ghostscript");
+		return -1;
+	}
+
+	if (!print_job->debug) {
+		if (unlink(target_eps)) {
+			perror("Error deleting eps file");
+			return -1;
+		}
+	}
+	free(target_eps);
+
+	return 0;
+}
+
+/**
+ * Formats read straight into a print job instead of being interpreted by
+ * Ghostscript, chosen by the extension of the source. Vector formats are
+ * only cut and images are only engraved.
+ */
+static const struct {
+	const char *extension;
+	const char *name;
+	const char *stage;
+	print_job_mode mode;
+	int (*parse)(print_job_t *print_job, FILE *source_fh);
+} render_readers[] = {
+	{".svg", "SVG", "svg_parse", PRINT_JOB_MODE_VECTOR, svg_parse},
+	{".dxf", "DXF", "dxf_parse", PRINT_JOB_MODE_VECTOR, dxf_parse},
+	{".plt", "HPGL", "hpgl_parse", PRINT_JOB_MODE_VECTOR, hpgl_parse},
+	{".hpgl", "HPGL", "hpgl_parse", PRINT_JOB_MODE_VECTOR, hpgl_parse},
+	{".hpg", "HPGL", "hpgl_parse", PRINT_JOB_MODE_VECTOR, hpgl_parse},
+	{".hgl", "HPGL", "hpgl_parse", PRINT_JOB_MODE_VECTOR, hpgl_parse},
+	{".png", "PNG", "image_parse", PRINT_JOB_MODE_RASTER, image_parse},
+	{".pnm", "PNM", "image_parse", PRINT_JOB_MODE_RASTER, image_parse},
+	{".pbm", "PBM", "image_parse", PRINT_JOB_MODE_RASTER, image_parse},
+	{".pgm", "PGM", "image_parse", PRINT_JOB_MODE_RASTER, image_parse},
+	{".ppm", "PPM", "image_parse", PRINT_JOB_MODE_RASTER, image_parse},
+	{NULL, NULL, NULL, 0, NULL},
+};
+
+/**
+ * Find the reader for a source file, going by its extension.
+ *
+ * @return The index of the reader or -1 if the source goes through Ghostscript.
+ */
+static int render_find_reader(const char *const source_filename)
+{
+	const char *extension = strrchr(source_filename, '.');
+	if (extension == NULL)
+		return -1;
+
+	for (int index = 0; render_readers[index].extension != NULL; index += 1) {
+		if (strcasecmp(extension, render_readers[index].extension) == 0)
+			return index;
+	}
+
+	return -1;
+}
+
+/**
+ * Read a source straight into the print job. A combined job becomes a job of
+ * the one kind the reader supports.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+static int render_load(print_job_t *print_job, int reader, const char *const source_filename)
+{
+	print_job_mode mode = render_readers[reader].mode;
+	if (print_job->mode != mode && print_job->mode != PRINT_JOB_MODE_COMBINED) {
+		fprintf(stderr, "%s input can only be used for %s jobs\n", render_readers[reader].name,
+		        (mode == PRINT_JOB_MODE_VECTOR) ? "vector" : "raster");
+		return -1;
+	}
+	print_job->mode = mode;
+
+	FILE *source_fh = fopen(source_filename, "r");
+	if (source_fh == NULL) {
+		perror(source_filename);
+		return -1;
+	}
+
+	timings_begin(print_job->timings, render_readers[reader].stage);
+	int rc = render_readers[reader].parse(print_job, source_fh);
+	timings_end(print_job->timings);
+
+	fclose(source_fh);
+
+	return rc;
+}
+
+/**
+ * Read the paths of a PDF source straight into the vector lists, leaving
+ * anything the in-tree reader does not support to Ghostscript. A combined job
+ * becomes a vector job, as there is nothing left to engrave.
+ *
+ * @return 0 if the source was read, -1 if it needs Ghostscript.
+ */
+static int render_load_pdf(print_job_t *print_job, const char *const source_filename)
+{
+	if (print_job->mode == PRINT_JOB_MODE_RASTER || strcmp(source_filename, "stdin") == 0)
+		return -1;
+
+	FILE *source_fh = fopen(source_filename, "r");
+	if (source_fh == NULL)
+		return -1;
+
+	timings_begin(print_job->timings, "pdf_parse");
+	int rc = pdf_parse(print_job, source_fh);
+	timings_end(print_job->timings);
+
+	fclose(source_fh);
+
+	if (rc == 0)
+		print_job->mode = PRINT_JOB_MODE_VECTOR;
+
+	return rc;
+}
+
+/**
+ * Turn a source into vectors and a bitmap for the print job: formats with a
+ * reader of their own are loaded straight into it, PDF made only of strokes
+ * is read in-tree and everything else is rendered by Ghostscript into files
+ * next to target_base.
+ *
+ * @param target_bmp set to the bitmap rendered by Ghostscript, or NULL.
+ * @param target_vector set to the vector file written by Ghostscript, or NULL.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int render_source(print_job_t *print_job, const char *const source_filename, const char *const target_base, char **target_bmp, char **target_vector)
+{
+	*target_bmp = NULL;
+	*target_vector = NULL;
+
+	int reader = render_find_reader(source_filename);
+	if (reader != -1) {
+		if (render_load(print_job, reader, source_filename)) {
+			fprintf(stderr, "Failed to read %s file %s\n", render_readers[reader].name, source_filename);
+			return -1;
+		}
+		return 0;
+	}
+
+	// every path of the page was read, Ghostscript is not needed
+	if (render_load_pdf(print_job, source_filename) == 0)
+		return 0;
+
+	*target_bmp = pdf2laser_format_string("%s.bmp", target_base);
+	*target_vector = pdf2laser_format_string("%s.vector", target_base);
+
+	return render_interpret(print_job, source_filename, target_base, *target_bmp, *target_vector);
+}
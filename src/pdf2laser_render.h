@@ -0,0 +1,19 @@
+#ifndef __PDF2LASER_RENDER_H__
+#define __PDF2LASER_RENDER_H__ 1
+
+#include "type_print_job.h"  // for print_job_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+int render_source(print_job_t *print_job, const char *const source_filename, const char *const target_base, char **target_bmp, char **target_vector);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
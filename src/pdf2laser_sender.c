@@ -0,0 +1,471 @@
+#include "pdf2laser_sender.h"
+#include <errno.h>              // for errno, EAGAIN, EINPROGRESS, EINTR, ETIMEDOUT, EWOULDBLOCK
+#include <fcntl.h>              // for fcntl, open, F_GETFL, F_SETFL, O_NONBLOCK, O_RDONLY
+#include <inttypes.h>           // for PRIu32, PRIu8
+#include <netdb.h>              // for addrinfo, freeaddrinfo, gai_strerror
+#include <netinet/in.h>         // for IPPROTO_TCP
+#include <netinet/tcp.h>        // for TCP_CORK, TCP_NODELAY
+#include <poll.h>               // for poll, pollfd, POLLIN, POLLOUT
+#include <stdbool.h>            // for bool, false, true
+#include <stdint.h>             // for uint8_t, uint32_t
+#include <stdio.h>              // for fprintf, perror, stderr, NULL
+#include <stdlib.h>             // for calloc, free
+#include <string.h>             // for strchr, strlen
+#ifdef __linux
+#include <sys/epoll.h>          // for epoll_create1, epoll_ctl, epoll_wait, epoll_event, EPOLLIN, EPOLLOUT, EPOLL_CTL_ADD, EPOLL_CTL_MOD
+#include <sys/sendfile.h>       // for sendfile
+#endif
+#include <sys/socket.h>         // for connect, getsockopt, setsockopt, socket, socklen_t, SOL_SOCKET, SO_ERROR, SO_SNDBUF
+#include <sys/stat.h>           // for fstat, stat
+#include <time.h>               // for nanosleep, timespec
+#include <unistd.h>             // for close, gethostname, pread, read, write, ssize_t
+#include "config.h"             // for HOSTNAME_NCHARS
+#include "pdf2laser_printer.h"  // for printer_resolve, printer_transfer_t, PRINTER_MAX_WAIT, PRINTER_SEND_CHUNK
+#include "pdf2laser_trace.h"    // for trace_begin, trace_end
+#include "pdf2laser_util.h"     // for pdf2laser_clock, pdf2laser_format_string
+
+static int sender_fail(sender_t *self, const char *message)
+{
+	if (message != NULL)
+		perror(message);
+
+	self->state = SENDER_STATE_FAILED;
+	return -1;
+}
+
+/**
+ * Note that the transfer moved on, giving the printer PRINTER_MAX_WAIT
+ * seconds from now for its next step.
+ */
+static void sender_progressed(sender_t *self)
+{
+	self->stall_at = pdf2laser_clock() + PRINTER_MAX_WAIT;
+}
+
+/**
+ * Set what the sender is waiting for on its socket.
+ */
+static int sender_watch(sender_t *self, bool writable)
+{
+#ifdef __linux
+	struct epoll_event event = { .events = writable ? EPOLLOUT : EPOLLIN, .data.fd = self->socket_fd };
+	int operation = self->event_registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	if (epoll_ctl(self->event_fd, operation, self->socket_fd, &event))
+		return sender_fail(self, "epoll_ctl failed");
+	self->event_registered = true;
+#else
+	(void)writable;
+#endif
+	return 0;
+}
+
+/**
+ * Wait for the socket to become ready for the current state.
+ *
+ * @return 1 if the socket is ready, 0 on timeout, -1 on error.
+ */
+static int sender_wait(sender_t *self, int timeout)
+{
+	int rc;
+#ifdef __linux
+	struct epoll_event event;
+	rc = epoll_wait(self->event_fd, &event, 1, timeout);
+#else
+	short events = (self->state == SENDER_STATE_ACK) ? POLLIN : POLLOUT;
+	struct pollfd pollfd = { .fd = self->socket_fd, .events = events };
+	rc = poll(&pollfd, 1, timeout);
+#endif
+	if (rc < 0 && errno == EINTR)
+		return 0;
+	return rc;
+}
+
+static void sender_report_progress(sender_t *self, bool force)
+{
+	if (self->progress == NULL)
+		return;
+
+	double now = pdf2laser_clock();
+	if (!force && now - self->progress_at < SENDER_PROGRESS_INTERVAL)
+		return;
+	self->progress_at = now;
+
+	double elapsed = now - self->transfer.start;
+	double payload_seconds = elapsed - self->transfer.first_byte_seconds;
+
+	sender_progress_t progress = {
+		.bytes = self->transfer.bytes,
+		.total = self->total,
+		.percent = (self->total > 0) ? (100.0 * self->transfer.bytes / self->total) : 100.0,
+		.rate = (payload_seconds > 0.0 && self->transfer.bytes > 0) ? (self->transfer.bytes / payload_seconds) : 0.0,
+		.elapsed = elapsed,
+		.done = (self->state == SENDER_STATE_DONE),
+	};
+
+	self->progress(&progress, self->progress_data);
+}
+
+static void sender_configure_socket(sender_t *self)
+{
+	print_job_t *print_job = self->print_job;
+
+	if (print_job->send_buffer_size > 0) {
+		int value = print_job->send_buffer_size;
+		if (setsockopt(self->socket_fd, SOL_SOCKET, SO_SNDBUF, &value, sizeof(value)))
+			perror("Unable to set SO_SNDBUF");
+	}
+
+	if (print_job->tcp_nodelay) {
+		int value = 1;
+		if (setsockopt(self->socket_fd, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value)))
+			perror("Unable to set TCP_NODELAY");
+	}
+}
+
+/**
+ * Hold back (or release) partial frames so that the pjl leaves in full sized
+ * segments. Only available where TCP_CORK is.
+ */
+static void sender_cork(sender_t *self, int value)
+{
+	if (!self->print_job->tcp_cork)
+		return;
+
+#ifdef TCP_CORK
+	if (setsockopt(self->socket_fd, IPPROTO_TCP, TCP_CORK, &value, sizeof(value)))
+		perror("Unable to set TCP_CORK");
+#else
+	(void)value;
+#endif
+}
+
+static int sender_start_command(sender_t *self, const char *command)
+{
+	self->state = SENDER_STATE_COMMAND;
+	self->command = command;
+	self->command_length = strlen(command);
+	self->command_sent = 0;
+	return sender_watch(self, true);
+}
+
+/**
+ * Start connecting to the next resolved address, starting a new round of
+ * name resolution once every address has been tried.
+ */
+static int sender_connect_next(sender_t *self)
+{
+	if (self->socket_fd >= 0) {
+		close(self->socket_fd);
+		self->socket_fd = -1;
+		self->event_registered = false;
+	}
+
+	while (true) {
+		if (self->address == NULL) {
+			if (self->addresses != NULL) {
+				// Every address failed, wait a second before the next round
+				freeaddrinfo(self->addresses);
+				self->addresses = NULL;
+				self->retry_at = pdf2laser_clock() + 1.0;
+				if (self->retry_at > self->deadline) {
+					fprintf(stderr, "Cannot connect to %s\n", self->print_job->host);
+					return sender_fail(self, NULL);
+				}
+				return 0;
+			}
+
+			int error_code = printer_resolve(self->print_job->host, &(self->addresses));
+			if (error_code) {
+				self->addresses = NULL;
+				self->retry_at = pdf2laser_clock() + 1.0;
+				if (self->retry_at > self->deadline) {
+					fprintf(stderr, "Cannot resolve %s: %s\n", self->print_job->host, gai_strerror(error_code));
+					return sender_fail(self, NULL);
+				}
+				return 0;
+			}
+			self->address = self->addresses;
+		}
+
+		struct addrinfo *address = self->address;
+		self->address = address->ai_next;
+
+		self->socket_fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if (self->socket_fd < 0)
+			continue;
+
+		int flags = fcntl(self->socket_fd, F_GETFL, 0);
+		fcntl(self->socket_fd, F_SETFL, flags | O_NONBLOCK);
+
+		if (!connect(self->socket_fd, address->ai_addr, address->ai_addrlen) || errno == EINPROGRESS) {
+			self->state = SENDER_STATE_CONNECTING;
+			sender_progressed(self);
+			return sender_watch(self, true);
+		}
+
+		close(self->socket_fd);
+		self->socket_fd = -1;
+	}
+}
+
+static int sender_handle_connecting(sender_t *self)
+{
+	int error = 0;
+	socklen_t error_length = sizeof(error);
+	if (getsockopt(self->socket_fd, SOL_SOCKET, SO_ERROR, &error, &error_length) || error)
+		return sender_connect_next(self);
+
+	freeaddrinfo(self->addresses);
+	self->addresses = NULL;
+	self->address = NULL;
+
+	self->transfer.connect_seconds = pdf2laser_clock() - self->transfer.start;
+
+	sender_configure_socket(self);
+
+	// LPD "receive a printer job" for the default queue
+	return sender_start_command(self, "\002\r\n");
+}
+
+static int sender_handle_command(sender_t *self)
+{
+	ssize_t rc = write(self->socket_fd, self->command + self->command_sent, self->command_length - self->command_sent);
+	if (rc < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return 0;
+		return sender_fail(self, "Error writing to printer");
+	}
+
+	self->command_sent += rc;
+	sender_progressed(self);
+	if (self->command_sent < self->command_length)
+		return 0;
+
+	self->state = SENDER_STATE_ACK;
+	return sender_watch(self, false);
+}
+
+static int sender_handle_ack(sender_t *self)
+{
+	uint8_t lpdres = 1;
+	ssize_t rc = read(self->socket_fd, &lpdres, 1);
+	if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return 0;
+
+	if (rc != 1 || lpdres) {
+		fprintf(stderr, "Bad response from %s, %"PRIu8"\n", self->print_job->host, lpdres);
+		return sender_fail(self, NULL);
+	}
+
+	self->commands_acked += 1;
+	sender_progressed(self);
+	if (self->commands_acked == 1)
+		return sender_start_command(self, self->job_header);
+
+	self->transfer.handshake_seconds = pdf2laser_clock() - self->transfer.start - self->transfer.connect_seconds;
+
+	sender_cork(self, 1);
+	self->state = SENDER_STATE_PAYLOAD;
+	return sender_watch(self, true);
+}
+
+static int sender_handle_payload(sender_t *self)
+{
+	for (uint32_t index = 0; index < SENDER_STEP_CHUNKS && self->transfer.bytes < self->total; index += 1) {
+		size_t chunk = self->total - self->transfer.bytes;
+		if (chunk > PRINTER_SEND_CHUNK)
+			chunk = PRINTER_SEND_CHUNK;
+
+#ifdef __linux
+		off_t offset = self->transfer.bytes;
+		ssize_t bs = sendfile(self->socket_fd, self->pjl_fd, &offset, chunk);
+#else
+		char buffer[PRINTER_SEND_CHUNK];
+		ssize_t bs = pread(self->pjl_fd, buffer, chunk, self->transfer.bytes);
+		if (bs > 0)
+			bs = write(self->socket_fd, buffer, bs);
+#endif
+		if (bs < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+			break;
+		if (bs <= 0)
+			return sender_fail(self, "Error sending pjl file");
+
+		if (self->transfer.bytes == 0)
+			self->transfer.first_byte_seconds = pdf2laser_clock() - self->transfer.start;
+
+		self->transfer.bytes += bs;
+		sender_progressed(self);
+	}
+
+	if (self->transfer.bytes < self->total) {
+		sender_report_progress(self, false);
+		return 0;
+	}
+
+	sender_cork(self, 0);
+	self->transfer.total_seconds = pdf2laser_clock() - self->transfer.start;
+	self->state = SENDER_STATE_DONE;
+	sender_report_progress(self, true);
+
+	return 0;
+}
+
+sender_t *sender_create(print_job_t *print_job, const char *target_pjl, sender_progress_callback progress, void *progress_data)
+{
+	int pjl_fd = open(target_pjl, O_RDONLY);
+
+	struct stat file_stat;
+	if (pjl_fd < 0 || fstat(pjl_fd, &file_stat)) {
+		perror("Error reading pjl file");
+		if (pjl_fd >= 0)
+			close(pjl_fd);
+		return NULL;
+	}
+
+	char local_hostname[HOSTNAME_NCHARS];
+	char *first_dot;
+
+	gethostname(local_hostname, HOSTNAME_NCHARS);
+	if ((first_dot = strchr(local_hostname, '.'))) {
+		*first_dot = '\0';
+	}
+
+	sender_t *sender = calloc(1, sizeof(sender_t));
+	sender->print_job = print_job;
+	sender->socket_fd = -1;
+	sender->pjl_fd = pjl_fd;
+	sender->total = file_stat.st_size;
+	sender->job_header = pdf2laser_format_string("\003%"PRIu32" dfA%s%s\r\n", (uint32_t)file_stat.st_size, print_job->name, local_hostname);
+	sender->progress = progress;
+	sender->progress_data = progress_data;
+
+#ifdef __linux
+	sender->event_fd = epoll_create1(0);
+	if (sender->event_fd < 0) {
+		perror("epoll_create1 failed");
+		return sender_destroy(sender);
+	}
+#else
+	sender->event_fd = -1;
+#endif
+
+	sender->transfer.start = pdf2laser_clock();
+	sender->deadline = sender->transfer.start + PRINTER_MAX_WAIT;
+	sender_connect_next(sender);
+
+	return sender;
+}
+
+sender_t *sender_destroy(sender_t *self)
+{
+	if (self == NULL)
+		return NULL;
+
+	if (self->addresses != NULL)
+		freeaddrinfo(self->addresses);
+
+	if (self->socket_fd >= 0 && close(self->socket_fd))
+		perror("Error closing printer connection");
+
+	if (self->event_fd >= 0)
+		close(self->event_fd);
+
+	close(self->pjl_fd);
+	free(self->job_header);
+	free(self);
+
+	return NULL;
+}
+
+/**
+ * A descriptor which becomes readable whenever the sender can make progress,
+ * so that the sender can be driven from an outer event loop.
+ */
+int sender_fd(sender_t *self)
+{
+	return (self->event_fd >= 0) ? self->event_fd : self->socket_fd;
+}
+
+/**
+ * Wait at most timeout milliseconds (-1 waits as long as the printer is
+ * given) for the printer and advance the transfer as far as possible without
+ * blocking. A printer which makes no progress for PRINTER_MAX_WAIT seconds
+ * fails the transfer.
+ *
+ * @return 1 while the transfer is in progress, 0 once it completed, -1 if it
+ * failed.
+ */
+int sender_step(sender_t *self, int timeout)
+{
+	if (self->state == SENDER_STATE_DONE)
+		return 0;
+	if (self->state == SENDER_STATE_FAILED)
+		return -1;
+
+	if (self->retry_at > 0.0) {
+		int retry_timeout = (int)((self->retry_at - pdf2laser_clock()) * 1000.0);
+		if (retry_timeout > 0) {
+			if (timeout >= 0 && timeout < retry_timeout)
+				return 1;
+			struct timespec duration = { retry_timeout / 1000, (retry_timeout % 1000) * 1000000L };
+			nanosleep(&duration, NULL);
+		}
+		self->retry_at = 0.0;
+		return (sender_connect_next(self) < 0) ? -1 : 1;
+	}
+
+	double now = pdf2laser_clock();
+	if (now >= self->stall_at) {
+		errno = ETIMEDOUT;
+		return sender_fail(self, "Timed out waiting for printer");
+	}
+
+	int remaining = (int)((self->stall_at - now) * 1000.0) + 1;
+	if (timeout < 0 || timeout > remaining)
+		timeout = remaining;
+
+	trace_begin("sender_wait");
+	int rc = sender_wait(self, timeout);
+	trace_end();
+	if (rc < 0)
+		return sender_fail(self, "Error waiting for printer");
+	if (rc == 0)
+		return 1;
+
+	switch (self->state) {
+	case SENDER_STATE_CONNECTING:
+		rc = sender_handle_connecting(self);
+		break;
+	case SENDER_STATE_COMMAND:
+		rc = sender_handle_command(self);
+		break;
+	case SENDER_STATE_ACK:
+		rc = sender_handle_ack(self);
+		break;
+	case SENDER_STATE_PAYLOAD:
+		trace_begin("sender_payload");
+		rc = sender_handle_payload(self);
+		trace_end();
+		break;
+	default:
+		break;
+	}
+
+	if (rc < 0 || self->state == SENDER_STATE_FAILED)
+		return -1;
+
+	return (self->state == SENDER_STATE_DONE) ? 0 : 1;
+}
+
+/**
+ * Drive the transfer to completion.
+ *
+ * @return 0 if the job was sent, -1 otherwise.
+ */
+int sender_run(sender_t *self)
+{
+	int rc;
+	while ((rc = sender_step(self, -1)) > 0)
+		;
+	return rc;
+}
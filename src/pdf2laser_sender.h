@@ -0,0 +1,86 @@
+#ifndef __PDF2LASER_SENDER_H__
+#define __PDF2LASER_SENDER_H__ 1
+
+#include <netdb.h>               // for addrinfo
+#include <stdbool.h>             // for bool
+#include <stddef.h>              // for size_t
+#include <stdint.h>              // for uint32_t
+#include "pdf2laser_printer.h"   // for printer_transfer_t
+#include "type_print_job.h"      // for print_job_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/** Minimum number of seconds between two progress events. */
+#define SENDER_PROGRESS_INTERVAL (0.25)
+
+/** Number of payload chunks sent per step before yielding to the caller. */
+#define SENDER_STEP_CHUNKS (16)
+
+typedef enum {
+	SENDER_STATE_CONNECTING,  // waiting for the connection to be established
+	SENDER_STATE_COMMAND,     // writing an LPD command
+	SENDER_STATE_ACK,         // waiting for the acknowledgement of a command
+	SENDER_STATE_PAYLOAD,     // streaming the pjl
+	SENDER_STATE_DONE,
+	SENDER_STATE_FAILED,
+} sender_state;
+
+typedef struct sender_progress sender_progress_t;
+struct sender_progress {
+	size_t bytes;     // pjl bytes handed to the socket so far
+	size_t total;     // size of the pjl
+	double percent;
+	double rate;      // payload bytes per second so far
+	double elapsed;   // seconds since the send was started
+	bool done;
+};
+
+typedef void (*sender_progress_callback)(sender_progress_t *progress, void *data);
+
+typedef struct sender sender_t;
+struct sender {
+	print_job_t *print_job;
+	sender_state state;
+
+	struct addrinfo *addresses;  // resolved addresses of the printer
+	struct addrinfo *address;    // address currently being connected to
+	double deadline;             // monotonic time at which connecting is given up
+	double retry_at;             // monotonic time of the next connection round, 0 if none
+	double stall_at;             // monotonic time at which a printer making no progress is given up
+
+	int socket_fd;
+	int pjl_fd;
+	int event_fd;                // epoll instance, -1 where epoll is unavailable
+	bool event_registered;
+
+	char *job_header;
+	const char *command;         // LPD command being written
+	size_t command_length;
+	size_t command_sent;
+	uint32_t commands_acked;
+
+	size_t total;
+	printer_transfer_t transfer;
+
+	sender_progress_callback progress;
+	void *progress_data;
+	double progress_at;
+};
+
+sender_t *sender_create(print_job_t *print_job, const char *target_pjl, sender_progress_callback progress, void *progress_data);
+sender_t *sender_destroy(sender_t *self);
+
+int sender_fd(sender_t *self);
+int sender_step(sender_t *self, int timeout);
+int sender_run(sender_t *self);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
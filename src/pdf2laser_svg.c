@@ -0,0 +1,1106 @@
+#include "pdf2laser_svg.h"
+#include <ctype.h>                    // for isspace, isalpha, islower, isxdigit, toupper
+#include <inttypes.h>                 // for PRId32
+#include <math.h>                     // for acos, atan2, ceil, cos, fabs, fmax, fmin, hypot, lround, sin, sqrt, tan, M_PI
+#include <stdbool.h>                  // for bool, false, true
+#include <stddef.h>                   // for NULL, size_t
+#include <stdint.h>                   // for int32_t
+#include <stdio.h>                    // for fprintf, fread, printf, snprintf, stderr, FILE
+#include <stdlib.h>                   // for calloc, free, realloc, strtod, strtol
+#include <string.h>                   // for memchr, memcpy, strchr, strcmp, strlen, strncmp, strrchr, strstr
+#include <strings.h>                  // for strncasecmp
+#include "type_print_job.h"           // for print_job_t, print_job_clone_last_vector_list_config, print_job_find_vector_list_config_by_rgb
+#include "type_raster.h"              // for raster_t
+#include "type_vector.h"              // for vector_create
+#include "type_vector_list.h"         // for vector_list_append, vector_list_t
+#include "type_vector_list_config.h"  // for vector_list_config_t
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/** Affine transform mapping (x, y) to (a x + c y + e, b x + d y + f). */
+typedef struct svg_matrix svg_matrix_t;
+struct svg_matrix {
+	double a, b, c, d, e, f;
+};
+
+/** Inherited state of an element. */
+typedef struct svg_state svg_state_t;
+struct svg_state {
+	svg_matrix_t ctm;  // user units to device units
+	bool stroke;       // whether shapes are stroked, and so cut
+	int32_t red;
+	int32_t green;
+	int32_t blue;
+};
+
+typedef struct svg_attribute svg_attribute_t;
+struct svg_attribute {
+	char *name;
+	char *value;
+};
+
+typedef struct svg_tag svg_tag_t;
+struct svg_tag {
+	char *name;     // without any namespace prefix
+	bool closed;    // written as <name/>
+	svg_attribute_t attributes[SVG_ATTRIBUTES_MAX];
+	int attributes_length;
+};
+
+typedef struct svg_parser svg_parser_t;
+struct svg_parser {
+	print_job_t *print_job;
+
+	svg_state_t stack[SVG_DEPTH_MAX];
+	int depth;       // index of the state of the innermost open element
+	int skip_depth;  // open elements within a subtree which is not drawn
+	bool root_seen;
+
+	svg_state_t *state;   // state of the shape being drawn
+	vector_list_t *list;  // where the shape being drawn is cut, NULL to skip it
+
+	double x, y;                 // current point in user units
+	double start_x, start_y;     // start of the current subpath in user units
+	int32_t device_x, device_y;  // current point in device units
+
+	int32_t vectors;
+};
+
+static const struct {
+	const char *name;
+	int32_t red, green, blue;
+} svg_color_names[] = {
+	{"black",     0,   0,   0},
+	{"white",   255, 255, 255},
+	{"red",     255,   0,   0},
+	{"lime",      0, 255,   0},
+	{"green",     0, 128,   0},
+	{"blue",      0,   0, 255},
+	{"yellow",  255, 255,   0},
+	{"cyan",      0, 255, 255},
+	{"aqua",      0, 255, 255},
+	{"magenta", 255,   0, 255},
+	{"fuchsia", 255,   0, 255},
+	{"gray",    128, 128, 128},
+	{"grey",    128, 128, 128},
+	{"silver",  192, 192, 192},
+	{"maroon",  128,   0,   0},
+	{"olive",   128, 128,   0},
+	{"navy",      0,   0, 128},
+	{"purple",  128,   0, 128},
+	{"teal",      0, 128, 128},
+	{"orange",  255, 165,   0},
+	{NULL, 0, 0, 0},
+};
+
+static svg_matrix_t svg_matrix_multiply(svg_matrix_t m, svg_matrix_t n)
+{
+	return (svg_matrix_t){
+		.a = m.a * n.a + m.c * n.b,
+		.b = m.b * n.a + m.d * n.b,
+		.c = m.a * n.c + m.c * n.d,
+		.d = m.b * n.c + m.d * n.d,
+		.e = m.a * n.e + m.c * n.f + m.e,
+		.f = m.b * n.e + m.d * n.f + m.f,
+	};
+}
+
+static svg_matrix_t svg_matrix_scale(double sx, double sy)
+{
+	return (svg_matrix_t){ .a = sx, .b = 0.0, .c = 0.0, .d = sy, .e = 0.0, .f = 0.0 };
+}
+
+static svg_matrix_t svg_matrix_translate(double tx, double ty)
+{
+	return (svg_matrix_t){ .a = 1.0, .b = 0.0, .c = 0.0, .d = 1.0, .e = tx, .f = ty };
+}
+
+static void svg_skip_separators(const char **s)
+{
+	while (isspace((unsigned char)**s) || **s == ',')
+		*s += 1;
+}
+
+static bool svg_number(const char **s, double *value)
+{
+	svg_skip_separators(s);
+
+	char *end;
+	*value = strtod(*s, &end);
+	if (end == *s)
+		return false;
+
+	*s = end;
+	return true;
+}
+
+/** Arc flags may be written without any separator, as in "a1,1 0 0110,10". */
+static bool svg_flag(const char **s, bool *flag)
+{
+	svg_skip_separators(s);
+
+	if (**s != '0' && **s != '1')
+		return false;
+
+	*flag = (**s == '1');
+	*s += 1;
+	return true;
+}
+
+/**
+ * Parse a length into user units, taking any absolute unit into account.
+ * Percentages cannot be resolved and are reported as missing.
+ */
+static bool svg_length(const char *s, double *value)
+{
+	static const struct {
+		const char *unit;
+		double scale;
+	} units[] = {
+		{"px", 1.0},
+		{"in", SVG_UNITS_PER_INCH},
+		{"cm", SVG_UNITS_PER_INCH / 2.54},
+		{"mm", SVG_UNITS_PER_INCH / 25.4},
+		{"pt", SVG_UNITS_PER_INCH / 72.0},
+		{"pc", SVG_UNITS_PER_INCH / 6.0},
+		{NULL, 0.0},
+	};
+
+	if (s == NULL || !svg_number(&s, value))
+		return false;
+
+	while (isspace((unsigned char)*s))
+		s += 1;
+
+	if (*s == '%')
+		return false;
+
+	for (size_t index = 0; units[index].unit != NULL; index += 1) {
+		if (strncmp(s, units[index].unit, 2) == 0) {
+			*value *= units[index].scale;
+			break;
+		}
+	}
+
+	return true;
+}
+
+static double svg_length_or(const char *s, double fallback)
+{
+	double value;
+	return svg_length(s, &value) ? value : fallback;
+}
+
+static bool svg_color(const char *s, int32_t *red, int32_t *green, int32_t *blue)
+{
+	while (isspace((unsigned char)*s))
+		s += 1;
+
+	if (*s == '#') {
+		size_t length = 0;
+		while (isxdigit((unsigned char)s[1 + length]))
+			length += 1;
+
+		long value = strtol(s + 1, NULL, 16);
+		if (length == 3) {
+			*red = ((value >> 8) & 0xf) * 0x11;
+			*green = ((value >> 4) & 0xf) * 0x11;
+			*blue = (value & 0xf) * 0x11;
+			return true;
+		}
+		if (length == 6) {
+			*red = (value >> 16) & 0xff;
+			*green = (value >> 8) & 0xff;
+			*blue = value & 0xff;
+			return true;
+		}
+		return false;
+	}
+
+	if (strncmp(s, "rgb(", 4) == 0) {
+		const char *p = s + 4;
+		double channels[3];
+		for (int index = 0; index < 3; index += 1) {
+			if (!svg_number(&p, &channels[index]))
+				return false;
+			while (isspace((unsigned char)*p))
+				p += 1;
+			if (*p == '%') {
+				channels[index] = channels[index] * 255.0 / 100.0;
+				p += 1;
+			}
+			channels[index] = (channels[index] < 0.0) ? 0.0 : (channels[index] > 255.0) ? 255.0 : channels[index];
+		}
+		*red = lround(channels[0]);
+		*green = lround(channels[1]);
+		*blue = lround(channels[2]);
+		return true;
+	}
+
+	for (size_t index = 0; svg_color_names[index].name != NULL; index += 1) {
+		size_t length = strlen(svg_color_names[index].name);
+		if (strncasecmp(s, svg_color_names[index].name, length) == 0 &&
+		    (s[length] == '\0' || isspace((unsigned char)s[length]))) {
+			*red = svg_color_names[index].red;
+			*green = svg_color_names[index].green;
+			*blue = svg_color_names[index].blue;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Apply a transform list such as "translate(10,20) rotate(45)" to a matrix.
+ * Parsing stops at the first transform which cannot be read.
+ */
+static svg_matrix_t svg_transform(svg_matrix_t matrix, const char *s)
+{
+	while (*s) {
+		svg_skip_separators(&s);
+
+		const char *name = s;
+		while (isalpha((unsigned char)*s))
+			s += 1;
+		size_t name_length = s - name;
+
+		while (isspace((unsigned char)*s))
+			s += 1;
+		if (name_length == 0 || *s != '(')
+			break;
+		s += 1;
+
+		double args[6];
+		int count = 0;
+		while (count < 6 && svg_number(&s, &args[count]))
+			count += 1;
+
+		svg_skip_separators(&s);
+		if (*s != ')')
+			break;
+		s += 1;
+
+		svg_matrix_t local;
+		if (strncmp(name, "matrix", name_length) == 0 && count == 6) {
+			local = (svg_matrix_t){ args[0], args[1], args[2], args[3], args[4], args[5] };
+		}
+		else if (strncmp(name, "translate", name_length) == 0 && count >= 1) {
+			local = svg_matrix_translate(args[0], (count > 1) ? args[1] : 0.0);
+		}
+		else if (strncmp(name, "scale", name_length) == 0 && count >= 1) {
+			local = svg_matrix_scale(args[0], (count > 1) ? args[1] : args[0]);
+		}
+		else if (strncmp(name, "rotate", name_length) == 0 && count >= 1) {
+			double angle = args[0] * M_PI / 180.0;
+			local = (svg_matrix_t){ cos(angle), sin(angle), -sin(angle), cos(angle), 0.0, 0.0 };
+			if (count == 3) {
+				local = svg_matrix_multiply(svg_matrix_translate(args[1], args[2]), local);
+				local = svg_matrix_multiply(local, svg_matrix_translate(-args[1], -args[2]));
+			}
+		}
+		else if (strncmp(name, "skewX", name_length) == 0 && count == 1) {
+			local = (svg_matrix_t){ 1.0, 0.0, tan(args[0] * M_PI / 180.0), 1.0, 0.0, 0.0 };
+		}
+		else if (strncmp(name, "skewY", name_length) == 0 && count == 1) {
+			local = (svg_matrix_t){ 1.0, tan(args[0] * M_PI / 180.0), 0.0, 1.0, 0.0, 0.0 };
+		}
+		else {
+			break;
+		}
+
+		matrix = svg_matrix_multiply(matrix, local);
+	}
+
+	return matrix;
+}
+
+static const char *svg_attribute(svg_tag_t *tag, const char *name)
+{
+	for (int index = 0; index < tag->attributes_length; index += 1) {
+		if (strcmp(tag->attributes[index].name, name) == 0)
+			return tag->attributes[index].value;
+	}
+	return NULL;
+}
+
+/**
+ * Look up a presentation property, preferring the style attribute over the
+ * attribute of the same name as CSS does.
+ *
+ * @return The value of the property copied into buffer, or NULL if it is not
+ * set on the element.
+ */
+static const char *svg_property(svg_tag_t *tag, const char *name, char *buffer, size_t size)
+{
+	const char *style = svg_attribute(tag, "style");
+	size_t name_length = strlen(name);
+
+	while (style != NULL && *style) {
+		while (isspace((unsigned char)*style) || *style == ';')
+			style += 1;
+
+		const char *end = strchr(style, ';');
+		if (end == NULL)
+			end = style + strlen(style);
+
+		const char *colon = memchr(style, ':', end - style);
+		if (colon != NULL) {
+			const char *key_end = colon;
+			while (key_end > style && isspace((unsigned char)key_end[-1]))
+				key_end -= 1;
+
+			if ((size_t)(key_end - style) == name_length && strncmp(style, name, name_length) == 0) {
+				const char *value = colon + 1;
+				while (value < end && isspace((unsigned char)*value))
+					value += 1;
+				const char *value_end = end;
+				while (value_end > value && isspace((unsigned char)value_end[-1]))
+					value_end -= 1;
+
+				size_t length = value_end - value;
+				if (length >= size)
+					length = size - 1;
+				memcpy(buffer, value, length);
+				buffer[length] = '\0';
+				return buffer;
+			}
+		}
+
+		style = end;
+	}
+
+	const char *value = svg_attribute(tag, name);
+	if (value == NULL)
+		return NULL;
+
+	snprintf(buffer, size, "%s", value);
+	return buffer;
+}
+
+/**
+ * Split a start tag into its name and attributes, terminating each of them
+ * in place.
+ *
+ * @param s the text following the opening '<'.
+ *
+ * @return The text following the closing '>' or NULL if the tag is not
+ * terminated.
+ */
+static char *svg_parse_tag(char *s, svg_tag_t *tag)
+{
+	tag->closed = false;
+	tag->attributes_length = 0;
+
+	tag->name = s;
+	while (*s && !isspace((unsigned char)*s) && *s != '/' && *s != '>')
+		s += 1;
+	char *name_end = s;
+
+	for (;;) {
+		while (isspace((unsigned char)*s))
+			s += 1;
+
+		if (*s == '\0')
+			return NULL;
+
+		if (*s == '/') {
+			tag->closed = true;
+			s += 1;
+			continue;
+		}
+
+		if (*s == '>') {
+			s += 1;
+			break;
+		}
+
+		char *name = s;
+		while (*s && !isspace((unsigned char)*s) && *s != '=' && *s != '/' && *s != '>')
+			s += 1;
+		char *attribute_name_end = s;
+
+		while (isspace((unsigned char)*s))
+			s += 1;
+		if (*s != '=') {
+			if (s == name)
+				s += 1;
+			continue;
+		}
+		s += 1;
+
+		while (isspace((unsigned char)*s))
+			s += 1;
+		char quote = *s;
+		if (quote != '"' && quote != '\'')
+			return NULL;
+
+		char *value = s + 1;
+		s = strchr(value, quote);
+		if (s == NULL)
+			return NULL;
+		*s = '\0';
+		s += 1;
+
+		*attribute_name_end = '\0';
+		if (tag->attributes_length < SVG_ATTRIBUTES_MAX) {
+			tag->attributes[tag->attributes_length] = (svg_attribute_t){ .name = name, .value = value };
+			tag->attributes_length += 1;
+		}
+	}
+
+	*name_end = '\0';
+
+	char *local_name = strrchr(tag->name, ':');
+	if (local_name != NULL)
+		tag->name = local_name + 1;
+
+	return s;
+}
+
+/**
+ * Work out the state of an element from that of its parent and its own
+ * transform and presentation properties.
+ */
+static svg_state_t svg_state(svg_state_t *parent, svg_tag_t *tag)
+{
+	svg_state_t state = *parent;
+	char buffer[128];
+
+	const char *transform = svg_attribute(tag, "transform");
+	if (transform != NULL)
+		state.ctm = svg_transform(state.ctm, transform);
+
+	const char *stroke = svg_property(tag, "stroke", buffer, sizeof(buffer));
+	if (stroke != NULL) {
+		if (strncmp(stroke, "none", 4) == 0)
+			state.stroke = false;
+		else if (svg_color(stroke, &state.red, &state.green, &state.blue))
+			state.stroke = true;
+	}
+
+	return state;
+}
+
+/**
+ * Map the viewBox of an svg element onto its viewport, as done by the default
+ * preserveAspectRatio of xMidYMid meet, or by stretching when it is none.
+ */
+static svg_matrix_t svg_viewport(svg_tag_t *tag, bool root)
+{
+	double x = root ? 0.0 : svg_length_or(svg_attribute(tag, "x"), 0.0);
+	double y = root ? 0.0 : svg_length_or(svg_attribute(tag, "y"), 0.0);
+	svg_matrix_t matrix = svg_matrix_translate(x, y);
+
+	double view[4];
+	const char *view_box = svg_attribute(tag, "viewBox");
+	if (view_box == NULL)
+		return matrix;
+
+	for (int index = 0; index < 4; index += 1) {
+		if (!svg_number(&view_box, &view[index]))
+			return matrix;
+	}
+	if (view[2] <= 0.0 || view[3] <= 0.0)
+		return matrix;
+
+	double width = svg_length_or(svg_attribute(tag, "width"), view[2]);
+	double height = svg_length_or(svg_attribute(tag, "height"), view[3]);
+
+	double sx = width / view[2];
+	double sy = height / view[3];
+	double tx = 0.0;
+	double ty = 0.0;
+
+	const char *aspect = svg_attribute(tag, "preserveAspectRatio");
+	if (aspect == NULL || strncmp(aspect, "none", 4) != 0) {
+		double scale = (sx < sy) ? sx : sy;
+		tx = (width - view[2] * scale) / 2.0;
+		ty = (height - view[3] * scale) / 2.0;
+		sx = scale;
+		sy = scale;
+	}
+
+	matrix = svg_matrix_multiply(matrix, svg_matrix_translate(tx, ty));
+	matrix = svg_matrix_multiply(matrix, svg_matrix_scale(sx, sy));
+	return svg_matrix_multiply(matrix, svg_matrix_translate(-view[0], -view[1]));
+}
+
+static void svg_device(svg_parser_t *self, double x, double y, int32_t *device_x, int32_t *device_y)
+{
+	svg_matrix_t *m = &(self->state->ctm);
+	*device_x = lround(m->a * x + m->c * y + m->e);
+	*device_y = lround(m->b * x + m->d * y + m->f);
+}
+
+static void svg_move_to(svg_parser_t *self, double x, double y)
+{
+	self->x = self->start_x = x;
+	self->y = self->start_y = y;
+	svg_device(self, x, y, &self->device_x, &self->device_y);
+}
+
+static void svg_line_to(svg_parser_t *self, double x, double y)
+{
+	int32_t device_x, device_y;
+	svg_device(self, x, y, &device_x, &device_y);
+
+	if (self->list != NULL && (device_x != self->device_x || device_y != self->device_y)) {
+		vector_list_append(self->list, vector_create(self->device_x, self->device_y, device_x, device_y));
+		self->vectors += 1;
+	}
+
+	self->x = x;
+	self->y = y;
+	self->device_x = device_x;
+	self->device_y = device_y;
+}
+
+static void svg_close_path(svg_parser_t *self)
+{
+	svg_line_to(self, self->start_x, self->start_y);
+}
+
+/**
+ * Number of straight segments a curve is flattened into, from the length of
+ * its control polygon in device units.
+ */
+static int svg_segments(svg_parser_t *self, const double *points, int count)
+{
+	svg_matrix_t *m = &(self->state->ctm);
+	double length = 0.0;
+
+	for (int index = 1; index < count; index += 1) {
+		double dx = points[2 * index] - points[2 * index - 2];
+		double dy = points[2 * index + 1] - points[2 * index - 1];
+		length += hypot(m->a * dx + m->c * dy, m->b * dx + m->d * dy);
+	}
+
+	int segments = (int)ceil(sqrt(length / SVG_FLATNESS) / 2.0);
+	return (segments < 1) ? 1 : (segments > SVG_SEGMENTS_MAX) ? SVG_SEGMENTS_MAX : segments;
+}
+
+static void svg_cubic_to(svg_parser_t *self, double x1, double y1, double x2, double y2, double x, double y)
+{
+	double x0 = self->x;
+	double y0 = self->y;
+	int segments = svg_segments(self, (double[]){ x0, y0, x1, y1, x2, y2, x, y }, 4);
+
+	for (int index = 1; index <= segments; index += 1) {
+		double t = (double)index / segments;
+		double u = 1.0 - t;
+		svg_line_to(self,
+		            u * u * u * x0 + 3.0 * u * u * t * x1 + 3.0 * u * t * t * x2 + t * t * t * x,
+		            u * u * u * y0 + 3.0 * u * u * t * y1 + 3.0 * u * t * t * y2 + t * t * t * y);
+	}
+}
+
+static void svg_quadratic_to(svg_parser_t *self, double x1, double y1, double x, double y)
+{
+	double x0 = self->x;
+	double y0 = self->y;
+	int segments = svg_segments(self, (double[]){ x0, y0, x1, y1, x, y }, 3);
+
+	for (int index = 1; index <= segments; index += 1) {
+		double t = (double)index / segments;
+		double u = 1.0 - t;
+		svg_line_to(self,
+		            u * u * x0 + 2.0 * u * t * x1 + t * t * x,
+		            u * u * y0 + 2.0 * u * t * y1 + t * t * y);
+	}
+}
+
+/**
+ * Flatten an elliptical arc given in the endpoint form of path data, by way
+ * of its center parameterization (SVG 1.1 appendix F.6).
+ */
+static void svg_arc_to(svg_parser_t *self, double rx, double ry, double rotation, bool large_arc, bool sweep, double x, double y)
+{
+	double x0 = self->x;
+	double y0 = self->y;
+
+	rx = fabs(rx);
+	ry = fabs(ry);
+	if (rx == 0.0 || ry == 0.0 || (x0 == x && y0 == y)) {
+		svg_line_to(self, x, y);
+		return;
+	}
+
+	double phi = rotation * M_PI / 180.0;
+	double cos_phi = cos(phi);
+	double sin_phi = sin(phi);
+
+	double dx = (x0 - x) / 2.0;
+	double dy = (y0 - y) / 2.0;
+	double x1 = cos_phi * dx + sin_phi * dy;
+	double y1 = -sin_phi * dx + cos_phi * dy;
+
+	// scale up radii too small to reach the end point
+	double lambda = (x1 * x1) / (rx * rx) + (y1 * y1) / (ry * ry);
+	if (lambda > 1.0) {
+		rx *= sqrt(lambda);
+		ry *= sqrt(lambda);
+	}
+
+	double numerator = rx * rx * ry * ry - rx * rx * y1 * y1 - ry * ry * x1 * x1;
+	double denominator = rx * rx * y1 * y1 + ry * ry * x1 * x1;
+	double coefficient = sqrt(fmax(0.0, numerator / denominator));
+	if (large_arc == sweep)
+		coefficient = -coefficient;
+
+	double cx1 = coefficient * rx * y1 / ry;
+	double cy1 = -coefficient * ry * x1 / rx;
+	double cx = cos_phi * cx1 - sin_phi * cy1 + (x0 + x) / 2.0;
+	double cy = sin_phi * cx1 + cos_phi * cy1 + (y0 + y) / 2.0;
+
+	double theta = atan2((y1 - cy1) / ry, (x1 - cx1) / rx);
+	double delta = atan2((-y1 - cy1) / ry, (-x1 - cx1) / rx) - theta;
+	if (sweep && delta < 0.0)
+		delta += 2.0 * M_PI;
+	else if (!sweep && delta > 0.0)
+		delta -= 2.0 * M_PI;
+
+	// keep the chords within SVG_FLATNESS of the arc at its scale on the device
+	svg_matrix_t *m = &(self->state->ctm);
+	double radius = fmax(rx, ry) * sqrt(fabs(m->a * m->d - m->b * m->c));
+	int segments = 1;
+	if (radius > SVG_FLATNESS)
+		segments = (int)ceil(fabs(delta) / (2.0 * acos(1.0 - SVG_FLATNESS / radius)));
+	if (segments > SVG_SEGMENTS_MAX)
+		segments = SVG_SEGMENTS_MAX;
+
+	for (int index = 1; index < segments; index += 1) {
+		double angle = theta + delta * index / segments;
+		double ex = rx * cos(angle);
+		double ey = ry * sin(angle);
+		svg_line_to(self, cos_phi * ex - sin_phi * ey + cx, sin_phi * ex + cos_phi * ey + cy);
+	}
+	svg_line_to(self, x, y);
+}
+
+/**
+ * Follow path data, flattening curves into straight segments. As required by
+ * the specification, drawing stops at the first error but everything before
+ * it is kept.
+ */
+static void svg_path(svg_parser_t *self, const char *s)
+{
+	char command = 0;
+	char previous = 0;
+	double control_x = 0.0;
+	double control_y = 0.0;
+
+	for (;;) {
+		svg_skip_separators(&s);
+		if (*s == '\0')
+			return;
+
+		if (isalpha((unsigned char)*s)) {
+			command = *s;
+			s += 1;
+		}
+		else if (command == 0 || toupper((unsigned char)command) == 'Z') {
+			return;
+		}
+		else if (command == 'M') {
+			command = 'L';
+		}
+		else if (command == 'm') {
+			command = 'l';
+		}
+
+		bool relative = islower((unsigned char)command);
+		double base_x = relative ? self->x : 0.0;
+		double base_y = relative ? self->y : 0.0;
+		double v[7];
+
+		switch (toupper((unsigned char)command)) {
+		case 'M': {
+			if (!svg_number(&s, &v[0]) || !svg_number(&s, &v[1]))
+				return;
+			svg_move_to(self, base_x + v[0], base_y + v[1]);
+			break;
+		}
+		case 'L': {
+			if (!svg_number(&s, &v[0]) || !svg_number(&s, &v[1]))
+				return;
+			svg_line_to(self, base_x + v[0], base_y + v[1]);
+			break;
+		}
+		case 'H': {
+			if (!svg_number(&s, &v[0]))
+				return;
+			svg_line_to(self, base_x + v[0], self->y);
+			break;
+		}
+		case 'V': {
+			if (!svg_number(&s, &v[0]))
+				return;
+			svg_line_to(self, self->x, base_y + v[0]);
+			break;
+		}
+		case 'C': {
+			for (int index = 0; index < 6; index += 1) {
+				if (!svg_number(&s, &v[index]))
+					return;
+			}
+			control_x = base_x + v[2];
+			control_y = base_y + v[3];
+			svg_cubic_to(self, base_x + v[0], base_y + v[1], control_x, control_y, base_x + v[4], base_y + v[5]);
+			break;
+		}
+		case 'S': {
+			for (int index = 0; index < 4; index += 1) {
+				if (!svg_number(&s, &v[index]))
+					return;
+			}
+			// reflect the second control point of a preceding cubic
+			double x1 = self->x;
+			double y1 = self->y;
+			if (toupper((unsigned char)previous) == 'C' || toupper((unsigned char)previous) == 'S') {
+				x1 = 2.0 * self->x - control_x;
+				y1 = 2.0 * self->y - control_y;
+			}
+			control_x = base_x + v[0];
+			control_y = base_y + v[1];
+			svg_cubic_to(self, x1, y1, control_x, control_y, base_x + v[2], base_y + v[3]);
+			break;
+		}
+		case 'Q': {
+			for (int index = 0; index < 4; index += 1) {
+				if (!svg_number(&s, &v[index]))
+					return;
+			}
+			control_x = base_x + v[0];
+			control_y = base_y + v[1];
+			svg_quadratic_to(self, control_x, control_y, base_x + v[2], base_y + v[3]);
+			break;
+		}
+		case 'T': {
+			if (!svg_number(&s, &v[0]) || !svg_number(&s, &v[1]))
+				return;
+			// reflect the control point of a preceding quadratic
+			if (toupper((unsigned char)previous) == 'Q' || toupper((unsigned char)previous) == 'T') {
+				control_x = 2.0 * self->x - control_x;
+				control_y = 2.0 * self->y - control_y;
+			}
+			else {
+				control_x = self->x;
+				control_y = self->y;
+			}
+			svg_quadratic_to(self, control_x, control_y, base_x + v[0], base_y + v[1]);
+			break;
+		}
+		case 'A': {
+			bool large_arc, sweep;
+			if (!svg_number(&s, &v[0]) || !svg_number(&s, &v[1]) || !svg_number(&s, &v[2]) ||
+			    !svg_flag(&s, &large_arc) || !svg_flag(&s, &sweep) ||
+			    !svg_number(&s, &v[3]) || !svg_number(&s, &v[4]))
+				return;
+			svg_arc_to(self, v[0], v[1], v[2], large_arc, sweep, base_x + v[3], base_y + v[4]);
+			break;
+		}
+		case 'Z': {
+			svg_close_path(self);
+			break;
+		}
+		default:
+			return;
+		}
+
+		previous = command;
+	}
+}
+
+static void svg_points(svg_parser_t *self, const char *s, bool close)
+{
+	double x, y;
+
+	if (s == NULL || !svg_number(&s, &x) || !svg_number(&s, &y))
+		return;
+	svg_move_to(self, x, y);
+
+	while (svg_number(&s, &x) && svg_number(&s, &y))
+		svg_line_to(self, x, y);
+
+	if (close)
+		svg_close_path(self);
+}
+
+static void svg_ellipse(svg_parser_t *self, double cx, double cy, double rx, double ry)
+{
+	if (rx <= 0.0 || ry <= 0.0)
+		return;
+
+	svg_move_to(self, cx + rx, cy);
+	svg_arc_to(self, rx, ry, 0.0, false, true, cx - rx, cy);
+	svg_arc_to(self, rx, ry, 0.0, false, true, cx + rx, cy);
+	svg_close_path(self);
+}
+
+static void svg_rect(svg_parser_t *self, svg_tag_t *tag)
+{
+	double x = svg_length_or(svg_attribute(tag, "x"), 0.0);
+	double y = svg_length_or(svg_attribute(tag, "y"), 0.0);
+	double width = svg_length_or(svg_attribute(tag, "width"), 0.0);
+	double height = svg_length_or(svg_attribute(tag, "height"), 0.0);
+	if (width <= 0.0 || height <= 0.0)
+		return;
+
+	// a missing corner radius takes the value of the other one
+	double rx = svg_length_or(svg_attribute(tag, "rx"), -1.0);
+	double ry = svg_length_or(svg_attribute(tag, "ry"), -1.0);
+	if (rx < 0.0)
+		rx = (ry < 0.0) ? 0.0 : ry;
+	if (ry < 0.0)
+		ry = rx;
+	rx = fmin(rx, width / 2.0);
+	ry = fmin(ry, height / 2.0);
+
+	svg_move_to(self, x + rx, y);
+	svg_line_to(self, x + width - rx, y);
+	if (rx > 0.0 && ry > 0.0)
+		svg_arc_to(self, rx, ry, 0.0, false, true, x + width, y + ry);
+	svg_line_to(self, x + width, y + height - ry);
+	if (rx > 0.0 && ry > 0.0)
+		svg_arc_to(self, rx, ry, 0.0, false, true, x + width - rx, y + height);
+	svg_line_to(self, x + rx, y + height);
+	if (rx > 0.0 && ry > 0.0)
+		svg_arc_to(self, rx, ry, 0.0, false, true, x, y + height - ry);
+	svg_line_to(self, x, y + ry);
+	if (rx > 0.0 && ry > 0.0)
+		svg_arc_to(self, rx, ry, 0.0, false, true, x + rx, y);
+	svg_close_path(self);
+}
+
+/**
+ * Find the vector list a shape of the given state is cut into, following the
+ * same fallthrough rules as colours found by Ghostscript.
+ *
+ * @return The vector list or NULL if the shape is not cut.
+ */
+static vector_list_t *svg_vector_list(svg_parser_t *self, svg_state_t *state)
+{
+	if (!state->stroke)
+		return NULL;
+
+	print_job_t *print_job = self->print_job;
+	vector_list_config_t *config = print_job_find_vector_list_config_by_rgb(print_job, state->red, state->green, state->blue);
+	if (config == NULL && print_job->vector_fallthrough)
+		config = print_job_clone_last_vector_list_config(print_job, state->red, state->green, state->blue);
+
+	return (config != NULL) ? config->vector_list : NULL;
+}
+
+/**
+ * Draw a basic shape or path element.
+ *
+ * @return true if the element is a shape, false otherwise.
+ */
+static bool svg_shape(svg_parser_t *self, svg_tag_t *tag, svg_state_t *state)
+{
+	const char *name = tag->name;
+	if (strcmp(name, "path") && strcmp(name, "line") && strcmp(name, "rect") &&
+	    strcmp(name, "circle") && strcmp(name, "ellipse") &&
+	    strcmp(name, "polyline") && strcmp(name, "polygon"))
+		return false;
+
+	self->state = state;
+	self->list = svg_vector_list(self, state);
+	if (self->list == NULL)
+		return true;
+
+	svg_move_to(self, 0.0, 0.0);
+
+	if (strcmp(name, "path") == 0) {
+		const char *d = svg_attribute(tag, "d");
+		if (d != NULL)
+			svg_path(self, d);
+	}
+	else if (strcmp(name, "line") == 0) {
+		svg_move_to(self, svg_length_or(svg_attribute(tag, "x1"), 0.0), svg_length_or(svg_attribute(tag, "y1"), 0.0));
+		svg_line_to(self, svg_length_or(svg_attribute(tag, "x2"), 0.0), svg_length_or(svg_attribute(tag, "y2"), 0.0));
+	}
+	else if (strcmp(name, "rect") == 0) {
+		svg_rect(self, tag);
+	}
+	else if (strcmp(name, "circle") == 0) {
+		double r = svg_length_or(svg_attribute(tag, "r"), 0.0);
+		svg_ellipse(self, svg_length_or(svg_attribute(tag, "cx"), 0.0), svg_length_or(svg_attribute(tag, "cy"), 0.0), r, r);
+	}
+	else if (strcmp(name, "ellipse") == 0) {
+		svg_ellipse(self, svg_length_or(svg_attribute(tag, "cx"), 0.0), svg_length_or(svg_attribute(tag, "cy"), 0.0),
+		            svg_length_or(svg_attribute(tag, "rx"), 0.0), svg_length_or(svg_attribute(tag, "ry"), 0.0));
+	}
+	else {
+		svg_points(self, svg_attribute(tag, "points"), strcmp(name, "polygon") == 0);
+	}
+
+	return true;
+}
+
+static bool svg_container(svg_tag_t *tag)
+{
+	return strcmp(tag->name, "svg") == 0 || strcmp(tag->name, "g") == 0 ||
+		strcmp(tag->name, "a") == 0 || strcmp(tag->name, "switch") == 0;
+}
+
+/**
+ * Handle a start tag: shapes are drawn, containers pass their state on to
+ * their children and the content of anything else, such as definitions,
+ * text or hidden elements, is skipped.
+ */
+static int svg_start_element(svg_parser_t *self, svg_tag_t *tag)
+{
+	if (self->skip_depth > 0) {
+		if (!tag->closed)
+			self->skip_depth += 1;
+		return 0;
+	}
+
+	char buffer[32];
+	const char *display = svg_property(tag, "display", buffer, sizeof(buffer));
+	bool hidden = display != NULL && strncmp(display, "none", 4) == 0;
+
+	svg_state_t state = svg_state(&(self->stack[self->depth]), tag);
+
+	if (!hidden && strcmp(tag->name, "svg") == 0) {
+		state.ctm = svg_matrix_multiply(state.ctm, svg_viewport(tag, !self->root_seen));
+		self->root_seen = true;
+	}
+
+	if (hidden || (!svg_container(tag) && !svg_shape(self, tag, &state))) {
+		if (!tag->closed)
+			self->skip_depth = 1;
+		return 0;
+	}
+
+	if (tag->closed)
+		return 0;
+
+	if (self->depth + 1 >= SVG_DEPTH_MAX) {
+		fprintf(stderr, "SVG elements nested deeper than %d\n", SVG_DEPTH_MAX);
+		return -1;
+	}
+
+	self->depth += 1;
+	self->stack[self->depth] = state;
+
+	return 0;
+}
+
+static void svg_end_element(svg_parser_t *self)
+{
+	if (self->skip_depth > 0)
+		self->skip_depth -= 1;
+	else if (self->depth > 0)
+		self->depth -= 1;
+}
+
+static char *svg_read_file(FILE *svg_file)
+{
+	char *buffer = NULL;
+	size_t length = 0;
+	size_t capacity = 0;
+
+	for (;;) {
+		if (capacity - length < 4096) {
+			capacity = capacity ? 2 * capacity : 65536;
+			buffer = realloc(buffer, capacity + 1);
+		}
+
+		size_t rc = fread(buffer + length, 1, capacity - length, svg_file);
+		if (rc == 0)
+			break;
+		length += rc;
+	}
+
+	buffer[length] = '\0';
+	return buffer;
+}
+
+/**
+ * Read the stroked shapes of an SVG document straight into the vector lists
+ * of a print job, without going through Ghostscript.
+ *
+ * Paths, lines, rectangles, circles, ellipses, polylines and polygons are
+ * cut in their stroke colour, with curves flattened to within SVG_FLATNESS
+ * device units. Transforms and the viewBox of svg elements are applied and
+ * user units are taken as 1/96 in, the document origin being the top left
+ * of the bed. Unstroked shapes, text, images and definitions are ignored.
+ *
+ * @return 0 on success, -1 if the document could not be read.
+ */
+int svg_parse(print_job_t *print_job, FILE *svg_file)
+{
+	char *buffer = svg_read_file(svg_file);
+
+	svg_parser_t *self = calloc(1, sizeof(svg_parser_t));
+	self->print_job = print_job;
+	self->depth = 0;
+	self->skip_depth = 0;
+	self->root_seen = false;
+
+	double scale = print_job->raster->resolution / SVG_UNITS_PER_INCH;
+	self->stack[0] = (svg_state_t){
+		.ctm = svg_matrix_scale(scale, scale),
+		.stroke = false,
+		.red = 0,
+		.green = 0,
+		.blue = 0,
+	};
+
+	int rc = 0;
+	char *cursor = buffer;
+	while (rc == 0 && (cursor = strchr(cursor, '<')) != NULL) {
+		cursor += 1;
+
+		if (strncmp(cursor, "!--", 3) == 0) {
+			cursor = strstr(cursor, "-->");
+		}
+		else if (strncmp(cursor, "![CDATA[", 8) == 0) {
+			cursor = strstr(cursor, "]]>");
+		}
+		else if (*cursor == '!') {
+			// a DOCTYPE may carry an internal subset in brackets
+			char *end = strchr(cursor, '>');
+			char *subset = strchr(cursor, '[');
+			if (end != NULL && subset != NULL && subset < end)
+				end = strstr(subset, "]>");
+			cursor = end;
+		}
+		else if (*cursor == '?') {
+			cursor = strstr(cursor, "?>");
+		}
+		else if (*cursor == '/') {
+			svg_end_element(self);
+			cursor = strchr(cursor, '>');
+		}
+		else {
+			svg_tag_t tag;
+			cursor = svg_parse_tag(cursor, &tag);
+			if (cursor != NULL)
+				rc = svg_start_element(self, &tag);
+		}
+
+		if (cursor == NULL) {
+			fprintf(stderr, "SVG document ends inside markup\n");
+			rc = -1;
+		}
+	}
+
+	if (rc == 0 && !self->root_seen) {
+		fprintf(stderr, "No svg element found in the document\n");
+		rc = -1;
+	}
+
+	if (print_job->debug)
+		printf("SVG vectors: %"PRId32"\n", self->vectors);
+
+	free(self);
+	free(buffer);
+
+	return rc;
+}
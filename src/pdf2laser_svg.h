@@ -0,0 +1,35 @@
+#ifndef __PDF2LASER_SVG_H__
+#define __PDF2LASER_SVG_H__ 1
+
+#include <stdio.h>           // for FILE
+#include "type_print_job.h"  // for print_job_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+// SVG user units (px) per inch
+#define SVG_UNITS_PER_INCH (96.0)
+
+// deepest element nesting followed before giving up on a file
+#define SVG_DEPTH_MAX (256)
+
+// attributes kept per element, any further ones are ignored
+#define SVG_ATTRIBUTES_MAX (64)
+
+// largest distance in device units between a curve and its flattened segments
+#define SVG_FLATNESS (0.5)
+
+// most segments a single curve is flattened into
+#define SVG_SEGMENTS_MAX (4096)
+
+int svg_parse(print_job_t *print_job, FILE *svg_file);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,147 @@
+#include "pdf2laser_trace.h"
+#include <inttypes.h>        // for PRIu32, PRIu64
+#include <stdatomic.h>       // for atomic_load, atomic_load_explicit, atomic_store, atomic_compare_exchange_weak, atomic_exchange, atomic_fetch_add, atomic_bool, atomic_uint, memory_order_relaxed
+#include <stdbool.h>         // for bool, false, true
+#include <stdio.h>           // for fprintf, fclose, fopen, perror, FILE, NULL
+#include <stdlib.h>          // for calloc, free
+#include <unistd.h>          // for getpid
+#include "pdf2laser_util.h"  // for pdf2laser_clock
+
+static atomic_bool trace_enabled = false;
+static double trace_epoch = 0.0;
+
+static _Atomic(trace_buffer_t *) trace_buffers = NULL;
+static atomic_uint trace_thread_count = 0;
+
+static _Thread_local trace_buffer_t *trace_buffer = NULL;
+
+/**
+ * Allocate the calling thread's buffer and link it into the list of buffers
+ * written out by trace_write.
+ */
+static trace_buffer_t *trace_buffer_register(void)
+{
+	trace_buffer_t *buffer = calloc(1, sizeof(trace_buffer_t));
+	if (buffer == NULL)
+		return NULL;
+
+	buffer->thread_id = atomic_fetch_add(&trace_thread_count, 1) + 1;
+
+	buffer->next = atomic_load(&trace_buffers);
+	while (!atomic_compare_exchange_weak(&trace_buffers, &buffer->next, buffer))
+		;
+
+	return buffer;
+}
+
+static void trace_record(const char *name, char phase)
+{
+	if (!atomic_load_explicit(&trace_enabled, memory_order_relaxed))
+		return;
+
+	trace_buffer_t *buffer = trace_buffer;
+	if (buffer == NULL) {
+		buffer = trace_buffer = trace_buffer_register();
+		if (buffer == NULL)
+			return;
+	}
+
+	trace_event_t *event = &(buffer->events[buffer->head]);
+	event->name = name;
+	event->timestamp = (pdf2laser_clock() - trace_epoch) * 1e6;
+	event->phase = phase;
+
+	buffer->head = (buffer->head + 1) % TRACE_BUFFER_EVENTS;
+	if (buffer->count < TRACE_BUFFER_EVENTS)
+		buffer->count += 1;
+	else
+		buffer->dropped += 1;
+}
+
+/**
+ * Start recording events. Until this is called trace_begin and trace_end
+ * only test a flag.
+ */
+int trace_start(void)
+{
+	trace_epoch = pdf2laser_clock();
+	atomic_store(&trace_enabled, true);
+	return 0;
+}
+
+/**
+ * Stop recording and release the buffers of every thread. No thread may be
+ * recording events while this runs.
+ */
+void trace_stop(void)
+{
+	atomic_store(&trace_enabled, false);
+
+	trace_buffer_t *buffer = atomic_exchange(&trace_buffers, NULL);
+	while (buffer != NULL) {
+		trace_buffer_t *next = buffer->next;
+		free(buffer);
+		buffer = next;
+	}
+
+	trace_buffer = NULL;
+}
+
+void trace_begin(const char *name)
+{
+	trace_record(name, 'B');
+}
+
+void trace_end(void)
+{
+	trace_record(NULL, 'E');
+}
+
+/**
+ * Write every recorded event as a Chrome trace event file, which can be
+ * loaded in chrome://tracing or Perfetto.
+ *
+ * @return 0 on success, -1 if the file could not be written.
+ */
+int trace_write(const char *filename)
+{
+	FILE *trace_file = fopen(filename, "w");
+	if (trace_file == NULL) {
+		perror(filename);
+		return -1;
+	}
+
+	int pid = getpid();
+	bool first = true;
+
+	fprintf(trace_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+	for (trace_buffer_t *buffer = atomic_load(&trace_buffers); buffer != NULL; buffer = buffer->next) {
+		fprintf(trace_file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%"PRIu32",\"args\":{\"name\":\"%s\"}}",
+		        first ? "" : ",", pid, buffer->thread_id, (buffer->thread_id == 1) ? "main" : "worker");
+		first = false;
+
+		if (buffer->dropped)
+			fprintf(stderr, "Trace buffer of thread %"PRIu32" wrapped, %"PRIu64" events lost\n", buffer->thread_id, buffer->dropped);
+
+		size_t start = (buffer->count < TRACE_BUFFER_EVENTS) ? 0 : buffer->head;
+		for (size_t index = 0; index < buffer->count; index += 1) {
+			trace_event_t *event = &(buffer->events[(start + index) % TRACE_BUFFER_EVENTS]);
+			if (event->name != NULL)
+				fprintf(trace_file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%"PRIu32"}",
+				        event->name, event->phase, event->timestamp, pid, buffer->thread_id);
+			else
+				fprintf(trace_file, ",\n{\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%"PRIu32"}",
+				        event->phase, event->timestamp, pid, buffer->thread_id);
+		}
+	}
+
+	fprintf(trace_file, "\n]}\n");
+
+	if (fclose(trace_file)) {
+		perror(filename);
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef __PDF2LASER_TRACE_H__
+#define __PDF2LASER_TRACE_H__ 1
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint32_t, uint64_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/** Number of events kept per thread, older events are overwritten. */
+#define TRACE_BUFFER_EVENTS (65536)
+
+typedef struct trace_event trace_event_t;
+struct trace_event {
+	const char *name;  // NULL for end events
+	double timestamp;  // microseconds since the recorder was started
+	char phase;        // 'B' or 'E' as in the Chrome trace event format
+};
+
+typedef struct trace_buffer trace_buffer_t;
+struct trace_buffer {
+	uint32_t thread_id;
+	size_t head;       // index the next event is written to
+	size_t count;      // number of valid events, at most TRACE_BUFFER_EVENTS
+	uint64_t dropped;  // events overwritten once the buffer wrapped
+	trace_buffer_t *next;
+	trace_event_t events[TRACE_BUFFER_EVENTS];
+};
+
+int trace_start(void);
+void trace_stop(void);
+
+void trace_begin(const char *name);
+void trace_end(void);
+
+int trace_write(const char *filename);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -8,6 +8,7 @@
 #include <sys/sendfile.h>  // for sendfile
 #endif
 #include <sys/stat.h>      // for fstat, stat
+#include <time.h>          // for clock_gettime, timespec, CLOCK_MONOTONIC
 #include <unistd.h>        // for lseek, ssize_t
 
 
@@ -76,3 +77,13 @@ char *pdf2laser_format_string(char *template, ...)
 
 	return s;
 }
+
+/**
+ * Seconds elapsed on the monotonic clock, for measuring durations.
+ */
+double pdf2laser_clock(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
@@ -13,6 +13,7 @@ extern "C" {
 
 int pdf2laser_sendfile(int out_fd, int in_fd);
 char *pdf2laser_format_string(char *template, ...);
+double pdf2laser_clock(void);
 
 #ifdef __cplusplus
 };
@@ -0,0 +1,628 @@
+#include "pdf2laser_workload.h"
+#include <inttypes.h>             // for PRId32
+#include <math.h>                 // for ceil, cos, lround, sin, sqrt, M_PI
+#include <stdbool.h>              // for bool, false, true
+#include <stddef.h>               // for size_t, NULL
+#include <stdint.h>               // for int32_t, uint8_t, uint32_t, uint64_t, int64_t, UINT64_C
+#include <stdio.h>                // for fprintf, fwrite, fclose, ferror, fread, ftell, rewind, tmpfile, FILE, perror, BUFSIZ
+#include <stdlib.h>               // for calloc, free
+#include <string.h>               // for memset, strcmp
+#include "pdf2laser_generator.h"  // for BITMAP_HEADER_NBYTES
+#include "type_raster.h"          // for raster_mode, RASTER_MODE_COLOR, RASTER_MODE_GREY_SCALE
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/** A pixel of synthetic content, 255 in every channel is white. */
+typedef struct workload_pixel workload_pixel_t;
+struct workload_pixel {
+	uint8_t red;
+	uint8_t green;
+	uint8_t blue;
+};
+
+/** Vectors being written, either as a vector file or as pdf path operators. */
+typedef struct workload_stream workload_stream_t;
+struct workload_stream {
+	workload_t *workload;
+	FILE *file;
+	bool pdf;
+	double scale;      // output units per device unit
+	double top;        // pdf y of the top of the field
+	uint64_t state;    // random number generator state
+	size_t segments;   // segments written so far
+	int64_t color;     // colour of the current path, -1 before the first
+	bool open;         // pdf path not stroked yet
+};
+
+static const char *workload_shape_names[WORKLOAD_SHAPES_LENGTH] = {
+	"random", "grid", "circles", "text",
+};
+
+static const char *workload_fill_names[WORKLOAD_FILLS_LENGTH] = {
+	"blank", "text", "photo", "noise",
+};
+
+/** The first colours handed out, after these they are spread over the cube. */
+static const workload_pixel_t workload_palette[] = {
+	{0, 0, 0}, {255, 0, 0}, {0, 0, 255}, {0, 255, 0},
+	{255, 0, 255}, {0, 255, 255}, {255, 255, 0}, {128, 128, 128},
+};
+
+workload_t *workload_create(uint64_t seed)
+{
+	workload_t *self = calloc(1, sizeof(workload_t));
+
+	self->seed = seed;
+	self->shape = WORKLOAD_SHAPE_RANDOM;
+	self->segments = 1000;
+	self->connectivity = 0.0;
+	self->colors = 1;
+	self->field = WORKLOAD_FIELD;
+	self->fill = WORKLOAD_FILL_BLANK;
+	self->density = 0.5;
+	self->width = 4.0;
+	self->height = 3.0;
+
+	return self;
+}
+
+workload_t *workload_destroy(workload_t *self)
+{
+	free(self);
+	return NULL;
+}
+
+const char *workload_shape_to_string(workload_shape shape)
+{
+	return (shape < WORKLOAD_SHAPES_LENGTH) ? workload_shape_names[shape] : NULL;
+}
+
+int workload_shape_from_string(const char *name, workload_shape *shape)
+{
+	for (int index = 0; index < WORKLOAD_SHAPES_LENGTH; index += 1) {
+		if (!strcmp(name, workload_shape_names[index])) {
+			*shape = index;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+const char *workload_fill_to_string(workload_fill fill)
+{
+	return (fill < WORKLOAD_FILLS_LENGTH) ? workload_fill_names[fill] : NULL;
+}
+
+int workload_fill_from_string(const char *name, workload_fill *fill)
+{
+	for (int index = 0; index < WORKLOAD_FILLS_LENGTH; index += 1) {
+		if (!strcmp(name, workload_fill_names[index])) {
+			*fill = index;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Colour of the given vector colour index. Index 0 is black so that a
+ * single colour workload matches the usual vector configuration.
+ */
+void workload_color(uint32_t index, int32_t *red, int32_t *green, int32_t *blue)
+{
+	size_t named = sizeof(workload_palette) / sizeof(workload_palette[0]);
+
+	if (index < named) {
+		*red = workload_palette[index].red;
+		*green = workload_palette[index].green;
+		*blue = workload_palette[index].blue;
+	}
+	else {
+		*red = (index * 37) % 256;
+		*green = (index * 101) % 256;
+		*blue = (index * 211) % 256;
+	}
+}
+
+/**
+ * xorshift64* generator, so that workloads are the same on every platform.
+ */
+static uint64_t workload_random(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * UINT64_C(2685821657736338717);
+}
+
+static int32_t workload_random_range(workload_stream_t *stream, int32_t limit)
+{
+	return (int32_t)(workload_random(&(stream->state)) % (uint64_t)limit);
+}
+
+/** A uniform double in [0, 1). */
+static double workload_random_unit(uint64_t *state)
+{
+	return (workload_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static bool workload_full(workload_stream_t *stream)
+{
+	return stream->segments >= stream->workload->segments;
+}
+
+static void workload_stroke(workload_stream_t *stream)
+{
+	if (stream->pdf && stream->open)
+		fprintf(stream->file, "S\n");
+	stream->open = false;
+}
+
+/**
+ * Start a new path, switching to the colour drawn for it when there is more
+ * than one.
+ */
+static void workload_move(workload_stream_t *stream, int32_t x, int32_t y)
+{
+	uint32_t colors = stream->workload->colors;
+	int64_t color = (colors > 1) ? (int64_t)(workload_random(&(stream->state)) % colors) : 0;
+
+	if (color != stream->color) {
+		int32_t red, green, blue;
+		workload_color(color, &red, &green, &blue);
+		workload_stroke(stream);
+
+		// Note: Colours are stored as blue, green, red in the vector file
+		if (stream->pdf)
+			fprintf(stream->file, "%.4f %.4f %.4f RG\n", red / 255.0, green / 255.0, blue / 255.0);
+		else
+			fprintf(stream->file, "P,%"PRId32",%"PRId32",%"PRId32"\n", blue, green, red);
+		stream->color = color;
+	}
+
+	if (stream->pdf)
+		fprintf(stream->file, "%.3f %.3f m\n", x * stream->scale, stream->top - y * stream->scale);
+	else
+		fprintf(stream->file, "M%"PRId32",%"PRId32"\n", x, y);
+	stream->open = true;
+}
+
+static void workload_line(workload_stream_t *stream, int32_t x, int32_t y)
+{
+	if (stream->pdf)
+		fprintf(stream->file, "%.3f %.3f l\n", x * stream->scale, stream->top - y * stream->scale);
+	else
+		fprintf(stream->file, "L%"PRId32",%"PRId32"\n", x, y);
+	stream->segments += 1;
+}
+
+static void workload_close(workload_stream_t *stream)
+{
+	fprintf(stream->file, stream->pdf ? "h\n" : "C\n");
+	stream->segments += 1;
+}
+
+/**
+ * Segments scattered over the whole field. With no connectivity none of them
+ * touch, the worst case for the optimizer; otherwise each one continues the
+ * last with the given chance, forming random walks.
+ */
+static void workload_generate_random(workload_stream_t *stream)
+{
+	int32_t field = stream->workload->field;
+	double connectivity = stream->workload->connectivity;
+
+	while (!workload_full(stream)) {
+		bool connected = (stream->segments > 0) && (connectivity > 0.0)
+			&& (workload_random_unit(&(stream->state)) < connectivity);
+
+		if (!connected) {
+			int32_t x = workload_random_range(stream, field);
+			int32_t y = workload_random_range(stream, field);
+			workload_move(stream, x, y);
+		}
+
+		int32_t x = workload_random_range(stream, field);
+		int32_t y = workload_random_range(stream, field);
+		workload_line(stream, x, y);
+	}
+}
+
+/**
+ * A square mesh drawn as rows and then columns of unit segments, so every
+ * segment shares its end points with others.
+ */
+static void workload_generate_grid(workload_stream_t *stream)
+{
+	int32_t cells = (int32_t)ceil(sqrt(stream->workload->segments / 2.0));
+	int32_t step = stream->workload->field / cells;
+
+	for (int32_t row = 0; row <= cells && !workload_full(stream); row += 1) {
+		workload_move(stream, 0, row * step);
+		for (int32_t column = 0; column < cells && !workload_full(stream); column += 1)
+			workload_line(stream, (column + 1) * step, row * step);
+	}
+
+	for (int32_t column = 0; column <= cells && !workload_full(stream); column += 1) {
+		workload_move(stream, column * step, 0);
+		for (int32_t row = 0; row < cells && !workload_full(stream); row += 1)
+			workload_line(stream, column * step, (row + 1) * step);
+	}
+}
+
+/**
+ * Groups of 32 concentric circles laid out on a grid, each circle a closed
+ * polygon.
+ */
+static void workload_generate_circles(workload_stream_t *stream)
+{
+	size_t circles = (stream->workload->segments + WORKLOAD_CIRCLE_SIDES - 1) / WORKLOAD_CIRCLE_SIDES;
+	size_t groups = (circles + 31) / 32;
+	int32_t columns = (int32_t)ceil(sqrt(groups));
+	int32_t cell = stream->workload->field / columns;
+	double ring = cell / 2.0 / 33.0;
+
+	for (size_t circle = 0; !workload_full(stream); circle += 1) {
+		size_t group = circle / 32;
+		double center_x = (group % columns + 0.5) * cell;
+		double center_y = (group / columns + 0.5) * cell;
+		double radius = (circle % 32 + 1) * ring;
+
+		workload_move(stream, lround(center_x + radius), lround(center_y));
+		for (int32_t side = 1; side < WORKLOAD_CIRCLE_SIDES && !workload_full(stream); side += 1) {
+			double angle = 2.0 * M_PI * side / WORKLOAD_CIRCLE_SIDES;
+			workload_line(stream, lround(center_x + radius * cos(angle)), lround(center_y + radius * sin(angle)));
+		}
+		if (!workload_full(stream))
+			workload_close(stream);
+	}
+}
+
+/**
+ * Lines of small closed outlines, some with a counter inside, with the odd
+ * gap between words. Close to what converted text looks like.
+ */
+static void workload_generate_text(workload_stream_t *stream)
+{
+	const int32_t columns = 80;
+	size_t glyphs = stream->workload->segments / 10 + 1;
+	int32_t lines = (int32_t)((glyphs + columns - 1) / columns);
+	int32_t width = stream->workload->field / columns;
+	int32_t height = stream->workload->field / lines;
+	if (height > 2 * width)
+		height = 2 * width;
+
+	for (int32_t glyph = 0; !workload_full(stream); glyph += 1) {
+		if (workload_random_range(stream, 100) < 15)
+			continue;
+
+		double center_x = (glyph % columns + 0.5) * width;
+		double center_y = (glyph / columns % lines + 0.5) * height;
+		int32_t contours = (workload_random_range(stream, 100) < 40) ? 2 : 1;
+
+		for (int32_t contour = 0; contour < contours && !workload_full(stream); contour += 1) {
+			double scale = (contour == 0) ? 0.4 : 0.15;
+			int32_t sides = 4 + workload_random_range(stream, 9);
+
+			for (int32_t side = 0; side < sides && !workload_full(stream); side += 1) {
+				double angle = 2.0 * M_PI * side / sides;
+				double jitter = 0.8 + workload_random_range(stream, 40) / 100.0;
+				int32_t x = lround(center_x + jitter * scale * width * cos(angle));
+				int32_t y = lround(center_y + jitter * scale * height * sin(angle));
+				if (side == 0)
+					workload_move(stream, x, y);
+				else
+					workload_line(stream, x, y);
+			}
+			if (!workload_full(stream))
+				workload_close(stream);
+		}
+	}
+}
+
+static void workload_generate(workload_stream_t *stream)
+{
+	// the grid and circles size their cells from the count
+	if (stream->workload->segments == 0)
+		return;
+
+	switch (stream->workload->shape) {
+	case WORKLOAD_SHAPE_GRID:
+		workload_generate_grid(stream);
+		break;
+	case WORKLOAD_SHAPE_CIRCLES:
+		workload_generate_circles(stream);
+		break;
+	case WORKLOAD_SHAPE_TEXT:
+		workload_generate_text(stream);
+		break;
+	default:
+		workload_generate_random(stream);
+	}
+
+	workload_stroke(stream);
+}
+
+static void workload_stream_init(workload_stream_t *stream, workload_t *self, FILE *file)
+{
+	*stream = (workload_stream_t){
+		.workload = self,
+		.file = file,
+		.pdf = false,
+		.scale = 1.0,
+		.top = 0.0,
+		.state = self->seed ? self->seed : 1,
+		.segments = 0,
+		.color = -1,
+		.open = false,
+	};
+}
+
+/**
+ * Write the vectors in the format the ghostscript vector device produces,
+ * ready for vectors_parse.
+ *
+ * @return The number of segments written.
+ */
+size_t workload_write_vectors(workload_t *self, FILE *file)
+{
+	workload_stream_t stream;
+	workload_stream_init(&stream, self, file);
+
+	workload_generate(&stream);
+	fprintf(file, "X\n");
+
+	return stream.segments;
+}
+
+static workload_pixel_t workload_grey(uint8_t level)
+{
+	return (workload_pixel_t){ level, level, level };
+}
+
+/**
+ * Paragraphs of block letters in lines of 60, mostly white with short runs
+ * of black.
+ */
+static workload_pixel_t workload_ink_text(double x, double y)
+{
+	const double line_pitch = 0.25;
+	const double glyph_pitch = 0.08;
+	const double stroke = 0.012;
+
+	uint32_t line = (uint32_t)(y / line_pitch);
+	uint32_t column = (uint32_t)(x / glyph_pitch);
+	double glyph_x = x - column * glyph_pitch;
+	double glyph_y = y - line * line_pitch;
+
+	if (line % 4 == 3 || column % 80 >= 60 || glyph_x > 0.06 || glyph_y > 0.1)
+		return workload_grey(255);
+
+	// the strokes of each letter follow from its position
+	uint32_t shape = (line * 7919 + column * 104729) % 97;
+	if (shape < 15)
+		return workload_grey(255);
+
+	bool ink = (glyph_x < stroke)
+		|| ((shape & 1) && glyph_y < stroke)
+		|| ((shape & 2) && glyph_y > 0.05 - stroke / 2 && glyph_y < 0.05 + stroke / 2)
+		|| ((shape & 4) && glyph_x > 0.06 - stroke)
+		|| ((shape & 8) && glyph_y > 0.1 - stroke);
+
+	return workload_grey(ink ? 0 : 255);
+}
+
+/**
+ * Smooth colour gradients over the whole page, with no white at all.
+ */
+static workload_pixel_t workload_ink_photo(double x, double y)
+{
+	return (workload_pixel_t){
+		.red = (uint8_t)(120 + 100 * sin(5.0 * x + 3.0 * y)),
+		.green = (uint8_t)(120 + 100 * sin(2.0 * x - 7.0 * y + 1.0)),
+		.blue = (uint8_t)(120 + 100 * cos(4.0 * x * y / 3.0)),
+	};
+}
+
+/**
+ * Colour of the fill at x and y, in inches from the top left of the page.
+ * Noise draws from the generator, so pixels must be asked for in order.
+ */
+static workload_pixel_t workload_ink(workload_t *self, double x, double y, uint64_t *state)
+{
+	switch (self->fill) {
+	case WORKLOAD_FILL_TEXT:
+		return workload_ink_text(x, y);
+	case WORKLOAD_FILL_PHOTO:
+		return workload_ink_photo(x, y);
+	case WORKLOAD_FILL_NOISE:
+		return workload_grey((workload_random_unit(state) >= 1.0 - self->density) ? 0 : 255);
+	default:
+		return workload_grey(255);
+	}
+}
+
+static void workload_put32(uint8_t *position, uint32_t value)
+{
+	for (int index = 0; index < 4; index += 1)
+		position[index] = (value >> (8 * index)) & 0xff;
+}
+
+/**
+ * Write the fill as a bitmap in the layout ghostscript produces for the
+ * mode: 1 bit mono, 8 bit grey or 24 bit colour, bottom row first.
+ *
+ * @return The number of bytes of pixel data, or 0 on failure.
+ */
+size_t workload_write_bitmap(workload_t *self, FILE *file, raster_mode mode, uint32_t dpi)
+{
+	int32_t pixels_x = (int32_t)(self->width * dpi);
+	int32_t pixels_y = (int32_t)(self->height * dpi);
+
+	uint32_t bits = (mode == RASTER_MODE_COLOR) ? 24 : (mode == RASTER_MODE_GREY_SCALE) ? 8 : 1;
+	uint32_t palette = (bits == 24) ? 0 : (1 << bits);
+	size_t row_bytes = ((size_t)pixels_x * bits + 31) / 32 * 4;
+	uint32_t offset = BITMAP_HEADER_NBYTES + 4 * palette;
+
+	uint8_t header[BITMAP_HEADER_NBYTES] = { 'B', 'M' };
+	workload_put32(header + 2, offset + row_bytes * pixels_y);
+	workload_put32(header + 10, offset);
+	workload_put32(header + 14, 40);
+	workload_put32(header + 18, pixels_x);
+	workload_put32(header + 22, pixels_y);
+	header[26] = 1;
+	header[28] = bits;
+	workload_put32(header + 34, row_bytes * pixels_y);
+	workload_put32(header + 38, (uint32_t)(dpi * 39.3701));
+	workload_put32(header + 42, (uint32_t)(dpi * 39.3701));
+	workload_put32(header + 46, palette);
+	fwrite(header, 1, sizeof(header), file);
+
+	// mono maps index 1 to black so that set bits are burnt
+	for (uint32_t index = 0; index < palette; index += 1) {
+		uint8_t level = (bits == 1) ? (index ? 0 : 255) : index;
+		uint8_t entry[4] = { level, level, level, 0 };
+		fwrite(entry, 1, sizeof(entry), file);
+	}
+
+	uint8_t *row = calloc(row_bytes, 1);
+	uint64_t state = self->seed ? self->seed : 1;
+
+	for (int32_t y = pixels_y - 1; y >= 0; y -= 1) {
+		memset(row, 0, row_bytes);
+		for (int32_t x = 0; x < pixels_x; x += 1) {
+			workload_pixel_t pixel = workload_ink(self, (double)x / dpi, (double)y / dpi, &state);
+			uint8_t level = (pixel.red * 30 + pixel.green * 59 + pixel.blue * 11) / 100;
+
+			switch (mode) {
+			case RASTER_MODE_COLOR:
+				row[3 * x] = pixel.blue;
+				row[3 * x + 1] = pixel.green;
+				row[3 * x + 2] = pixel.red;
+				break;
+			case RASTER_MODE_GREY_SCALE:
+				row[x] = level;
+				break;
+			default:
+				if (level < 128)
+					row[x / 8] |= 0x80 >> (x % 8);
+			}
+		}
+
+		if (fwrite(row, 1, row_bytes, file) != row_bytes) {
+			perror("Unable to write bitmap");
+			free(row);
+			return 0;
+		}
+	}
+
+	free(row);
+
+	return row_bytes * pixels_y;
+}
+
+/**
+ * Write a single page pdf holding the fill as an RGB image at dpi, unless
+ * it is blank, with the vectors stroked as hairlines on top. The field is
+ * scaled to the shorter side of the page.
+ *
+ * Offsets are counted rather than asked for so the file may be a pipe.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int workload_write_pdf(workload_t *self, FILE *file, uint32_t dpi)
+{
+	double page_width = self->width * 72.0;
+	double page_height = self->height * 72.0;
+	bool image = (self->fill != WORKLOAD_FILL_BLANK) && (dpi > 0);
+	int32_t pixels_x = (int32_t)(self->width * dpi);
+	int32_t pixels_y = (int32_t)(self->height * dpi);
+
+	FILE *content_file = tmpfile();
+	if (content_file == NULL) {
+		perror("Unable to create temporary file");
+		return -1;
+	}
+
+	if (image)
+		fprintf(content_file, "q %.2f 0 0 %.2f 0 0 cm /Im1 Do Q\n", page_width, page_height);
+
+	if (self->segments > 0) {
+		workload_stream_t stream;
+		workload_stream_init(&stream, self, content_file);
+		stream.pdf = true;
+		stream.scale = ((page_width < page_height) ? page_width : page_height) / self->field;
+		stream.top = page_height;
+
+		fprintf(content_file, "0.072 w\n");
+		workload_generate(&stream);
+	}
+
+	long content_length = ftell(content_file);
+	rewind(content_file);
+
+	long offsets[5];
+	int objects = image ? 5 : 4;
+	long offset = 0;
+
+	offset += fprintf(file, "%%PDF-1.4\n");
+
+	offsets[0] = offset;
+	offset += fprintf(file, "1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+
+	offsets[1] = offset;
+	offset += fprintf(file, "2 0 obj\n<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n");
+
+	offsets[2] = offset;
+	offset += fprintf(file, "3 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 %.2f %.2f] /Resources << %s >> /Contents 4 0 R >>\nendobj\n",
+		page_width, page_height, image ? "/XObject << /Im1 5 0 R >>" : "");
+
+	offsets[3] = offset;
+	offset += fprintf(file, "4 0 obj\n<< /Length %ld >>\nstream\n", content_length);
+	char buffer[BUFSIZ];
+	size_t length;
+	while ((length = fread(buffer, 1, sizeof(buffer), content_file)) > 0)
+		offset += fwrite(buffer, 1, length, file);
+	offset += fprintf(file, "\nendstream\nendobj\n");
+	fclose(content_file);
+
+	if (image) {
+		size_t row_bytes = 3 * (size_t)pixels_x;
+		uint8_t *row = calloc(row_bytes, 1);
+		uint64_t state = self->seed ? self->seed : 1;
+
+		offsets[4] = offset;
+		offset += fprintf(file, "5 0 obj\n<< /Type /XObject /Subtype /Image /Width %"PRId32" /Height %"PRId32" /ColorSpace /DeviceRGB /BitsPerComponent 8 /Length %zu >>\nstream\n",
+			pixels_x, pixels_y, row_bytes * pixels_y);
+
+		// pdf images run from the top row down, bitmaps from the bottom up
+		for (int32_t y = 0; y < pixels_y; y += 1) {
+			for (int32_t x = 0; x < pixels_x; x += 1) {
+				workload_pixel_t pixel = workload_ink(self, (double)x / dpi, (double)y / dpi, &state);
+				row[3 * x] = pixel.red;
+				row[3 * x + 1] = pixel.green;
+				row[3 * x + 2] = pixel.blue;
+			}
+			offset += fwrite(row, 1, row_bytes, file);
+		}
+		free(row);
+
+		offset += fprintf(file, "\nendstream\nendobj\n");
+	}
+
+	fprintf(file, "xref\n0 %d\n0000000000 65535 f \n", objects + 1);
+	for (int index = 0; index < objects; index += 1)
+		fprintf(file, "%010ld 00000 n \n", offsets[index]);
+	fprintf(file, "trailer\n<< /Size %d /Root 1 0 R >>\nstartxref\n%ld\n%%%%EOF\n", objects + 1, offset);
+
+	if (ferror(file)) {
+		perror("Unable to write pdf");
+		return -1;
+	}
+
+	return 0;
+}
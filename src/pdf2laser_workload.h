@@ -0,0 +1,78 @@
+#ifndef __PDF2LASER_WORKLOAD_H__
+#define __PDF2LASER_WORKLOAD_H__ 1
+
+#include <stddef.h>         // for size_t
+#include <stdint.h>         // for int32_t, uint32_t, uint64_t
+#include <stdio.h>          // for FILE
+#include "type_raster.h"    // for raster_mode
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/** Side of the square vectors are drawn in unless changed, in device units. */
+#define WORKLOAD_FIELD (20000)
+
+/** Number of segments used to draw each circle. */
+#define WORKLOAD_CIRCLE_SIDES (64)
+
+typedef enum {
+	WORKLOAD_SHAPE_RANDOM,   // segments scattered over the field
+	WORKLOAD_SHAPE_GRID,     // a mesh where every segment shares its ends
+	WORKLOAD_SHAPE_CIRCLES,  // groups of concentric closed polygons
+	WORKLOAD_SHAPE_TEXT,     // lines of small outlines, like converted text
+	WORKLOAD_SHAPES_LENGTH,
+} workload_shape;
+
+typedef enum {
+	WORKLOAD_FILL_BLANK,     // white everywhere
+	WORKLOAD_FILL_TEXT,      // block letters, mostly white with short runs
+	WORKLOAD_FILL_PHOTO,     // smooth colour gradients without any white
+	WORKLOAD_FILL_NOISE,     // pixels inked at random
+	WORKLOAD_FILLS_LENGTH,
+} workload_fill;
+
+/**
+ * Parameters of a synthetic job. The same parameters and seed always give
+ * the same output, on every platform.
+ */
+typedef struct workload workload_t;
+struct workload {
+	uint64_t seed;
+
+	// vectors
+	workload_shape shape;
+	size_t segments;        // number of segments to draw
+	double connectivity;    // chance a random segment starts where the last ended
+	uint32_t colors;        // number of vector colours, assigned per path
+	int32_t field;          // side of the square drawn in, in device units
+
+	// bitmaps
+	workload_fill fill;
+	double density;         // share of pixels inked by the noise fill
+	double width;           // page size in inches
+	double height;
+};
+
+workload_t *workload_create(uint64_t seed);
+workload_t *workload_destroy(workload_t *self);
+
+const char *workload_shape_to_string(workload_shape shape);
+int workload_shape_from_string(const char *name, workload_shape *shape);
+const char *workload_fill_to_string(workload_fill fill);
+int workload_fill_from_string(const char *name, workload_fill *fill);
+
+void workload_color(uint32_t index, int32_t *red, int32_t *green, int32_t *blue);
+
+size_t workload_write_vectors(workload_t *self, FILE *file);
+size_t workload_write_bitmap(workload_t *self, FILE *file, raster_mode mode, uint32_t dpi);
+int workload_write_pdf(workload_t *self, FILE *file, uint32_t dpi);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,119 @@
+#include "type_calibration.h"
+#include <inttypes.h>  // for PRId32
+#include <math.h>      // for lround
+#include <stdio.h>     // for snprintf
+#include <stdlib.h>    // for calloc, free, strtol, NULL
+#include <string.h>    // for strchr, strlen
+
+calibration_t *calibration_create(void)
+{
+	calibration_t *calibration = calloc(1, sizeof(calibration_t));
+
+	calibration->powers = NULL;
+	calibration->powers_count = 0;
+	calibration->speeds = NULL;
+	calibration->speeds_count = 0;
+	calibration->frequencies = NULL;
+	calibration->frequencies_count = 0;
+
+	calibration_parse_axis(CALIBRATION_AXIS_DEFAULT, &calibration->powers, &calibration->powers_count);
+	calibration_parse_axis(CALIBRATION_AXIS_DEFAULT, &calibration->speeds, &calibration->speeds_count);
+
+	return calibration;
+}
+
+calibration_t *calibration_destroy(calibration_t *self)
+{
+	if (self == NULL)
+		return NULL;
+
+	free(self->powers);
+	free(self->speeds);
+	free(self->frequencies);
+	free(self);
+
+	return NULL;
+}
+
+/**
+ * Write the values of an axis separated by spaces, or "job" for an empty
+ * axis, returning the length written as snprintf does.
+ */
+static size_t calibration_axis_to_string(char *s, size_t s_len, int32_t *values, size_t count)
+{
+	if (count == 0)
+		return snprintf(s, s_len, " job");
+
+	size_t length = 0;
+	for (size_t index = 0; index < count; index += 1)
+		length += snprintf(s ? s + length : NULL, s ? s_len - length : 0, " %"PRId32, values[index]);
+
+	return length;
+}
+
+char *calibration_to_string(calibration_t *self)
+{
+	const char *labels[3] = {"Powers:", "\nSpeeds:", "\nFrequencies:"};
+	int32_t *values[3] = {self->powers, self->speeds, self->frequencies};
+	size_t counts[3] = {self->powers_count, self->speeds_count, self->frequencies_count};
+
+	size_t s_len = 1;
+	for (size_t axis = 0; axis < 3; axis += 1)
+		s_len += strlen(labels[axis]) + calibration_axis_to_string(NULL, 0, values[axis], counts[axis]);
+
+	char *s = calloc(s_len, sizeof(char));
+	size_t length = 0;
+	for (size_t axis = 0; axis < 3; axis += 1) {
+		length += snprintf(s + length, s_len - length, "%s", labels[axis]);
+		length += calibration_axis_to_string(s + length, s_len - length, values[axis], counts[axis]);
+	}
+
+	return s;
+}
+
+/**
+ * Parse the values of an axis, given either as a comma separated list such
+ * as "10,20,40" or as FIRST:LAST:COUNT, COUNT values evenly spread from FIRST
+ * to LAST. The previous values of the axis are replaced.
+ *
+ * @return 0 on success, -1 if the text is invalid, leaving the axis as it was.
+ */
+int calibration_parse_axis(const char *text, int32_t **values, size_t *count)
+{
+	int32_t *parsed = calloc(CALIBRATION_AXIS_MAX, sizeof(int32_t));
+	size_t parsed_count = 0;
+
+	char *end;
+	if (strchr(text, ':') != NULL) {
+		long first = strtol(text, &end, 10);
+		long last = (*end == ':') ? strtol(end + 1, &end, 10) : 0;
+		long steps = (*end == ':') ? strtol(end + 1, &end, 10) : 0;
+		if (*end != '\0' || steps < 1 || steps > CALIBRATION_AXIS_MAX) {
+			free(parsed);
+			return -1;
+		}
+
+		for (long step = 0; step < steps; step += 1)
+			parsed[step] = (steps == 1) ? first : first + lround((double)(last - first) * step / (steps - 1));
+		parsed_count = steps;
+	}
+	else {
+		const char *position = text;
+		do {
+			long value = strtol(position, &end, 10);
+			if (end == position || (*end != ',' && *end != '\0') || parsed_count == CALIBRATION_AXIS_MAX) {
+				free(parsed);
+				return -1;
+			}
+			parsed[parsed_count] = value;
+			parsed_count += 1;
+			position = end + 1;
+		} while (*end == ',');
+	}
+
+	free(*values);
+	*values = parsed;
+	*count = parsed_count;
+
+	return 0;
+}
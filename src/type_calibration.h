@@ -0,0 +1,46 @@
+#ifndef __PDF2LASER_TYPE_CALIBRATION_H__
+#define __PDF2LASER_TYPE_CALIBRATION_H__ 1
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for int32_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+// most values an axis of the card may step through
+#define CALIBRATION_AXIS_MAX (100)
+
+// powers and speeds tried when the command does not give them, in percent
+#define CALIBRATION_AXIS_DEFAULT "10:100:10"
+
+/**
+ * The settings a calibration card steps through: one column per power, one
+ * row per speed and one block of cells per frequency. A card without
+ * frequencies is cut at the frequency of the job.
+ */
+typedef struct calibration calibration_t;
+struct calibration {
+	int32_t *powers;       // in percent
+	size_t powers_count;
+	int32_t *speeds;       // in percent
+	size_t speeds_count;
+	int32_t *frequencies;  // in hertz
+	size_t frequencies_count;
+};
+
+calibration_t *calibration_create(void);
+calibration_t *calibration_destroy(calibration_t *self);
+
+char *calibration_to_string(calibration_t *self);
+
+int calibration_parse_axis(const char *text, int32_t **values, size_t *count);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,75 @@
+#include "type_estimate.h"
+#include <inttypes.h>  // for PRId32
+#include <stdbool.h>   // for bool
+#include <stdio.h>     // for snprintf
+#include <stdlib.h>    // for calloc, free, realloc, NULL
+
+estimate_t *estimate_create(void)
+{
+	estimate_t *estimate = calloc(1, sizeof(estimate_t));
+
+	estimate->rows = NULL;
+	estimate->rows_length = 0;
+	estimate->rows_capacity = 0;
+
+	return estimate;
+}
+
+estimate_t *estimate_destroy(estimate_t *self)
+{
+	if (self == NULL)
+		return NULL;
+
+	free(self->rows);
+	free(self);
+
+	return NULL;
+}
+
+/**
+ * Record a raster row. Does nothing when self is NULL so that the raster
+ * generator need not check whether an estimate was requested.
+ */
+void estimate_add_row(estimate_t *self, int32_t y, int32_t left, int32_t right, bool reverse)
+{
+	if (self == NULL)
+		return;
+
+	if (self->rows_length == self->rows_capacity) {
+		self->rows_capacity = self->rows_capacity ? 2 * self->rows_capacity : 1024;
+		self->rows = realloc(self->rows, self->rows_capacity * sizeof(estimate_row_t));
+	}
+
+	self->rows[self->rows_length] = (estimate_row_t){ .y = y, .left = left, .right = right, .reverse = reverse };
+	self->rows_length += 1;
+}
+
+char *estimate_breakdown_to_string(estimate_breakdown_t *self)
+{
+	static char *template =
+		"Estimate:\n"
+		"%-10s %10s %12s\n"
+		"%-10s %10"PRId32" %12.1f\n"
+		"%-10s %10"PRId32" %12.1f\n"
+		"%-10s %10"PRId32" %12.1f\n"
+		"%-10s %10s %12.1f (%d:%02d:%02d)";
+
+	int32_t total = (int32_t)(self->total_seconds + 0.5);
+	int hours = total / 3600;
+	int minutes = total / 60 % 60;
+	int seconds = total % 60;
+
+	size_t s_len = 1 + snprintf(NULL, 0, template, "Motion", "Count", "Seconds",
+	                            "Raster", self->raster_rows, self->raster_seconds,
+	                            "Vector", self->cuts, self->vector_seconds,
+	                            "Transit", self->pen_ups, self->transit_seconds,
+	                            "Total", "", self->total_seconds, hours, minutes, seconds);
+
+	char *s = calloc(s_len, sizeof(char));
+	snprintf(s, s_len, template, "Motion", "Count", "Seconds",
+	         "Raster", self->raster_rows, self->raster_seconds,
+	         "Vector", self->cuts, self->vector_seconds,
+	         "Transit", self->pen_ups, self->transit_seconds,
+	         "Total", "", self->total_seconds, hours, minutes, seconds);
+	return s;
+}
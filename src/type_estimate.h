@@ -0,0 +1,59 @@
+#ifndef __PDF2LASER_TYPE_ESTIMATE_H__
+#define __PDF2LASER_TYPE_ESTIMATE_H__ 1
+
+#include <stdbool.h>  // for bool
+#include <stddef.h>   // for size_t
+#include <stdint.h>   // for int32_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/** A raster row as sent to the printer, in pixels. */
+typedef struct estimate_row estimate_row_t;
+struct estimate_row {
+	int32_t y;
+	int32_t left;
+	int32_t right;  // one past the last inked pixel
+	bool reverse;   // engraved from right to left
+};
+
+/**
+ * What a job asks of the machine, kept as it is generated so that the
+ * duration can be worked out for any machine afterwards. Vectors are read
+ * from the vector lists of the print job and need not be recorded.
+ */
+typedef struct estimate estimate_t;
+struct estimate {
+	estimate_row_t *rows;  // every row of every raster pass in order
+	size_t rows_length;
+	size_t rows_capacity;
+};
+
+/** Duration of a job on one machine, broken down by the kind of motion. */
+typedef struct estimate_breakdown estimate_breakdown_t;
+struct estimate_breakdown {
+	int32_t raster_rows;
+	double raster_seconds;   // engraving rows and stepping between them
+	int32_t cuts;
+	double vector_seconds;   // cutting with the laser on
+	int32_t pen_ups;
+	double transit_seconds;  // moving between cuts with the laser off
+	double total_seconds;
+};
+
+estimate_t *estimate_create(void);
+estimate_t *estimate_destroy(estimate_t *self);
+
+void estimate_add_row(estimate_t *self, int32_t y, int32_t left, int32_t right, bool reverse);
+
+char *estimate_breakdown_to_string(estimate_breakdown_t *self);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
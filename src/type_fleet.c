@@ -0,0 +1,362 @@
+#include "type_fleet.h"
+#include <ctype.h>              // for tolower
+#include <fcntl.h>              // for fcntl, open, flock, F_SETLKW, F_WRLCK, O_CREAT, O_RDONLY, O_RDWR, SEEK_SET
+#include <float.h>              // for DBL_MAX
+#include <stdio.h>              // for NULL, fclose, fdopen, fflush, fileno, fprintf, getline, perror, rewind, snprintf, sscanf, FILE
+#include <stdlib.h>             // for atof, atoi, calloc, free
+#include <string.h>             // for strlen, strncmp, strndup
+#include <sys/stat.h>           // for fstat, stat
+#include <time.h>               // for time, time_t
+#include <unistd.h>             // for close, ftruncate, read
+#include "config.h"             // for FILENAME_NCHARS, HOSTNAME_NCHARS
+#include "ini_file.h"           // for ini_entry_t, ini_section_t, ini_file_destroy, ini_section_lookup_entry, ini_file_t, MAX_FIELD_LENGTH
+#include "ini_parser.h"         // for ini_file_parse
+#include "pdf2laser_printer.h"  // for printer_status_t, printer_query_status
+#include "type_kinematics.h"    // for kinematics_t
+#include "type_print_job.h"     // for print_job_t
+#include "type_printer.h"       // for printer_t, printer_create, printer_destroy, printer_accepts_print_job, printer_estimate_seconds, printer_to_string
+
+static fleet_t *fleet_load_ini_section_fleet(fleet_t *self, ini_section_t *section)
+{
+	for (ini_entry_t *entry = section->entries; entry != NULL; entry = entry->next) {
+		switch (tolower(entry->key[0])) {
+		case 's': { // state
+			free(self->state_path);
+			self->state_path = strndup(entry->value, FILENAME_NCHARS);
+			break;
+		}
+		default: {
+			// error
+		}
+		}
+	}
+	return self;
+}
+
+static fleet_t *fleet_load_ini_section_printer(fleet_t *self, ini_section_t *section)
+{
+	ini_entry_t *host_entry = ini_section_lookup_entry(section, "host");
+	if (host_entry == NULL) {
+		fprintf(stderr, "Fleet printer without a host in %s\n", self->path);
+		return NULL;
+	}
+
+	printer_t *printer = printer_create(host_entry->value);
+
+	for (ini_entry_t *entry = section->entries; entry != NULL; entry = entry->next) {
+		switch (tolower(entry->key[0])) {
+		case 'h': { // host, height
+			if (tolower(entry->key[1]) == 'e')
+				printer->height = atoi(entry->value);
+			break;
+		}
+		case 'w': { // width
+			printer->width = atoi(entry->value);
+			break;
+		}
+		case 'r': {
+			switch (tolower(entry->key[1])) {
+			case 'e': { // resolution
+				printer->resolution = atoi(entry->value);
+				break;
+			}
+			case 'a': { // rate, rasterspeed
+				if (tolower(entry->key[2]) == 's')
+					printer->kinematics->raster_speed = atof(entry->value);
+				else
+					printer->rate = atoi(entry->value);
+				break;
+			}
+			}
+			break;
+		}
+		case 'a': { // acceleration
+			printer->kinematics->acceleration = atof(entry->value);
+			break;
+		}
+		case 'v': { // vectorspeed
+			printer->kinematics->vector_speed = atof(entry->value);
+			break;
+		}
+		case 't': { // transitspeed
+			printer->kinematics->transit_speed = atof(entry->value);
+			break;
+		}
+		case 'p': { // penup
+			printer->kinematics->pen_up_seconds = atof(entry->value);
+			break;
+		}
+		default: {
+			// error
+		}
+		}
+	}
+
+	// keep the printers in file order
+	printer_t **tail = &(self->printers);
+	while (*tail != NULL)
+		tail = &((*tail)->next);
+	*tail = printer;
+
+	return self;
+}
+
+static char *fleet_read_file(char *path)
+{
+	int source_fd = open(path, O_RDONLY);
+	if (source_fd < 0) {
+		perror(path);
+		return NULL;
+	}
+
+	struct stat stat;
+	if (fstat(source_fd, &stat)) {
+		perror(path);
+		close(source_fd);
+		return NULL;
+	}
+
+	char *buffer = calloc(stat.st_size + 1, sizeof(char));
+	ssize_t rc = 0;
+	for (off_t offset = 0; offset < stat.st_size; offset += rc) {
+		rc = read(source_fd, buffer + offset, stat.st_size - offset);
+		if (rc <= 0)
+			break;
+	}
+
+	close(source_fd);
+
+	return buffer;
+}
+
+fleet_t *fleet_create(char *path)
+{
+	char *buffer = fleet_read_file(path);
+	if (buffer == NULL)
+		return NULL;
+
+	ini_file_t *config = NULL;
+	int rc = ini_file_parse(buffer, &config);
+	free(buffer);
+
+	if (rc) {
+		fprintf(stderr, "Unable to parse fleet file %s\n", path);
+		return NULL;
+	}
+
+	fleet_t *fleet = calloc(1, sizeof(fleet_t));
+	fleet->path = strndup(path, FILENAME_NCHARS);
+	fleet->state_path = NULL;
+	fleet->printers = NULL;
+
+	for (ini_section_t *section = config->sections; section != NULL; section = section->next) {
+		switch (tolower(section->name[0])) {
+		case 'f': { // fleet
+			fleet_load_ini_section_fleet(fleet, section);
+			break;
+		}
+		case 'p': { // printer
+			if (fleet_load_ini_section_printer(fleet, section) == NULL) {
+				ini_file_destroy(config);
+				return fleet_destroy(fleet);
+			}
+			break;
+		}
+		default: {
+			// error
+		}
+		}
+	}
+
+	ini_file_destroy(config);
+
+	if (fleet->printers == NULL) {
+		fprintf(stderr, "No printers configured in fleet file %s\n", path);
+		return fleet_destroy(fleet);
+	}
+
+	return fleet;
+}
+
+fleet_t *fleet_destroy(fleet_t *self)
+{
+	if (self == NULL)
+		return NULL;
+
+	free(self->path);
+	free(self->state_path);
+
+	printer_t *printer = self->printers;
+	while (printer != NULL) {
+		printer_t *next = printer->next;
+		printer_destroy(printer);
+		printer = next;
+	}
+
+	free(self);
+
+	return NULL;
+}
+
+char *fleet_to_string(fleet_t *self)
+{
+	size_t s_len = 1;  // '\0'
+	s_len += snprintf(NULL, 0, "Fleet: %s", self->path);
+
+	size_t printer_count = 0;
+	for (printer_t *printer = self->printers; printer != NULL; printer = printer->next)
+		printer_count += 1;
+
+	char *printers[printer_count];
+	size_t index = 0;
+	for (printer_t *printer = self->printers; printer != NULL; printer = printer->next) {
+		printers[index] = printer_to_string(printer);
+		s_len += 1 + strlen(printers[index]);  // '\n'
+		index += 1;
+	}
+
+	char *s = calloc(s_len, sizeof(char));
+	size_t rc = snprintf(s, s_len, "Fleet: %s", self->path);
+	for (index = 0; index < printer_count; index += 1) {
+		rc += snprintf(s + rc, s_len - rc, "\n%s", printers[index]);
+		free(printers[index]);
+	}
+
+	return s;
+}
+
+/**
+ * Query the queue state of every printer in the fleet. Printers which cannot
+ * be reached are marked offline and will not be dispatched to.
+ *
+ * @return The number of printers which answered.
+ */
+size_t fleet_probe(fleet_t *self)
+{
+	size_t online_count = 0;
+
+	for (printer_t *printer = self->printers; printer != NULL; printer = printer->next) {
+		printer_status_t status;
+		if (printer_query_status(printer->host, &status, NULL)) {
+			printer->online = false;
+			continue;
+		}
+
+		printer->online = true;
+		printer->queue_depth = status.queue_depth;
+		online_count += 1;
+	}
+
+	return online_count;
+}
+
+/**
+ * Lock and open the fleet state file. The state file records, per host, the
+ * wall clock time at which the jobs previously dispatched to it are expected
+ * to be done. This allows concurrent pdf2laser processes to balance against
+ * each other.
+ */
+static FILE *fleet_state_open(fleet_t *self)
+{
+	int state_fd = open(self->state_path, O_RDWR | O_CREAT, 0644);
+	if (state_fd < 0) {
+		perror(self->state_path);
+		return NULL;
+	}
+
+	struct flock lock = { .l_type = F_WRLCK, .l_whence = SEEK_SET, .l_start = 0, .l_len = 0 };
+	if (fcntl(state_fd, F_SETLKW, &lock) == -1) {
+		perror("Unable to lock fleet state");
+		close(state_fd);
+		return NULL;
+	}
+
+	return fdopen(state_fd, "r+");
+}
+
+static void fleet_state_load(fleet_t *self, FILE *state_fh, time_t now)
+{
+	char *line = NULL;
+	size_t length = 0;
+
+	while (getline(&line, &length, state_fh) != -1) {
+		char host[length];
+		long long busy_until;
+		if (sscanf(line, "%s %lld", host, &busy_until) != 2)
+			continue;
+
+		for (printer_t *printer = self->printers; printer != NULL; printer = printer->next) {
+			if (strncmp(printer->host, host, HOSTNAME_NCHARS))
+				continue;
+
+			if (busy_until - now > printer->pending_seconds)
+				printer->pending_seconds = (double)(busy_until - now);
+		}
+	}
+
+	free(line);
+}
+
+static void fleet_state_store(fleet_t *self, FILE *state_fh, time_t now)
+{
+	rewind(state_fh);
+	if (ftruncate(fileno(state_fh), 0))
+		perror("Unable to truncate fleet state");
+
+	for (printer_t *printer = self->printers; printer != NULL; printer = printer->next)
+		fprintf(state_fh, "%s %lld\n", printer->host, (long long)(now + (time_t)printer->pending_seconds));
+
+	fflush(state_fh);
+}
+
+/**
+ * Select the printer of the fleet which is expected to finish the given print
+ * job first and record the job against it.
+ *
+ * The expected completion time is the time the printer is expected to stay
+ * busy with work already dispatched to it, plus the jobs reported in its queue
+ * by fleet_probe, which are assumed to be of similar size to this one, plus
+ * the job itself at the rate of that printer.
+ *
+ * @return The printer the job was assigned to or NULL if no printer in the
+ * fleet is able to run the job.
+ */
+printer_t *fleet_dispatch(fleet_t *self, print_job_t *print_job, size_t job_size)
+{
+	time_t now = time(NULL);
+
+	FILE *state_fh = NULL;
+	if (self->state_path != NULL) {
+		state_fh = fleet_state_open(self);
+		if (state_fh != NULL)
+			fleet_state_load(self, state_fh, now);
+	}
+
+	printer_t *best_printer = NULL;
+	double best_completion = DBL_MAX;
+	double best_job_seconds = 0.0;
+
+	for (printer_t *printer = self->printers; printer != NULL; printer = printer->next) {
+		if (!printer_accepts_print_job(printer, print_job))
+			continue;
+
+		double job_seconds = printer_estimate_seconds(printer, print_job, job_size);
+		double completion = printer->pending_seconds + (printer->queue_depth + 1) * job_seconds;
+
+		if (completion < best_completion) {
+			best_printer = printer;
+			best_completion = completion;
+			best_job_seconds = job_seconds;
+		}
+	}
+
+	if (best_printer != NULL)
+		best_printer->pending_seconds += best_job_seconds;
+
+	if (state_fh != NULL) {
+		fleet_state_store(self, state_fh, now);
+		fclose(state_fh);
+	}
+
+	return best_printer;
+}
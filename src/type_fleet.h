@@ -0,0 +1,36 @@
+#ifndef __PDF2LASER_TYPE_FLEET_H__
+#define __PDF2LASER_TYPE_FLEET_H__ 1
+
+#include <stddef.h>          // for size_t
+#include "ini_file.h"        // for ini_file_t
+#include "type_print_job.h"  // for print_job_t
+#include "type_printer.h"    // for printer_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+typedef struct fleet fleet_t;
+struct fleet {
+	char *path;
+	char *state_path;
+	printer_t *printers;
+};
+
+fleet_t *fleet_create(char *path);
+fleet_t *fleet_destroy(fleet_t *self);
+
+char *fleet_to_string(fleet_t *self);
+
+size_t fleet_probe(fleet_t *self);
+
+printer_t *fleet_dispatch(fleet_t *self, print_job_t *print_job, size_t job_size);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
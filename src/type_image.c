@@ -0,0 +1,134 @@
+#include "type_image.h"
+#include <inttypes.h>  // for PRId32
+#include <math.h>      // for lround
+#include <stdint.h>    // for int32_t, int64_t, uint8_t, uint32_t
+#include <stdio.h>     // for snprintf
+#include <stdlib.h>    // for calloc, free, NULL
+#include <string.h>    // for memset
+
+image_t *image_create(int32_t width, int32_t height, int32_t channels)
+{
+	image_t *image = calloc(1, sizeof(image_t));
+
+	image->width = width;
+	image->height = height;
+	image->channels = channels;
+	image->resolution = IMAGE_UNITS_PER_INCH;
+	image->pixels = calloc((size_t)width * height * channels, sizeof(uint8_t));
+
+	return image;
+}
+
+image_t *image_destroy(image_t *self)
+{
+	if (self == NULL)
+		return NULL;
+
+	free(self->pixels);
+	free(self);
+
+	return NULL;
+}
+
+char *image_to_string(image_t *self)
+{
+	static char *template = "Image: %"PRId32"x%"PRId32" %s dpi=%.1f";
+
+	const char *kind = (self->channels == 1) ? "grey" : "rgb";
+	size_t s_len = 1 + snprintf(NULL, 0, template, self->width, self->height, kind, self->resolution);
+
+	char *s = calloc(s_len, sizeof(char));
+	snprintf(s, s_len, template, self->width, self->height, kind, self->resolution);
+	return s;
+}
+
+/**
+ * Size of the image in device pixels once scaled from its own resolution.
+ */
+void image_device_size(image_t *self, uint32_t resolution, int32_t *width, int32_t *height)
+{
+	*width = lround(self->width * resolution / self->resolution);
+	*height = lround(self->height * resolution / self->resolution);
+
+	if (*width < 1)
+		*width = 1;
+	if (*height < 1)
+		*height = 1;
+}
+
+/**
+ * Render one device row of the image in the layout Ghostscript gives the
+ * bitmap of a raster mode: bgr bytes for colour, a grey byte for grey-scale
+ * and packed bits with 1 for black for mono, which is ordered dithered.
+ *
+ * Every device pixel is the average of the source pixels it covers, so that
+ * enlarging repeats source pixels and reducing blends them.
+ *
+ * @param y row from the top, in device pixels.
+ * @param length bytes in row, anything past the image is cleared.
+ */
+void image_render_row(image_t *self, raster_mode mode, uint32_t resolution, int32_t y, uint8_t *row, size_t length)
+{
+	static const uint8_t bayer[8][8] = {
+		{ 0, 32,  8, 40,  2, 34, 10, 42},
+		{48, 16, 56, 24, 50, 18, 58, 26},
+		{12, 44,  4, 36, 14, 46,  6, 38},
+		{60, 28, 52, 20, 62, 30, 54, 22},
+		{ 3, 35, 11, 43,  1, 33,  9, 41},
+		{51, 19, 59, 27, 49, 17, 57, 25},
+		{15, 47,  7, 39, 13, 45,  5, 37},
+		{63, 31, 55, 23, 61, 29, 53, 21},
+	};
+
+	memset(row, 0, length);
+
+	int32_t width, height;
+	image_device_size(self, resolution, &width, &height);
+	if (y < 0 || y >= height)
+		return;
+
+	int64_t top = (int64_t)y * self->height / height;
+	int64_t bottom = (int64_t)(y + 1) * self->height / height;
+	if (bottom <= top)
+		bottom = top + 1;
+
+	for (int32_t x = 0; x < width; x += 1) {
+		int64_t left = (int64_t)x * self->width / width;
+		int64_t right = (int64_t)(x + 1) * self->width / width;
+		if (right <= left)
+			right = left + 1;
+
+		uint32_t sums[3] = {0, 0, 0};
+		for (int64_t source_y = top; source_y < bottom; source_y += 1) {
+			const uint8_t *pixel = self->pixels + (source_y * self->width + left) * self->channels;
+			for (int64_t source_x = left; source_x < right; source_x += 1) {
+				for (int32_t channel = 0; channel < self->channels; channel += 1)
+					sums[channel] += *pixel++;
+			}
+		}
+
+		uint32_t count = (uint32_t)((bottom - top) * (right - left));
+		uint32_t red = sums[0] / count;
+		uint32_t green = (self->channels == 3) ? sums[1] / count : red;
+		uint32_t blue = (self->channels == 3) ? sums[2] / count : red;
+		uint32_t grey = (299 * red + 587 * green + 114 * blue) / 1000;
+
+		switch (mode) {
+		case RASTER_MODE_COLOR:
+			if ((size_t)x * 3 + 2 < length) {
+				row[x * 3] = blue;
+				row[x * 3 + 1] = green;
+				row[x * 3 + 2] = red;
+			}
+			break;
+		case RASTER_MODE_GREY_SCALE:
+			if ((size_t)x < length)
+				row[x] = grey;
+			break;
+		default:
+			if ((size_t)x / 8 < length && grey < bayer[y & 7][x & 7] * 4u + 2u)
+				row[x / 8] |= 0x80 >> (x & 7);
+			break;
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#ifndef __PDF2LASER_TYPE_IMAGE_H__
+#define __PDF2LASER_TYPE_IMAGE_H__ 1
+
+#include <stddef.h>       // for size_t
+#include <stdint.h>       // for int32_t, uint8_t, uint32_t
+#include "type_raster.h"  // for raster_mode
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+// source pixels per inch of images which do not give their resolution
+#define IMAGE_UNITS_PER_INCH (96.0)
+
+/**
+ * A decoded raster image, engraved without going through Ghostscript. The
+ * source pixels are kept as read and each device row is scaled from them as
+ * the raster generator asks for it.
+ */
+typedef struct image image_t;
+struct image {
+	int32_t width;      // in source pixels
+	int32_t height;
+	int32_t channels;   // 1 for grey, 3 for rgb
+	double resolution;  // source pixels per inch
+	uint8_t *pixels;    // rows from the top, channels bytes per pixel
+};
+
+image_t *image_create(int32_t width, int32_t height, int32_t channels);
+image_t *image_destroy(image_t *self);
+
+char *image_to_string(image_t *self);
+
+void image_device_size(image_t *self, uint32_t resolution, int32_t *width, int32_t *height);
+void image_render_row(image_t *self, raster_mode mode, uint32_t resolution, int32_t y, uint8_t *row, size_t length);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
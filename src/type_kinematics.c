@@ -0,0 +1,74 @@
+#include "type_kinematics.h"
+#include <math.h>    // for sqrt, fmax, fmin
+#include <stdio.h>   // for snprintf
+#include <stdlib.h>  // for calloc, free, NULL
+#include "config.h"  // for ACCELERATION, PEN_UP_SECONDS, RASTER_SPEED_MAX, TRANSIT_SPEED, VECTOR_SPEED_MAX
+
+kinematics_t *kinematics_create(void)
+{
+	kinematics_t *kinematics = calloc(1, sizeof(kinematics_t));
+
+	kinematics->vector_speed = VECTOR_SPEED_MAX;
+	kinematics->raster_speed = RASTER_SPEED_MAX;
+	kinematics->transit_speed = TRANSIT_SPEED;
+	kinematics->acceleration = ACCELERATION;
+	kinematics->pen_up_seconds = PEN_UP_SECONDS;
+
+	return kinematics;
+}
+
+kinematics_t *kinematics_destroy(kinematics_t *self)
+{
+	free(self);
+	return NULL;
+}
+
+char *kinematics_to_string(kinematics_t *self)
+{
+	static char *template = "Kinematics: vector=%.1fin/s raster=%.1fin/s transit=%.1fin/s acceleration=%.1fin/s2 pen-up=%.3fs";
+
+	size_t s_len = 1 + snprintf(NULL, 0, template, self->vector_speed, self->raster_speed, self->transit_speed, self->acceleration, self->pen_up_seconds);
+
+	char *s = calloc(s_len, sizeof(char));
+	snprintf(s, s_len, template, self->vector_speed, self->raster_speed, self->transit_speed, self->acceleration, self->pen_up_seconds);
+	return s;
+}
+
+/**
+ * Time taken by a straight move with a trapezoidal velocity profile: the head
+ * accelerates from the entry speed towards the cruise speed and decelerates
+ * to the exit speed. Moves too short to reach the cruise speed peak at
+ * whatever speed the distance allows.
+ *
+ * @param distance length of the move in inches.
+ * @param speed cruise speed in inches per second.
+ * @param entry_speed speed at the start of the move, 0 from rest.
+ * @param exit_speed speed at the end of the move, 0 to stop.
+ *
+ * @return The duration of the move in seconds.
+ */
+double kinematics_move_seconds(kinematics_t *self, double distance, double speed, double entry_speed, double exit_speed)
+{
+	if (distance <= 0.0 || speed <= 0.0)
+		return 0.0;
+
+	double a = self->acceleration;
+	if (a <= 0.0)
+		return distance / speed;
+
+	double v0 = fmin(entry_speed, speed);
+	double v1 = fmin(exit_speed, speed);
+
+	double accelerate = (speed * speed - v0 * v0) / (2.0 * a);
+	double decelerate = (speed * speed - v1 * v1) / (2.0 * a);
+	if (accelerate + decelerate <= distance)
+		return (speed - v0) / a + (speed - v1) / a + (distance - accelerate - decelerate) / speed;
+
+	double peak = sqrt((2.0 * a * distance + v0 * v0 + v1 * v1) / 2.0);
+	if (peak < fmax(v0, v1)) {
+		// the move is too short to change speed as asked, so take the mean
+		return 2.0 * distance / (v0 + v1);
+	}
+
+	return (peak - v0) / a + (peak - v1) / a;
+}
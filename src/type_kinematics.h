@@ -0,0 +1,36 @@
+#ifndef __PDF2LASER_TYPE_KINEMATICS_H__
+#define __PDF2LASER_TYPE_KINEMATICS_H__ 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/**
+ * Motion limits of a cutter, used to estimate how long it takes to run a
+ * job. Speeds are in inches per second, with the speed settings of a job
+ * taken as a percentage of the maximum for the pass.
+ */
+typedef struct kinematics kinematics_t;
+struct kinematics {
+	double vector_speed;    // head speed cutting vectors at 100% speed
+	double raster_speed;    // head speed engraving rows at 100% speed
+	double transit_speed;   // head speed with the laser off
+	double acceleration;    // in inches per second squared
+	double pen_up_seconds;  // lifting and lowering the pen around a transit
+};
+
+kinematics_t *kinematics_create(void);
+kinematics_t *kinematics_destroy(kinematics_t *self);
+
+char *kinematics_to_string(kinematics_t *self);
+
+double kinematics_move_seconds(kinematics_t *self, double distance, double speed, double entry_speed, double exit_speed);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,251 @@
+#include "type_optimizer_report.h"
+#include <inttypes.h>            // for PRId32, PRId64, PRIu32, PRIx32
+#include <stdbool.h>             // for false, true
+#include <stdio.h>               // for fprintf, fclose, open_memstream, snprintf, FILE, NULL
+#include <stdlib.h>              // for calloc, free
+#include "config.h"              // for RESOLUTION_DEFAULT
+#include "pdf2laser_estimate.h"  // for estimate_vector_list
+#include "type_estimate.h"       // for estimate_breakdown_t
+#include "type_timings.h"        // for timings_format, TIMINGS_FORMAT_JSON
+#include "type_vector_list.h"    // for vector_list_stats_t, vector_list_t, vector_list_measure
+
+static const char *optimizer_stage_names[OPTIMIZER_STAGES_LENGTH] = {
+	"input", "dedup", "optimize",
+};
+
+optimizer_report_t *optimizer_report_create(timings_format format)
+{
+	optimizer_report_t *report = calloc(1, sizeof(optimizer_report_t));
+
+	report->format = format;
+	report->resolution = RESOLUTION_DEFAULT;
+	report->kinematics = NULL;
+	report->layers = NULL;
+	report->tail = NULL;
+
+	return report;
+}
+
+optimizer_report_t *optimizer_report_destroy(optimizer_report_t *self)
+{
+	if (self == NULL)
+		return NULL;
+
+	optimizer_layer_t *layer = self->layers;
+	while (layer != NULL) {
+		optimizer_layer_t *next = layer->next;
+		free(layer);
+		layer = next;
+	}
+
+	free(self);
+
+	return NULL;
+}
+
+const char *optimizer_stage_to_string(optimizer_stage stage)
+{
+	return (stage < OPTIMIZER_STAGES_LENGTH) ? optimizer_stage_names[stage] : NULL;
+}
+
+/**
+ * Find the layer for a vector list config, appending a new one the first
+ * time it is asked for so that layers are listed in job order.
+ */
+optimizer_layer_t *optimizer_report_layer(optimizer_report_t *self, uint32_t id)
+{
+	for (optimizer_layer_t *layer = self->layers; layer != NULL; layer = layer->next) {
+		if (layer->id == id)
+			return layer;
+	}
+
+	optimizer_layer_t *layer = calloc(1, sizeof(optimizer_layer_t));
+	layer->id = id;
+	layer->next = NULL;
+
+	if (self->tail == NULL)
+		self->layers = layer;
+	else
+		self->tail->next = layer;
+	self->tail = layer;
+
+	return layer;
+}
+
+/**
+ * Measure a layer as it leaves an optimizer stage. Transit time is the pen ups
+ * and transits of the job time estimate, and is left out when no machine model
+ * was given.
+ */
+void optimizer_report_record(optimizer_report_t *self, uint32_t id, optimizer_stage stage, vector_list_t *vector_list, double seconds)
+{
+	if (self == NULL)
+		return;
+
+	vector_list_stats_t stats;
+	vector_list_measure(vector_list, &stats);
+
+	optimizer_measure_t *measure = &(optimizer_report_layer(self, id)->stages[stage]);
+	measure->measured = true;
+	measure->vectors = vector_list->length;
+	measure->pen_ups = stats.transits;
+	measure->transit_length = stats.transit_length;
+	measure->transit_seconds = 0.0;
+	measure->seconds = seconds;
+
+	if (self->kinematics != NULL) {
+		estimate_breakdown_t breakdown = { .transit_seconds = 0.0 };
+		estimate_vector_list(self->kinematics, vector_list, self->resolution, 100, &breakdown);
+		measure->transit_seconds = breakdown.transit_seconds;
+	}
+}
+
+/**
+ * Sum a stage over every layer, so that the totals compare like for like.
+ */
+static optimizer_measure_t optimizer_report_total(optimizer_report_t *self, optimizer_stage stage)
+{
+	optimizer_measure_t total = { .measured = false };
+
+	for (optimizer_layer_t *layer = self->layers; layer != NULL; layer = layer->next) {
+		optimizer_measure_t *measure = &(layer->stages[stage]);
+		if (!measure->measured)
+			continue;
+
+		total.measured = true;
+		total.vectors += measure->vectors;
+		total.pen_ups += measure->pen_ups;
+		total.transit_length += measure->transit_length;
+		total.transit_seconds += measure->transit_seconds;
+		total.seconds += measure->seconds;
+	}
+
+	return total;
+}
+
+/**
+ * Transit time saved by the optimizer against the input order, and the CPU
+ * time it took to save it.
+ */
+static void optimizer_report_savings(optimizer_report_t *self, double *saved, double *cpu)
+{
+	optimizer_measure_t input = optimizer_report_total(self, OPTIMIZER_STAGE_INPUT);
+
+	*saved = 0.0;
+	*cpu = 0.0;
+	for (int stage = OPTIMIZER_STAGE_INPUT + 1; stage < OPTIMIZER_STAGES_LENGTH; stage += 1) {
+		optimizer_measure_t total = optimizer_report_total(self, stage);
+		if (!total.measured)
+			continue;
+
+		*saved = input.transit_seconds - total.transit_seconds;
+		*cpu += total.seconds;
+	}
+}
+
+static void optimizer_write_row(optimizer_report_t *self, FILE *stream, const char *layer, optimizer_stage stage, optimizer_measure_t *measure)
+{
+	fprintf(stream, "\n%-8s %-10s %10"PRId32" %10"PRId32" %14.2f %12.3f", layer, optimizer_stage_to_string(stage), measure->vectors, measure->pen_ups, (double)measure->transit_length / self->resolution, measure->transit_seconds);
+
+	if (stage == OPTIMIZER_STAGE_INPUT)
+		fprintf(stream, " %10s", "-");
+	else
+		fprintf(stream, " %10.3f", 1000.0 * measure->seconds);
+}
+
+/**
+ * Render each layer as a table row per optimizer stage with its pen ups,
+ * transit length in inches, estimated transit time and the CPU time spent
+ * reaching it, followed by the totals over all layers.
+ */
+char *optimizer_report_to_string(optimizer_report_t *self)
+{
+	char *s = NULL;
+	size_t s_len = 0;
+	FILE *stream = open_memstream(&s, &s_len);
+
+	fprintf(stream, "Optimizer:\n%-8s %-10s %10s %10s %14s %12s %10s", "Layer", "Stage", "Vectors", "Pen ups", "Transit (in)", "Transit (s)", "CPU (ms)");
+
+	for (optimizer_layer_t *layer = self->layers; layer != NULL; layer = layer->next) {
+		char name[8];
+		snprintf(name, sizeof(name), "%06"PRIx32, layer->id);
+		for (int stage = 0; stage < OPTIMIZER_STAGES_LENGTH; stage += 1) {
+			if (layer->stages[stage].measured)
+				optimizer_write_row(self, stream, name, stage, &(layer->stages[stage]));
+		}
+	}
+
+	for (int stage = 0; stage < OPTIMIZER_STAGES_LENGTH; stage += 1) {
+		optimizer_measure_t total = optimizer_report_total(self, stage);
+		if (total.measured)
+			optimizer_write_row(self, stream, "Total", stage, &total);
+	}
+
+	double saved, cpu;
+	optimizer_report_savings(self, &saved, &cpu);
+	fprintf(stream, "\n%.3f ms of optimizer CPU time saved an estimated %.3f s of transit", 1000.0 * cpu, saved);
+
+	fclose(stream);
+	return s;
+}
+
+static void optimizer_write_json(optimizer_report_t *self, FILE *stream, optimizer_measure_t *stages)
+{
+	bool first = true;
+
+	fprintf(stream, "[");
+	for (int stage = 0; stage < OPTIMIZER_STAGES_LENGTH; stage += 1) {
+		optimizer_measure_t *measure = &(stages[stage]);
+		if (!measure->measured)
+			continue;
+
+		fprintf(stream, "%s{\"stage\":\"%s\",\"vectors\":%"PRId32",\"pen_ups\":%"PRId32",\"transit_length\":%"PRId64",\"transit_inches\":%.4f,\"transit_seconds\":%.6f,\"seconds\":%.6f}",
+			first ? "" : ",", optimizer_stage_to_string(stage), measure->vectors, measure->pen_ups, measure->transit_length,
+			(double)measure->transit_length / self->resolution, measure->transit_seconds, measure->seconds);
+		first = false;
+	}
+	fprintf(stream, "]");
+}
+
+/**
+ * Render the report as a single line JSON document, with the stages of each
+ * layer and of the totals in pipeline order.
+ */
+char *optimizer_report_to_json(optimizer_report_t *self)
+{
+	char *s = NULL;
+	size_t s_len = 0;
+	FILE *stream = open_memstream(&s, &s_len);
+
+	fprintf(stream, "{\"resolution\":%"PRIu32",\"layers\":[", self->resolution);
+	for (optimizer_layer_t *layer = self->layers; layer != NULL; layer = layer->next) {
+		fprintf(stream, "%s{\"color\":\"%06"PRIx32"\",\"stages\":", (layer == self->layers) ? "" : ",", layer->id);
+		optimizer_write_json(self, stream, layer->stages);
+		fprintf(stream, "}");
+	}
+
+	optimizer_measure_t totals[OPTIMIZER_STAGES_LENGTH];
+	for (int stage = 0; stage < OPTIMIZER_STAGES_LENGTH; stage += 1)
+		totals[stage] = optimizer_report_total(self, stage);
+
+	fprintf(stream, "],\"total\":");
+	optimizer_write_json(self, stream, totals);
+
+	double saved, cpu;
+	optimizer_report_savings(self, &saved, &cpu);
+	fprintf(stream, ",\"cpu_seconds\":%.6f,\"transit_seconds_saved\":%.6f}", cpu, saved);
+
+	fclose(stream);
+	return s;
+}
+
+/**
+ * Render the report in the format requested on creation.
+ */
+char *optimizer_report_render(optimizer_report_t *self)
+{
+	if (self->format == TIMINGS_FORMAT_JSON)
+		return optimizer_report_to_json(self);
+
+	return optimizer_report_to_string(self);
+}
@@ -0,0 +1,66 @@
+#ifndef __PDF2LASER_TYPE_OPTIMIZER_REPORT_H__
+#define __PDF2LASER_TYPE_OPTIMIZER_REPORT_H__ 1
+
+#include <stdbool.h>           // for bool
+#include <stdint.h>            // for int32_t, int64_t, uint32_t
+#include "type_kinematics.h"   // for kinematics_t
+#include "type_timings.h"      // for timings_format
+#include "type_vector_list.h"  // for vector_list_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+typedef enum {
+	OPTIMIZER_STAGE_INPUT,     // order the vectors were parsed in
+	OPTIMIZER_STAGE_DEDUP,     // after removing duplicates
+	OPTIMIZER_STAGE_OPTIMIZE,  // after ordering by vector_list_optimize
+	OPTIMIZER_STAGES_LENGTH,
+} optimizer_stage;
+
+typedef struct optimizer_measure optimizer_measure_t;
+struct optimizer_measure {
+	bool measured;
+	int32_t vectors;
+	int32_t pen_ups;          // transits, each lifting and lowering the pen
+	int64_t transit_length;   // in device units
+	double transit_seconds;   // estimated machine time spent in transit
+	double seconds;           // CPU time spent producing this stage
+};
+
+typedef struct optimizer_layer optimizer_layer_t;
+struct optimizer_layer {
+	uint32_t id;  // rgb of the vector list config
+	optimizer_measure_t stages[OPTIMIZER_STAGES_LENGTH];
+	optimizer_layer_t *next;
+};
+
+typedef struct optimizer_report optimizer_report_t;
+struct optimizer_report {
+	timings_format format;
+	uint32_t resolution;       // device units per inch
+	kinematics_t *kinematics;  // machine model for transit times, owned by the print job
+	optimizer_layer_t *layers;
+	optimizer_layer_t *tail;
+};
+
+optimizer_report_t *optimizer_report_create(timings_format format);
+optimizer_report_t *optimizer_report_destroy(optimizer_report_t *self);
+
+optimizer_layer_t *optimizer_report_layer(optimizer_report_t *self, uint32_t id);
+void optimizer_report_record(optimizer_report_t *self, uint32_t id, optimizer_stage stage, vector_list_t *vector_list, double seconds);
+
+const char *optimizer_stage_to_string(optimizer_stage stage);
+
+char *optimizer_report_to_string(optimizer_report_t *self);
+char *optimizer_report_to_json(optimizer_report_t *self);
+char *optimizer_report_render(optimizer_report_t *self);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
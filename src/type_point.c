@@ -1,8 +1,8 @@
 #include "type_point.h"
-#include <math.h>    // for atan2
-#include <stdint.h>  // for int32_t
-#include <stdio.h>   // for NULL
-#include <stdlib.h>  // for calloc, free
+#include <math.h>              // for atan2
+#include <stdint.h>            // for int32_t
+#include <stdio.h>             // for NULL
+#include "pdf2laser_memory.h"  // for memory_calloc, memory_free, MEMORY_VECTOR
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -10,7 +10,7 @@
 
 point_t *point_create(int32_t x, int32_t y)
 {
-	point_t *point = calloc(1, sizeof(point_t));
+	point_t *point = memory_calloc(MEMORY_VECTOR, 1, sizeof(point_t));
 
 	point->x = x;
 	point->y = y;
@@ -20,7 +20,7 @@ point_t *point_create(int32_t x, int32_t y)
 
 point_t *point_destroy(point_t *self)
 {
-	free(self);
+	memory_free(MEMORY_VECTOR, self, sizeof(point_t));
 	return NULL;
 }
 
@@ -3,21 +3,24 @@
 #include <inttypes.h>                 // for SCNx64
 #include <stdbool.h>                  // for false, true
 #include <stdint.h>                   // for int32_t, int64_t, uint64_t
-#include <stdio.h>                    // for NULL, sscanf
-#include <stdlib.h>                   // for atoi, exit, free, calloc
-#include <string.h>                   // for strndup
+#include <stdio.h>                    // for NULL, fprintf, sscanf, stderr
+#include <stdlib.h>                   // for atoi, free, calloc
+#include <string.h>                   // for memcpy, strndup
 #include <strings.h>                  // for strncasecmp
 #include "config.h"                   // for PRESET_NAME_NCHARS
 #include "ini_file.h"                 // for ini_entry_t, ini_section_t, MAX_FIELD_LENGTH, ini_file_destroy, ini_section_lookup_entry, ini_file_t
+#include "ini_parser.h"               // for ini_file_parse
+#include "pdf2laser_memory.h"         // for memory_calloc, memory_free, memory_free_string, memory_strndup, MEMORY_PRESET
 #include "type_print_job.h"           // for print_job_t, print_job_append_new_vector_list_config, print_job_find_vector_list_config_by_rgb
 #include "type_raster.h"              // for raster_t, raster_create, raster_mode
+#include "type_transform.h"           // for transform_create, transform_parse_offset, transform_parse_rotation
 #include "type_vector_list_config.h"  // for vector_list_config_t, vector_list_config_id_to_rgb
 
 
 preset_t *preset_create(char *name)
 {
-	preset_t *preset = calloc(1, sizeof(preset_t));
-	preset->name = strndup(name, PRESET_NAME_NCHARS);
+	preset_t *preset = memory_calloc(MEMORY_PRESET, 1, sizeof(preset_t));
+	preset->name = memory_strndup(MEMORY_PRESET, name, PRESET_NAME_NCHARS);
 	preset->config = NULL;
 	return preset;
 }
@@ -29,11 +32,37 @@ preset_t *preset_destroy(preset_t *self)
 
 	ini_file_destroy(self->config);
 
-	free(self);
+	memory_free_string(MEMORY_PRESET, self->name);
+	memory_free(MEMORY_PRESET, self, sizeof(preset_t));
 
 	return NULL;
 }
 
+/**
+ * Parse the ini text of a preset, which need not be nul terminated.
+ *
+ * @return The preset, or NULL if the text could not be parsed.
+ */
+preset_t *preset_parse(preset_t *self, const char *text, size_t length)
+{
+	char *buffer = memory_calloc(MEMORY_PRESET, length + 1, sizeof(char));
+	memcpy(buffer, text, length);
+
+	ini_file_destroy(self->config);
+	self->config = NULL;
+
+	int rc = ini_file_parse(buffer, &(self->config));
+
+	memory_free(MEMORY_PRESET, buffer, length + 1);
+
+	if (rc) {
+		self->config = NULL;
+		return NULL;
+	}
+
+	return self;
+}
+
 static preset_t *preset_load_merge_raster(preset_t *self, print_job_t *print_job, raster_t *raster)
 {
 	if (print_job->raster == NULL) {
@@ -106,15 +135,19 @@ static preset_t *preset_load_ini_section_raster(preset_t *self, print_job_t *pri
 
 static preset_t *preset_load_ini_section_vector(preset_t *self, print_job_t *print_job, ini_section_t *section)
 {
+	// a vector section without a usable colour cannot be applied to anything
 	ini_entry_t *color_entry = ini_section_lookup_entry(section, "color");
 	if (color_entry == NULL) {
-		exit(-1);
+		fprintf(stderr, "Vector section of preset %s has no color\n", self->name);
+		return NULL;
 	}
 
 	uint64_t vid;
 	int32_t rc = sscanf(color_entry->value, "%"SCNx64"", &vid);
-	if (rc != 1)
-		exit(-1);
+	if (rc != 1) {
+		fprintf(stderr, "Vector section of preset %s has an invalid color: %s\n", self->name, color_entry->value);
+		return NULL;
+	}
 
 	int32_t red, green, blue;
 	vector_list_config_id_to_rgb(vid, &red, &green, &blue);
@@ -158,12 +191,47 @@ static preset_t *preset_load_ini_section_vector(preset_t *self, print_job_t *pri
 	return self;
 }
 
+static preset_t *preset_load_ini_section_transform(preset_t *self, print_job_t *print_job, ini_section_t *section)
+{
+	if (print_job->transform == NULL)
+		print_job->transform = transform_create();
+
+	for (ini_entry_t *entry = section->entries; entry != NULL; entry = entry->next) {
+		switch (tolower(entry->key[0])) {
+		case 'o': { // offset (--offset=DX,DY)
+			if (transform_parse_offset(print_job->transform, entry->value)) {
+				fprintf(stderr, "Transform section of preset %s has an invalid offset: %s\n", self->name, entry->value);
+				return NULL;
+			}
+			break;
+		}
+		case 'r': { // rotation (--rotate=DEGREES)
+			if (transform_parse_rotation(print_job->transform, entry->value)) {
+				fprintf(stderr, "Transform section of preset %s has an invalid rotation: %s\n", self->name, entry->value);
+				return NULL;
+			}
+			break;
+		}
+		case 'm': { // mirror (--mirror)
+			print_job->transform->mirror = !strncasecmp(entry->value, "true", MAX_FIELD_LENGTH);
+			break;
+		}
+		default: {
+			// error
+		}
+		}
+	}
+
+	return self;
+}
+
 static preset_t *preset_load_ini_section_preset(preset_t * self, print_job_t *print_job, ini_section_t *section)
 {
 	for (ini_entry_t *entry = section->entries; entry != NULL; entry = entry->next) {
 		switch (tolower(entry->key[0])) {
 		case 'n': { // name
-			self->name = strndup(entry->value, MAX_FIELD_LENGTH);
+			memory_free_string(MEMORY_PRESET, self->name);
+			self->name = memory_strndup(MEMORY_PRESET, entry->value, MAX_FIELD_LENGTH);
 			break;
 		}
 		case 'a': { // autofocus (--autofocus, --no-autofocus)
@@ -211,6 +279,9 @@ static preset_t *preset_load_ini_section(preset_t * self, print_job_t *print_job
 	case 'r': { // raster
 		return preset_load_ini_section_raster(self, print_job, section);
 	}
+	case 't': { // transform
+		return preset_load_ini_section_transform(self, print_job, section);
+	}
 	case 'v': { // vector
 		return preset_load_ini_section_vector(self, print_job, section);
 	}
@@ -223,15 +294,23 @@ static preset_t *preset_load_ini_section(preset_t * self, print_job_t *print_job
 
 static preset_t *preset_load_ini_file(preset_t *self, print_job_t *print_job)
 {
+	if (self->config == NULL)
+		return NULL;
+
 	for (ini_section_t *section = self->config->sections; section != NULL; section = section->next) {
-		preset_load_ini_section(self, print_job, section);
+		if (preset_load_ini_section(self, print_job, section) == NULL)
+			return NULL;
 	}
 	return self;
 }
 
+/**
+ * Apply the settings of a preset to a print job. Sections are applied in
+ * order, so an invalid section leaves the ones before it applied.
+ *
+ * @return The preset, or NULL if it could not be applied.
+ */
 preset_t *preset_apply_to_print_job(preset_t *self, print_job_t *print_job)
 {
-	//
-	preset_load_ini_file(self, print_job);
-	return self;
+	return preset_load_ini_file(self, print_job);
 }
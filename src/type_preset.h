@@ -1,6 +1,7 @@
 #ifndef __PDF2LASER_TYPE_PRESET_H__
 #define __PDF2LASER_TYPE_PRESET_H__ 1
 
+#include <stddef.h>          // for size_t
 #include "type_print_job.h"  // for print_job_t
 #include "ini_file.h"        // for ini_file_t
 
@@ -20,6 +21,8 @@ struct preset {
 preset_t *preset_create(char *name);
 preset_t *preset_destroy(preset_t *self);
 
+preset_t *preset_parse(preset_t *self, const char *text, size_t length);
+
 preset_t *preset_apply_to_print_job(preset_t *self, print_job_t *print_job);
 
 #ifdef __cplusplus
@@ -1,38 +1,52 @@
 #include "type_preset_file.h"
-#include <fcntl.h>        // for open, O_RDONLY
-#include <stdio.h>        // for NULL
-#include <stdlib.h>       // for free, calloc
-#include <string.h>       // for strndup
-#include <sys/mman.h>     // for mmap, munmap, MAP_PRIVATE, PROT_READ
-#include <sys/stat.h>     // for fstat, stat
-#include <unistd.h>       // for close
-#include "config.h"       // for FILENAME_NCHARS
-#include "ini_parser.h"   // for ini_file_parse
-#include "libgen.h"       // for basename
-#include "type_preset.h"  // for preset_create, preset_destroy, preset_t
+#include <fcntl.h>             // for open, O_RDONLY
+#include <stdio.h>             // for NULL
+#include <stdlib.h>            // for free, calloc
+#include <string.h>            // for strndup
+#include <sys/mman.h>          // for mmap, munmap, MAP_FAILED, MAP_PRIVATE, PROT_READ
+#include <sys/stat.h>          // for fstat, stat
+#include <unistd.h>            // for close
+#include "config.h"            // for FILENAME_NCHARS
+#include "libgen.h"            // for basename
+#include "pdf2laser_memory.h"  // for memory_calloc, memory_free, memory_free_string, memory_strndup, MEMORY_PRESET
+#include "type_preset.h"       // for preset_create, preset_destroy, preset_parse, preset_t
 
+/**
+ * Load the preset stored in a file, named after the file until its own name
+ * is read.
+ *
+ * @return The preset file, or NULL if it could not be read or parsed.
+ */
 preset_file_t *preset_file_create(char *path)
 {
-	preset_file_t *preset_file = calloc(1, sizeof(preset_file_t));
-	preset_file->path = strndup(path, FILENAME_NCHARS);
-
-	char *preset_basename = strndup(path, FILENAME_NCHARS);
-	preset_file->preset = preset_create(basename(preset_basename));
-
 	int source_fd = open(path, O_RDONLY);
+	if (source_fd == -1)
+		return NULL;
 
 	struct stat stat;
-	fstat(source_fd, &stat);
+	if (fstat(source_fd, &stat) || stat.st_size == 0) {
+		close(source_fd);
+		return NULL;
+	}
 
 	char *mmap_data = mmap((void*)NULL, stat.st_size, PROT_READ, MAP_PRIVATE, source_fd, 0);
-	char *buffer = mmap_data;
+	close(source_fd);
+	if (mmap_data == MAP_FAILED)
+		return NULL;
 
-	ini_file_parse(buffer, &(preset_file->preset->config));
+	preset_file_t *preset_file = memory_calloc(MEMORY_PRESET, 1, sizeof(preset_file_t));
+	preset_file->path = memory_strndup(MEMORY_PRESET, path, FILENAME_NCHARS);
 
+	char *preset_basename = strndup(path, FILENAME_NCHARS);
+	preset_file->preset = preset_create(basename(preset_basename));
 	free(preset_basename);
 
+	preset_t *preset = preset_parse(preset_file->preset, mmap_data, stat.st_size);
+
 	munmap((void*)mmap_data, stat.st_size);
-	close(source_fd);
+
+	if (preset == NULL)
+		return preset_file_destroy(preset_file);
 
 	return preset_file;
 }
@@ -42,11 +56,11 @@ preset_file_t *preset_file_destroy(preset_file_t *self)
 	if (self == NULL)
 		return NULL;
 
-	free(self->path);
+	memory_free_string(MEMORY_PRESET, self->path);
 
 	preset_destroy(self->preset);
 
-	free(self);
+	memory_free(MEMORY_PRESET, self, sizeof(preset_file_t));
 
 	return NULL;
 }
@@ -5,23 +5,51 @@
 #include <stdio.h>                    // for snprintf
 #include <stdlib.h>                   // for free, calloc
 #include <string.h>                   // for strlen, strndup
-#include "config.h"                   // for BED_HEIGHT, BED_WIDTH, DEBUG, DEFAULT_HOST, HOSTNAME_NCHARS
+#include "config.h"                   // for BED_HEIGHT, BED_WIDTH, DEBUG, DEFAULT_HOST, HOSTNAME_NCHARS, SEND_BUFFER_SIZE, TCP_CORK_DEFAULT, TCP_NODELAY_DEFAULT
+#include "type_calibration.h"         // for calibration_destroy
+#include "type_estimate.h"            // for estimate_destroy
+#include "type_image.h"               // for image_destroy
+#include "type_kinematics.h"          // for kinematics_create, kinematics_destroy
+#include "type_optimizer_report.h"    // for optimizer_report_destroy
 #include "type_raster.h"              // for raster_t, raster_create, raster_destroy
+#include "type_timings.h"             // for timings_destroy
+#include "type_transform.h"           // for transform_destroy
 #include "type_vector_list_config.h"  // for vector_list_config_t, vector_list_config_create, vector_list_config_destroy, vector_list_config_rgb_to_id, vector_list_config_shallow_clone, vector_list_config_to_string
 
 print_job_t *print_job_create(void)
 {
 	print_job_t *print_job = calloc(1, sizeof(print_job_t));
 	print_job->raster = raster_create();
+	print_job->image = NULL;
+	print_job->calibration = NULL;
 
 	print_job->host = strndup(DEFAULT_HOST, HOSTNAME_NCHARS);
+	print_job->fleet_filename = NULL;
+	print_job->output_filename = NULL;
+	print_job->send_buffer_size = SEND_BUFFER_SIZE;
+	print_job->tcp_nodelay = TCP_NODELAY_DEFAULT;
+	print_job->tcp_cork = TCP_CORK_DEFAULT;
 	print_job->mode = PRINT_JOB_MODE_COMBINED;
 	print_job->height = BED_HEIGHT;
 	print_job->width = BED_WIDTH;
+	print_job->array_columns = 1;
+	print_job->array_rows = 1;
+	print_job->pitch_x = 0.0;
+	print_job->pitch_y = 0.0;
+	print_job->transform = NULL;
 	print_job->focus = false;
 	print_job->vector_optimize = true;
 	print_job->vector_fallthrough = true;
+	print_job->vector_stats = true;
 	print_job->configs = NULL;
+	print_job->query_status = false;
+	print_job->kinematics = kinematics_create();
+	print_job->estimate = NULL;
+	print_job->estimate_only = false;
+	print_job->timings = NULL;
+	print_job->optimizer_report = NULL;
+	print_job->trace_filename = NULL;
+	print_job->profile_counters = false;
 	print_job->debug = DEBUG;
 
 	return print_job;
@@ -34,9 +62,19 @@ print_job_t *print_job_destroy(print_job_t *self)
 
 	free(self->source_filename);
 	free(self->host);
+	free(self->fleet_filename);
+	free(self->output_filename);
+	free(self->trace_filename);
 	free(self->name);
 
 	raster_destroy(self->raster);
+	image_destroy(self->image);
+	calibration_destroy(self->calibration);
+	transform_destroy(self->transform);
+	kinematics_destroy(self->kinematics);
+	estimate_destroy(self->estimate);
+	timings_destroy(self->timings);
+	optimizer_report_destroy(self->optimizer_report);
 
 	size_t config_count = 0;
 	for (vector_list_config_t *config = self->configs; config != NULL; config = config->next) {
@@ -58,6 +96,68 @@ print_job_t *print_job_destroy(print_job_t *self)
 	return NULL;
 }
 
+/**
+ * Perform range validation checks on the settings of a print job to ensure
+ * their values are sane. If values are outside accepted tolerances then modify
+ * them to be the correct value.
+ *
+ * @return Nothing
+ */
+void print_job_range_check(print_job_t *self)
+{
+	if (self->raster->power > 100) {
+		self->raster->power = 100;
+	}
+	else if (self->raster->power < 0) {
+		self->raster->power = 0;
+	}
+
+	if (self->raster->speed > 100) {
+		self->raster->speed = 100;
+	}
+	else if (self->raster->speed < 1) {
+		self->raster->speed = 1;
+	}
+
+	if (self->raster->resolution > 1200) {
+		self->raster->resolution = 1200;
+	}
+	else if (self->raster->resolution < 75) {
+		self->raster->resolution = 75;
+	}
+
+	if (self->raster->screen_size < 1) {
+		self->raster->screen_size = 1;
+	}
+
+	for (vector_list_config_t *current_config = self->configs; current_config != NULL; current_config = current_config->next) {
+		if (current_config->power > 100) {
+			current_config->power = 100;
+		}
+		else if (current_config->power < 0) {
+			current_config->power = 0;
+		}
+
+		if (current_config->speed > 100) {
+			current_config->speed = 100;
+		}
+		else if (current_config->speed < 1) {
+			current_config->speed = 1;
+		}
+
+		if (current_config->multipass < 1) {
+			current_config->multipass = 1;
+		}
+
+		if (current_config->frequency < 10) {
+			current_config->frequency = 10;
+		}
+		else if (current_config->frequency > 5000) {
+			current_config->frequency = 5000;
+		}
+	}
+}
+
 char *print_job_inspect(print_job_t *self)
 {
 	char *s = calloc(30, sizeof(char));
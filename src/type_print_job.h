@@ -3,7 +3,14 @@
 
 #include <stdbool.h>                  // for bool
 #include <stdint.h>                   // for int32_t, uint32_t
+#include "type_calibration.h"         // for calibration_t
+#include "type_estimate.h"            // for estimate_t
+#include "type_image.h"               // for image_t
+#include "type_kinematics.h"          // for kinematics_t
+#include "type_optimizer_report.h"    // for optimizer_report_t
 #include "type_raster.h"              // for raster_t
+#include "type_timings.h"             // for timings_t
+#include "type_transform.h"           // for transform_t
 #include "type_vector_list_config.h"  // for vector_list_config_t
 
 #ifdef __cplusplus
@@ -23,6 +30,12 @@ typedef struct print_job print_job_t;
 struct print_job {
 	char *source_filename;
 	char *host;
+	char *fleet_filename;
+	char *output_filename;  // write the pjl here instead of sending it when set
+
+	int32_t send_buffer_size;
+	bool tcp_nodelay;
+	bool tcp_cork;
 
 	char *name;
 	bool focus;
@@ -32,13 +45,34 @@ struct print_job {
 	uint32_t height;
 	uint32_t width;
 
+	int32_t array_columns;  // copies across of a step and repeat array, 1 for one copy
+	int32_t array_rows;     // copies down
+	double pitch_x;         // distance between copies across, in inches
+	double pitch_y;         // distance between copies down, in inches
+
+	transform_t *transform;  // NULL unless the job is moved, turned or mirrored on the bed
+
 	raster_t *raster;
+	image_t *image;              // NULL unless the raster is read straight from an image file
+	calibration_t *calibration;  // NULL unless a calibration card is drawn instead of reading a source
 
 	bool vector_optimize;
 	bool vector_fallthrough;
+	bool vector_stats;  // print the cut and move totals of each optimized layer
 
 	vector_list_config_t *configs;
 
+	bool query_status;
+
+	kinematics_t *kinematics;              // machine model used to estimate the job duration
+	estimate_t *estimate;                  // NULL unless the job duration is to be estimated
+	bool estimate_only;                    // report the estimated duration instead of sending
+
+	timings_t *timings;                    // NULL unless a timing report was requested
+	optimizer_report_t *optimizer_report;  // NULL unless an optimizer report was requested
+	char *trace_filename;                  // NULL unless a trace was requested
+	bool profile_counters;                 // add hardware counters to the timing report
+
 	bool debug;
 };
 
@@ -50,6 +84,8 @@ char *print_job_to_string(print_job_t *self);
 
 print_job_t *print_job_merge(print_job_t *self, print_job_t *other);
 
+void print_job_range_check(print_job_t *self);
+
 vector_list_config_t *print_job_clone_last_vector_list_config(print_job_t *self, int32_t red, int32_t green, int32_t blue);
 vector_list_config_t *print_job_append_new_vector_list_config(print_job_t *self, int32_t red, int32_t green, int32_t blue);
 
@@ -0,0 +1,93 @@
+#include "type_printer.h"
+#include <inttypes.h>            // for PRIxPTR, PRId32, PRIu32
+#include <stdbool.h>             // for bool
+#include <stddef.h>              // for NULL, size_t
+#include <stdio.h>               // for snprintf
+#include <stdlib.h>              // for calloc, free
+#include <string.h>              // for strndup
+#include "config.h"              // for BED_HEIGHT, BED_WIDTH, HOSTNAME_NCHARS, PRINTER_RATE
+#include "pdf2laser_estimate.h"  // for estimate_print_job
+#include "type_kinematics.h"     // for kinematics_create, kinematics_destroy
+#include "type_print_job.h"      // for print_job_t
+#include "type_raster.h"         // for raster_t
+
+printer_t *printer_create(char *host)
+{
+	printer_t *printer = calloc(1, sizeof(printer_t));
+
+	printer->host = strndup(host, HOSTNAME_NCHARS);
+	printer->height = BED_HEIGHT;
+	printer->width = BED_WIDTH;
+	printer->resolution = 1200;
+	printer->rate = PRINTER_RATE;
+	printer->kinematics = kinematics_create();
+	printer->online = true;
+	printer->queue_depth = 0;
+	printer->pending_seconds = 0.0;
+	printer->next = NULL;
+
+	return printer;
+}
+
+printer_t *printer_destroy(printer_t *self)
+{
+	if (self == NULL)
+		return NULL;
+
+	free(self->host);
+	kinematics_destroy(self->kinematics);
+	free(self);
+
+	return NULL;
+}
+
+char *printer_inspect(printer_t *self)
+{
+	char *s = calloc(29, sizeof(char));
+	snprintf(s, 29, "<Printer:0x%016"PRIxPTR">", (uintptr_t)self);
+	return s;
+}
+
+char *printer_to_string(printer_t *self)
+{
+	static char *template = "Printer: host=%s bed=%"PRIu32"x%"PRIu32" dpi=%"PRIu32" online=%s queue=%"PRId32" pending=%.0fs";
+
+	const char *online = self->online ? "true" : "false";
+
+	size_t s_len = 1 + snprintf(NULL, 0, template, self->host, self->width, self->height, self->resolution, online, self->queue_depth, self->pending_seconds);
+
+	char *s = calloc(s_len, sizeof(char));
+	snprintf(s, s_len, template, self->host, self->width, self->height, self->resolution, online, self->queue_depth, self->pending_seconds);
+	return s;
+}
+
+bool printer_accepts_print_job(printer_t *self, print_job_t *print_job)
+{
+	if (!self->online)
+		return false;
+
+	if (print_job->width > self->width || print_job->height > self->height)
+		return false;
+
+	if (print_job->raster->resolution > self->resolution)
+		return false;
+
+	return true;
+}
+
+/**
+ * Estimate how long a job keeps the machine busy. Jobs generated with an
+ * estimate are timed against the motion limits of the printer, others are
+ * roughly derived from the size of the generated pjl and the configured
+ * intake rate of the printer.
+ */
+double printer_estimate_seconds(printer_t *self, print_job_t *print_job, size_t job_size)
+{
+	if (print_job->estimate != NULL)
+		return estimate_print_job(print_job, self->kinematics, NULL);
+
+	if (self->rate == 0)
+		return 0.0;
+
+	return (double)job_size / (double)self->rate;
+}
@@ -0,0 +1,48 @@
+#ifndef __PDF2LASER_TYPE_PRINTER_H__
+#define __PDF2LASER_TYPE_PRINTER_H__ 1
+
+#include <stdbool.h>          // for bool
+#include <stddef.h>           // for size_t
+#include <stdint.h>           // for int32_t, uint32_t
+#include "type_kinematics.h"  // for kinematics_t
+#include "type_print_job.h"   // for print_job_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+typedef struct printer printer_t;
+struct printer {
+	char *host;
+
+	uint32_t height;      // bed height (y-axis) in pts
+	uint32_t width;       // bed width (x-axis) in pts
+	uint32_t resolution;  // maximum supported DPI
+	uint32_t rate;        // pjl bytes consumed per second of machine time
+
+	kinematics_t *kinematics;  // motion limits used to estimate job durations
+
+	bool online;
+	int32_t queue_depth;
+	double pending_seconds;
+
+	printer_t *next;
+};
+
+printer_t *printer_create(char *host);
+printer_t *printer_destroy(printer_t *self);
+
+char *printer_inspect(printer_t *self);
+char *printer_to_string(printer_t *self);
+
+bool printer_accepts_print_job(printer_t *self, print_job_t *print_job);
+double printer_estimate_seconds(printer_t *self, print_job_t *print_job, size_t job_size);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,273 @@
+#include "type_timings.h"
+#include <inttypes.h>            // for PRIu32, PRIu64
+#include <stdbool.h>             // for bool, false, true
+#include <stdio.h>               // for fprintf, fclose, open_memstream, FILE, NULL
+#include <stdlib.h>              // for calloc, free, realloc
+#include <string.h>              // for strcmp
+#include "pdf2laser_counters.h"  // for counters_available, counters_destroy, counters_read, counter_id_to_string, COUNTERS_LENGTH, COUNTER_CYCLES, COUNTER_INSTRUCTIONS
+#include "pdf2laser_memory.h"    // for memory_category_to_string, memory_peak_rss, memory_stats, memory_stats_t, MEMORY_CATEGORIES_LENGTH
+#include "pdf2laser_trace.h"     // for trace_begin, trace_end
+#include "pdf2laser_util.h"      // for pdf2laser_clock
+
+timings_t *timings_create(timings_format format)
+{
+	timings_t *timings = calloc(1, sizeof(timings_t));
+
+	timings->format = format;
+	timings->start = pdf2laser_clock();
+	timings->counters = NULL;
+	timings->stages = NULL;
+	timings->stages_length = 0;
+	timings->stages_capacity = 0;
+	timings->depth = 0;
+	timings->overflow = 0;
+
+	return timings;
+}
+
+timings_t *timings_destroy(timings_t *self)
+{
+	if (self == NULL)
+		return NULL;
+
+	counters_destroy(self->counters);
+	free(self->stages);
+	free(self);
+
+	return NULL;
+}
+
+static size_t timings_find_stage(timings_t *self, const char *name)
+{
+	bool top_level = (self->depth == 0);
+	size_t parent = top_level ? 0 : self->stack[self->depth - 1];
+
+	for (size_t index = 0; index < self->stages_length; index += 1) {
+		timing_stage_t *stage = &(self->stages[index]);
+		if (stage->depth != self->depth || strcmp(stage->name, name))
+			continue;
+		if (top_level || stage->parent == parent)
+			return index;
+	}
+
+	if (self->stages_length == self->stages_capacity) {
+		self->stages_capacity = self->stages_capacity ? 2 * self->stages_capacity : 16;
+		self->stages = realloc(self->stages, self->stages_capacity * sizeof(timing_stage_t));
+	}
+
+	size_t index = self->stages_length;
+	self->stages_length += 1;
+
+	self->stages[index] = (timing_stage_t){
+		.name = name,
+		.parent = top_level ? index : parent,
+		.depth = self->depth,
+		.calls = 0,
+		.seconds = 0.0,
+		.start = 0.0,
+		.peak_rss = 0,
+		.counts = { 0 },
+		.counts_start = { 0 },
+	};
+
+	return index;
+}
+
+/**
+ * Enter a stage of the pipeline. Stages nest, and entering a stage with the
+ * same name under the same parent again accumulates into the same entry.
+ *
+ * Does nothing when self is NULL so that call sites need not check whether
+ * timings were requested. The stage is also recorded by the trace recorder
+ * when one is running.
+ */
+void timings_begin(timings_t *self, const char *name)
+{
+	trace_begin(name);
+
+	if (self == NULL)
+		return;
+
+	if (self->depth >= TIMINGS_MAX_DEPTH) {
+		self->overflow += 1;
+		return;
+	}
+
+	size_t index = timings_find_stage(self, name);
+	self->stack[self->depth] = index;
+	self->depth += 1;
+
+	timing_stage_t *stage = &(self->stages[index]);
+	stage->calls += 1;
+
+	if (self->counters != NULL)
+		counters_read(self->counters, stage->counts_start);
+
+	stage->start = pdf2laser_clock();
+}
+
+/**
+ * Leave the innermost stage. Stages entered too deep to be tracked are left
+ * without touching the stack, so that every end still pairs with its begin.
+ */
+void timings_end(timings_t *self)
+{
+	trace_end();
+
+	if (self == NULL || self->depth == 0)
+		return;
+
+	if (self->overflow > 0) {
+		self->overflow -= 1;
+		return;
+	}
+
+	self->depth -= 1;
+	timing_stage_t *stage = &(self->stages[self->stack[self->depth]]);
+	stage->seconds += pdf2laser_clock() - stage->start;
+
+	uint64_t peak_rss = memory_peak_rss();
+	if (peak_rss > stage->peak_rss)
+		stage->peak_rss = peak_rss;
+
+	uint64_t counts[COUNTERS_LENGTH];
+	if (self->counters != NULL && !counters_read(self->counters, counts)) {
+		for (uint32_t index = 0; index < COUNTERS_LENGTH; index += 1)
+			stage->counts[index] += counts[index] - stage->counts_start[index];
+	}
+}
+
+static void timings_write_table(timings_t *self, FILE *stream, size_t index, double total)
+{
+	timing_stage_t *stage = &(self->stages[index]);
+
+	int indent = 2 * stage->depth;
+	int width = 32 - indent;
+	double share = (total > 0.0) ? (100.0 * stage->seconds / total) : 0.0;
+	fprintf(stream, "\n%*s%-*s %6"PRIu32" %10.3f %6.1f%% %10"PRIu64, indent, "", width, stage->name, stage->calls, stage->seconds, share, stage->peak_rss);
+
+	if (self->counters != NULL) {
+		for (uint32_t counter = 0; counter < COUNTERS_LENGTH; counter += 1) {
+			if (counters_available(self->counters, counter))
+				fprintf(stream, " %14"PRIu64, stage->counts[counter]);
+			else
+				fprintf(stream, " %14s", "-");
+		}
+
+		uint64_t cycles = stage->counts[COUNTER_CYCLES];
+		double ipc = cycles ? ((double)stage->counts[COUNTER_INSTRUCTIONS] / cycles) : 0.0;
+		fprintf(stream, " %5.2f", ipc);
+	}
+
+	for (size_t child = index + 1; child < self->stages_length; child += 1) {
+		if (self->stages[child].parent == index)
+			timings_write_table(self, stream, child, total);
+	}
+}
+
+static void timings_write_path(timings_t *self, FILE *stream, size_t index)
+{
+	timing_stage_t *stage = &(self->stages[index]);
+	if (stage->parent != index) {
+		timings_write_path(self, stream, stage->parent);
+		fprintf(stream, "/");
+	}
+	fprintf(stream, "%s", stage->name);
+}
+
+static void timings_write_json(timings_t *self, FILE *stream, size_t index, bool *first)
+{
+	timing_stage_t *stage = &(self->stages[index]);
+
+	fprintf(stream, "%s{\"name\":\"%s\",\"path\":\"", *first ? "" : ",", stage->name);
+	timings_write_path(self, stream, index);
+	fprintf(stream, "\",\"depth\":%"PRIu32",\"calls\":%"PRIu32",\"seconds\":%.6f,\"peak_rss_kib\":%"PRIu64, stage->depth, stage->calls, stage->seconds, stage->peak_rss);
+
+	for (uint32_t counter = 0; counter < COUNTERS_LENGTH; counter += 1) {
+		if (counters_available(self->counters, counter))
+			fprintf(stream, ",\"%s\":%"PRIu64, counter_id_to_string(counter), stage->counts[counter]);
+	}
+
+	fprintf(stream, "}");
+	*first = false;
+
+	for (size_t child = index + 1; child < self->stages_length; child += 1) {
+		if (self->stages[child].parent == index)
+			timings_write_json(self, stream, child, first);
+	}
+}
+
+/**
+ * Render the stages as an indented table with the number of calls, the time
+ * spent, the share of the total run time and the peak resident set size of
+ * each, followed by the allocation counters of each memory category.
+ */
+char *timings_to_string(timings_t *self)
+{
+	char *s = NULL;
+	size_t s_len = 0;
+	FILE *stream = open_memstream(&s, &s_len);
+
+	double total = pdf2laser_clock() - self->start;
+
+	fprintf(stream, "Timings:\n%-32s %6s %10s %7s %10s", "Stage", "Calls", "Seconds", "Share", "RSS (KiB)");
+	if (self->counters != NULL) {
+		for (uint32_t counter = 0; counter < COUNTERS_LENGTH; counter += 1)
+			fprintf(stream, " %14s", counter_id_to_string(counter));
+		fprintf(stream, " %5s", "IPC");
+	}
+	for (size_t index = 0; index < self->stages_length; index += 1) {
+		if (self->stages[index].parent == index)
+			timings_write_table(self, stream, index, total);
+	}
+	fprintf(stream, "\n%-32s %6s %10.3f %6.1f%% %10"PRIu64, "Total", "", total, 100.0, memory_peak_rss());
+
+	fprintf(stream, "\n\nMemory:\n%-32s %12s %12s %12s %12s", "Category", "Allocations", "Frees", "Live bytes", "Peak bytes");
+	for (uint32_t category = 0; category < MEMORY_CATEGORIES_LENGTH; category += 1) {
+		memory_stats_t *stats = memory_stats(category);
+		fprintf(stream, "\n%-32s %12"PRIu64" %12"PRIu64" %12"PRIu64" %12"PRIu64, memory_category_to_string(category), stats->allocations, stats->frees, stats->bytes, stats->peak_bytes);
+	}
+
+	fclose(stream);
+	return s;
+}
+
+/**
+ * Render the stages as a single line JSON document. Stages are listed in
+ * pipeline order, each with a slash separated path naming its parents.
+ */
+char *timings_to_json(timings_t *self)
+{
+	char *s = NULL;
+	size_t s_len = 0;
+	FILE *stream = open_memstream(&s, &s_len);
+
+	double total = pdf2laser_clock() - self->start;
+
+	fprintf(stream, "{\"total_seconds\":%.6f,\"stages\":[", total);
+	bool first = true;
+	for (size_t index = 0; index < self->stages_length; index += 1) {
+		if (self->stages[index].parent == index)
+			timings_write_json(self, stream, index, &first);
+	}
+	fprintf(stream, "],\"peak_rss_kib\":%"PRIu64",\"memory\":{", memory_peak_rss());
+	for (uint32_t category = 0; category < MEMORY_CATEGORIES_LENGTH; category += 1) {
+		memory_stats_t *stats = memory_stats(category);
+		fprintf(stream, "%s\"%s\":{\"allocations\":%"PRIu64",\"frees\":%"PRIu64",\"bytes\":%"PRIu64",\"peak_bytes\":%"PRIu64"}", category ? "," : "", memory_category_to_string(category), stats->allocations, stats->frees, stats->bytes, stats->peak_bytes);
+	}
+	fprintf(stream, "}}");
+
+	fclose(stream);
+	return s;
+}
+
+/**
+ * Render the stages in the format requested on creation.
+ */
+char *timings_report(timings_t *self)
+{
+	if (self->format == TIMINGS_FORMAT_JSON)
+		return timings_to_json(self);
+
+	return timings_to_string(self);
+}
@@ -0,0 +1,68 @@
+#ifndef __PDF2LASER_TYPE_TIMINGS_H__
+#define __PDF2LASER_TYPE_TIMINGS_H__ 1
+
+#include <stdbool.h>             // for bool
+#include <stddef.h>              // for size_t
+#include <stdint.h>              // for uint32_t, uint64_t
+#include "pdf2laser_counters.h"  // for counters_t, COUNTERS_LENGTH
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/** Deepest nesting of stages which is tracked. */
+#define TIMINGS_MAX_DEPTH (16)
+
+typedef enum {
+	TIMINGS_FORMAT_TABLE,
+	TIMINGS_FORMAT_JSON,
+} timings_format;
+
+typedef struct timing_stage timing_stage_t;
+struct timing_stage {
+	const char *name;
+	size_t parent;      // index of the enclosing stage, or the stage itself at the top level
+	uint32_t depth;
+	uint32_t calls;     // number of times the stage was entered
+	double seconds;     // total time spent in the stage
+	double start;       // monotonic clock when the stage was last entered
+	uint64_t peak_rss;  // largest resident set size seen on leaving the stage, in KiB
+
+	uint64_t counts[COUNTERS_LENGTH];        // hardware events spent in the stage
+	uint64_t counts_start[COUNTERS_LENGTH];  // counter values when the stage was last entered
+};
+
+typedef struct timings timings_t;
+struct timings {
+	timings_format format;
+	double start;
+
+	counters_t *counters;  // NULL unless hardware counters were requested
+
+	timing_stage_t *stages;
+	size_t stages_length;
+	size_t stages_capacity;
+
+	size_t stack[TIMINGS_MAX_DEPTH];
+	uint32_t depth;
+	uint32_t overflow;  // stages entered beyond TIMINGS_MAX_DEPTH, which are not tracked
+};
+
+timings_t *timings_create(timings_format format);
+timings_t *timings_destroy(timings_t *self);
+
+void timings_begin(timings_t *self, const char *name);
+void timings_end(timings_t *self);
+
+char *timings_to_string(timings_t *self);
+char *timings_to_json(timings_t *self);
+char *timings_report(timings_t *self);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,158 @@
+#include "type_transform.h"
+#include <inttypes.h>  // for PRId32
+#include <math.h>      // for lround
+#include <stdint.h>    // for INT32_MAX, INT32_MIN
+#include <stdio.h>     // for snprintf, sscanf
+#include <stdlib.h>    // for calloc, free, strtol, NULL
+
+transform_t *transform_create(void)
+{
+	transform_t *transform = calloc(1, sizeof(transform_t));
+
+	transform->offset_x = 0.0;
+	transform->offset_y = 0.0;
+	transform->rotation = 0;
+	transform->mirror = false;
+
+	transform_frame_clear(transform);
+
+	return transform;
+}
+
+transform_t *transform_destroy(transform_t *self)
+{
+	if (self == NULL)
+		return NULL;
+
+	free(self);
+
+	return NULL;
+}
+
+char *transform_to_string(transform_t *self)
+{
+	static char *template = "Transform: offset=%.3fin,%.3fin rotation=%"PRId32" mirror=%s";
+
+	const char *mirror = self->mirror ? "yes" : "no";
+
+	size_t s_len = 1 + snprintf(NULL, 0, template, self->offset_x, self->offset_y, self->rotation, mirror);
+
+	char *s = calloc(s_len, sizeof(char));
+	snprintf(s, s_len, template, self->offset_x, self->offset_y, self->rotation, mirror);
+	return s;
+}
+
+/**
+ * Parse an offset given as DX,DY in inches, either of which may be negative
+ * to move the job up or to the left.
+ *
+ * @return 0 on success, -1 if the text is invalid, leaving the offset as it was.
+ */
+int transform_parse_offset(transform_t *self, const char *text)
+{
+	double offset_x, offset_y;
+	if (sscanf(text, "%lf,%lf", &offset_x, &offset_y) != 2)
+		return -1;
+
+	self->offset_x = offset_x;
+	self->offset_y = offset_y;
+
+	return 0;
+}
+
+/**
+ * Parse a clockwise rotation in degrees, which must be a multiple of 90.
+ * Anticlockwise rotations are given as negative values.
+ *
+ * @return 0 on success, -1 if the text is invalid, leaving the rotation as it was.
+ */
+int transform_parse_rotation(transform_t *self, const char *text)
+{
+	char *end;
+	long rotation = strtol(text, &end, 10);
+	if (end == text || *end != '\0' || rotation % 90 != 0)
+		return -1;
+
+	self->rotation = (int32_t)(((rotation % 360) + 360) % 360);
+
+	return 0;
+}
+
+/**
+ * Whether the transform turns or mirrors the job, which needs the frame of
+ * the job, rather than only moving it.
+ */
+bool transform_turns(transform_t *self)
+{
+	return self->rotation != 0 || self->mirror;
+}
+
+void transform_frame_clear(transform_t *self)
+{
+	self->left = INT32_MAX;
+	self->top = INT32_MAX;
+	self->right = INT32_MIN;
+	self->bottom = INT32_MIN;
+}
+
+/**
+ * Grow the frame to take in a point of the job.
+ */
+void transform_frame_include(transform_t *self, int32_t x, int32_t y)
+{
+	if (x < self->left)
+		self->left = x;
+	if (x > self->right)
+		self->right = x;
+	if (y < self->top)
+		self->top = y;
+	if (y > self->bottom)
+		self->bottom = y;
+}
+
+/**
+ * Move a point of the job, in device units, to where the transform places
+ * it. A turned frame keeps its top left corner, so a job turned on its side
+ * grows to the right and down from where it was.
+ */
+void transform_point(transform_t *self, uint32_t resolution, int32_t *x, int32_t *y)
+{
+	int32_t offset_x = lround(self->offset_x * resolution);
+	int32_t offset_y = lround(self->offset_y * resolution);
+
+	if (!transform_turns(self)) {
+		*x += offset_x;
+		*y += offset_y;
+		return;
+	}
+
+	int32_t width = self->right - self->left;
+	int32_t height = self->bottom - self->top;
+	int32_t u = *x - self->left;
+	int32_t v = *y - self->top;
+
+	if (self->mirror)
+		u = width - u;
+
+	int32_t turned_u, turned_v;
+	switch (self->rotation) {
+	case 90:
+		turned_u = height - v;
+		turned_v = u;
+		break;
+	case 180:
+		turned_u = width - u;
+		turned_v = height - v;
+		break;
+	case 270:
+		turned_u = v;
+		turned_v = width - u;
+		break;
+	default:
+		turned_u = u;
+		turned_v = v;
+	}
+
+	*x = self->left + turned_u + offset_x;
+	*y = self->top + turned_v + offset_y;
+}
@@ -0,0 +1,53 @@
+#ifndef __PDF2LASER_TYPE_TRANSFORM_H__
+#define __PDF2LASER_TYPE_TRANSFORM_H__ 1
+
+#include <stdbool.h>  // for bool
+#include <stdint.h>   // for int32_t, uint32_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+/**
+ * Where a rendered job is placed on the bed: mirrored, turned clockwise in
+ * its frame around the top left corner of the frame, then moved by the
+ * offset. The frame is the extent of everything the job engraves and cuts,
+ * so that both passes turn together.
+ */
+typedef struct transform transform_t;
+struct transform {
+	double offset_x;   // in inches, to the right
+	double offset_y;   // in inches, down
+	int32_t rotation;  // clockwise, in degrees: 0, 90, 180 or 270
+	bool mirror;       // flipped left to right before turning
+
+	// frame in device units, found when the job is generated
+	int32_t left;
+	int32_t top;
+	int32_t right;
+	int32_t bottom;
+};
+
+transform_t *transform_create(void);
+transform_t *transform_destroy(transform_t *self);
+
+char *transform_to_string(transform_t *self);
+
+int transform_parse_offset(transform_t *self, const char *text);
+int transform_parse_rotation(transform_t *self, const char *text);
+
+bool transform_turns(transform_t *self);
+
+void transform_frame_clear(transform_t *self);
+void transform_frame_include(transform_t *self, int32_t x, int32_t y);
+
+void transform_point(transform_t *self, uint32_t resolution, int32_t *x, int32_t *y);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
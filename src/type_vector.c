@@ -1,8 +1,8 @@
 #include "type_vector.h"
-#include <math.h>        // for atan2
-#include <stdio.h>       // for NULL
-#include <stdlib.h>      // for calloc, free
-#include "type_point.h"  // for point_t, point_create, point_destroy
+#include <math.h>              // for atan2
+#include <stdio.h>             // for NULL
+#include "pdf2laser_memory.h"  // for memory_calloc, memory_free, MEMORY_VECTOR
+#include "type_point.h"        // for point_t, point_create, point_destroy
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -10,7 +10,7 @@
 
 vector_t *vector_create(int32_t start_x, int32_t start_y, int32_t end_x, int32_t end_y)
 {
-	vector_t *vector = calloc(1, sizeof(vector_t));
+	vector_t *vector = memory_calloc(MEMORY_VECTOR, 1, sizeof(vector_t));
 
 	vector->start = point_create(start_x, start_y);
 	vector->end = point_create(end_x, end_y);
@@ -26,7 +26,7 @@ vector_t *vector_destroy(vector_t *self)
 	point_destroy(self->start);
 	point_destroy(self->end);
 
-	free(self);
+	memory_free(MEMORY_VECTOR, self, sizeof(vector_t));
 
 	return NULL;
 }
@@ -1,13 +1,15 @@
 #include "type_vector_list.h"
-#include <inttypes.h>     // for PRId32, PRId64
-#include <math.h>         // for pow, powl, sqrt
-#include <stdio.h>        // for NULL, printf, size_t
-#include <stdlib.h>       // for calloc, free
-#include "type_vector.h"  // for vector_t, vector_compare, vector_destroy, vector_flip
+#include <inttypes.h>          // for PRId32, PRId64
+#include <math.h>              // for hypot, llround, powl
+#include <stdbool.h>           // for bool
+#include <stdio.h>             // for NULL, printf, size_t
+#include "pdf2laser_memory.h"  // for memory_calloc, memory_free, MEMORY_VECTOR
+#include "type_transform.h"    // for transform_point, transform_t
+#include "type_vector.h"       // for vector_t, vector_compare, vector_create, vector_destroy, vector_flip
 
 vector_list_t *vector_list_create(void)
 {
-	vector_list_t *list = calloc(1, sizeof(vector_list_t));
+	vector_list_t *list = memory_calloc(MEMORY_VECTOR, 1, sizeof(vector_list_t));
 	list->head = NULL;
 	list->tail = NULL;
 	list->length = 0;
@@ -19,18 +21,14 @@ vector_list_t *vector_list_destroy(vector_list_t *self)
 	if (self == NULL)
 		return NULL;
 
-	vector_t *vectors[self->length];
-	size_t index = 0;
-	for (vector_t *vector = self->head; vector != NULL; vector = vector->next) {
-		vectors[index] = vector;
-		index += 1;
-	}
-
-	for (index = 0; index < (size_t)self->length; index += 1) {
-		vector_destroy(vectors[index]);
+	vector_t *vector = self->head;
+	while (vector != NULL) {
+		vector_t *next = vector->next;
+		vector_destroy(vector);
+		vector = next;
 	}
 
-	free(self);
+	memory_free(MEMORY_VECTOR, self, sizeof(vector_list_t));
 
 	return NULL;
 }
@@ -78,7 +76,7 @@ vector_t *vector_list_remove(vector_list_t *self, vector_t *vector)
 	}
 
 	// reduce length
-	self->length -= 0;
+	self->length -= 1;
 
 	// return pointer to be freed
 	return vector;
@@ -98,6 +96,103 @@ int vector_list_contains(vector_list_t *self, vector_t *vector)
 	return -1;
 }
 
+/**
+ * Remove every vector which compares equal to one earlier in the list.
+ *
+ * @return The number of vectors removed.
+ */
+size_t vector_list_dedup(vector_list_t *self)
+{
+	size_t removed = 0;
+
+	vector_t *vector = self->head;
+	while (vector) {
+		vector_t *next = vector->next;
+		for (vector_t *earlier = self->head; earlier != vector; earlier = earlier->next) {
+			if (vector_compare(vector, earlier) == 0) {
+				vector_destroy(vector_list_remove(self, vector));
+				removed += 1;
+				break;
+			}
+		}
+		vector = next;
+	}
+
+	return removed;
+}
+
+/**
+ * Append copies of the vectors of a list laid out as a step and repeat
+ * array, columns across and rows down, the list itself being the copy at the
+ * top left. Vectors of a copy which leave the area from the origin to width
+ * and height are dropped.
+ *
+ * @return The number of vectors appended.
+ */
+size_t vector_list_repeat(vector_list_t *self, int32_t columns, int32_t rows, int32_t pitch_x, int32_t pitch_y, int32_t width, int32_t height)
+{
+	size_t appended = 0;
+
+	vector_t *last = self->tail;
+	for (int32_t row = 0; row < rows; row += 1) {
+		for (int32_t column = 0; column < columns; column += 1) {
+			if (row == 0 && column == 0)
+				continue;
+
+			int32_t offset_x = column * pitch_x;
+			int32_t offset_y = row * pitch_y;
+			for (vector_t *vector = self->head; vector != NULL; vector = vector->next) {
+				int32_t start_x = vector->start->x + offset_x;
+				int32_t start_y = vector->start->y + offset_y;
+				int32_t end_x = vector->end->x + offset_x;
+				int32_t end_y = vector->end->y + offset_y;
+
+				bool inside = start_x >= 0 && start_x <= width && end_x >= 0 && end_x <= width &&
+				              start_y >= 0 && start_y <= height && end_y >= 0 && end_y <= height;
+				if (inside) {
+					vector_list_append(self, vector_create(start_x, start_y, end_x, end_y));
+					appended += 1;
+				}
+
+				if (vector == last)
+					break;
+			}
+		}
+	}
+
+	return appended;
+}
+
+/**
+ * Move every vector of a list to where a transform places it, dropping the
+ * vectors which leave the area from the origin to width and height.
+ *
+ * @return The number of vectors dropped.
+ */
+size_t vector_list_transform(vector_list_t *self, transform_t *transform, uint32_t resolution, int32_t width, int32_t height)
+{
+	size_t removed = 0;
+
+	vector_t *vector = self->head;
+	while (vector != NULL) {
+		vector_t *next = vector->next;
+
+		transform_point(transform, resolution, &vector->start->x, &vector->start->y);
+		transform_point(transform, resolution, &vector->end->x, &vector->end->y);
+
+		bool inside = vector->start->x >= 0 && vector->start->x <= width && vector->end->x >= 0 && vector->end->x <= width &&
+		              vector->start->y >= 0 && vector->start->y <= height && vector->end->y >= 0 && vector->end->y <= height;
+		if (!inside) {
+			vector_destroy(vector_list_remove(self, vector));
+			removed += 1;
+		}
+
+		vector = next;
+	}
+
+	return removed;
+}
+
 /** Find the closest vector to a given point and remove it from the list.
  *
  * This might reverse a vector if it is closest to draw it in reverse
@@ -170,38 +265,39 @@ vector_list_t *vector_list_optimize(vector_list_t *self)
 		current_point = vector->end;
 	}
 
-	vector_list_stats(list);
-
 	return list;
 }
 
-vector_list_t *vector_list_stats(vector_list_t *self)
+/**
+ * Measure the cuts and the transits between them, starting from the origin,
+ * in the order the list would be output. A transit is counted wherever
+ * output_vector lifts the pen, and lengths are summed before rounding.
+ */
+vector_list_stats_t *vector_list_measure(vector_list_t *self, vector_list_stats_t *stats)
 {
 	int32_t transits = 0;
-	int64_t transit_total = 0;
+	double transit_total = 0.0;
 
 	int32_t cuts = 0;
-	int64_t cut_total = 0;
+	double cut_total = 0.0;
 
 	int32_t current_x = 0;
 	int32_t current_y = 0;
 
 	vector_t *vector = self->head;
 	while (vector) {
-		int32_t transit_dx = current_x - vector->start->x;
-		int32_t transit_dy = current_y - vector->start->y;
-		int64_t transit_length = sqrt(pow(transit_dx, 2) + pow(transit_dy, 2));
-		if (transit_length) {
+		int64_t transit_dx = (int64_t)current_x - vector->start->x;
+		int64_t transit_dy = (int64_t)current_y - vector->start->y;
+		if (transit_dx || transit_dy) {
 			transits += 1;
-			transit_total += transit_length;
+			transit_total += hypot(transit_dx, transit_dy);
 		}
 
-		int64_t cut_dx = vector->start->x - vector->end->x;
-		int64_t cut_dy = vector->start->y - vector->end->y;
-		int64_t cut_length = sqrt(pow(cut_dx, 2) + pow(cut_dy, 2));
-		if (cut_length) {
+		int64_t cut_dx = (int64_t)vector->start->x - vector->end->x;
+		int64_t cut_dy = (int64_t)vector->start->y - vector->end->y;
+		if (cut_dx || cut_dy) {
 			cuts += 1;
-			cut_total += cut_length;
+			cut_total += hypot(cut_dx, cut_dy);
 		}
 
 		current_x = vector->end->x;
@@ -209,8 +305,21 @@ vector_list_t *vector_list_stats(vector_list_t *self)
 		vector = vector->next;
 	}
 
-	printf("Cuts: %"PRId32" len %"PRId64"\n", cuts, cut_total);
-	printf("Move: %"PRId32" len %"PRId64"\n", transits, transit_total);
+	stats->cuts = cuts;
+	stats->cut_length = llround(cut_total);
+	stats->transits = transits;
+	stats->transit_length = llround(transit_total);
+
+	return stats;
+}
+
+vector_list_t *vector_list_stats(vector_list_t *self)
+{
+	vector_list_stats_t stats;
+	vector_list_measure(self, &stats);
+
+	printf("Cuts: %"PRId32" len %"PRId64"\n", stats.cuts, stats.cut_length);
+	printf("Move: %"PRId32" len %"PRId64"\n", stats.transits, stats.transit_length);
 
 	return self;
 }
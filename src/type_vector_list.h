@@ -1,10 +1,12 @@
 #ifndef __PDF2LASER_TYPE_VECTOR_LIST_H__
 #define __PDF2LASER_TYPE_VECTOR_LIST_H__ 1
 
-#include <stdbool.h>      // for bool
-#include <stdint.h>       // for int32_t
-#include "type_point.h"   // for point_t
-#include "type_vector.h"  // for vector_t
+#include <stdbool.h>         // for bool
+#include <stddef.h>          // for size_t
+#include <stdint.h>          // for int32_t, int64_t, uint32_t
+#include "type_point.h"      // for point_t
+#include "type_transform.h"  // for transform_t
+#include "type_vector.h"     // for vector_t
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,16 +22,28 @@ struct vector_list {
 	int32_t length;
 };
 
+typedef struct vector_list_stats vector_list_stats_t;
+struct vector_list_stats {
+	int32_t cuts;
+	int64_t cut_length;
+	int32_t transits;        // moves with the laser off
+	int64_t transit_length;
+};
+
 vector_list_t *vector_list_create(void);
 vector_list_t *vector_list_destroy(vector_list_t *self);
 
 vector_list_t *vector_list_append(vector_list_t *self, vector_t *vector);
 vector_t *vector_list_remove(vector_list_t *self, vector_t *vector);
 int vector_list_contains(vector_list_t *self, vector_t *vector);
+size_t vector_list_dedup(vector_list_t *self);
+size_t vector_list_repeat(vector_list_t *self, int32_t columns, int32_t rows, int32_t pitch_x, int32_t pitch_y, int32_t width, int32_t height);
+size_t vector_list_transform(vector_list_t *self, transform_t *transform, uint32_t resolution, int32_t width, int32_t height);
 
 vector_t *vector_list_find_closest(vector_list_t *list, point_t *point);
 vector_list_t *vector_list_optimize(vector_list_t *self);
 
+vector_list_stats_t *vector_list_measure(vector_list_t *self, vector_list_stats_t *stats);
 vector_list_t *vector_list_stats(vector_list_t *self);
 
 #ifdef __cplusplus